@@ -41,7 +41,8 @@ CHAR strJobHelpText[] =
         "JOB EXITCODE <id>\n"
         "JOB KILL <id>\n"
         "JOB NICE <id>\n"
-        "JOB OUTPUT <id>\n";
+        "JOB OUTPUT <id>\n"
+        "JOB STATS <id>\n";
 
 /**
  Display usage text to the user.
@@ -57,6 +58,67 @@ JobHelp()
     return TRUE;
 }
 
+/**
+ Display a size in bytes in a human readable form, preceded by a label.
+
+ @param Label The label to display.
+
+ @param Size The size, in bytes.
+ */
+VOID
+JobDisplaySize(
+    __in LPCTSTR Label,
+    __in DWORDLONG Size
+    )
+{
+    LARGE_INTEGER liSize;
+    YORI_STRING SizeString;
+    TCHAR SizeStringBuffer[6];
+
+    YoriLibInitEmptyString(&SizeString);
+    SizeString.StartOfString = SizeStringBuffer;
+    SizeString.LengthAllocated = sizeof(SizeStringBuffer)/sizeof(SizeStringBuffer[0]);
+
+    liSize.QuadPart = Size;
+    YoriLibFileSizeToString(&SizeString, &liSize);
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%-16s %y\n"), Label, &SizeString);
+}
+
+/**
+ Display resource usage for a job.
+
+ @param JobId The job to display resource usage for.
+
+ @return TRUE to indicate success, FALSE if resource usage is not available
+         for the job.
+ */
+BOOL
+JobDisplayAccounting(
+    __in DWORD JobId
+    )
+{
+    YORI_LIB_JOB_ACCOUNTING Accounting;
+    DWORDLONG UserTimeInMs;
+    DWORDLONG KernelTimeInMs;
+
+    if (!YoriCallGetJobAccounting(JobId, &Accounting)) {
+        return FALSE;
+    }
+
+    UserTimeInMs = Accounting.UserTime.QuadPart / (10 * 1000);
+    KernelTimeInMs = Accounting.KernelTime.QuadPart / (10 * 1000);
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%-16s %i (%i active)\n"), _T("Processes:"), Accounting.TotalProcesses, Accounting.ActiveProcesses);
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%-16s %lli.%03lli seconds\n"), _T("User time:"), UserTimeInMs / 1000, UserTimeInMs % 1000);
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%-16s %lli.%03lli seconds\n"), _T("Kernel time:"), KernelTimeInMs / 1000, KernelTimeInMs % 1000);
+    JobDisplaySize(_T("Bytes read:"), Accounting.ReadBytes);
+    JobDisplaySize(_T("Bytes written:"), Accounting.WriteBytes);
+    JobDisplaySize(_T("Other IO bytes:"), Accounting.OtherBytes);
+    JobDisplaySize(_T("Peak commit:"), Accounting.PeakJobMemoryUsed);
+
+    return TRUE;
+}
+
 /**
  Builtin command for managing background jobs.
 
@@ -257,6 +319,24 @@ YoriCmd_JOB(
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Output);
             YoriCallFreeYoriString(&Output);
             YoriCallFreeYoriString(&Errors);
+        } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[1], _T("stats")) == 0) {
+            if (ArgC < 3) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Job not specified\n"));
+                return EXIT_FAILURE;
+            }
+            if (!YoriLibStringToNumber(&ArgV[2], TRUE, &llTemp, &CharsConsumed)) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%y is not a valid job.\n"), &ArgV[2]);
+                return EXIT_FAILURE;
+            }
+            JobId = (DWORD)llTemp;
+            if (JobId == 0) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%y is not a valid job.\n"), &ArgV[2]);
+                return EXIT_FAILURE;
+            }
+            if (!JobDisplayAccounting(JobId)) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%i could not return statistics.\n"), JobId);
+                return EXIT_FAILURE;
+            }
         }
     }
     return EXIT_SUCCESS;
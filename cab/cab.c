@@ -35,14 +35,15 @@ CHAR strCabHelpText[] =
         "\n"
         "Compresses files into CAB files or extracts files from CAB files.\n"
         "\n"
-        "CAB [-license] [-b] [-s] -c <cabfile> <files...>\n"
-        "CAB [-license] [-b] [-s] -u <cabfiles...>\n"
-        "CAB [-license] [-b] [-s] -f <files...>\n"
+        "CAB [-license] [-b] [-s] [-t] -c <cabfile> <files...>\n"
+        "CAB [-license] [-b] [-s] [-t] -u <cabfiles...>\n"
+        "CAB [-license] [-b] [-s] [-t] -f <files...>\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -c             Compress files into an archive\n"
         "   -f             Compress each file into its own archive\n"
         "   -s             Copy subdirectories as well as files\n"
+        "   -t             Display the time taken\n"
         "   -u             Uncompress files from an archive\n";
 
 /**
@@ -544,6 +545,9 @@ ENTRYPOINT(
     BOOL Uncompress = FALSE;
     BOOL Recursive = FALSE;
     BOOL BasicEnumeration = FALSE;
+    BOOL DisplayTime = FALSE;
+    DWORD StartTime;
+    DWORD ElapsedTime;
     DWORD i;
     DWORD StartArg = 1;
     DWORD MatchFlags;
@@ -579,6 +583,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("t")) == 0) {
+                DisplayTime = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("u")) == 0) {
                 Compress = FALSE;
                 CompressEachFile = FALSE;
@@ -624,6 +631,8 @@ ENTRYPOINT(
 
     YoriLibEnableBackupPrivilege();
 
+    StartTime = GetTickCount();
+
     if (CompressEachFile) {
         CAB_CREATE_CONTEXT CreateContext;
 
@@ -724,6 +733,14 @@ ENTRYPOINT(
         YoriLibFreeStringContents(&ExpandContext.FullTargetDirectory);
     }
 
+    if (DisplayTime) {
+        ElapsedTime = GetTickCount() - StartTime;
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                      _T("cab: completed in %i.%03i seconds\n"),
+                      ElapsedTime / 1000,
+                      ElapsedTime % 1000);
+    }
+
     return EXIT_SUCCESS;
 }
 
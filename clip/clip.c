@@ -523,7 +523,7 @@ ClipCopyAsText(
 #if defined(_MSC_VER) && (_MSC_VER >= 1700)
 #pragma warning(suppress: 6385)
 #endif
-    YoriLibMultibyteInput(AnsiBuffer, CurrentOffset, pMem, AllocSize);
+    AllocSize = YoriLibMultibyteInput(AnsiBuffer, CurrentOffset, pMem, AllocSize);
 
     pMem[AllocSize] = '\0';
     GlobalUnlock(hMem);
@@ -36,9 +36,10 @@ CHAR strHelpText[] =
         "\n"
         "Multi process compiler wrapper\n"
         "\n"
-        "CLMP [-license] [-MP[n]] <arguments to CL>\n"
+        "CLMP [-license] [-MP[n]] [-MPB] <arguments to CL>\n"
         "\n"
-        "   -MP[n]         Use up to 'n' processes for compilation\n";
+        "   -MP[n]         Use up to 'n' processes for compilation\n"
+        "   -MPB           Display the output of each compilation when it completes\n";
 
 /**
  Display the help and license information for this application.
@@ -87,6 +88,19 @@ typedef struct _CLMP_PIPE_BUFFER {
      The flags to use when outputting anything from this stream.
      */
     DWORD OutputFlags;
+
+    /**
+     If TRUE, lines are collected in Output and displayed when the child
+     process completes.  If FALSE, each line is displayed as it arrives.
+     */
+    BOOLEAN BufferOutput;
+
+    /**
+     Lines collected from this stream which have not yet been displayed.
+     Only used if BufferOutput is TRUE.  The allocation is retained when the
+     process slot is reused.
+     */
+    YORI_STRING Output;
 } CLMP_PIPE_BUFFER, *PCLMP_PIPE_BUFFER;
 
 /**
@@ -111,10 +125,54 @@ typedef struct _CLMP_PROCESS_INFO {
     LPTSTR Filename;
 } CLMP_PROCESS_INFO, *PCLMP_PROCESS_INFO;
 
+/**
+ Append a line to the output collected from a stream.  If memory cannot be
+ allocated, the line is displayed immediately.
+
+ @param Buffer Pointer to the stream.
+
+ @param LineString Pointer to the line to append, which does not include a
+        line ending.
+ */
+VOID
+ClmpAppendLineToBuffer(
+    __in PCLMP_PIPE_BUFFER Buffer,
+    __in PYORI_STRING LineString
+    )
+{
+    DWORD LengthNeeded;
+    DWORD NewLength;
+
+    LengthNeeded = Buffer->Output.LengthInChars + LineString->LengthInChars + 1;
+    if (LengthNeeded > Buffer->Output.LengthAllocated) {
+        NewLength = Buffer->Output.LengthAllocated * 2;
+        if (NewLength < 4096) {
+            NewLength = 4096;
+        }
+        if (NewLength < LengthNeeded) {
+            NewLength = LengthNeeded;
+        }
+        if (!YoriLibReallocateString(&Buffer->Output, NewLength)) {
+            WaitForSingleObject(hOutputMutex, INFINITE);
+            YoriLibOutput(Buffer->OutputFlags, _T("%y\n"), LineString);
+            ReleaseMutex(hOutputMutex);
+            return;
+        }
+    }
+
+    memcpy(&Buffer->Output.StartOfString[Buffer->Output.LengthInChars],
+           LineString->StartOfString,
+           LineString->LengthInChars * sizeof(TCHAR));
+    Buffer->Output.LengthInChars += LineString->LengthInChars;
+    Buffer->Output.StartOfString[Buffer->Output.LengthInChars] = '\n';
+    Buffer->Output.LengthInChars++;
+}
+
 /**
  A worker thread function that fetches entire lines from an input stream,
  and writes them to the current process output stream, with synchronization
- to ensure that each line is written as a line.
+ to ensure that each line is written as a line.  If the output is being
+ buffered, lines are collected to be displayed when the process completes.
 
  @param Param Pointer to a CLMP_PIPE_BUFFER structure indicating a single
         input stream to process.
@@ -137,6 +195,16 @@ ClmpPumpSingleStream(
             break;
         }
 
+        //
+        //  Only this thread accesses the buffer until the process
+        //  completes, so no synchronization is needed to collect output.
+        //
+
+        if (Buffer->BufferOutput) {
+            ClmpAppendLineToBuffer(Buffer, &LineString);
+            continue;
+        }
+
         //
         //  Synchronize with other things writing to output
         //
@@ -190,6 +258,21 @@ ClmpWaitOnProcess (
         }
     }
 
+    //
+    //  If output is being buffered, display everything the process wrote
+    //  now.  Processes are waited on in the order they were launched, so
+    //  output appears in the same order as the source files.
+    //
+
+    for (PipeNum = 0; PipeNum < sizeof(Process->Pipes)/sizeof(Process->Pipes[0]); PipeNum++) {
+        if (Process->Pipes[PipeNum].Output.LengthInChars > 0) {
+            WaitForSingleObject(hOutputMutex, INFINITE);
+            YoriLibOutput(Process->Pipes[PipeNum].OutputFlags, _T("%y"), &Process->Pipes[PipeNum].Output);
+            ReleaseMutex(hOutputMutex);
+            Process->Pipes[PipeNum].Output.LengthInChars = 0;
+        }
+    }
+
 
     //
     //  If a child failed and the parent is still going, fail with
@@ -238,8 +321,11 @@ ymain(
     PCLMP_PROCESS_INFO ProcessInfo;
     DWORD CurrentProcess = 0;
     DWORD NumberProcesses = 0;
+    DWORD DrainProcess;
+    DWORD DrainCount;
     BOOLEAN MultiProcPossible = FALSE;
     BOOLEAN MultiProcNotPossible = FALSE;
+    BOOLEAN BufferOutput = FALSE;
     YORI_STRING Arg;
     SYSTEM_INFO SysInfo;
 
@@ -279,7 +365,9 @@ ymain(
             //
 
             if (YoriLibCompareStringWithLiteralInsensitiveCount(&Arg, _T("MP"), 2) == 0) {
-                if (Arg.LengthInChars > 2) {
+                if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("MPB")) == 0) {
+                    BufferOutput = TRUE;
+                } else if (Arg.LengthInChars > 2) {
                     YORI_STRING NumberProcessesString;
                     LONGLONG LlNumberProcesses;
                     DWORD CharsConsumed;
@@ -433,6 +521,7 @@ ymain(
             }
 
             ProcessInfo[MyProcess].Pipes[0].OutputFlags = YORI_LIB_OUTPUT_STDOUT;
+            ProcessInfo[MyProcess].Pipes[0].BufferOutput = BufferOutput;
 
             ProcessInfo[MyProcess].Pipes[0].hPumpThread = CreateThread(NULL, 0, ClmpPumpSingleStream, &ProcessInfo[MyProcess].Pipes[0], 0, &ThreadId);
             if (ProcessInfo[MyProcess].Pipes[0].hPumpThread == NULL) {
@@ -441,6 +530,7 @@ ymain(
             }
 
             ProcessInfo[MyProcess].Pipes[1].OutputFlags = YORI_LIB_OUTPUT_STDERR;
+            ProcessInfo[MyProcess].Pipes[1].BufferOutput = BufferOutput;
 
             ProcessInfo[MyProcess].Pipes[1].hPumpThread = CreateThread(NULL, 0, ClmpPumpSingleStream, &ProcessInfo[MyProcess].Pipes[1], 0, &ThreadId);
             if (ProcessInfo[MyProcess].Pipes[1].hPumpThread == NULL) {
@@ -501,24 +591,35 @@ drain:
 
     //
     //  Now wait on all of the child processes.  Note that if any
-    //  fail we will also fail with the same error code.
+    //  fail we will also fail with the same error code.  Slots are
+    //  reused in a cycle, so the oldest outstanding process is in the
+    //  slot that would be used next.  Wait from there so that buffered
+    //  output is displayed in the order the processes were launched.
     //
 
-    if (CurrentProcess > NumberProcesses) {
-        CurrentProcess = NumberProcesses;
+    if (CurrentProcess >= NumberProcesses) {
+        DrainCount = NumberProcesses;
+        DrainProcess = CurrentProcess % NumberProcesses;
+    } else {
+        DrainCount = CurrentProcess;
+        DrainProcess = 0;
     }
 
-    do {
-        CurrentProcess--;
-
-        ClmpWaitOnProcess(&ProcessInfo[CurrentProcess]);
-
-    } while (CurrentProcess > 0);
+    for (i = 0; i < DrainCount; i++) {
+        ClmpWaitOnProcess(&ProcessInfo[DrainProcess]);
+        DrainProcess = (DrainProcess + 1) % NumberProcesses;
+    }
 
     if (GlobalExitCode) {
         ExitProcess(GlobalExitCode);
     }
 
+    for (i = 0; i < NumberProcesses; i++) {
+        for (j = 0; j < sizeof(ProcessInfo[i].Pipes)/sizeof(ProcessInfo[i].Pipes[0]); j++) {
+            YoriLibFreeStringContents(&ProcessInfo[i].Pipes[j].Output);
+        }
+    }
+
     YoriLibFree(ProcessInfo);
 
     //
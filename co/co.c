@@ -249,7 +249,149 @@ CoFileFoundCallback(
 }
 
 /**
- Populate in memory structures and the UI list with found files.
+ Compare two found files according to the sort order currently selected.
+
+ @param CoContext Pointer to the context specifying the sort order.
+
+ @param Left Pointer to the first file to compare.
+
+ @param Right Pointer to the second file to compare.
+
+ @return Less than zero if Left should be displayed before Right, greater
+         than zero if Right should be displayed before Left, or zero if
+         they are equivalent.
+ */
+int
+CoCompareFiles(
+    __in PCO_CONTEXT CoContext,
+    __in PCO_FOUND_FILE Left,
+    __in PCO_FOUND_FILE Right
+    )
+{
+    if (CoContext->SortType == CoSortBySize) {
+        if (Left->FileSize.QuadPart < Right->FileSize.QuadPart) {
+            return -1;
+        } else if (Left->FileSize.QuadPart > Right->FileSize.QuadPart) {
+            return 1;
+        }
+        return 0;
+    } else if (CoContext->SortType == CoSortByDate) {
+        if (Left->WriteTime.QuadPart < Right->WriteTime.QuadPart) {
+            return -1;
+        } else if (Left->WriteTime.QuadPart > Right->WriteTime.QuadPart) {
+            return 1;
+        }
+        return 0;
+    }
+
+    return YoriLibCompareStringInsensitive(&Left->DisplayName, &Right->DisplayName);
+}
+
+/**
+ Sort the array of found files according to the sort order currently
+ selected.  This is a merge sort, so large directories can be sorted
+ quickly and files which compare equal retain their enumeration order.
+
+ @param CoContext Pointer to the context containing the array to sort.
+
+ @param Scratch Pointer to an array with as many elements as the array being
+        sorted, used as temporary storage.
+
+ @param Start The index of the first element to sort.
+
+ @param Count The number of elements to sort.
+ */
+VOID
+CoSortFileArray(
+    __in PCO_CONTEXT CoContext,
+    __in PCO_FOUND_FILE *Scratch,
+    __in DWORD Start,
+    __in DWORD Count
+    )
+{
+    PCO_FOUND_FILE *FileArray;
+    DWORD LeftCount;
+    DWORD LeftIndex;
+    DWORD RightIndex;
+    DWORD Index;
+
+    if (Count < 2) {
+        return;
+    }
+
+    LeftCount = Count / 2;
+    CoSortFileArray(CoContext, Scratch, Start, LeftCount);
+    CoSortFileArray(CoContext, Scratch, Start + LeftCount, Count - LeftCount);
+
+    FileArray = CoContext->FileArray;
+
+    //
+    //  If the two halves are already in order, there's nothing to merge.
+    //
+
+    if (CoCompareFiles(CoContext, FileArray[Start + LeftCount - 1], FileArray[Start + LeftCount]) <= 0) {
+        return;
+    }
+
+    memcpy(&Scratch[Start], &FileArray[Start], Count * sizeof(PCO_FOUND_FILE));
+
+    LeftIndex = Start;
+    RightIndex = Start + LeftCount;
+    for (Index = Start; Index < Start + Count; Index++) {
+        if (RightIndex >= Start + Count ||
+            (LeftIndex < Start + LeftCount &&
+             CoCompareFiles(CoContext, Scratch[LeftIndex], Scratch[RightIndex]) <= 0)) {
+
+            FileArray[Index] = Scratch[LeftIndex];
+            LeftIndex++;
+        } else {
+            FileArray[Index] = Scratch[RightIndex];
+            RightIndex++;
+        }
+    }
+}
+
+/**
+ Return the text to display for a found file.  This is invoked by the list
+ control only for the files that it needs to display or search.
+
+ @param CtrlHandle Pointer to the list control.
+
+ @param Context Pointer to the co context.
+
+ @param Index Specifies the index of the file within the sorted array.
+
+ @param Text On successful completion, updated to point to the display name
+        of the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+CoGetItemText(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in PVOID Context,
+    __in DWORD Index,
+    __out PYORI_STRING Text
+    )
+{
+    PCO_CONTEXT CoContext = (PCO_CONTEXT)Context;
+
+    UNREFERENCED_PARAMETER(CtrlHandle);
+
+    if (Index >= CoContext->FilesFoundCount) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(Text);
+    Text->StartOfString = CoContext->FileArray[Index]->DisplayName.StartOfString;
+    Text->LengthInChars = CoContext->FileArray[Index]->DisplayName.LengthInChars;
+    return TRUE;
+}
+
+/**
+ Populate in memory structures and the UI list with found files.  The list
+ control obtains file names from the sorted array as it needs them, so
+ they are not copied into the control.
 
  @param CoContext Pointer to the context to populate with found files.
 
@@ -262,14 +404,10 @@ CoPopulateList(
     )
 {
     YORI_STRING FileSpec;
-    PYORI_STRING DisplayArray;
+    PCO_FOUND_FILE *Scratch;
     DWORD Index;
-    DWORD SubIndex;
-    DWORD BestIndex;
     PYORI_LIST_ENTRY ListEntry;
     PCO_FOUND_FILE FoundFile;
-    PCO_FOUND_FILE CompareFile;
-    PCO_FOUND_FILE BestFile;
 
     YoriLibConstantString(&FileSpec, _T("*"));
     YoriLibForEachFile(&FileSpec, YORILIB_FILEENUM_BASIC_EXPANSION | YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_RETURN_DIRECTORIES | YORILIB_FILEENUM_INCLUDE_DOTFILES, 0, CoFileFoundCallback, NULL, CoContext);
@@ -278,14 +416,15 @@ CoPopulateList(
         return TRUE;
     }
 
-    DisplayArray = YoriLibMalloc(sizeof(YORI_STRING) * CoContext->FilesFoundCount);
-    if (DisplayArray == NULL) {
+    CoContext->FileArray = YoriLibMalloc(sizeof(PCO_FOUND_FILE) * CoContext->FilesFoundCount);
+    if (CoContext->FileArray == NULL) {
         return FALSE;
     }
 
-    CoContext->FileArray = YoriLibMalloc(sizeof(PCO_FOUND_FILE) * CoContext->FilesFoundCount);
-    if (CoContext->FileArray == NULL) {
-        YoriLibDereference(DisplayArray);
+    Scratch = YoriLibMalloc(sizeof(PCO_FOUND_FILE) * CoContext->FilesFoundCount);
+    if (Scratch == NULL) {
+        YoriLibFree(CoContext->FileArray);
+        CoContext->FileArray = NULL;
         return FALSE;
     }
 
@@ -304,54 +443,23 @@ CoPopulateList(
     //  Sort the array based on the selected sort criteria
     //
 
-    for (Index = 0; Index < CoContext->FilesFoundCount; Index++) {
-        FoundFile = CoContext->FileArray[Index];
-        BestFile = FoundFile;
-        BestIndex = Index;
-        for (SubIndex = Index + 1; SubIndex < CoContext->FilesFoundCount; SubIndex++) {
-            CompareFile = CoContext->FileArray[SubIndex];
-            if (CoContext->SortType == CoSortByName) {
-                if (YoriLibCompareStringInsensitive(&CompareFile->DisplayName, &BestFile->DisplayName) < 0) {
-                    BestFile = CompareFile;
-                    BestIndex = SubIndex;
-                }
-            } else if (CoContext->SortType == CoSortBySize) {
-                if (CompareFile->FileSize.QuadPart < BestFile->FileSize.QuadPart) {
-                    BestFile = CompareFile;
-                    BestIndex = SubIndex;
-                }
-            } else if (CoContext->SortType == CoSortByDate) {
-                if (CompareFile->WriteTime.QuadPart < BestFile->WriteTime.QuadPart) {
-                    BestFile = CompareFile;
-                    BestIndex = SubIndex;
-                }
-            }
-        }
-
-        if (BestIndex != Index) {
-            CoContext->FileArray[BestIndex] = CoContext->FileArray[Index];
-            CoContext->FileArray[Index] = BestFile;
-        }
-    }
+    CoSortFileArray(CoContext, Scratch, 0, CoContext->FilesFoundCount);
+    YoriLibFree(Scratch);
 
     //
-    //  Generate the display array string based on the result of the sort
+    //  Point the list at the result
     //
 
-    for (Index = 0; Index < CoContext->FilesFoundCount; Index++) {
-        memcpy(&DisplayArray[Index], &CoContext->FileArray[Index]->DisplayName, sizeof(YORI_STRING));
+    if (!YoriWinListSetDataSource(CoContext->List, CoGetItemText, CoContext, CoContext->FilesFoundCount)) {
+        return FALSE;
     }
 
-    //
-    //  Populate the list with the result
-    //
-
-    if (!YoriWinListAddItems(CoContext->List, DisplayArray, CoContext->FilesFoundCount)) {
-        YoriLibDereference(DisplayArray);
-        return FALSE;
+    if (CoContext->SortType == CoSortByName) {
+        YoriWinListSetItemsSorted(CoContext->List, TRUE);
+    } else {
+        YoriWinListSetItemsSorted(CoContext->List, FALSE);
     }
 
-    YoriLibFree(DisplayArray);
     return TRUE;
 }
 
@@ -204,7 +204,7 @@ DfReportSingleVolume(
                 YoriLibSPrintfS(FindData.cFileName, MAX_PATH, _T("%s"), NameToReport);
             }
             YoriLibConstantString(&YsVolName, VolName);
-            if (!YoriLibFileFiltCheckColorMatch(&DfContext->ColorRules, &YsVolName, &FindData, &Attribute)) {
+            if (!YoriLibFileFiltCheckColorMatch(&DfContext->ColorRules, &YsVolName, &FindData, NULL, &Attribute)) {
                 Attribute.Ctrl = YORILIB_ATTRCTRL_WINDOW_BG | YORILIB_ATTRCTRL_WINDOW_FG;
                 Attribute.Win32Attr = (UCHAR)YoriLibVtGetDefaultColor();
             }
@@ -317,17 +317,26 @@ DirOutputBeginningOfDirectorySummary(
 
     if (DirContext->ColorRules.NumberCriteria) {
         WIN32_FIND_DATA FileInfo;
+        YORI_LIB_FILE_INFO_SESSION Session;
 
         VtAttribute.StartOfString = VtAttributeBuffer;
         VtAttribute.LengthAllocated = sizeof(VtAttributeBuffer)/sizeof(VtAttributeBuffer[0]);
 
-        YoriLibUpdateFindDataFromFileInformation(&FileInfo, DirContext->CurrentDirectoryName.StartOfString, TRUE);
+        //
+        //  Query the directory and evaluate the color rules through one
+        //  session so the directory is only opened once.
+        //
 
-        if (!YoriLibFileFiltCheckColorMatch(&DirContext->ColorRules, &DirContext->CurrentDirectoryName, &FileInfo, &Attribute)) {
+        YoriLibFileInfoSessionInitialize(&Session, FILE_READ_ATTRIBUTES | YoriLibFileFiltGetAccessNeeded(&DirContext->ColorRules));
+        YoriLibFileInfoSessionUpdateFindData(&Session, &FileInfo, &DirContext->CurrentDirectoryName, TRUE);
+
+        if (!YoriLibFileFiltCheckColorMatch(&DirContext->ColorRules, &DirContext->CurrentDirectoryName, &FileInfo, &Session, &Attribute)) {
             Attribute.Ctrl = YORILIB_ATTRCTRL_WINDOW_BG | YORILIB_ATTRCTRL_WINDOW_FG;
             Attribute.Win32Attr = (UCHAR)YoriLibVtGetDefaultColor();
         }
 
+        YoriLibFileInfoSessionCleanup(&Session);
+
         YoriLibVtStringForTextAttribute(&VtAttribute, Attribute.Ctrl, Attribute.Win32Attr);
     }
 
@@ -539,7 +548,7 @@ DirInitializeVtAttributeForFile(
     YORILIB_COLOR_ATTRIBUTES Attribute;
 
     if (DirContext->ColorRules.NumberCriteria) {
-        if (!YoriLibFileFiltCheckColorMatch(&DirContext->ColorRules, FilePath, FileInfo, &Attribute)) {
+        if (!YoriLibFileFiltCheckColorMatch(&DirContext->ColorRules, FilePath, FileInfo, NULL, &Attribute)) {
             Attribute.Ctrl = YORILIB_ATTRCTRL_WINDOW_BG | YORILIB_ATTRCTRL_WINDOW_FG;
             Attribute.Win32Attr = (UCHAR)YoriLibVtGetDefaultColor();
         }
@@ -35,7 +35,7 @@ CHAR strDuHelpText[] =
         "\n"
         "Display disk space used within directories.\n"
         "\n"
-        "DU [-license] [-a] [-b] [-c] [-color] [-d] [-h] [-r <num>] [-s <size>]\n"
+        "DU [-license] [-a] [-b] [-c] [-color] [-d] [-h|-l] [-r <num>] [-s <size>]\n"
         "   [-w] [<spec>...]\n"
         "\n"
         "   -a             Enable all features for maximum accuracy\n"
@@ -44,6 +44,7 @@ CHAR strDuHelpText[] =
         "   -color         Use file color highlighting\n"
         "   -d             Include space used by alternate data streams\n"
         "   -h             Average space used across multiple hard links\n"
+        "   -l             Count space used by hard linked files once\n"
         "   -r <num>       The maximum recursion depth to display\n"
         "   -s <size>      Only display directories containing at least size bytes\n"
         "   -u             Round space up to file allocation unit or cluster size\n"
@@ -113,14 +114,106 @@ typedef struct _DU_DIRECTORY_STACK {
      their enumerations.
      */
     LONGLONG SpaceConsumedInChildren;
+} DU_DIRECTORY_STACK, *PDU_DIRECTORY_STACK;
+
+/**
+ A structure describing a single object found during enumeration.  The space
+ used by the object may be calculated on a worker thread, but objects are
+ added to the directory stack in the order they were found.
+ */
+typedef struct _DU_FILE_ITEM {
+
+    /**
+     The work queue item for this object.
+     */
+    YORI_LIB_WORK_ITEM WorkItem;
+
+    /**
+     A fully specified path to the object.  The buffer for this string
+     follows the structure.
+     */
+    YORI_STRING FilePath;
+
+    /**
+     The recursion depth of the object.
+     */
+    DWORD Depth;
+
+    /**
+     The attributes of the object returned from directory enumerate.
+     */
+    DWORD FileAttributes;
+
+    /**
+     The number of hard links to the file.  This is only populated if
+     hard link information is needed.
+     */
+    DWORD NumberOfLinks;
+
+    /**
+     The serial number of the volume containing the file.  This is only
+     populated if hard link information is needed.
+     */
+    DWORD VolumeSerialNumber;
 
     /**
-     The number of bytes in each file system allocation unit for this
-     directory.  This is only meaningful if AllocationSize reporting is
-     enabled.
+     The identifier of the file within the volume.  This is only populated
+     if hard link information is needed.
+     */
+    LARGE_INTEGER FileId;
+
+    /**
+     The size of the file returned from directory enumerate.
+     */
+    LARGE_INTEGER FileSize;
+
+    /**
+     The number of bytes in each file system allocation unit for the
+     directory containing the file.  This is only meaningful if
+     AllocationSize reporting is enabled.
      */
     LONGLONG AllocationSize;
-} DU_DIRECTORY_STACK, *PDU_DIRECTORY_STACK;
+
+    /**
+     The number of bytes attributable to the file.
+     */
+    LARGE_INTEGER SpaceUsed;
+} DU_FILE_ITEM, *PDU_FILE_ITEM;
+
+/**
+ The number of characters in the key describing a hard linked file, being
+ eight hex digits for the volume serial number and sixteen for the file ID.
+ */
+#define DU_LINKED_FILE_KEY_LENGTH (24)
+
+/**
+ The number of buckets in the hash table of linked files.  A tree can
+ contain many thousands of files with multiple links, and the table is
+ never resized, so this is large.  Since string hashes are 16 bits, more
+ buckets than this would rarely help.
+ */
+#define DU_LINKED_FILE_BUCKETS (16381)
+
+/**
+ A file with multiple hard links whose space has already been counted.
+ */
+typedef struct _DU_LINKED_FILE {
+
+    /**
+     The entry for this file within the hash table of linked files.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     A string form of the volume serial number and file ID.
+     */
+    YORI_STRING Key;
+
+    /**
+     The buffer for the above string.
+     */
+    TCHAR KeyBuffer[DU_LINKED_FILE_KEY_LENGTH + 1];
+} DU_LINKED_FILE, *PDU_LINKED_FILE;
 
 /**
  Context passed to the callback which is invoked for each file found.
@@ -170,6 +263,12 @@ typedef struct _DU_CONTEXT {
      */
     BOOL AverageHardLinkSize;
 
+    /**
+     Count the size of files with multiple hard links once, in the first
+     directory where a link is found.
+     */
+    BOOL ExactHardLinkSize;
+
     /**
      Count space used by alternate data streams on the file.
      */
@@ -206,6 +305,33 @@ typedef struct _DU_CONTEXT {
      */
     YORI_LIB_FILE_FILTER ColorRules;
 
+    /**
+     A hash table of files with multiple hard links whose space has already
+     been counted.  This is only allocated if ExactHardLinkSize is set.
+     */
+    PYORI_HASH_TABLE LinkedFiles;
+
+    /**
+     The most recent directory whose allocation unit size was queried.
+     */
+    YORI_STRING AllocationSizeDirectory;
+
+    /**
+     The allocation unit size of AllocationSizeDirectory.
+     */
+    LONGLONG AllocationSizeForDirectory;
+
+    /**
+     A queue of objects whose space is being calculated on worker threads.
+     This is only used if calculating space requires opening files.
+     */
+    YORI_LIB_WORK_QUEUE WorkQueue;
+
+    /**
+     TRUE if WorkQueue has been initialized.
+     */
+    BOOLEAN WorkQueueActive;
+
 } DU_CONTEXT, *PDU_CONTEXT;
 
 /**
@@ -233,6 +359,24 @@ DuCleanupContext(
     DuContext->StackAllocated = 0;
     DuContext->StackIndex = 0;
     YoriLibFileFiltFreeFilter(&DuContext->ColorRules);
+
+    if (DuContext->LinkedFiles != NULL) {
+        PYORI_HASH_BUCKET Bucket;
+        PDU_LINKED_FILE LinkedFile;
+
+        for (Index = 0; Index < DuContext->LinkedFiles->NumberBuckets; Index++) {
+            Bucket = &DuContext->LinkedFiles->Buckets[Index];
+            while (!YoriLibIsListEmpty(&Bucket->ListHead)) {
+                LinkedFile = CONTAINING_RECORD(Bucket->ListHead.Next, DU_LINKED_FILE, HashEntry.ListEntry);
+                YoriLibHashRemoveByEntry(&LinkedFile->HashEntry);
+                YoriLibDereference(LinkedFile);
+            }
+        }
+        YoriLibFreeEmptyHashTable(DuContext->LinkedFiles);
+        DuContext->LinkedFiles = NULL;
+    }
+
+    YoriLibFreeStringContents(&DuContext->AllocationSizeDirectory);
 }
 
 /**
@@ -322,16 +466,20 @@ DuReportAndCloseStack(
             YoriLibInitEmptyString(&VtAttribute);
             if (DuContext->ColorRules.NumberCriteria) {
                 WIN32_FIND_DATA FileInfo;
+                YORI_LIB_FILE_INFO_SESSION Session;
         
                 VtAttribute.StartOfString = VtAttributeBuffer;
                 VtAttribute.LengthAllocated = sizeof(VtAttributeBuffer)/sizeof(VtAttributeBuffer[0]);
         
-                YoriLibUpdateFindDataFromFileInformation(&FileInfo, DirStack->DirectoryName.StartOfString, TRUE);
+                YoriLibFileInfoSessionInitialize(&Session, FILE_READ_ATTRIBUTES | YoriLibFileFiltGetAccessNeeded(&DuContext->ColorRules));
+                YoriLibFileInfoSessionUpdateFindData(&Session, &FileInfo, &DirStack->DirectoryName, TRUE);
         
-                if (!YoriLibFileFiltCheckColorMatch(&DuContext->ColorRules, &DirStack->DirectoryName, &FileInfo, &Attribute)) {
+                if (!YoriLibFileFiltCheckColorMatch(&DuContext->ColorRules, &DirStack->DirectoryName, &FileInfo, &Session, &Attribute)) {
                     Attribute.Ctrl = YORILIB_ATTRCTRL_WINDOW_BG | YORILIB_ATTRCTRL_WINDOW_FG;
                     Attribute.Win32Attr = (UCHAR)YoriLibVtGetDefaultColor();
                 }
+
+                YoriLibFileInfoSessionCleanup(&Session);
         
                 YoriLibVtStringForTextAttribute(&VtAttribute, Attribute.Ctrl, Attribute.Win32Attr);
             }
@@ -419,10 +567,7 @@ DuInitializeDirectoryStack(
     __in PYORI_STRING DirName
     )
 {
-    DWORD SectorsPerCluster;
-    DWORD BytesPerSector;
-    DWORD NumberOfFreeClusters;
-    DWORD TotalNumberOfClusters;
+    UNREFERENCED_PARAMETER(DuContext);
 
     if (DirStack->DirectoryName.LengthAllocated <= DirName->LengthInChars) {
         YoriLibFreeStringContents(&DirStack->DirectoryName);
@@ -435,72 +580,152 @@ DuInitializeDirectoryStack(
     DirStack->DirectoryName.StartOfString[DirName->LengthInChars] = '\0';
     DirStack->DirectoryName.LengthInChars = DirName->LengthInChars;
 
+    return TRUE;
+}
+
+/**
+ Find the parent directory of an object.
+
+ @param FilePath Pointer to a fully specified path to the object.
+
+ @param ParentName On successful completion, updated to describe the part of
+        FilePath that refers to the parent directory.  This is not NULL
+        terminated.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+DuFindParentDirectory(
+    __in PYORI_STRING FilePath,
+    __out PYORI_STRING ParentName
+    )
+{
+    LPTSTR FilePart;
+
+    YoriLibInitEmptyString(ParentName);
+    FilePart = YoriLibFindRightMostCharacter(FilePath, '\\');
+    if (FilePart == NULL) {
+        return FALSE;
+    }
+
+    ParentName->StartOfString = FilePath->StartOfString;
+    ParentName->LengthInChars = (DWORD)(FilePart - FilePath->StartOfString);
+    if (ParentName->LengthInChars == 6) {
+        ParentName->LengthInChars++;
+        if (!YoriLibIsPrefixedDriveLetterWithColonAndSlash(ParentName)) {
+            ParentName->LengthInChars--;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Determine the file system allocation unit size for the directory containing
+ a file.  Since files are typically found in groups within one directory,
+ the most recent result is cached.
+
+ @param DuContext Pointer to the DU context containing the cached result.
+
+ @param FilePath Pointer to a fully specified path to the file.
+
+ @return The number of bytes in each allocation unit.
+ */
+LONGLONG
+DuGetAllocationSize(
+    __in PDU_CONTEXT DuContext,
+    __in PYORI_STRING FilePath
+    )
+{
+    DWORD SectorsPerCluster;
+    DWORD BytesPerSector;
+    DWORD NumberOfFreeClusters;
+    DWORD TotalNumberOfClusters;
+    YORI_STRING DirName;
+    PYORI_STRING CachedDirName;
+
+    if (!DuFindParentDirectory(FilePath, &DirName)) {
+        return 4096;
+    }
+
+    CachedDirName = &DuContext->AllocationSizeDirectory;
+    if (CachedDirName->LengthInChars > 0 &&
+        YoriLibCompareString(CachedDirName, &DirName) == 0) {
+
+        return DuContext->AllocationSizeForDirectory;
+    }
+
+    if (CachedDirName->LengthAllocated <= DirName.LengthInChars) {
+        YoriLibFreeStringContents(CachedDirName);
+        if (!YoriLibAllocateString(CachedDirName, DirName.LengthInChars + 80)) {
+            return 4096;
+        }
+    }
+
+    memcpy(CachedDirName->StartOfString, DirName.StartOfString, DirName.LengthInChars * sizeof(TCHAR));
+    CachedDirName->StartOfString[DirName.LengthInChars] = '\0';
+    CachedDirName->LengthInChars = DirName.LengthInChars;
+
     //
     //  If GetDiskFreeSpace fails, see if it works on the effective root.
     //  This is to support systems without mount points where this call can
     //  fail when called on a directory.
     //
 
-    if (DuContext->AllocationSize) {
-        if (!GetDiskFreeSpace(DirStack->DirectoryName.StartOfString, &SectorsPerCluster, &BytesPerSector, &NumberOfFreeClusters, &TotalNumberOfClusters)) {
-            YORI_STRING EffectiveRoot;
-
-            DirStack->AllocationSize = 4096;
+    if (!GetDiskFreeSpace(CachedDirName->StartOfString, &SectorsPerCluster, &BytesPerSector, &NumberOfFreeClusters, &TotalNumberOfClusters)) {
+        YORI_STRING EffectiveRoot;
 
-            if (YoriLibFindEffectiveRoot(&DirStack->DirectoryName, &EffectiveRoot) &&
-                EffectiveRoot.LengthInChars < DirStack->DirectoryName.LengthInChars) {
+        DuContext->AllocationSizeForDirectory = 4096;
 
-                TCHAR SavedChar;
-                SavedChar = EffectiveRoot.StartOfString[EffectiveRoot.LengthInChars];
-                EffectiveRoot.StartOfString[EffectiveRoot.LengthInChars] = '\0';
+        if (YoriLibFindEffectiveRoot(CachedDirName, &EffectiveRoot) &&
+            EffectiveRoot.LengthInChars < CachedDirName->LengthInChars) {
 
-                if (GetDiskFreeSpace(EffectiveRoot.StartOfString, &SectorsPerCluster, &BytesPerSector, &NumberOfFreeClusters, &TotalNumberOfClusters)) {
-                    DirStack->AllocationSize = SectorsPerCluster * BytesPerSector;
-                }
+            TCHAR SavedChar;
+            SavedChar = EffectiveRoot.StartOfString[EffectiveRoot.LengthInChars];
+            EffectiveRoot.StartOfString[EffectiveRoot.LengthInChars] = '\0';
 
-                EffectiveRoot.StartOfString[EffectiveRoot.LengthInChars] = SavedChar;
+            if (GetDiskFreeSpace(EffectiveRoot.StartOfString, &SectorsPerCluster, &BytesPerSector, &NumberOfFreeClusters, &TotalNumberOfClusters)) {
+                DuContext->AllocationSizeForDirectory = SectorsPerCluster * BytesPerSector;
             }
 
-        } else {
-            DirStack->AllocationSize = SectorsPerCluster * BytesPerSector;
+            EffectiveRoot.StartOfString[EffectiveRoot.LengthInChars] = SavedChar;
         }
+
+    } else {
+        DuContext->AllocationSizeForDirectory = SectorsPerCluster * BytesPerSector;
     }
 
-    return TRUE;
+    return DuContext->AllocationSizeForDirectory;
 }
 
 /**
  Count the amount of disk space to attribute to a file given the user selected
- options.
+ options.  This can be called on a worker thread, so it must not reference
+ the directory stack.
 
  @param DuContext Context specifying the accounting options to apply.
 
- @param DirStack Pointer to the directory stack indicating the allocation size
-        used for the directory.
-
- @param FilePath Pointer to a fully specified path to the file.
-
- @param FileInfo Pointer to the block of data returned from directory
-        enumerate.
+ @param FileItem Pointer to the file to calculate.  On completion, this is
+        updated with hard link information if it is needed.
 
  @return The number of bytes attributable to the file.
  */
 LARGE_INTEGER
 DuCalculateSpaceUsedByFile(
     __in PDU_CONTEXT DuContext,
-    __in PDU_DIRECTORY_STACK DirStack,
-    __in PYORI_STRING FilePath,
-    __in PWIN32_FIND_DATA FileInfo
+    __inout PDU_FILE_ITEM FileItem
     )
 {
     LARGE_INTEGER FileSize;
+    PYORI_STRING FilePath;
     HANDLE FileHandle = INVALID_HANDLE_VALUE;
     BOOL ForceSizeZero = FALSE;
     BOOL ReportedOpenError = FALSE;
 
     FileSize.QuadPart = 0;
+    FilePath = &FileItem->FilePath;
 
-    if (DuContext->AverageHardLinkSize || DuContext->WimBackedFilesAsZero) {
+    if (DuContext->AverageHardLinkSize || DuContext->ExactHardLinkSize || DuContext->WimBackedFilesAsZero) {
 
         FileHandle = CreateFile(FilePath->StartOfString,
                                 FILE_READ_ATTRIBUTES|SYNCHRONIZE,
@@ -553,12 +778,10 @@ DuCalculateSpaceUsedByFile(
             FileSize.LowPart = DllKernel32.pGetCompressedFileSizeW(FilePath->StartOfString, (PDWORD)&FileSize.HighPart);
     
             if (FileSize.LowPart == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) {
-                FileSize.LowPart = FileInfo->nFileSizeLow;
-                FileSize.HighPart = FileInfo->nFileSizeHigh;
+                FileSize.QuadPart = FileItem->FileSize.QuadPart;
             }
         } else {
-            FileSize.LowPart = FileInfo->nFileSizeLow;
-            FileSize.HighPart = FileInfo->nFileSizeHigh;
+            FileSize.QuadPart = FileItem->FileSize.QuadPart;
         }
     }
 
@@ -567,7 +790,7 @@ DuCalculateSpaceUsedByFile(
     //
 
     if (DuContext->AllocationSize) {
-        FileSize.QuadPart = (FileSize.QuadPart + DirStack->AllocationSize - 1) & (~(DirStack->AllocationSize - 1));
+        FileSize.QuadPart = (FileSize.QuadPart + FileItem->AllocationSize - 1) & (~(FileItem->AllocationSize - 1));
     }
 
     //
@@ -596,7 +819,7 @@ DuCalculateSpaceUsedByFile(
                 if (_tcscmp(FindStreamData.cStreamName, L"::$DATA") != 0) {
                     FileSize.QuadPart += FindStreamData.StreamSize.QuadPart;
                     if (DuContext->AllocationSize) {
-                        FileSize.QuadPart = (FileSize.QuadPart + DirStack->AllocationSize - 1) & (~(DirStack->AllocationSize - 1));
+                        FileSize.QuadPart = (FileSize.QuadPart + FileItem->AllocationSize - 1) & (~(FileItem->AllocationSize - 1));
                     }
                 }
             } while (DllKernel32.pFindNextStreamW(hFind, &FindStreamData));
@@ -606,14 +829,24 @@ DuCalculateSpaceUsedByFile(
 
     //
     //  If the file has a size and hardlink averaging is reuqested, divide the
-    //  size found by the number of hard links.
+    //  size found by the number of hard links.  If exact hard link
+    //  accounting is requested, record the file's identity so that it can
+    //  be counted only once.
     //
 
-    if (DuContext->AverageHardLinkSize && FileHandle != INVALID_HANDLE_VALUE && FileSize.QuadPart != 0) {
+    FileItem->NumberOfLinks = 1;
+    if ((DuContext->AverageHardLinkSize || DuContext->ExactHardLinkSize) &&
+        FileHandle != INVALID_HANDLE_VALUE &&
+        FileSize.QuadPart != 0) {
+
         BY_HANDLE_FILE_INFORMATION HandleFileInfo;
 
         if (GetFileInformationByHandle(FileHandle, &HandleFileInfo)) {
-            if (HandleFileInfo.nNumberOfLinks > 1) {
+            FileItem->NumberOfLinks = HandleFileInfo.nNumberOfLinks;
+            FileItem->VolumeSerialNumber = HandleFileInfo.dwVolumeSerialNumber;
+            FileItem->FileId.LowPart = HandleFileInfo.nFileIndexLow;
+            FileItem->FileId.HighPart = HandleFileInfo.nFileIndexHigh;
+            if (DuContext->AverageHardLinkSize && HandleFileInfo.nNumberOfLinks > 1) {
                 FileSize.QuadPart = FileSize.QuadPart / HandleFileInfo.nNumberOfLinks;
             }
         }
@@ -627,35 +860,88 @@ DuCalculateSpaceUsedByFile(
     return FileSize;
 }
 
+/**
+ Check whether a file with multiple hard links has already been counted.  If
+ it has not, it is recorded so that later links to the file are not counted.
 
+ @param DuContext Pointer to the DU context containing the set of linked
+        files that have been counted.
 
-/**
- A callback that is invoked when a file is found that matches a search criteria
- specified in the set of strings to enumerate.
+ @param FileItem Pointer to the file to check.
 
- @param FilePath Pointer to the file path that was found.
+ @return TRUE if the file has already been counted, FALSE if it has not.
+ */
+BOOL
+DuIsLinkedFileCounted(
+    __in PDU_CONTEXT DuContext,
+    __in PDU_FILE_ITEM FileItem
+    )
+{
+    PDU_LINKED_FILE LinkedFile;
+    YORI_STRING Key;
+    TCHAR KeyBuffer[DU_LINKED_FILE_KEY_LENGTH + 1];
+
+    YoriLibInitEmptyString(&Key);
+    Key.StartOfString = KeyBuffer;
+    Key.LengthAllocated = sizeof(KeyBuffer)/sizeof(KeyBuffer[0]);
+    Key.LengthInChars = YoriLibSPrintfS(Key.StartOfString,
+                                        Key.LengthAllocated,
+                                        _T("%08x%08x%08x"),
+                                        FileItem->VolumeSerialNumber,
+                                        FileItem->FileId.HighPart,
+                                        FileItem->FileId.LowPart);
+
+    if (YoriLibHashLookupByKey(DuContext->LinkedFiles, &Key) != NULL) {
+        return TRUE;
+    }
 
- @param FileInfo Information about the file.
+    //
+    //  If the file can't be recorded, it will be counted again when the
+    //  next link is found, which is the best that can be done.
+    //
 
- @param Depth Recursion depth, ignored in this application.
+    LinkedFile = YoriLibReferencedMalloc(sizeof(DU_LINKED_FILE));
+    if (LinkedFile == NULL) {
+        return FALSE;
+    }
 
- @param Context Pointer to the du context structure indicating the
-        action to perform and populated with the number of objects found.
+    YoriLibInitEmptyString(&LinkedFile->Key);
+    LinkedFile->Key.MemoryToFree = LinkedFile;
+    LinkedFile->Key.StartOfString = LinkedFile->KeyBuffer;
+    LinkedFile->Key.LengthAllocated = sizeof(LinkedFile->KeyBuffer)/sizeof(LinkedFile->KeyBuffer[0]);
+    LinkedFile->Key.LengthInChars = Key.LengthInChars;
+    memcpy(LinkedFile->KeyBuffer, KeyBuffer, sizeof(KeyBuffer));
 
- @return TRUE to continute enumerating, FALSE to abort.
+    YoriLibHashInsertByKey(DuContext->LinkedFiles, &LinkedFile->Key, LinkedFile, &LinkedFile->HashEntry);
+    return FALSE;
+}
+
+/**
+ Add an object to the directory stack, reporting and closing any directories
+ that cannot contain it, and add the space used by the object to its parent
+ directory.  Objects must be added in the order they were found.
+
+ @param DuContext Pointer to the du context structure containing the
+        directory stack.
+
+ @param FileItem Pointer to the object to add, including the space it uses.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
-DuFileFoundCallback(
-    __in PYORI_STRING FilePath,
-    __in PWIN32_FIND_DATA FileInfo,
-    __in DWORD Depth,
-    __in PVOID Context
+DuAccountForObject(
+    __in PDU_CONTEXT DuContext,
+    __in PDU_FILE_ITEM FileItem
     )
 {
-    PDU_CONTEXT DuContext = (PDU_CONTEXT)Context;
+    PYORI_STRING FilePath;
+    DWORD Depth;
     LPTSTR FilePart;
     DWORD Index;
 
+    FilePath = &FileItem->FilePath;
+    Depth = FileItem->Depth;
+
     if (Depth >= DuContext->StackAllocated) {
         PDU_DIRECTORY_STACK NewStack;
         NewStack = YoriLibMalloc((Depth + 8) * sizeof(DU_DIRECTORY_STACK));
@@ -758,15 +1044,158 @@ DuFileFoundCallback(
     DuContext->StackIndex = Depth;
     DuContext->DirStack[Depth].ObjectsFoundThisDirectory++;
 
-    if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
-        LARGE_INTEGER FileSize;
-        FileSize = DuCalculateSpaceUsedByFile(DuContext, &DuContext->DirStack[Depth], FilePath, FileInfo);
-        DuContext->DirStack[Depth].SpaceConsumedThisDirectory += FileSize.QuadPart;
+    if ((FileItem->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+
+        //
+        //  If the file has multiple links and has been counted already,
+        //  don't count it again.  Since objects are added in the order they
+        //  were found, the space is attributed to the first directory where
+        //  the file was found.
+        //
+
+        if (DuContext->ExactHardLinkSize &&
+            FileItem->NumberOfLinks > 1 &&
+            DuIsLinkedFileCounted(DuContext, FileItem)) {
+
+            return TRUE;
+        }
+
+        DuContext->DirStack[Depth].SpaceConsumedThisDirectory += FileItem->SpaceUsed.QuadPart;
     }
 
     return TRUE;
 }
 
+/**
+ Calculate the space used by an object on a worker thread.
+
+ @param Context Pointer to the du context structure indicating the options to
+        apply.
+
+ @param WorkItem Pointer to the work item within the object to calculate.
+
+ @param Cancelled TRUE if the operation has been cancelled, in which case
+        the object is not opened.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+DuCalculateFileItem(
+    __in PVOID Context,
+    __in PYORI_LIB_WORK_ITEM WorkItem,
+    __in BOOL Cancelled
+    )
+{
+    PDU_CONTEXT DuContext = (PDU_CONTEXT)Context;
+    PDU_FILE_ITEM FileItem;
+
+    FileItem = CONTAINING_RECORD(WorkItem, DU_FILE_ITEM, WorkItem);
+    if (!Cancelled && (FileItem->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+        FileItem->SpaceUsed = DuCalculateSpaceUsedByFile(DuContext, FileItem);
+    }
+
+    return TRUE;
+}
+
+/**
+ Add an object whose space has been calculated to the directory stack.  The
+ work queue invokes this on objects in the order they were found, one at a
+ time.
+
+ @param Context Pointer to the du context structure containing the
+        directory stack.
+
+ @param WorkItem Pointer to the work item within the object to add.
+ */
+VOID
+DuCompleteFileItem(
+    __in PVOID Context,
+    __in PYORI_LIB_WORK_ITEM WorkItem
+    )
+{
+    PDU_CONTEXT DuContext = (PDU_CONTEXT)Context;
+    PDU_FILE_ITEM FileItem;
+
+    FileItem = CONTAINING_RECORD(WorkItem, DU_FILE_ITEM, WorkItem);
+    DuAccountForObject(DuContext, FileItem);
+    YoriLibFree(FileItem);
+}
+
+/**
+ A callback that is invoked when a file is found that matches a search criteria
+ specified in the set of strings to enumerate.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.
+
+ @param Depth Recursion depth, ignored in this application.
+
+ @param Context Pointer to the du context structure indicating the
+        action to perform and populated with the number of objects found.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+DuFileFoundCallback(
+    __in PYORI_STRING FilePath,
+    __in PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PDU_CONTEXT DuContext = (PDU_CONTEXT)Context;
+    PDU_FILE_ITEM FileItem;
+    BOOL Result;
+
+    FileItem = YoriLibMalloc(sizeof(DU_FILE_ITEM) + (FilePath->LengthInChars + 1) * sizeof(TCHAR));
+    if (FileItem == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(FileItem, sizeof(DU_FILE_ITEM));
+    YoriLibInitEmptyString(&FileItem->FilePath);
+    FileItem->FilePath.StartOfString = (LPTSTR)(FileItem + 1);
+    FileItem->FilePath.LengthAllocated = FilePath->LengthInChars + 1;
+    FileItem->FilePath.LengthInChars = FilePath->LengthInChars;
+    memcpy(FileItem->FilePath.StartOfString, FilePath->StartOfString, FilePath->LengthInChars * sizeof(TCHAR));
+    FileItem->FilePath.StartOfString[FilePath->LengthInChars] = '\0';
+
+    FileItem->Depth = Depth;
+    FileItem->FileAttributes = FileInfo->dwFileAttributes;
+    FileItem->FileSize.LowPart = FileInfo->nFileSizeLow;
+    FileItem->FileSize.HighPart = FileInfo->nFileSizeHigh;
+    FileItem->NumberOfLinks = 1;
+
+    if (DuContext->AllocationSize &&
+        (FileItem->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+
+        FileItem->AllocationSize = DuGetAllocationSize(DuContext, &FileItem->FilePath);
+    }
+
+    //
+    //  If calculating the space requires opening files, do it on worker
+    //  threads.  The work queue adds objects to the directory stack in the
+    //  order they were found.
+    //
+
+    if (DuContext->WorkQueueActive) {
+        if (!YoriLibWorkQueueSubmit(&DuContext->WorkQueue, &FileItem->WorkItem)) {
+            YoriLibFree(FileItem);
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    if ((FileItem->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+        FileItem->SpaceUsed = DuCalculateSpaceUsedByFile(DuContext, FileItem);
+    }
+
+    Result = DuAccountForObject(DuContext, FileItem);
+    YoriLibFree(FileItem);
+    return Result;
+}
+
 /**
  A callback that is invoked when a directory cannot be successfully enumerated.
 
@@ -867,6 +1296,11 @@ ENTRYPOINT(
                 ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("h")) == 0) {
                 DuContext.AverageHardLinkSize = TRUE;
+                DuContext.ExactHardLinkSize = FALSE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
+                DuContext.AverageHardLinkSize = FALSE;
+                DuContext.ExactHardLinkSize = TRUE;
                 ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
                 if (i + 1 < ArgC) {
@@ -932,10 +1366,36 @@ ENTRYPOINT(
     YoriLibCancelEnable();
 #endif
 
+    if (DuContext.ExactHardLinkSize) {
+        DuContext.LinkedFiles = YoriLibAllocateHashTable(DU_LINKED_FILE_BUCKETS);
+        if (DuContext.LinkedFiles == NULL) {
+            DuCleanupContext(&DuContext);
+            return EXIT_FAILURE;
+        }
+    }
+
+    //
+    //  If calculating space requires opening each file, fan the work out
+    //  across worker threads.  If it doesn't, the information from
+    //  enumeration is sufficient and is faster to process inline.
+    //
+
+    if (DuContext.CompressedFileSize ||
+        DuContext.IncludeNamedStreams ||
+        DuContext.AverageHardLinkSize ||
+        DuContext.ExactHardLinkSize ||
+        DuContext.WimBackedFilesAsZero) {
+
+        if (YoriLibWorkQueueInitialize(&DuContext.WorkQueue, 0, 0, DuCalculateFileItem, DuCompleteFileItem, &DuContext)) {
+            DuContext.WorkQueueActive = TRUE;
+        }
+    }
+
     MatchFlags = YORILIB_FILEENUM_RETURN_FILES |
                  YORILIB_FILEENUM_RETURN_DIRECTORIES |
                  YORILIB_FILEENUM_RECURSE_BEFORE_RETURN |
-                 YORILIB_FILEENUM_NO_LINK_TRAVERSE;
+                 YORILIB_FILEENUM_NO_LINK_TRAVERSE |
+                 YORILIB_FILEENUM_NO_SHORT_NAMES;
     if (BasicEnumeration) {
         MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
     }
@@ -948,14 +1408,25 @@ ENTRYPOINT(
         YORI_STRING FilesInDirectorySpec;
         YoriLibConstantString(&FilesInDirectorySpec, _T("."));
         YoriLibForEachFile(&FilesInDirectorySpec, MatchFlags, 0, DuFileFoundCallback, NULL, &DuContext);
+        if (DuContext.WorkQueueActive) {
+            YoriLibWorkQueueWaitForIdle(&DuContext.WorkQueue);
+        }
         DuReportAndCloseAllActiveStacks(&DuContext, 1);
     } else {
         for (i = StartArg; i < ArgC; i++) {
             YoriLibForEachFile(&ArgV[i], MatchFlags, 0, DuFileFoundCallback, DuFileEnumerateErrorCallback, &DuContext);
+            if (DuContext.WorkQueueActive) {
+                YoriLibWorkQueueWaitForIdle(&DuContext.WorkQueue);
+            }
             DuReportAndCloseAllActiveStacks(&DuContext, 1);
         }
     }
 
+    if (DuContext.WorkQueueActive) {
+        YoriLibWorkQueueCleanup(&DuContext.WorkQueue);
+        DuContext.WorkQueueActive = FALSE;
+    }
+
     DuCleanupContext(&DuContext);
 
     return EXIT_SUCCESS;
@@ -102,14 +102,119 @@ typedef struct _EDIT_CONTEXT {
      */
     DWORD Encoding;
 
+    /**
+     A handle to a background thread which is reading the file being opened
+     and decoding its lines.  NULL if no load is in progress.
+     */
+    HANDLE LoadThread;
+
+    /**
+     A handle to the file being read by LoadThread.  This handle is owned by
+     the load thread and closed when the load is cleaned up.
+     */
+    HANDLE LoadFileHandle;
+
+    /**
+     A mutex synchronizing LoadedBatchList, FirstLineEnding and LoadComplete
+     between the load thread and the UI thread.
+     */
+    HANDLE LoadMutex;
+
+    /**
+     An event signalled by the load thread when lines have been added to
+     LoadedBatchList.  This is registered with the window manager so lines
+     are added to the control by the UI thread as they arrive.
+     */
+    HANDLE LoadBatchReadyEvent;
+
+    /**
+     An event signalled by the UI thread to indicate that the load thread
+     should stop reading the file.
+     */
+    HANDLE LoadShutdownEvent;
+
+    /**
+     A list of EDIT_LOAD_BATCH structures containing lines that have been
+     decoded by the load thread but not yet added to the control.
+     */
+    YORI_LIST_ENTRY LoadedBatchList;
+
+    /**
+     The number of lines from the current load that have been added to the
+     control.
+     */
+    DWORD LinesLoaded;
+
+    /**
+     If nonzero, the one based line number that the user navigated to before
+     it had been loaded.  The cursor is moved there once it arrives.
+     */
+    DWORD PendingGoToLine;
+
+    /**
+     The line ending of the first line that was found by the load thread.
+     */
+    YORI_LIB_LINE_ENDING FirstLineEnding;
+
     /**
      TRUE if the search should be case sensitive.  FALSE if it should be case
      insensitive.
      */
     BOOLEAN SearchMatchCase;
 
+    /**
+     TRUE if the load thread has finished reading the file and will not
+     add any more lines to LoadedBatchList.
+     */
+    BOOLEAN LoadComplete;
+
 } EDIT_CONTEXT, *PEDIT_CONTEXT;
 
+/**
+ The number of lines in the first batch handed from the load thread to the
+ UI thread.  This is kept small so the first screen can be displayed
+ quickly.
+ */
+#define EDIT_LOAD_INITIAL_BATCH_LINES (0x100)
+
+/**
+ The maximum number of lines in a batch handed from the load thread to the
+ UI thread.  Batches double in size until they reach this value, which keeps
+ the number of UI thread wakeups low for large files while keeping each
+ merge short enough that the UI remains responsive and a cancel is noticed
+ quickly.
+ */
+#define EDIT_LOAD_MAXIMUM_BATCH_LINES (0x1000)
+
+/**
+ A set of lines that have been read and decoded by the load thread and are
+ waiting to be added to the multiline edit control.
+ */
+typedef struct _EDIT_LOAD_BATCH {
+
+    /**
+     Linkage of this batch on EDIT_CONTEXT::LoadedBatchList.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The number of lines populated in LineArray.
+     */
+    DWORD LineCount;
+
+    /**
+     The number of lines allocated in LineArray.
+     */
+    DWORD LinesAllocated;
+
+    /**
+     An array of lines.  This points into the same allocation as this
+     structure.
+     */
+    PYORI_STRING LineArray;
+
+} EDIT_LOAD_BATCH, *PEDIT_LOAD_BATCH;
+
 /**
  Global context for the edit application.
  */
@@ -156,21 +261,104 @@ EditUpdateOpenedFileCaption(
 }
 
 /**
- Process a single opened stream, enumerating through all lines and populating
- the multiline edit control with the contents.
+ Allocate a batch of lines for the load thread to populate.
+
+ @param LineCount The number of lines the batch should have space for.
+
+ @return Pointer to the batch, or NULL on allocation failure.
+ */
+PEDIT_LOAD_BATCH
+EditAllocateLoadBatch(
+    __in DWORD LineCount
+    )
+{
+    PEDIT_LOAD_BATCH Batch;
+
+    Batch = YoriLibMalloc(sizeof(EDIT_LOAD_BATCH) + LineCount * sizeof(YORI_STRING));
+    if (Batch == NULL) {
+        return NULL;
+    }
+
+    Batch->LineCount = 0;
+    Batch->LinesAllocated = LineCount;
+    Batch->LineArray = (PYORI_STRING)(Batch + 1);
+    return Batch;
+}
+
+/**
+ Free a batch of lines, including the lines within it.  This is used for
+ batches whose lines have not been handed to the multiline edit control.
+
+ @param Batch Pointer to the batch to free.
+ */
+VOID
+EditFreeLoadBatch(
+    __in PEDIT_LOAD_BATCH Batch
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < Batch->LineCount; Index++) {
+        YoriLibFreeStringContents(&Batch->LineArray[Index]);
+    }
+
+    YoriLibFree(Batch);
+}
+
+/**
+ Hand a batch of lines from the load thread to the UI thread, and optionally
+ indicate that loading is complete.
 
  @param EditContext Pointer to the edit context.
 
- @param hSource The opened source stream.
+ @param Batch Optionally points to a batch of lines to hand to the UI thread.
 
- @return TRUE to indicate success, FALSE to indicate failure.
+ @param FirstLineEnding The line ending of the first line in the file.
+
+ @param LoadComplete TRUE if the load thread will not supply any more lines.
  */
-BOOLEAN
-EditPopulateFromStream(
+VOID
+EditQueueLoadBatch(
     __in PEDIT_CONTEXT EditContext,
-    __in HANDLE hSource
+    __in_opt PEDIT_LOAD_BATCH Batch,
+    __in YORI_LIB_LINE_ENDING FirstLineEnding,
+    __in BOOLEAN LoadComplete
     )
 {
+    if (Batch != NULL && Batch->LineCount == 0) {
+        YoriLibFree(Batch);
+        Batch = NULL;
+    }
+
+    WaitForSingleObject(EditContext->LoadMutex, INFINITE);
+    if (Batch != NULL) {
+        YoriLibAppendList(&EditContext->LoadedBatchList, &Batch->ListEntry);
+    }
+    EditContext->FirstLineEnding = FirstLineEnding;
+    if (LoadComplete) {
+        EditContext->LoadComplete = TRUE;
+    }
+    ReleaseMutex(EditContext->LoadMutex);
+
+    SetEvent(EditContext->LoadBatchReadyEvent);
+}
+
+/**
+ A background thread that reads the file being opened, decodes its lines,
+ and hands them to the UI thread in batches.  The first batch is small so
+ the window can display the start of the file immediately, and later batches
+ grow so that large files don't wake the UI thread excessively.
+
+ @param Context Pointer to the EDIT_CONTEXT.
+
+ @return DWORD, ignored.
+ */
+DWORD WINAPI
+EditLoadThread(
+    __in LPVOID Context
+    )
+{
+    PEDIT_CONTEXT EditContext = (PEDIT_CONTEXT)Context;
     PVOID LineContext = NULL;
     YORI_STRING LineString;
     PTCHAR NewLine;
@@ -180,26 +368,32 @@ EditPopulateFromStream(
     DWORD BytesRemainingInBuffer = 0;
     DWORD BufferOffset = 0;
     DWORD Alignment;
-    BOOLEAN Result;
-    DWORD LinesAllocated;
-    DWORD LinesPopulated;
-    PYORI_STRING LineArray;
+    DWORD BatchSize;
+    PEDIT_LOAD_BATCH Batch;
+    PYORI_STRING Line;
     YORI_LIB_LINE_ENDING FirstLineEnding;
     YORI_LIB_LINE_ENDING LineEnding;
     BOOL TimeoutReached;
 
-    LineArray = NULL;
-    LinesAllocated = 0;
-    LinesPopulated = 0;
-
+    Batch = NULL;
+    BatchSize = EDIT_LOAD_INITIAL_BATCH_LINES;
     FirstLineEnding = YoriLibLineEndingNone;
 
     YoriLibInitEmptyString(&LineString);
-    Result = TRUE;
+
+    //
+    //  Decode in the encoding of this file without changing the encoding
+    //  used by the rest of the process.
+    //
+
+    if (!YoriLibLineReadCreateContext(EditContext->Encoding, &LineContext)) {
+        EditQueueLoadBatch(EditContext, NULL, FirstLineEnding, TRUE);
+        return 0;
+    }
 
     while (TRUE) {
 
-        if (!YoriLibReadLineToStringEx(&LineString, &LineContext, TRUE, INFINITE, hSource, &LineEnding, &TimeoutReached)) {
+        if (!YoriLibReadLineToStringEx(&LineString, &LineContext, TRUE, INFINITE, EditContext->LoadFileHandle, &LineEnding, &TimeoutReached)) {
             break;
         }
 
@@ -236,39 +430,15 @@ EditPopulateFromStream(
 
             Buffer = YoriLibReferencedMalloc(BytesRemainingInBuffer);
             if (Buffer == NULL) {
-                Result = FALSE;
                 break;
             }
         }
 
-        //
-        //  See if more lines in the line array need to be allocated
-        //
-
-        if (LinesPopulated == LinesAllocated) {
-            PYORI_STRING NewLineArray;
-            DWORD NewLineCount;
-
-            NewLineCount = LinesAllocated * 2;
-            if (NewLineCount < 0x1000) {
-                NewLineCount = 0x1000;
-            }
-
-            NewLineArray = YoriLibReferencedMalloc(NewLineCount * sizeof(YORI_STRING));
-            if (NewLineArray == NULL) {
-                Result = FALSE;
+        if (Batch == NULL) {
+            Batch = EditAllocateLoadBatch(BatchSize);
+            if (Batch == NULL) {
                 break;
             }
-
-            if (LinesPopulated > 0) {
-                memcpy(NewLineArray, LineArray, LinesPopulated * sizeof(YORI_STRING));
-            }
-
-            if (LineArray != NULL) {
-                YoriLibDereference(LineArray);
-            }
-            LineArray = NewLineArray;
-            LinesAllocated = NewLineCount;
         }
 
         //
@@ -278,22 +448,37 @@ EditPopulateFromStream(
         NewLine = (PTCHAR)YoriLibAddToPointer(Buffer, BufferOffset);
         YoriLibReference(Buffer);
 
-        LineArray[LinesPopulated].MemoryToFree = Buffer;
-        LineArray[LinesPopulated].StartOfString = NewLine;
-        LineArray[LinesPopulated].LengthAllocated = BytesRequired / sizeof(TCHAR);
-        LineArray[LinesPopulated].LengthInChars = LineArray[LinesPopulated].LengthAllocated - 1;
+        Line = &Batch->LineArray[Batch->LineCount];
+        Line->MemoryToFree = Buffer;
+        Line->StartOfString = NewLine;
+        Line->LengthAllocated = BytesRequired / sizeof(TCHAR);
+        Line->LengthInChars = Line->LengthAllocated - 1;
 
         memcpy(NewLine, LineString.StartOfString, LineString.LengthInChars * sizeof(TCHAR));
         NewLine[LineString.LengthInChars] = '\0';
 
-        LinesPopulated++;
+        Batch->LineCount++;
+
+        BufferOffset += BytesAfterAlignment;
+        BytesRemainingInBuffer -= BytesAfterAlignment;
 
         //
-        //  Align to 8 bytes for the next line.
+        //  If the batch is full, give it to the UI thread and check whether
+        //  the UI thread wants the load to stop.
         //
 
-        BufferOffset += BytesAfterAlignment;
-        BytesRemainingInBuffer -= BytesAfterAlignment;
+        if (Batch->LineCount == Batch->LinesAllocated) {
+            EditQueueLoadBatch(EditContext, Batch, FirstLineEnding, FALSE);
+            Batch = NULL;
+
+            if (BatchSize < EDIT_LOAD_MAXIMUM_BATCH_LINES) {
+                BatchSize = BatchSize * 2;
+            }
+
+            if (WaitForSingleObject(EditContext->LoadShutdownEvent, 0) == WAIT_OBJECT_0) {
+                break;
+            }
+        }
     }
 
     if (Buffer != NULL) {
@@ -303,39 +488,269 @@ EditPopulateFromStream(
     YoriLibLineReadClose(LineContext);
     YoriLibFreeStringContents(&LineString);
 
-    if (Result == FALSE) {
-        while (LinesPopulated > 0) {
-            YoriLibFreeStringContents(&LineArray[LinesPopulated - 1]);
-            LinesPopulated--;
+    EditQueueLoadBatch(EditContext, Batch, FirstLineEnding, TRUE);
+
+    return 0;
+}
+
+/**
+ Clean up the state associated with loading a file once the load thread has
+ terminated.  Any lines which were not added to the control are discarded.
+
+ @param EditContext Pointer to the edit context.
+ */
+VOID
+EditCleanupLoad(
+    __in PEDIT_CONTEXT EditContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PEDIT_LOAD_BATCH Batch;
+
+    if (EditContext->LoadBatchReadyEvent != NULL) {
+        YoriWinMgrUnregisterWaitObject(EditContext->WinMgr, EditContext->LoadBatchReadyEvent);
+        CloseHandle(EditContext->LoadBatchReadyEvent);
+        EditContext->LoadBatchReadyEvent = NULL;
+    }
+
+    if (EditContext->LoadThread != NULL) {
+        CloseHandle(EditContext->LoadThread);
+        EditContext->LoadThread = NULL;
+    }
+
+    if (EditContext->LoadShutdownEvent != NULL) {
+        CloseHandle(EditContext->LoadShutdownEvent);
+        EditContext->LoadShutdownEvent = NULL;
+    }
+
+    if (EditContext->LoadMutex != NULL) {
+        CloseHandle(EditContext->LoadMutex);
+        EditContext->LoadMutex = NULL;
+    }
+
+    if (EditContext->LoadFileHandle != NULL) {
+        CloseHandle(EditContext->LoadFileHandle);
+        EditContext->LoadFileHandle = NULL;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&EditContext->LoadedBatchList, NULL);
+    while (ListEntry != NULL) {
+        Batch = CONTAINING_RECORD(ListEntry, EDIT_LOAD_BATCH, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&EditContext->LoadedBatchList, ListEntry);
+        YoriLibRemoveListItem(&Batch->ListEntry);
+        EditFreeLoadBatch(Batch);
+    }
+
+    EditContext->PendingGoToLine = 0;
+}
+
+/**
+ Add any lines that the load thread has decoded into the multiline edit
+ control.  If the load thread has completed, clean up the load state.
+
+ @param EditContext Pointer to the edit context.
+ */
+VOID
+EditDrainLoadedLines(
+    __in PEDIT_CONTEXT EditContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PEDIT_LOAD_BATCH Batch;
+    YORI_LIB_LINE_ENDING FirstLineEnding;
+    BOOLEAN LoadComplete;
+    DWORD LineCount;
+
+    if (EditContext->LoadThread == NULL) {
+        return;
+    }
+
+    while (TRUE) {
+        WaitForSingleObject(EditContext->LoadMutex, INFINITE);
+        ListEntry = YoriLibGetNextListEntry(&EditContext->LoadedBatchList, NULL);
+        if (ListEntry != NULL) {
+            YoriLibRemoveListItem(ListEntry);
+        }
+        FirstLineEnding = EditContext->FirstLineEnding;
+        LoadComplete = EditContext->LoadComplete;
+        ReleaseMutex(EditContext->LoadMutex);
+
+        if (ListEntry == NULL) {
+            break;
         }
 
-        if (LineArray != NULL) {
-            YoriLibDereference(LineArray);
+        Batch = CONTAINING_RECORD(ListEntry, EDIT_LOAD_BATCH, ListEntry);
+
+        //
+        //  Use the line ending from the file when the first lines arrive.
+        //
+
+        if (EditContext->LinesLoaded == 0) {
+            YoriLibConstantString(&EditContext->Newline, _T("\r\n"));
+            if (FirstLineEnding == YoriLibLineEndingLF) {
+                YoriLibConstantString(&EditContext->Newline, _T("\n"));
+            } else if (FirstLineEnding == YoriLibLineEndingCR) {
+                YoriLibConstantString(&EditContext->Newline, _T("\r"));
+            }
         }
 
-        return FALSE;
+        if (YoriWinMultilineEditAppendLinesNoDataCopy(EditContext->MultilineEdit, Batch->LineArray, Batch->LineCount)) {
+            EditContext->LinesLoaded += Batch->LineCount;
+            YoriLibFree(Batch);
+        } else {
+            EditFreeLoadBatch(Batch);
+        }
     }
 
-    if (LinesPopulated > 0) {
-        YoriWinMultilineEditAppendLinesNoDataCopy(EditContext->MultilineEdit, LineArray, LinesPopulated);
+    //
+    //  If the user asked to go to a line that had not been loaded, and it
+    //  has been loaded now, go there.
+    //
 
-        YoriLibConstantString(&EditContext->Newline, _T("\r\n"));
-        if (FirstLineEnding == YoriLibLineEndingLF) {
-            YoriLibConstantString(&EditContext->Newline, _T("\n"));
-        } else if (FirstLineEnding == YoriLibLineEndingCR) {
-            YoriLibConstantString(&EditContext->Newline, _T("\r"));
+    if (EditContext->PendingGoToLine != 0) {
+        LineCount = YoriWinMultilineEditGetLineCount(EditContext->MultilineEdit);
+        if (EditContext->PendingGoToLine <= LineCount || LoadComplete) {
+            if (EditContext->PendingGoToLine > LineCount && LineCount > 0) {
+                EditContext->PendingGoToLine = LineCount;
+            }
+            YoriWinMultilineEditSetCursorLocation(EditContext->MultilineEdit, 0, EditContext->PendingGoToLine - 1);
+            EditContext->PendingGoToLine = 0;
         }
     }
 
-    if (LineArray != NULL) {
-        YoriLibDereference(LineArray);
+    if (LoadComplete) {
+        WaitForSingleObject(EditContext->LoadThread, INFINITE);
+        EditCleanupLoad(EditContext);
+    }
+}
+
+/**
+ A callback invoked by the window manager when the load thread indicates
+ that more lines are available.
+
+ @param WinMgrHandle Pointer to the window manager.
+
+ @param Object The event that was signalled.
+ */
+VOID
+EditLoadBatchReady(
+    __in PYORI_WIN_WINDOW_MANAGER_HANDLE WinMgrHandle,
+    __in HANDLE Object
+    )
+{
+    UNREFERENCED_PARAMETER(WinMgrHandle);
+    UNREFERENCED_PARAMETER(Object);
+
+    EditDrainLoadedLines(&GlobalEditContext);
+}
+
+/**
+ If a file is being loaded, stop loading it and discard any lines that have
+ not been added to the control.
+
+ @param EditContext Pointer to the edit context.
+ */
+VOID
+EditCancelLoad(
+    __in PEDIT_CONTEXT EditContext
+    )
+{
+    if (EditContext->LoadThread == NULL) {
+        return;
+    }
+
+    SetEvent(EditContext->LoadShutdownEvent);
+    WaitForSingleObject(EditContext->LoadThread, INFINITE);
+    EditCleanupLoad(EditContext);
+}
+
+/**
+ If a file is being loaded, wait for the load to complete and add all of its
+ lines to the control.  This is used by operations that need the entire file
+ to be present, such as saving.
+
+ @param EditContext Pointer to the edit context.
+ */
+VOID
+EditWaitForLoad(
+    __in PEDIT_CONTEXT EditContext
+    )
+{
+    if (EditContext->LoadThread == NULL) {
+        return;
+    }
+
+    WaitForSingleObject(EditContext->LoadThread, INFINITE);
+    EditDrainLoadedLines(EditContext);
+}
+
+/**
+ Start loading an opened file into the multiline edit control.  The file is
+ read by a background thread so the window remains responsive, and lines are
+ added to the control as they are decoded.
+
+ @param EditContext Pointer to the edit context.
+
+ @param hSource The opened source file.  On success, ownership of this handle
+        is transferred to the load, which will close it.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+EditStartLoad(
+    __in PEDIT_CONTEXT EditContext,
+    __in HANDLE hSource
+    )
+{
+    DWORD ThreadId;
+
+    ASSERT(EditContext->LoadThread == NULL);
+
+    YoriLibInitializeListHead(&EditContext->LoadedBatchList);
+    EditContext->LinesLoaded = 0;
+    EditContext->PendingGoToLine = 0;
+    EditContext->FirstLineEnding = YoriLibLineEndingNone;
+    EditContext->LoadComplete = FALSE;
+
+    EditContext->LoadMutex = CreateMutex(NULL, FALSE, NULL);
+    if (EditContext->LoadMutex == NULL) {
+        EditCleanupLoad(EditContext);
+        return FALSE;
+    }
+
+    EditContext->LoadShutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (EditContext->LoadShutdownEvent == NULL) {
+        EditCleanupLoad(EditContext);
+        return FALSE;
     }
 
-    return Result;
+    EditContext->LoadBatchReadyEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (EditContext->LoadBatchReadyEvent == NULL) {
+        EditCleanupLoad(EditContext);
+        return FALSE;
+    }
+
+    if (!YoriWinMgrRegisterWaitObject(EditContext->WinMgr, EditContext->LoadBatchReadyEvent, EditLoadBatchReady)) {
+        CloseHandle(EditContext->LoadBatchReadyEvent);
+        EditContext->LoadBatchReadyEvent = NULL;
+        EditCleanupLoad(EditContext);
+        return FALSE;
+    }
+
+    EditContext->LoadFileHandle = hSource;
+    EditContext->LoadThread = CreateThread(NULL, 0, EditLoadThread, EditContext, 0, &ThreadId);
+    if (EditContext->LoadThread == NULL) {
+        EditContext->LoadFileHandle = NULL;
+        EditCleanupLoad(EditContext);
+        return FALSE;
+    }
+
+    return TRUE;
 }
 
 /**
- Load the contents of the specified file into the edit window.
+ Load the contents of the specified file into the edit window.  The file
+ continues to load in the background after this function returns.
 
  @param EditContext Pointer to the edit context.
 
@@ -350,7 +765,6 @@ EditLoadFile(
     )
 {
     HANDLE hFile;
-    DWORD SavedEncoding;
 
     if (FileName->StartOfString == NULL) {
         return FALSE;
@@ -363,12 +777,12 @@ EditLoadFile(
         return FALSE;
     }
 
+    EditCancelLoad(EditContext);
     YoriWinMultilineEditClear(EditContext->MultilineEdit);
-    SavedEncoding = YoriLibGetMultibyteInputEncoding();
-    YoriLibSetMultibyteInputEncoding(EditContext->Encoding);
-    EditPopulateFromStream(EditContext, hFile);
-    YoriLibSetMultibyteInputEncoding(SavedEncoding);
-    CloseHandle(hFile);
+    if (!EditStartLoad(EditContext, hFile)) {
+        CloseHandle(hFile);
+        return FALSE;
+    }
     return TRUE;
 }
 
@@ -403,6 +817,12 @@ EditSaveFile(
 
     ASSERT(YoriLibIsStringNullTerminated(FileName));
 
+    //
+    //  Make sure the entire file has been loaded before writing it out.
+    //
+
+    EditWaitForLoad(EditContext);
+
     //
     //  Find the parent directory of the user specified file so a temporary
     //  file can be created in the same directory.  This is done to increase
@@ -587,6 +1007,7 @@ EditNewButtonClicked(
         return;
     }
 
+    EditCancelLoad(EditContext);
     YoriWinMultilineEditClear(EditContext->MultilineEdit);
     YoriLibFreeStringContents(&EditContext->OpenFileName);
     EditUpdateOpenedFileCaption(EditContext);
@@ -1263,6 +1684,12 @@ EditChangeButtonClicked(
     MatchCase = FALSE;
     MatchFound = FALSE;
 
+    //
+    //  Changes can apply to the whole file, so make sure it's all there.
+    //
+
+    EditWaitForLoad(EditContext);
+
     YoriWinMultilineEditGetCursorLocation(EditContext->MultilineEdit, &StartOffset, &StartLine);
 
     while(TRUE) {
@@ -1443,6 +1870,18 @@ EditGoToLineButtonClicked(
             NewLine--;
         }
 
+        //
+        //  If the requested line hasn't been loaded yet, move as far as
+        //  possible now and finish the move when the line arrives.
+        //
+
+        EditContext->PendingGoToLine = 0;
+        if (EditContext->LoadThread != NULL &&
+            NewLine >= YoriWinMultilineEditGetLineCount(EditContext->MultilineEdit)) {
+
+            EditContext->PendingGoToLine = NewLine + 1;
+        }
+
         YoriWinMultilineEditSetCursorLocation(EditContext->MultilineEdit, 0, NewLine);
     }
 
@@ -1852,6 +2291,7 @@ EditCreateMainWindow(
     Result = FALSE;
     YoriWinProcessInputForWindow(Parent, &Result);
 
+    EditCancelLoad(EditContext);
     YoriWinDestroyWindow(Parent);
     YoriWinCloseWindowManager(WinMgr);
     return (BOOL)Result;
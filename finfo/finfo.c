@@ -1405,6 +1405,7 @@ FInfoFileFoundCallback(
     WIN32_FIND_DATA LocalFileInfo;
     PWIN32_FIND_DATA FileInfoToUse;
     PFINFO_CONTEXT FInfoContext;
+    YORI_LIB_FILE_INFO_SESSION Session;
 
     UNREFERENCED_PARAMETER(Depth);
     ASSERT(YoriLibIsStringNullTerminated(FilePath));
@@ -1424,8 +1425,21 @@ FInfoFileFoundCallback(
     FInfoContext->FilesFound++;
     FInfoContext->FilesFoundThisArg++;
 
+    //
+    //  Share a handle to the file between all of the variables being
+    //  displayed.  The access needed isn't known until variables are
+    //  expanded, so the session will reopen the file if a variable needs
+    //  more than attribute access.
+    //
+
+    YoriLibFileInfoSessionInitialize(&Session, FILE_READ_ATTRIBUTES);
+    FInfoContext->Entry.Session = &Session;
+
     YoriLibInitEmptyString(&DisplayString);
     YoriLibExpandCommandVariables(&FInfoContext->FormatString, '$', TRUE, FInfoExpandVariables, FInfoContext, &DisplayString);
+
+    FInfoContext->Entry.Session = NULL;
+    YoriLibFileInfoSessionCleanup(&Session);
     if (DisplayString.StartOfString != NULL) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &DisplayString);
         YoriLibFreeStringContents(&DisplayString);
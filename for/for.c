@@ -37,8 +37,8 @@ const
 CHAR strForHelpText[] =
         "Enumerates through a list of strings or files.\n"
         "\n"
-        "FOR [-license] [-b] [-c] [-d] [-i <criteria>] [-p n] [-r] <var> in (<list>)\n"
-        "    do <cmd>\n"
+        "FOR [-license] [-b] [-c] [-d] [-i <criteria>] [-p n] [-r] [-t] <var> in\n"
+        "    (<list>) do <cmd>\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -c             Use cmd as a subshell rather than Yori\n"
@@ -47,6 +47,7 @@ CHAR strForHelpText[] =
         "   -l             Use (start,step,end) notation for the list\n"
         "   -p <n>         Execute with <n> concurrent processes\n"
         "   -r             Look for matches in subdirectories under the current directory\n"
+        "   -t             Display the number of items processed and the rate\n"
         "\n"
         " The -i option will match files only if they meet criteria.  This is a\n"
         " semicolon delimited list of entries matching the following form:\n"
@@ -109,16 +110,66 @@ typedef struct _FOR_EXEC_CONTEXT {
     DWORD TargetConcurrentCount;
 
     /**
-     The number of processes that are currently running as a result of this
-     program.
+     The number of worker threads that have been created.  Each worker
+     thread runs one process at a time.  Workers are only used if
+     TargetConcurrentCount is greater than one.
      */
-    DWORD CurrentConcurrentCount;
+    DWORD WorkerCount;
 
     /**
-     An array of handles with CurrentConcurrentCount number of valid
-     elements.  These correspond to processes that are currently running.
+     An array of TargetConcurrentCount handles, WorkerCount of which refer
+     to worker threads.
      */
-    PHANDLE HandleArray;
+    PHANDLE WorkerThreads;
+
+    /**
+     A mutex which synchronizes access to the queue of command lines.
+     */
+    HANDLE QueueMutex;
+
+    /**
+     A semaphore which is signalled once for each command line added to the
+     queue, and once for each worker when no more command lines will be
+     added.
+     */
+    HANDLE QueueItemsAvailable;
+
+    /**
+     A semaphore which is signalled once for each free entry in the queue.
+     */
+    HANDLE QueueSpaceAvailable;
+
+    /**
+     An array of command lines waiting for a worker to execute them.  This
+     is a circular buffer of QueueSize entries.
+     */
+    PYORI_STRING Queue;
+
+    /**
+     The number of entries in the Queue array.
+     */
+    DWORD QueueSize;
+
+    /**
+     The index of the oldest command line in the queue.
+     */
+    DWORD QueueHead;
+
+    /**
+     The number of command lines currently in the queue.
+     */
+    DWORD QueueCount;
+
+    /**
+     The number of items that have been processed.
+     */
+    LONGLONG ItemsProcessed;
+
+    /**
+     If TRUE, display the number of items processed and the rate of
+     processing on completion.
+     */
+    BOOL DisplayStatistics;
 
     /**
      A list of criteria to filter matches against.
@@ -128,44 +179,220 @@ typedef struct _FOR_EXEC_CONTEXT {
 } FOR_EXEC_CONTEXT, *PFOR_EXEC_CONTEXT;
 
 /**
- Wait for any single process to complete.
+ Launch a child process to execute a command line and wait for it to
+ complete.
 
- @param ExecContext Pointer to the for exec context containing information
-        about currently running processes.
+ @param CmdLine Pointer to the command line to execute.
  */
 VOID
-ForWaitForProcessToComplete(
-    __in PFOR_EXEC_CONTEXT ExecContext
+ForExecuteProcessAndWait(
+    __in PYORI_STRING CmdLine
+    )
+{
+    PROCESS_INFORMATION ProcessInfo;
+    STARTUPINFO StartupInfo;
+
+    memset(&StartupInfo, 0, sizeof(StartupInfo));
+    StartupInfo.cb = sizeof(StartupInfo);
+
+    if (!CreateProcess(NULL, CmdLine->StartOfString, NULL, NULL, TRUE, 0, NULL, NULL, &StartupInfo, &ProcessInfo)) {
+        DWORD LastError = GetLastError();
+        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("for: execution failed: %s"), ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        return;
+    }
+
+    CloseHandle(ProcessInfo.hThread);
+    WaitForSingleObject(ProcessInfo.hProcess, INFINITE);
+    CloseHandle(ProcessInfo.hProcess);
+}
+
+/**
+ A worker thread which removes command lines from the queue and executes
+ each one as a child process, until it finds the queue empty after being
+ signalled.
+
+ @param Context Pointer to the for exec context.
+
+ @return Thread exit code, which is ignored.
+ */
+DWORD WINAPI
+ForWorkerThread(
+    __in LPVOID Context
+    )
+{
+    PFOR_EXEC_CONTEXT ExecContext = (PFOR_EXEC_CONTEXT)Context;
+    YORI_STRING CmdLine;
+
+    while (TRUE) {
+        WaitForSingleObject(ExecContext->QueueItemsAvailable, INFINITE);
+        WaitForSingleObject(ExecContext->QueueMutex, INFINITE);
+        if (ExecContext->QueueCount == 0) {
+            ReleaseMutex(ExecContext->QueueMutex);
+            break;
+        }
+
+        memcpy(&CmdLine, &ExecContext->Queue[ExecContext->QueueHead], sizeof(YORI_STRING));
+        ExecContext->QueueHead = (ExecContext->QueueHead + 1) % ExecContext->QueueSize;
+        ExecContext->QueueCount--;
+        ReleaseMutex(ExecContext->QueueMutex);
+        ReleaseSemaphore(ExecContext->QueueSpaceAvailable, 1, NULL);
+
+        ForExecuteProcessAndWait(&CmdLine);
+        YoriLibFreeStringContents(&CmdLine);
+    }
+
+    return 0;
+}
+
+/**
+ Prepare the queue and synchronization objects used to execute commands
+ on worker threads.
+
+ @param ExecContext Pointer to the for exec context.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+ForInitializeWorkers(
+    __inout PFOR_EXEC_CONTEXT ExecContext
+    )
+{
+    ExecContext->WorkerThreads = YoriLibMalloc(ExecContext->TargetConcurrentCount * sizeof(HANDLE));
+    if (ExecContext->WorkerThreads == NULL) {
+        return FALSE;
+    }
+
+    //
+    //  Allow enough queued work for each worker to have another command
+    //  line ready when its process completes.  The enumeration blocks once
+    //  the queue is full, so very large lists do not need to be held in
+    //  memory.
+    //
+
+    ExecContext->QueueSize = ExecContext->TargetConcurrentCount * 2;
+    ExecContext->Queue = YoriLibMalloc(ExecContext->QueueSize * sizeof(YORI_STRING));
+    if (ExecContext->Queue == NULL) {
+        return FALSE;
+    }
+
+    ExecContext->QueueMutex = CreateMutex(NULL, FALSE, NULL);
+    if (ExecContext->QueueMutex == NULL) {
+        return FALSE;
+    }
+
+    ExecContext->QueueItemsAvailable = CreateSemaphore(NULL, 0, ExecContext->QueueSize + ExecContext->TargetConcurrentCount, NULL);
+    if (ExecContext->QueueItemsAvailable == NULL) {
+        return FALSE;
+    }
+
+    ExecContext->QueueSpaceAvailable = CreateSemaphore(NULL, ExecContext->QueueSize, ExecContext->QueueSize, NULL);
+    if (ExecContext->QueueSpaceAvailable == NULL) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Add a command line to the queue for a worker thread to execute, creating
+ a new worker thread if fewer than the requested number exist.  If the
+ queue is full, this waits for a worker to remove an entry.
+
+ @param ExecContext Pointer to the for exec context.
+
+ @param CmdLine Pointer to the command line to execute.  On success, the
+        queue takes ownership of its allocation and the caller's string is
+        reinitialized.
+ */
+VOID
+ForQueueCommand(
+    __inout PFOR_EXEC_CONTEXT ExecContext,
+    __inout PYORI_STRING CmdLine
     )
 {
-    DWORD Result;
     DWORD Index;
-    DWORD Count;
+    DWORD ThreadId;
 
-    Result = WaitForMultipleObjects(ExecContext->CurrentConcurrentCount, ExecContext->HandleArray, FALSE, INFINITE);
+    if (ExecContext->WorkerCount < ExecContext->TargetConcurrentCount) {
+        ExecContext->WorkerThreads[ExecContext->WorkerCount] = CreateThread(NULL, 0, ForWorkerThread, ExecContext, 0, &ThreadId);
+        if (ExecContext->WorkerThreads[ExecContext->WorkerCount] != NULL) {
+            ExecContext->WorkerCount++;
+        }
+    }
 
-    ASSERT(Result >= WAIT_OBJECT_0 && Result < (WAIT_OBJECT_0 + ExecContext->CurrentConcurrentCount));
+    //
+    //  If no worker could be created, execute the command here.
+    //
+
+    if (ExecContext->WorkerCount == 0) {
+        ForExecuteProcessAndWait(CmdLine);
+        return;
+    }
 
-    Index = Result - WAIT_OBJECT_0;
+    WaitForSingleObject(ExecContext->QueueSpaceAvailable, INFINITE);
+    WaitForSingleObject(ExecContext->QueueMutex, INFINITE);
+    Index = (ExecContext->QueueHead + ExecContext->QueueCount) % ExecContext->QueueSize;
+    memcpy(&ExecContext->Queue[Index], CmdLine, sizeof(YORI_STRING));
+    ExecContext->QueueCount++;
+    ReleaseMutex(ExecContext->QueueMutex);
+    ReleaseSemaphore(ExecContext->QueueItemsAvailable, 1, NULL);
 
-    CloseHandle(ExecContext->HandleArray[Index]);
+    YoriLibInitEmptyString(CmdLine);
+}
 
-    for (Count = Index; Count < ExecContext->CurrentConcurrentCount - 1; Count++) {
+/**
+ Indicate to worker threads that no more command lines will be queued, wait
+ for them to finish executing the queue, and free the queue and
+ synchronization objects.
 
-#if defined(_MSC_VER) && (_MSC_VER >= 1700)
-        //
-        //  The "correct" annotation here would describe that HandleArray is
-        //  of TargetConcurrentCount elements, CurrentConcurrentCount of which
-        //  are readable, and CurrentConcurrentCount needs to be less than or
-        //  equal to TargetConcurrentCount.  This is something that I don't
-        //  see a way to express as of this writing.
-        //
-#pragma warning(suppress: 6001)
-#endif
-        ExecContext->HandleArray[Count] = ExecContext->HandleArray[Count + 1];
+ @param ExecContext Pointer to the for exec context.
+ */
+VOID
+ForCleanupWorkers(
+    __inout PFOR_EXEC_CONTEXT ExecContext
+    )
+{
+    DWORD Index;
+
+    if (ExecContext->WorkerCount > 0) {
+        ReleaseSemaphore(ExecContext->QueueItemsAvailable, ExecContext->WorkerCount, NULL);
     }
 
-    ExecContext->CurrentConcurrentCount--;
+    for (Index = 0; Index < ExecContext->WorkerCount; Index++) {
+        WaitForSingleObject(ExecContext->WorkerThreads[Index], INFINITE);
+        CloseHandle(ExecContext->WorkerThreads[Index]);
+    }
+    ExecContext->WorkerCount = 0;
+
+    if (ExecContext->Queue != NULL) {
+        while (ExecContext->QueueCount > 0) {
+            YoriLibFreeStringContents(&ExecContext->Queue[ExecContext->QueueHead]);
+            ExecContext->QueueHead = (ExecContext->QueueHead + 1) % ExecContext->QueueSize;
+            ExecContext->QueueCount--;
+        }
+        YoriLibFree(ExecContext->Queue);
+        ExecContext->Queue = NULL;
+    }
+
+    if (ExecContext->WorkerThreads != NULL) {
+        YoriLibFree(ExecContext->WorkerThreads);
+        ExecContext->WorkerThreads = NULL;
+    }
+    if (ExecContext->QueueMutex != NULL) {
+        CloseHandle(ExecContext->QueueMutex);
+        ExecContext->QueueMutex = NULL;
+    }
+    if (ExecContext->QueueItemsAvailable != NULL) {
+        CloseHandle(ExecContext->QueueItemsAvailable);
+        ExecContext->QueueItemsAvailable = NULL;
+    }
+    if (ExecContext->QueueSpaceAvailable != NULL) {
+        CloseHandle(ExecContext->QueueSpaceAvailable);
+        ExecContext->QueueSpaceAvailable = NULL;
+    }
 }
 
 /**
@@ -192,8 +419,6 @@ ForExecuteCommand(
     YORI_STRING NewArgWritePoint;
     PYORI_STRING NewArgArray;
     YORI_STRING CmdLine;
-    PROCESS_INFORMATION ProcessInfo;
-    STARTUPINFO StartupInfo;
 
     YoriLibInitEmptyString(&CmdLine);
 
@@ -307,6 +532,8 @@ ForExecuteCommand(
         goto Cleanup;
     }
 
+    ExecContext->ItemsProcessed++;
+
 #ifdef YORI_BUILTIN
     if (PrefixArgCount == 0) {
         YoriCallExecuteExpression(&CmdLine);
@@ -314,24 +541,10 @@ ForExecuteCommand(
     }
 #endif
 
-    memset(&StartupInfo, 0, sizeof(StartupInfo));
-    StartupInfo.cb = sizeof(StartupInfo);
-
-    if (!CreateProcess(NULL, CmdLine.StartOfString, NULL, NULL, TRUE, 0, NULL, NULL, &StartupInfo, &ProcessInfo)) {
-        DWORD LastError = GetLastError();
-        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("for: execution failed: %s"), ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        goto Cleanup;
-    }
-
-    CloseHandle(ProcessInfo.hThread);
-
-    ExecContext->HandleArray[ExecContext->CurrentConcurrentCount] = ProcessInfo.hProcess;
-    ExecContext->CurrentConcurrentCount++;
-
-    if (ExecContext->CurrentConcurrentCount == ExecContext->TargetConcurrentCount) {
-        ForWaitForProcessToComplete(ExecContext);
+    if (ExecContext->TargetConcurrentCount == 1) {
+        ForExecuteProcessAndWait(&CmdLine);
+    } else {
+        ForQueueCommand(ExecContext, &CmdLine);
     }
 
 Cleanup:
@@ -376,7 +589,7 @@ ForFileFoundCallback(
 
     ASSERT(YoriLibIsStringNullTerminated(FilePath));
 
-    if (!YoriLibFileFiltCheckFilterMatch(&ExecContext->Filter, FilePath, FileInfo)) {
+    if (!YoriLibFileFiltCheckFilterMatch(&ExecContext->Filter, FilePath, FileInfo, NULL)) {
         return TRUE;
     }
 
@@ -427,12 +640,13 @@ ENTRYPOINT(
     DWORD CmdArg = 0;
     DWORD ArgIndex;
     DWORD i;
+    DWORD StartTime;
+    DWORD ElapsedTime;
     FOR_EXEC_CONTEXT ExecContext;
 
     ZeroMemory(&ExecContext, sizeof(ExecContext));
 
     ExecContext.TargetConcurrentCount = 1;
-    ExecContext.CurrentConcurrentCount = 0;
     MatchDirectories = FALSE;
     Recurse = FALSE;
     StepMode = FALSE;
@@ -494,6 +708,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
                 Recurse = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("t")) == 0) {
+                ExecContext.DisplayStatistics = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("-")) == 0) {
                 ArgumentUnderstood = TRUE;
                 StartArg = i + 1;
@@ -575,11 +792,14 @@ ENTRYPOINT(
 
     ExecContext.ArgC = ArgC - CmdArg;
     ExecContext.ArgV = &ArgV[CmdArg];
-    ExecContext.HandleArray = YoriLibMalloc(ExecContext.TargetConcurrentCount * sizeof(HANDLE));
-    if (ExecContext.HandleArray == NULL) {
-        goto cleanup_and_exit;
+    if (ExecContext.TargetConcurrentCount > 1) {
+        if (!ForInitializeWorkers(&ExecContext)) {
+            goto cleanup_and_exit;
+        }
     }
 
+    StartTime = GetTickCount();
+
     MatchFlags = 0;
     if (MatchDirectories) {
         MatchFlags = YORILIB_FILEENUM_RETURN_DIRECTORIES;
@@ -771,17 +991,28 @@ ENTRYPOINT(
         }
     }
 
-    while (ExecContext.CurrentConcurrentCount > 0) {
-        ForWaitForProcessToComplete(&ExecContext);
+    ForCleanupWorkers(&ExecContext);
+
+    if (ExecContext.DisplayStatistics) {
+        ElapsedTime = GetTickCount() - StartTime;
+        if (ElapsedTime == 0) {
+            ElapsedTime = 1;
+        }
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                      _T("for: %lli items in %i.%03i seconds, %lli items/s\n"),
+                      ExecContext.ItemsProcessed,
+                      ElapsedTime / 1000,
+                      ElapsedTime % 1000,
+                      ExecContext.ItemsProcessed * 1000 / ElapsedTime);
     }
 
     YoriLibFileFiltFreeFilter(&ExecContext.Filter);
-    YoriLibFree(ExecContext.HandleArray);
 
     return EXIT_SUCCESS;
 
 cleanup_and_exit:
 
+    ForCleanupWorkers(&ExecContext);
     YoriLibFileFiltFreeFilter(&ExecContext.Filter);
 
     return EXIT_FAILURE;
@@ -155,7 +155,7 @@ FsCmpFileFoundCallback(
             return FALSE;
         }
     } else if (FsCmpContext->TestType == FsCmpTestTypeApplyFilter) {
-        if (YoriLibFileFiltCheckFilterMatch(&FsCmpContext->Filter, FilePath, FileInfo)) {
+        if (YoriLibFileFiltCheckFilterMatch(&FsCmpContext->Filter, FilePath, FileInfo, NULL)) {
             FsCmpContext->ConditionMet = TRUE;
             return FALSE;
         }
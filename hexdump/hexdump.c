@@ -37,17 +37,22 @@ CHAR strHexDumpHelpText[] =
         "\n"
         "Output the contents of one or more files in hex.\n"
         "\n"
-        "HEXDUMP [-license] [-b] [-d] [-g1|-g2|-g4|-g8|-i] [-hc] [-ho]\n"
+        "HEXDUMP [-license] [-b] [-g1|-g2|-g4|-g8|-i|-p] [-hc] [-ho]\n"
         "        [-l length] [-o offset] [-r] [-s] [<file>...]\n"
+        "HEXDUMP [-license] -d|-ds [-g1|-g2|-g4|-g8] [-hc] [-ho] [-l length]\n"
+        "        [-n count] [-o offset] <file1> <file2>\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -d             Display the differences between two files\n"
+        "   -ds            Display the ranges that differ between two files\n"
         "   -g             Number of bytes per display group\n"
         "   -hc            Hide character display\n"
         "   -ho            Hide offset within buffer\n"
         "   -i             C-style include output\n"
         "   -l             Length of the section to display\n"
+        "   -n             Stop after this many differences\n"
         "   -o             Offset within the stream to display\n"
+        "   -p             Output continuous hex digits only, for piping\n"
         "   -r             Reverse process hex back into binary\n"
         "   -s             Process files from all subdirectories\n";
 
@@ -91,6 +96,12 @@ typedef struct _HEXDUMP_CONTEXT {
      */
     LONGLONG LengthToDisplay;
 
+    /**
+     The maximum number of differences to display when comparing two files,
+     or zero to display all differences.
+     */
+    LONGLONG MaximumDifferences;
+
     /**
      Number of bytes to display per group.
      */
@@ -119,6 +130,16 @@ typedef struct _HEXDUMP_CONTEXT {
      */
     BOOLEAN CStyleInclude;
 
+    /**
+     If TRUE, output only hex digits with no offsets, spacing or characters.
+     */
+    BOOLEAN RawHex;
+
+    /**
+     If TRUE, display only the ranges that differ when comparing two files.
+     */
+    BOOLEAN DiffSummary;
+
     /**
      TRUE if file enumeration is being performed recursively; FALSE if it is
      in one directory only.
@@ -663,10 +684,8 @@ HexDumpProcessStream(
     __in PHEXDUMP_CONTEXT HexDumpContext
     )
 {
-    PUCHAR Buffer;
-    DWORD BufferSize;
+    YORI_LIB_BYTE_SPAN_READER Reader;
     DWORD BufferOffset;
-    DWORD BytesReturned;
     DWORD LengthToDisplay;
     DWORD DisplayFlags;
     LARGE_INTEGER StreamOffset;
@@ -674,11 +693,6 @@ HexDumpProcessStream(
     HexDumpContext->FilesFound++;
     HexDumpContext->FilesFoundThisArg++;
 
-    BufferSize = 64 * 1024;
-    Buffer = YoriLibMalloc(BufferSize);
-    if (Buffer == NULL) {
-        return FALSE;
-    }
     DisplayFlags = 0;
     if (!HexDumpContext->HideOffset) {
         DisplayFlags |= YORI_LIB_HEX_FLAG_DISPLAY_LARGE_OFFSET;
@@ -689,35 +703,31 @@ HexDumpProcessStream(
     if (HexDumpContext->CStyleInclude) {
         DisplayFlags |= YORI_LIB_HEX_FLAG_C_STYLE;
     }
+    if (HexDumpContext->RawHex) {
+        DisplayFlags |= YORI_LIB_HEX_FLAG_RAW;
+    }
 
     //
-    //  If it's a file, start at the offset requested by the user.  If it's
-    //  not a file (it's a pipe), the only way to move forward is by
-    //  reading.
+    //  If it's a file, start at the offset requested by the user.  Files
+    //  are displayed from a mapped view.  If it's not a file (it's a pipe),
+    //  the only way to move forward is by reading.
     //
 
     StreamOffset.QuadPart = HexDumpContext->OffsetToDisplay;
 
-    if (!SetFilePointer(hSource, StreamOffset.LowPart, &StreamOffset.HighPart, FILE_BEGIN)) {
-        StreamOffset.QuadPart = 0;
+    if (!YoriLibByteSpanReaderOpen(&Reader, hSource, &StreamOffset)) {
+        return FALSE;
     }
 
-    while (TRUE) {
-        BytesReturned = 0;
-        if (!ReadFile(hSource, Buffer, BufferSize, &BytesReturned, NULL)) {
-            break;
-        }
+    while (YoriLibByteSpanReaderNext(&Reader, 0)) {
 
-        if (BytesReturned == 0) {
-            break;
-        }
+        StreamOffset.QuadPart = Reader.SpanOffset.QuadPart;
 
-        if (StreamOffset.QuadPart + BytesReturned <= HexDumpContext->OffsetToDisplay) {
-            StreamOffset.QuadPart += BytesReturned;
+        if (StreamOffset.QuadPart + Reader.SpanLength <= HexDumpContext->OffsetToDisplay) {
             continue;
         }
 
-        LengthToDisplay = BytesReturned;
+        LengthToDisplay = Reader.SpanLength;
 
         BufferOffset = 0;
         if (StreamOffset.QuadPart < HexDumpContext->OffsetToDisplay) {
@@ -725,7 +735,7 @@ HexDumpProcessStream(
             LengthToDisplay -= BufferOffset;
         }
 
-        ASSERT(BufferOffset + LengthToDisplay == BytesReturned);
+        ASSERT(BufferOffset + LengthToDisplay == Reader.SpanLength);
 
         if (HexDumpContext->LengthToDisplay != 0) {
             if (StreamOffset.QuadPart + BufferOffset + LengthToDisplay > HexDumpContext->OffsetToDisplay + HexDumpContext->LengthToDisplay) {
@@ -733,17 +743,17 @@ HexDumpProcessStream(
             }
         }
 
-        if (!YoriLibHexDump((LPCSTR)&Buffer[BufferOffset], StreamOffset.QuadPart + BufferOffset, LengthToDisplay, HexDumpContext->BytesPerGroup, DisplayFlags)) {
+        if (!YoriLibHexDump((LPCSTR)&Reader.Span[BufferOffset], StreamOffset.QuadPart + BufferOffset, LengthToDisplay, HexDumpContext->BytesPerGroup, DisplayFlags)) {
             break;
         }
 
-        StreamOffset.QuadPart += BytesReturned;
+        StreamOffset.QuadPart += Reader.SpanLength;
         if (HexDumpContext->LengthToDisplay != 0 && StreamOffset.QuadPart >= HexDumpContext->OffsetToDisplay + HexDumpContext->LengthToDisplay) {
             break;
         }
     }
 
-    YoriLibFree(Buffer);
+    YoriLibByteSpanReaderClose(&Reader);
 
     return TRUE;
 }
@@ -949,20 +959,31 @@ typedef struct _HEXDUMP_ONE_OBJECT {
     HANDLE FileHandle;
 
     /**
-     A buffer to hold data read from this source.
+     The reader returning spans of data from this source.
      */
-    PUCHAR Buffer;
+    YORI_LIB_BYTE_SPAN_READER Reader;
 
     /**
-     The number of bytes read from this source.
+     TRUE if Reader has been opened and needs to be closed.
      */
-    DWORD BytesReturned;
+    BOOLEAN ReaderOpen;
 
     /**
-     Set to TRUE if a read operation from this source has failed.
+     Set to TRUE if a read operation from this source has failed or the end
+     of the source has been reached.
      */
     BOOL ReadFailed;
 
+    /**
+     Pointer to the data at the current comparison offset.
+     */
+    PUCHAR Data;
+
+    /**
+     The number of bytes available from Data.
+     */
+    DWORD Available;
+
     /**
      The number of bytes to display for a given line from this
      buffer.  This is recalculated for each line based on the source's
@@ -971,6 +992,223 @@ typedef struct _HEXDUMP_ONE_OBJECT {
     DWORD DisplayLength;
 } HEXDUMP_ONE_OBJECT, *PHEXDUMP_ONE_OBJECT;
 
+/**
+ State describing the differences found so far when comparing two sources.
+ */
+typedef struct _HEXDUMP_DIFF_STATE {
+
+    /**
+     The number of differences reported so far.  When displaying lines,
+     this is the number of lines displayed.  When displaying a summary,
+     this is the number of ranges.
+     */
+    LONGLONG DifferenceCount;
+
+    /**
+     The offset of the first byte in the current range of differences.
+     */
+    LARGE_INTEGER RangeStart;
+
+    /**
+     The offset of the first byte after the current range of differences.
+     */
+    LARGE_INTEGER RangeEnd;
+
+    /**
+     TRUE if RangeStart and RangeEnd describe a range which has not been
+     displayed yet.
+     */
+    BOOLEAN RangeActive;
+} HEXDUMP_DIFF_STATE, *PHEXDUMP_DIFF_STATE;
+
+/**
+ Find the first byte which differs between two buffers.  When the buffers
+ have the same alignment, identical regions are skipped a machine word at a
+ time, several words per iteration, and only the word that differs is
+ examined a byte at a time.
+
+ @param Buffer1 Pointer to the first buffer.
+
+ @param Buffer2 Pointer to the second buffer.
+
+ @param Length The number of bytes in each buffer.
+
+ @return The offset of the first byte which differs, or Length if the
+         buffers are identical.
+ */
+DWORD
+HexDumpFindMismatch(
+    __in_ecount(Length) UCHAR CONST * Buffer1,
+    __in_ecount(Length) UCHAR CONST * Buffer2,
+    __in DWORD Length
+    )
+{
+    DWORD Offset;
+    DWORD_PTR CONST * Words1;
+    DWORD_PTR CONST * Words2;
+
+    //
+    //  Compare a byte at a time until the first buffer is aligned.  The
+    //  minimal CRT's memcmp compares a byte at a time, so it isn't used
+    //  here.
+    //
+
+    Offset = 0;
+    while (Offset < Length && ((DWORD_PTR)&Buffer1[Offset] % sizeof(DWORD_PTR)) != 0) {
+        if (Buffer1[Offset] != Buffer2[Offset]) {
+            return Offset;
+        }
+        Offset++;
+    }
+
+    //
+    //  If the second buffer is now aligned too, compare four words at a
+    //  time, then single words, until a word differs.  Buffers with
+    //  different alignment are compared a byte at a time.
+    //
+
+    if (((DWORD_PTR)&Buffer2[Offset] % sizeof(DWORD_PTR)) == 0) {
+        while (Offset + 4 * sizeof(DWORD_PTR) <= Length) {
+            Words1 = (DWORD_PTR CONST *)&Buffer1[Offset];
+            Words2 = (DWORD_PTR CONST *)&Buffer2[Offset];
+            if (((Words1[0] ^ Words2[0]) |
+                 (Words1[1] ^ Words2[1]) |
+                 (Words1[2] ^ Words2[2]) |
+                 (Words1[3] ^ Words2[3])) != 0) {
+
+                break;
+            }
+            Offset += 4 * sizeof(DWORD_PTR);
+        }
+
+        while (Offset + sizeof(DWORD_PTR) <= Length) {
+            Words1 = (DWORD_PTR CONST *)&Buffer1[Offset];
+            Words2 = (DWORD_PTR CONST *)&Buffer2[Offset];
+            if (Words1[0] != Words2[0]) {
+                break;
+            }
+            Offset += sizeof(DWORD_PTR);
+        }
+    }
+
+    while (Offset < Length && Buffer1[Offset] == Buffer2[Offset]) {
+        Offset++;
+    }
+
+    return Offset;
+}
+
+/**
+ Display a range of differences found between two sources.
+
+ @param DiffState Pointer to the state describing the range to display.
+ */
+VOID
+HexDumpDisplayDiffRange(
+    __inout PHEXDUMP_DIFF_STATE DiffState
+    )
+{
+    LARGE_INTEGER RangeLast;
+
+    if (!DiffState->RangeActive) {
+        return;
+    }
+
+    RangeLast.QuadPart = DiffState->RangeEnd.QuadPart - 1;
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                  _T("%08x`%08x-%08x`%08x (%lli bytes)\n"),
+                  DiffState->RangeStart.HighPart,
+                  DiffState->RangeStart.LowPart,
+                  RangeLast.HighPart,
+                  RangeLast.LowPart,
+                  DiffState->RangeEnd.QuadPart - DiffState->RangeStart.QuadPart);
+
+    DiffState->RangeActive = FALSE;
+}
+
+/**
+ Report a line which differs between two sources.  Depending on the
+ requested display, this either displays the line or extends the current
+ range of differences.
+
+ @param HexDumpContext Pointer to the context indicating display parameters.
+
+ @param DiffState Pointer to the state describing differences found so far.
+
+ @param StreamOffset The offset of the line within each source.
+
+ @param Buffer1 Pointer to the data from the first source.
+
+ @param Buffer1Length The number of bytes of data from the first source.
+
+ @param Buffer2 Pointer to the data from the second source.
+
+ @param Buffer2Length The number of bytes of data from the second source.
+
+ @param DisplayFlags Flags to pass when displaying the line.
+
+ @return TRUE to continue comparing, FALSE if the maximum number of
+         differences has been reached or the line could not be displayed.
+ */
+BOOL
+HexDumpReportDifference(
+    __in PHEXDUMP_CONTEXT HexDumpContext,
+    __inout PHEXDUMP_DIFF_STATE DiffState,
+    __in LONGLONG StreamOffset,
+    __in_ecount(Buffer1Length) UCHAR CONST * Buffer1,
+    __in DWORD Buffer1Length,
+    __in_ecount(Buffer2Length) UCHAR CONST * Buffer2,
+    __in DWORD Buffer2Length,
+    __in DWORD DisplayFlags
+    )
+{
+    DWORD LengthThisLine;
+
+    LengthThisLine = Buffer1Length;
+    if (Buffer2Length > LengthThisLine) {
+        LengthThisLine = Buffer2Length;
+    }
+
+    if (HexDumpContext->DiffSummary) {
+
+        if (DiffState->RangeActive &&
+            DiffState->RangeEnd.QuadPart == StreamOffset) {
+
+            DiffState->RangeEnd.QuadPart = StreamOffset + LengthThisLine;
+            return TRUE;
+        }
+
+        HexDumpDisplayDiffRange(DiffState);
+
+        if (HexDumpContext->MaximumDifferences != 0 &&
+            DiffState->DifferenceCount >= HexDumpContext->MaximumDifferences) {
+
+            return FALSE;
+        }
+
+        DiffState->DifferenceCount++;
+        DiffState->RangeActive = TRUE;
+        DiffState->RangeStart.QuadPart = StreamOffset;
+        DiffState->RangeEnd.QuadPart = StreamOffset + LengthThisLine;
+        return TRUE;
+    }
+
+    if (HexDumpContext->MaximumDifferences != 0 &&
+        DiffState->DifferenceCount >= HexDumpContext->MaximumDifferences) {
+
+        return FALSE;
+    }
+
+    DiffState->DifferenceCount++;
+    return YoriLibHexDiff(StreamOffset,
+                          (LPCSTR)Buffer1,
+                          Buffer1Length,
+                          (LPCSTR)Buffer2,
+                          Buffer2Length,
+                          HexDumpContext->BytesPerGroup,
+                          DisplayFlags);
+}
+
 /**
  Display the differences between two files in hex form.
 
@@ -990,17 +1228,19 @@ HexDumpDisplayDiff(
     )
 {
     HEXDUMP_ONE_OBJECT Objects[2];
-    DWORD BufferSize;
+    HEXDUMP_DIFF_STATE DiffState;
+    PHEXDUMP_ONE_OBJECT Object;
     DWORD BufferOffset;
-    DWORD LengthToDisplay;
+    DWORD Mismatch;
+    DWORD CompareLength;
     DWORD LengthThisLine;
     DWORD DisplayFlags;
     LARGE_INTEGER StreamOffset;
+    LONGLONG RemainingLength;
     DWORD Count;
     BOOL Result = FALSE;
-    BOOL LineDifference;
+    BOOL Continue;
 
-    BufferSize = 64 * 1024;
     DisplayFlags = 0;
     if (!HexDumpContext->HideOffset) {
         DisplayFlags |= YORI_LIB_HEX_FLAG_DISPLAY_LARGE_OFFSET;
@@ -1011,6 +1251,7 @@ HexDumpDisplayDiff(
     StreamOffset.QuadPart = HexDumpContext->OffsetToDisplay;
 
     ZeroMemory(Objects, sizeof(Objects));
+    ZeroMemory(&DiffState, sizeof(DiffState));
 
     for (Count = 0; Count < sizeof(Objects)/sizeof(Objects[0]); Count++) {
 
@@ -1050,43 +1291,73 @@ HexDumpDisplayDiff(
         }
 
         //
-        //  Allocate a read buffer for the file
+        //  Prepare to read the file from the requested offset.  Where
+        //  possible the file is mapped so large identical regions can be
+        //  compared without copying them.
         //
 
-        Objects[Count].Buffer = YoriLibMalloc(BufferSize);
-        if (Objects[Count].Buffer == NULL) {
+        if (!YoriLibByteSpanReaderOpen(&Objects[Count].Reader, Objects[Count].FileHandle, &StreamOffset)) {
             goto Exit;
         }
+        Objects[Count].ReaderOpen = TRUE;
+    }
+
+    Continue = TRUE;
+    while (Continue) {
+
+        if (YoriLibIsOperationCancelled()) {
+            break;
+        }
 
         //
-        //  Seek to the requested offset in the file.  Note that in the diff
-        //  case we have files, so seeking is valid.
+        //  Truncate the comparison to the range the user requested
         //
 
-        SetFilePointer(Objects[Count].FileHandle, StreamOffset.LowPart, &StreamOffset.HighPart, FILE_BEGIN);
-        if (GetLastError() != NO_ERROR) {
-            DWORD LastError = GetLastError();
-            LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hexdump: seek of %y failed: %s"), &Objects[Count].FullFileName, ErrText);
-            YoriLibFreeWinErrorText(ErrText);
-            goto Exit;
+        RemainingLength = 0;
+        if (HexDumpContext->LengthToDisplay != 0) {
+            RemainingLength = HexDumpContext->OffsetToDisplay + HexDumpContext->LengthToDisplay - StreamOffset.QuadPart;
+            if (RemainingLength <= 0) {
+                Result = TRUE;
+                break;
+            }
         }
-    }
-
-    while (TRUE) {
 
         //
-        //  Read from each file
+        //  Make sure each source has at least one line of data available,
+        //  unless it has ended.  Any data which has not been compared yet
+        //  is retained in the next span.  Once the shorter source has
+        //  ended, the comparison offset continues beyond the end of its
+        //  span, so it has no data available.
         //
 
         for (Count = 0; Count < sizeof(Objects)/sizeof(Objects[0]); Count++) {
-            Objects[Count].ReadFailed = FALSE;
-            Objects[Count].BytesReturned = 0;
-            if (!ReadFile(Objects[Count].FileHandle, Objects[Count].Buffer, BufferSize, &Objects[Count].BytesReturned, NULL)) {
-                Objects[Count].ReadFailed = TRUE;
-                Objects[Count].BytesReturned = 0;
-            } else if (Objects[Count].BytesReturned == 0) {
-                Objects[Count].ReadFailed = TRUE;
+            Object = &Objects[Count];
+            while (TRUE) {
+                BufferOffset = 0;
+                Object->Available = 0;
+                if (StreamOffset.QuadPart >= Object->Reader.SpanOffset.QuadPart &&
+                    StreamOffset.QuadPart < Object->Reader.SpanOffset.QuadPart + Object->Reader.SpanLength) {
+
+                    BufferOffset = (DWORD)(StreamOffset.QuadPart - Object->Reader.SpanOffset.QuadPart);
+                    Object->Available = Object->Reader.SpanLength - BufferOffset;
+                }
+
+                if (Object->Available >= YORI_LIB_HEXDUMP_BYTES_PER_LINE || Object->ReadFailed) {
+                    break;
+                }
+
+                if (!YoriLibByteSpanReaderNext(&Object->Reader, Object->Available)) {
+                    Object->ReadFailed = TRUE;
+                }
+            }
+
+            if (Object->Available == 0) {
+                Object->Data = NULL;
+            } else {
+                Object->Data = Object->Reader.Span + BufferOffset;
+                if (RemainingLength != 0 && Object->Available > RemainingLength) {
+                    Object->Available = (DWORD)RemainingLength;
+                }
             }
         }
 
@@ -1094,88 +1365,99 @@ HexDumpDisplayDiff(
         //  If we've finished both sources, we are done.
         //
 
-        if (Objects[0].ReadFailed && Objects[1].ReadFailed) {
+        if (Objects[0].Available == 0 && Objects[1].Available == 0) {
+            Result = TRUE;
             break;
         }
 
         //
-        //  Display the maximum of what was read between the two
+        //  Compare all of the complete lines available from both sources,
+        //  and only report the lines containing differences.
         //
 
-        if (Objects[0].BytesReturned > Objects[1].BytesReturned) {
-            LengthToDisplay = Objects[0].BytesReturned;
-        } else {
-            LengthToDisplay = Objects[1].BytesReturned;
+        CompareLength = Objects[0].Available;
+        if (Objects[1].Available < CompareLength) {
+            CompareLength = Objects[1].Available;
         }
+        CompareLength = CompareLength - (CompareLength % YORI_LIB_HEXDUMP_BYTES_PER_LINE);
 
-        //
-        //  Truncate the display to the range the user requested
-        //
+        if (CompareLength > 0) {
+            BufferOffset = 0;
+            while (BufferOffset < CompareLength) {
+                Mismatch = HexDumpFindMismatch(&Objects[0].Data[BufferOffset],
+                                               &Objects[1].Data[BufferOffset],
+                                               CompareLength - BufferOffset);
 
-        if (HexDumpContext->LengthToDisplay != 0) {
-            if (StreamOffset.QuadPart + LengthToDisplay >= HexDumpContext->OffsetToDisplay + HexDumpContext->LengthToDisplay) {
-                LengthToDisplay = (DWORD)(HexDumpContext->OffsetToDisplay + HexDumpContext->LengthToDisplay - StreamOffset.QuadPart);
-                if (LengthToDisplay == 0) {
+                if (Mismatch == CompareLength - BufferOffset) {
+                    break;
+                }
+
+                BufferOffset = BufferOffset + Mismatch - (Mismatch % YORI_LIB_HEXDUMP_BYTES_PER_LINE);
+                if (!HexDumpReportDifference(HexDumpContext,
+                                             &DiffState,
+                                             StreamOffset.QuadPart + BufferOffset,
+                                             &Objects[0].Data[BufferOffset],
+                                             YORI_LIB_HEXDUMP_BYTES_PER_LINE,
+                                             &Objects[1].Data[BufferOffset],
+                                             YORI_LIB_HEXDUMP_BYTES_PER_LINE,
+                                             DisplayFlags)) {
+                    Continue = FALSE;
                     break;
                 }
+
+                BufferOffset += YORI_LIB_HEXDUMP_BYTES_PER_LINE;
             }
-        }
 
-        BufferOffset = 0;
+            StreamOffset.QuadPart += CompareLength;
+            continue;
+        }
 
-        while(LengthToDisplay > 0) {
+        //
+        //  At least one source has less than a line remaining, so compare
+        //  one line, which may be a different length in each source.  If
+        //  a summary is being displayed and one source has ended, all of
+        //  the data available from the other is different.
+        //
 
-            //
-            //  Check each line to see if it's different
-            //
+        LengthThisLine = 0;
+        for (Count = 0; Count < sizeof(Objects)/sizeof(Objects[0]); Count++) {
+            Object = &Objects[Count];
+            Object->DisplayLength = Object->Available;
+            if (Object->DisplayLength > YORI_LIB_HEXDUMP_BYTES_PER_LINE &&
+                (!HexDumpContext->DiffSummary || Objects[1 - Count].Available != 0)) {
 
-            LineDifference = FALSE;
-            if (LengthToDisplay >= 16) {
-                LengthThisLine = 16;
-            } else {
-                LengthThisLine = LengthToDisplay;
+                Object->DisplayLength = YORI_LIB_HEXDUMP_BYTES_PER_LINE;
             }
-            for (Count = 0; Count < sizeof(Objects)/sizeof(Objects[0]); Count++) {
-                Objects[Count].DisplayLength = LengthThisLine;
-                if (BufferOffset + LengthThisLine > Objects[Count].BytesReturned) {
-                    LineDifference = TRUE;
-                    Objects[Count].DisplayLength = 0;
-                    if (Objects[Count].BytesReturned > BufferOffset) {
-                        Objects[Count].DisplayLength = Objects[0].BytesReturned - BufferOffset;
-                    }
-                }
-            }
-
-            if (!LineDifference &&
-                memcmp(&Objects[0].Buffer[BufferOffset], &Objects[1].Buffer[BufferOffset], LengthThisLine) != 0) {
-                LineDifference = TRUE;
+            if (Object->DisplayLength > LengthThisLine) {
+                LengthThisLine = Object->DisplayLength;
             }
+        }
 
-            //
-            //  If it's different, display it
-            //
-
-            if (LineDifference) {
-                if (!YoriLibHexDiff(StreamOffset.QuadPart + BufferOffset,
-                                    (LPCSTR)&Objects[0].Buffer[BufferOffset],
-                                    Objects[0].DisplayLength,
-                                    (LPCSTR)&Objects[1].Buffer[BufferOffset],
-                                    Objects[1].DisplayLength,
-                                    HexDumpContext->BytesPerGroup,
-                                    DisplayFlags)) {
-                    break;
-                }
+        if (Objects[0].DisplayLength != Objects[1].DisplayLength ||
+            (Objects[0].DisplayLength > 0 &&
+             memcmp(Objects[0].Data, Objects[1].Data, Objects[0].DisplayLength) != 0)) {
+
+            if (!HexDumpReportDifference(HexDumpContext,
+                                         &DiffState,
+                                         StreamOffset.QuadPart,
+                                         Objects[0].Data,
+                                         Objects[0].DisplayLength,
+                                         Objects[1].Data,
+                                         Objects[1].DisplayLength,
+                                         DisplayFlags)) {
+                Continue = FALSE;
             }
+        }
 
-            //
-            //  Move to the next line
-            //
+        StreamOffset.QuadPart += LengthThisLine;
+    }
 
-            LengthToDisplay -= LengthThisLine;
-            BufferOffset += LengthThisLine;
-        }
+    if (!Continue) {
+        Result = TRUE;
     }
 
+    HexDumpDisplayDiffRange(&DiffState);
+
 Exit:
 
     //
@@ -1183,12 +1465,12 @@ Exit:
     //
 
     for (Count = 0; Count < sizeof(Objects)/sizeof(Objects[0]); Count++) {
+        if (Objects[Count].ReaderOpen) {
+            YoriLibByteSpanReaderClose(&Objects[Count].Reader);
+        }
         if (Objects[Count].FileHandle != NULL && Objects[Count].FileHandle != INVALID_HANDLE_VALUE) {
             CloseHandle(Objects[Count].FileHandle);
         }
-        if (Objects[Count].Buffer != NULL) {
-            YoriLibFree(Objects[Count].Buffer);
-        }
         YoriLibFreeStringContents(&Objects[Count].FullFileName);
     }
 
@@ -1256,6 +1538,12 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("d")) == 0) {
                 DiffMode = TRUE;
                 HexDumpContext.CStyleInclude = FALSE;
+                HexDumpContext.DiffSummary = FALSE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("ds")) == 0) {
+                DiffMode = TRUE;
+                HexDumpContext.CStyleInclude = FALSE;
+                HexDumpContext.DiffSummary = TRUE;
                 ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("g1")) == 0) {
                 HexDumpContext.BytesPerGroup = 1;
@@ -1282,6 +1570,7 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("i")) == 0) {
                 DiffMode = FALSE;
                 HexDumpContext.CStyleInclude = TRUE;
+                HexDumpContext.RawHex = FALSE;
                 HexDumpContext.HideOffset = TRUE;
                 HexDumpContext.HideCharacters = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -1291,12 +1580,23 @@ ENTRYPOINT(
                     i++;
                     ArgumentUnderstood = TRUE;
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("n")) == 0) {
+                if (ArgC > i + 1) {
+                    YoriLibStringToNumber(&ArgV[i + 1], TRUE, &HexDumpContext.MaximumDifferences, &CharsConsumed);
+                    i++;
+                    ArgumentUnderstood = TRUE;
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("o")) == 0) {
                 if (ArgC > i + 1) {
                     YoriLibStringToNumber(&ArgV[i + 1], TRUE, &HexDumpContext.OffsetToDisplay, &CharsConsumed);
                     i++;
                     ArgumentUnderstood = TRUE;
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("p")) == 0) {
+                DiffMode = FALSE;
+                HexDumpContext.CStyleInclude = FALSE;
+                HexDumpContext.RawHex = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
                 Reverse = TRUE;
                 HexDumpContext.CStyleInclude = FALSE;
@@ -1322,6 +1622,8 @@ ENTRYPOINT(
 
 #if YORI_BUILTIN
     YoriLibCancelEnable();
+#else
+    YoriLibEnableFileMapping();
 #endif
 
     //
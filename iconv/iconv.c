@@ -92,10 +92,333 @@ typedef struct _ICONV_CONTEXT {
 
 } ICONV_CONTEXT, *PICONV_CONTEXT;
 
+/**
+ The number of bytes to read from the source at a time when converting in
+ blocks.
+ */
+#define ICONV_BLOCK_SIZE (1024 * 1024)
+
+/**
+ The maximum number of bytes of a partial character which can be carried
+ from the end of one block to the beginning of the next.
+ */
+#define ICONV_MAX_CARRY (4)
+
+/**
+ Determine whether a stream in the specified encoding can be converted in
+ blocks.  This requires that the end of a partial character can be found by
+ inspecting the end of a block, which is true for UTF8, UTF16, and single
+ byte code pages.  Double byte code pages are processed one line at a time.
+
+ @param Encoding The source encoding.
+
+ @return TRUE if the source can be processed in blocks, FALSE if it should
+         be processed one line at a time.
+ */
+BOOL
+IconvCanProcessInBlocks(
+    __in DWORD Encoding
+    )
+{
+    CPINFO CpInfo;
+
+    if (Encoding == CP_UTF8 || Encoding == CP_UTF16) {
+        return TRUE;
+    }
+
+    if (GetCPInfo(Encoding, &CpInfo) && CpInfo.MaxCharSize == 1) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ Return the number of bytes at the beginning of a buffer that contain only
+ complete characters.  Any bytes after this point describe a character whose
+ remaining bytes have not been read yet.
+
+ @param Buffer Pointer to the buffer.
+
+ @param BufferLength The number of bytes in the buffer.
+
+ @param Encoding The encoding of the buffer.
+
+ @return The number of bytes that can be converted.
+ */
+DWORD
+IconvGetCompleteBytes(
+    __in PUCHAR Buffer,
+    __in DWORD BufferLength,
+    __in DWORD Encoding
+    )
+{
+    DWORD Index;
+    DWORD SequenceLength;
+    UCHAR Char;
+
+    if (Encoding == CP_UTF16) {
+        BufferLength = BufferLength & ~(1);
+        if (BufferLength >= sizeof(WCHAR)) {
+            WCHAR LastChar;
+            LastChar = (WCHAR)(Buffer[BufferLength - 2] | (Buffer[BufferLength - 1] << 8));
+            if (LastChar >= 0xD800 && LastChar <= 0xDBFF) {
+                BufferLength = BufferLength - sizeof(WCHAR);
+            }
+        }
+        return BufferLength;
+    }
+
+    if (Encoding != CP_UTF8) {
+        return BufferLength;
+    }
+
+    //
+    //  Look backwards for the lead byte of the final sequence.  If the
+    //  sequence it describes extends beyond the end of the buffer, stop
+    //  before it.
+    //
+
+    for (Index = 1; Index < ICONV_MAX_CARRY && Index <= BufferLength; Index++) {
+        Char = Buffer[BufferLength - Index];
+        if ((Char & 0xC0) == 0x80) {
+            continue;
+        }
+
+        if (Char >= 0xF0) {
+            SequenceLength = 4;
+        } else if (Char >= 0xE0) {
+            SequenceLength = 3;
+        } else if (Char >= 0xC0) {
+            SequenceLength = 2;
+        } else {
+            SequenceLength = 1;
+        }
+
+        if (SequenceLength > Index) {
+            return BufferLength - Index;
+        }
+        break;
+    }
+
+    return BufferLength;
+}
+
+/**
+ Convert the encoding of an opened stream by reading large blocks of the
+ source, converting them, and writing each converted block to standard
+ output.  Line endings are rewritten as the data is converted.  Partial
+ characters at the end of a block are carried to the next block.
+
+ @param hSource Handle to the source.
+
+ @param IconvContext Specifies the encodings to apply.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+IconvProcessStreamInBlocks(
+    __in HANDLE hSource,
+    __in PICONV_CONTEXT IconvContext
+    )
+{
+    PUCHAR ReadBuffer;
+    LPWSTR WideBuffer;
+    LPWSTR LineBuffer;
+    LPSTR OutputBuffer;
+    DWORD OutputBufferLength;
+    DWORD BytesInBuffer;
+    DWORD BytesRead;
+    DWORD BytesToConvert;
+    DWORD BytesSkipped;
+    DWORD BytesNeeded;
+    DWORD BytesWritten;
+    DWORD WideChars;
+    DWORD LineChars;
+    DWORD LineEndingLength;
+    DWORD Index;
+    BOOLEAN FirstBlock;
+    BOOLEAN PreviousWasCr;
+    BOOLEAN AtLineStart;
+    BOOLEAN EndOfStream;
+    BOOL Result;
+    HANDLE hOutput;
+    WCHAR Char;
+
+    ReadBuffer = YoriLibMalloc(ICONV_BLOCK_SIZE + ICONV_MAX_CARRY);
+    WideBuffer = YoriLibMalloc((ICONV_BLOCK_SIZE + ICONV_MAX_CARRY) * sizeof(WCHAR));
+    LineBuffer = YoriLibMalloc((ICONV_BLOCK_SIZE + ICONV_MAX_CARRY) * 2 * sizeof(WCHAR) + sizeof(WCHAR) * 2);
+    OutputBuffer = NULL;
+    OutputBufferLength = 0;
+
+    if (ReadBuffer == NULL || WideBuffer == NULL || LineBuffer == NULL) {
+        Result = FALSE;
+        goto Exit;
+    }
+
+    hOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    LineEndingLength = (DWORD)_tcslen(IconvContext->LineEnding);
+    BytesInBuffer = 0;
+    FirstBlock = TRUE;
+    PreviousWasCr = FALSE;
+    AtLineStart = TRUE;
+    EndOfStream = FALSE;
+    Result = TRUE;
+
+    while (!EndOfStream) {
+
+        if (!ReadFile(hSource, ReadBuffer + BytesInBuffer, ICONV_BLOCK_SIZE, &BytesRead, NULL) ||
+            BytesRead == 0) {
+
+            //
+            //  At the end of the stream, convert anything that was carried
+            //  over.  Any incomplete character is converted to a
+            //  replacement character.
+            //
+
+            EndOfStream = TRUE;
+            BytesToConvert = BytesInBuffer;
+        } else {
+            BytesInBuffer = BytesInBuffer + BytesRead;
+            BytesToConvert = IconvGetCompleteBytes(ReadBuffer, BytesInBuffer, IconvContext->SourceEncoding);
+        }
+
+        //
+        //  Skip any byte order mark at the start of the stream.
+        //
+
+        BytesSkipped = 0;
+        if (FirstBlock && BytesToConvert > 0) {
+            FirstBlock = FALSE;
+            if (IconvContext->SourceEncoding == CP_UTF8 &&
+                BytesToConvert >= 3 &&
+                ReadBuffer[0] == 0xEF &&
+                ReadBuffer[1] == 0xBB &&
+                ReadBuffer[2] == 0xBF) {
+
+                BytesSkipped = 3;
+            } else if (IconvContext->SourceEncoding == CP_UTF16 &&
+                       BytesToConvert >= 2 &&
+                       ((ReadBuffer[0] == 0xFF && ReadBuffer[1] == 0xFE) ||
+                        (ReadBuffer[0] == 0xFE && ReadBuffer[1] == 0xFF))) {
+
+                BytesSkipped = 2;
+            }
+        }
+
+        WideChars = 0;
+        if (BytesToConvert > BytesSkipped) {
+            if (IconvContext->SourceEncoding == CP_UTF16) {
+                WideChars = YoriLibMultibyteInput((LPCSTR)(ReadBuffer + BytesSkipped),
+                                                  (BytesToConvert - BytesSkipped) / sizeof(WCHAR),
+                                                  WideBuffer,
+                                                  ICONV_BLOCK_SIZE + ICONV_MAX_CARRY);
+            } else {
+                WideChars = YoriLibMultibyteInput((LPCSTR)(ReadBuffer + BytesSkipped),
+                                                  BytesToConvert - BytesSkipped,
+                                                  WideBuffer,
+                                                  ICONV_BLOCK_SIZE + ICONV_MAX_CARRY);
+            }
+        }
+
+        //
+        //  Move any partial character to the start of the buffer for the
+        //  next read.
+        //
+
+        if (BytesToConvert < BytesInBuffer) {
+            memmove(ReadBuffer, ReadBuffer + BytesToConvert, BytesInBuffer - BytesToConvert);
+        }
+        BytesInBuffer = BytesInBuffer - BytesToConvert;
+
+        //
+        //  Rewrite line endings.  A CR is written as a line ending
+        //  immediately, and an LF immediately following it is discarded,
+        //  which may be at the start of the next block.
+        //
+
+        LineChars = 0;
+        for (Index = 0; Index < WideChars; Index++) {
+            Char = WideBuffer[Index];
+            if (PreviousWasCr) {
+                PreviousWasCr = FALSE;
+                if (Char == '\n') {
+                    continue;
+                }
+            }
+
+            if (Char == '\r' || Char == '\n') {
+                memcpy(&LineBuffer[LineChars], IconvContext->LineEnding, LineEndingLength * sizeof(WCHAR));
+                LineChars = LineChars + LineEndingLength;
+                AtLineStart = TRUE;
+                if (Char == '\r') {
+                    PreviousWasCr = TRUE;
+                }
+            } else {
+                LineBuffer[LineChars] = Char;
+                LineChars++;
+                AtLineStart = FALSE;
+            }
+        }
+
+        //
+        //  Terminate the final line if the source did not.
+        //
+
+        if (EndOfStream && !AtLineStart) {
+            memcpy(&LineBuffer[LineChars], IconvContext->LineEnding, LineEndingLength * sizeof(WCHAR));
+            LineChars = LineChars + LineEndingLength;
+        }
+
+        if (LineChars > 0) {
+            BytesNeeded = YoriLibGetMultibyteOutputSizeNeeded(LineBuffer, LineChars);
+            if (BytesNeeded > OutputBufferLength) {
+                if (OutputBuffer != NULL) {
+                    YoriLibFree(OutputBuffer);
+                }
+                OutputBuffer = YoriLibMalloc(BytesNeeded);
+                if (OutputBuffer == NULL) {
+                    OutputBufferLength = 0;
+                    Result = FALSE;
+                    break;
+                }
+                OutputBufferLength = BytesNeeded;
+            }
+
+            BytesNeeded = YoriLibMultibyteOutput(LineBuffer, LineChars, OutputBuffer, OutputBufferLength);
+            if (!WriteFile(hOutput, OutputBuffer, BytesNeeded, &BytesWritten, NULL)) {
+                Result = FALSE;
+                break;
+            }
+        }
+
+        if (YoriLibIsOperationCancelled()) {
+            break;
+        }
+    }
+
+Exit:
+    if (ReadBuffer != NULL) {
+        YoriLibFree(ReadBuffer);
+    }
+    if (WideBuffer != NULL) {
+        YoriLibFree(WideBuffer);
+    }
+    if (LineBuffer != NULL) {
+        YoriLibFree(LineBuffer);
+    }
+    if (OutputBuffer != NULL) {
+        YoriLibFree(OutputBuffer);
+    }
+
+    return Result;
+}
+
 /**
  Convert the encoding of an opened stream by reading the source with the
  requested encoding, then writing to the destination with the requested
- encoding.
+ encoding.  If output is not to a console, the stream is converted in
+ blocks; otherwise it is converted one line at a time.
 
  @param hSource Handle to the source.
 
@@ -114,7 +437,10 @@ IconvProcessStream(
     YORI_STRING LineString;
     DWORD OriginalInputEncoding;
     DWORD OriginalOutputEncoding;
+    DWORD ConsoleMode;
     LPTSTR OriginalLineEnding;
+    BOOL OutputIsConsole;
+    BOOL Result;
 
     IconvContext->FilesFound++;
 
@@ -127,16 +453,27 @@ IconvProcessStream(
     YoriLibVtSetLineEnding(IconvContext->LineEnding);
 
     YoriLibInitEmptyString(&LineString);
+    Result = TRUE;
 
-    while (TRUE) {
+    OutputIsConsole = GetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), &ConsoleMode);
 
-        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
-            break;
-        }
+    if (!OutputIsConsole && IconvCanProcessInBlocks(IconvContext->SourceEncoding)) {
+        Result = IconvProcessStreamInBlocks(hSource, IconvContext);
+    } else {
+        while (TRUE) {
 
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &LineString);
-        if (LineString.LengthInChars == 0 || !GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ScreenInfo) || ScreenInfo.dwCursorPosition.X != 0) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+            if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+                break;
+            }
+
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &LineString);
+            if (LineString.LengthInChars == 0 ||
+                !OutputIsConsole ||
+                !GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ScreenInfo) ||
+                ScreenInfo.dwCursorPosition.X != 0) {
+
+                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+            }
         }
     }
 
@@ -147,7 +484,7 @@ IconvProcessStream(
     YoriLibLineReadClose(LineContext);
     YoriLibFreeStringContents(&LineString);
 
-    return TRUE;
+    return Result;
 }
 
 /**
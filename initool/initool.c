@@ -81,18 +81,27 @@ IniToolDeleteFromIniFile(
     )
 {
     YORI_STRING RealFileName;
+    PVOID IniFile;
+    BOOL Result;
 
     if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
         return FALSE;
     }
 
-    if (!WritePrivateProfileString(Section->StartOfString, (Key != NULL)?Key->StartOfString:NULL, NULL, RealFileName.StartOfString)) {
-        YoriLibFreeStringContents(&RealFileName);
+    IniFile = YoriLibIniOpen(&RealFileName);
+    YoriLibFreeStringContents(&RealFileName);
+    if (IniFile == NULL) {
         return FALSE;
     }
 
-    YoriLibFreeStringContents(&RealFileName);
-    return TRUE;
+    //
+    //  Deleting something that doesn't exist is not an error.
+    //
+
+    YoriLibIniDelete(IniFile, Section, Key);
+    Result = YoriLibIniWrite(IniFile);
+    YoriLibIniClose(IniFile);
+    return Result;
 }
 
 /**
@@ -111,29 +120,28 @@ IniToolListSectionFromIniFile(
     )
 {
     YORI_STRING RealFileName;
+    YORI_STRING Key;
     YORI_STRING Value;
-    LPTSTR ThisVar;
+    PVOID IniFile;
+    PVOID Position;
 
     if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&Value, 64 * 1024)) {
-        YoriLibFreeStringContents(&RealFileName);
+    IniFile = YoriLibIniOpen(&RealFileName);
+    YoriLibFreeStringContents(&RealFileName);
+    if (IniFile == NULL) {
         return FALSE;
     }
 
-    Value.LengthInChars = GetPrivateProfileSection(Section->StartOfString, Value.StartOfString, Value.LengthAllocated, RealFileName.StartOfString);
-    ThisVar = Value.StartOfString;
-    while (*ThisVar != '\0') {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%s\n"), ThisVar);
-
-        ThisVar += _tcslen(ThisVar);
-        ThisVar++;
+    Position = YoriLibIniGetNextKey(IniFile, Section, NULL, &Key, &Value);
+    while (Position != NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y=%y\n"), &Key, &Value);
+        Position = YoriLibIniGetNextKey(IniFile, Section, Position, &Key, &Value);
     }
 
-    YoriLibFreeStringContents(&RealFileName);
-    YoriLibFreeStringContents(&Value);
+    YoriLibIniClose(IniFile);
     return TRUE;
 }
 
@@ -150,33 +158,27 @@ IniToolListSectionsFromIniFile(
     )
 {
     YORI_STRING RealFileName;
-    YORI_STRING Value;
-    LPTSTR ThisVar;
-
-    if (DllKernel32.pGetPrivateProfileSectionNamesW == NULL) {
-        return FALSE;
-    }
+    YORI_STRING SectionName;
+    PVOID IniFile;
+    PVOID Position;
 
     if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&Value, 64 * 1024)) {
-        YoriLibFreeStringContents(&RealFileName);
+    IniFile = YoriLibIniOpen(&RealFileName);
+    YoriLibFreeStringContents(&RealFileName);
+    if (IniFile == NULL) {
         return FALSE;
     }
 
-    Value.LengthInChars = DllKernel32.pGetPrivateProfileSectionNamesW(Value.StartOfString, Value.LengthAllocated, RealFileName.StartOfString);
-    ThisVar = Value.StartOfString;
-    while (*ThisVar != '\0') {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%s\n"), ThisVar);
-
-        ThisVar += _tcslen(ThisVar);
-        ThisVar++;
+    Position = YoriLibIniGetNextSection(IniFile, NULL, &SectionName);
+    while (Position != NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &SectionName);
+        Position = YoriLibIniGetNextSection(IniFile, Position, &SectionName);
     }
 
-    YoriLibFreeStringContents(&RealFileName);
-    YoriLibFreeStringContents(&Value);
+    YoriLibIniClose(IniFile);
     return TRUE;
 }
 
@@ -200,21 +202,24 @@ IniToolReadFromIniFile(
 {
     YORI_STRING RealFileName;
     YORI_STRING Value;
+    PVOID IniFile;
 
     if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&Value, 16 * 1024)) {
-        YoriLibFreeStringContents(&RealFileName);
+    IniFile = YoriLibIniOpen(&RealFileName);
+    YoriLibFreeStringContents(&RealFileName);
+    if (IniFile == NULL) {
         return FALSE;
     }
 
-    Value.LengthInChars = GetPrivateProfileString(Section->StartOfString, Key->StartOfString, _T(""), Value.StartOfString, Value.LengthAllocated, RealFileName.StartOfString);
-    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Value);
+    if (YoriLibIniGetString(IniFile, Section, Key, &Value)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Value);
+        YoriLibFreeStringContents(&Value);
+    }
 
-    YoriLibFreeStringContents(&RealFileName);
-    YoriLibFreeStringContents(&Value);
+    YoriLibIniClose(IniFile);
     return TRUE;
 }
 
@@ -240,18 +245,26 @@ IniToolWriteToIniFile(
     )
 {
     YORI_STRING RealFileName;
+    PVOID IniFile;
+    BOOL Result;
 
     if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
         return FALSE;
     }
 
-    if (!WritePrivateProfileString(Section->StartOfString, Key->StartOfString, Value->StartOfString, RealFileName.StartOfString)) {
-        YoriLibFreeStringContents(&RealFileName);
+    IniFile = YoriLibIniOpen(&RealFileName);
+    YoriLibFreeStringContents(&RealFileName);
+    if (IniFile == NULL) {
         return FALSE;
     }
 
-    YoriLibFreeStringContents(&RealFileName);
-    return TRUE;
+    Result = FALSE;
+    if (YoriLibIniSetString(IniFile, Section, Key, Value)) {
+        Result = YoriLibIniWrite(IniFile);
+    }
+
+    YoriLibIniClose(IniFile);
+    return Result;
 }
 
 /**
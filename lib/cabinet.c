@@ -27,6 +27,185 @@
 #include <yoripch.h>
 #include <yorilib.h>
 
+/**
+ The maximum number of threads to use to write files being extracted.
+ */
+#define YORI_LIB_CAB_MAX_WRITERS (4)
+
+/**
+ The maximum number of blocks of extracted data that can be waiting to be
+ written at any one time.  This bounds the memory used when decompression
+ is faster than the disk.
+ */
+#define YORI_LIB_CAB_MAX_PENDING_WRITES (64)
+
+/**
+ A single thread writing extracted files to disk.  Each extracted file is
+ assigned to one writer, so all operations on a file occur in order.
+ */
+typedef struct _YORI_LIB_CAB_WRITER {
+
+    /**
+     Pointer to the pool that this writer is part of.
+     */
+    struct _YORI_LIB_CAB_WRITER_POOL *Pool;
+
+    /**
+     A handle to the thread performing writes.
+     */
+    HANDLE Thread;
+
+    /**
+     A semaphore which is signalled once for each item added to WorkList.
+     */
+    HANDLE WorkAvailable;
+
+    /**
+     A list of YORI_LIB_CAB_WORK_ITEMs for this writer to process.  This is
+     protected by the pool's Mutex.
+     */
+    YORI_LIST_ENTRY WorkList;
+} YORI_LIB_CAB_WRITER, *PYORI_LIB_CAB_WRITER;
+
+/**
+ A set of threads writing extracted files to disk, allowing the writes to
+ overlap with decompression of subsequent data.
+ */
+typedef struct _YORI_LIB_CAB_WRITER_POOL {
+
+    /**
+     A mutex protecting the work lists, CompletedList, Error and ErrorPath.
+     */
+    HANDLE Mutex;
+
+    /**
+     A semaphore counting the number of blocks of data that can be queued
+     before waiting for a writer to complete an earlier block.
+     */
+    HANDLE WriteSlots;
+
+    /**
+     The number of elements in the Writers array that have threads.
+     */
+    DWORD WriterCount;
+
+    /**
+     The writer to assign the next extracted file to.
+     */
+    DWORD NextWriter;
+
+    /**
+     A list of YORI_LIB_CAB_FDI_FILEs which have been completely written
+     and are waiting for the extract complete callback to be invoked.
+     */
+    YORI_LIST_ENTRY CompletedList;
+
+    /**
+     The first Win32 error encountered when writing any file, or
+     ERROR_SUCCESS if no error has occurred.
+     */
+    DWORD Error;
+
+    /**
+     The file that was being written when Error occurred.
+     */
+    YORI_STRING ErrorPath;
+
+    /**
+     The threads writing to files.
+     */
+    YORI_LIB_CAB_WRITER Writers[YORI_LIB_CAB_MAX_WRITERS];
+} YORI_LIB_CAB_WRITER_POOL, *PYORI_LIB_CAB_WRITER_POOL;
+
+/**
+ A file opened by FDI.  FDI only refers to files by an opaque value, which
+ is a pointer to this structure.  This allows writes to files being
+ extracted to be issued on a writer thread while the cabinet itself is
+ accessed synchronously.
+ */
+typedef struct _YORI_LIB_CAB_FDI_FILE {
+
+    /**
+     The list of files which have been completely written.  This is only
+     meaningful when the file is in the pool's CompletedList.
+     */
+    YORI_LIST_ENTRY CompletedListEntry;
+
+    /**
+     The Win32 handle to the file.
+     */
+    HANDLE FileHandle;
+
+    /**
+     The writer responsible for all writes to this file, or NULL if writes
+     are performed synchronously.
+     */
+    PYORI_LIB_CAB_WRITER Writer;
+
+    /**
+     The first Win32 error encountered writing this file.  This is only
+     updated by the writer thread.
+     */
+    DWORD Error;
+
+    /**
+     For a file being extracted, the full path to the file.
+     */
+    YORI_STRING FullPath;
+
+    /**
+     For a file being extracted, the path of the file relative to the
+     target directory.
+     */
+    YORI_STRING FileName;
+} YORI_LIB_CAB_FDI_FILE, *PYORI_LIB_CAB_FDI_FILE;
+
+/**
+ The type of operation for a writer thread to perform.
+ */
+typedef enum _YORI_LIB_CAB_WORK_TYPE {
+    YoriLibCabWorkWrite = 1,
+    YoriLibCabWorkClose = 2,
+    YoriLibCabWorkAbortClose = 3
+} YORI_LIB_CAB_WORK_TYPE;
+
+/**
+ A single operation for a writer thread to perform.  For a write, the data
+ to write immediately follows this structure.
+ */
+typedef struct _YORI_LIB_CAB_WORK_ITEM {
+
+    /**
+     The list of work items for the writer.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The type of operation to perform.
+     */
+    YORI_LIB_CAB_WORK_TYPE Type;
+
+    /**
+     The file to operate on.
+     */
+    PYORI_LIB_CAB_FDI_FILE File;
+
+    /**
+     For a write, the number of bytes of data following this structure.
+     */
+    DWORD Length;
+
+    /**
+     For a close, the attributes to apply to the file.
+     */
+    DWORD Attributes;
+
+    /**
+     For a close, the timestamp to apply to the file.
+     */
+    FILETIME FileTime;
+} YORI_LIB_CAB_WORK_ITEM, *PYORI_LIB_CAB_WORK_ITEM;
+
 /**
  Context information to pass around as files are being expanded.
  */
@@ -84,8 +263,310 @@ typedef struct _YORI_LIB_CAB_EXPAND_CONTEXT {
      */
     PYORI_STRING ErrorString;
 
+    /**
+     Optionally points to a pool of threads to write extracted files.  If
+     NULL, files are written synchronously.
+     */
+    PYORI_LIB_CAB_WRITER_POOL WriterPool;
+
 } YORI_LIB_CAB_EXPAND_CONTEXT, *PYORI_LIB_CAB_EXPAND_CONTEXT;
 
+/**
+ Free a file opened by FDI.  The file handle must already be closed.
+
+ @param File Pointer to the file to free.
+ */
+VOID
+YoriLibCabFreeFdiFile(
+    __in PYORI_LIB_CAB_FDI_FILE File
+    )
+{
+    YoriLibFreeStringContents(&File->FullPath);
+    YoriLibFreeStringContents(&File->FileName);
+    YoriLibFree(File);
+}
+
+/**
+ Add an operation to the queue for a writer thread.
+
+ @param Writer Pointer to the writer to perform the operation.
+
+ @param WorkItem Pointer to the operation to perform.  This is freed by the
+        writer once processed.
+ */
+VOID
+YoriLibCabQueueWork(
+    __in PYORI_LIB_CAB_WRITER Writer,
+    __in PYORI_LIB_CAB_WORK_ITEM WorkItem
+    )
+{
+    WaitForSingleObject(Writer->Pool->Mutex, INFINITE);
+    YoriLibAppendList(&Writer->WorkList, &WorkItem->ListEntry);
+    ReleaseMutex(Writer->Pool->Mutex);
+    ReleaseSemaphore(Writer->WorkAvailable, 1, NULL);
+}
+
+/**
+ A thread which performs writes and closes of files being extracted until
+ it is asked to stop.
+
+ @param Context Pointer to the YORI_LIB_CAB_WRITER for this thread.
+
+ @return Zero.
+ */
+DWORD WINAPI
+YoriLibCabWriterThread(
+    __in LPVOID Context
+    )
+{
+    PYORI_LIB_CAB_WRITER Writer;
+    PYORI_LIB_CAB_WRITER_POOL Pool;
+    PYORI_LIB_CAB_WORK_ITEM WorkItem;
+    PYORI_LIB_CAB_FDI_FILE File;
+    PYORI_LIST_ENTRY ListEntry;
+    YORI_LIB_CAB_WORK_TYPE Type;
+    DWORD BytesWritten;
+
+    Writer = (PYORI_LIB_CAB_WRITER)Context;
+    Pool = Writer->Pool;
+
+    while (TRUE) {
+        WaitForSingleObject(Writer->WorkAvailable, INFINITE);
+
+        //
+        //  The semaphore is signalled once per item, and once more when the
+        //  pool is being destroyed.  Since items are processed in order,
+        //  finding the list empty means every item has been processed and
+        //  the thread should exit.
+        //
+
+        WaitForSingleObject(Pool->Mutex, INFINITE);
+        ListEntry = YoriLibGetNextListEntry(&Writer->WorkList, NULL);
+        if (ListEntry == NULL) {
+            ReleaseMutex(Pool->Mutex);
+            break;
+        }
+        YoriLibRemoveListItem(ListEntry);
+        ReleaseMutex(Pool->Mutex);
+
+        WorkItem = CONTAINING_RECORD(ListEntry, YORI_LIB_CAB_WORK_ITEM, ListEntry);
+        File = WorkItem->File;
+        Type = WorkItem->Type;
+
+        if (Type == YoriLibCabWorkWrite) {
+            if (File->Error == ERROR_SUCCESS) {
+                if (!WriteFile(File->FileHandle, WorkItem + 1, WorkItem->Length, &BytesWritten, NULL)) {
+                    File->Error = GetLastError();
+                } else if (BytesWritten != WorkItem->Length) {
+                    File->Error = ERROR_WRITE_FAULT;
+                }
+            }
+            ReleaseSemaphore(Pool->WriteSlots, 1, NULL);
+
+        } else if (Type == YoriLibCabWorkClose) {
+            SetFileTime(File->FileHandle, &WorkItem->FileTime, &WorkItem->FileTime, &WorkItem->FileTime);
+            CloseHandle(File->FileHandle);
+            if (File->Error == ERROR_SUCCESS) {
+                SetFileAttributes(File->FullPath.StartOfString, WorkItem->Attributes);
+            }
+
+            //
+            //  Hand the file back to the extracting thread so it can invoke
+            //  the complete callback, or record the failure.
+            //
+
+            WaitForSingleObject(Pool->Mutex, INFINITE);
+            if (File->Error == ERROR_SUCCESS) {
+                YoriLibAppendList(&Pool->CompletedList, &File->CompletedListEntry);
+                File = NULL;
+            } else if (Pool->Error == ERROR_SUCCESS) {
+                Pool->Error = File->Error;
+                YoriLibCloneString(&Pool->ErrorPath, &File->FullPath);
+            }
+            ReleaseMutex(Pool->Mutex);
+
+            if (File != NULL) {
+                YoriLibCabFreeFdiFile(File);
+            }
+
+        } else if (Type == YoriLibCabWorkAbortClose) {
+            CloseHandle(File->FileHandle);
+            YoriLibCabFreeFdiFile(File);
+        }
+
+        YoriLibFree(WorkItem);
+    }
+
+    return 0;
+}
+
+/**
+ Stop all writer threads once they have completed any outstanding work.
+
+ @param Pool Pointer to the writer pool.
+ */
+VOID
+YoriLibCabStopWriterPool(
+    __in PYORI_LIB_CAB_WRITER_POOL Pool
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < Pool->WriterCount; Index++) {
+        ReleaseSemaphore(Pool->Writers[Index].WorkAvailable, 1, NULL);
+        WaitForSingleObject(Pool->Writers[Index].Thread, INFINITE);
+        CloseHandle(Pool->Writers[Index].Thread);
+        Pool->Writers[Index].Thread = NULL;
+    }
+    Pool->WriterCount = 0;
+}
+
+/**
+ Stop all writer threads once they have completed any outstanding work, and
+ free the writer pool.  Any files on the completed list are freed without
+ invoking a callback.
+
+ @param Pool Pointer to the writer pool.
+ */
+VOID
+YoriLibCabDestroyWriterPool(
+    __in PYORI_LIB_CAB_WRITER_POOL Pool
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_CAB_FDI_FILE File;
+    DWORD Index;
+
+    YoriLibCabStopWriterPool(Pool);
+
+    for (Index = 0; Index < YORI_LIB_CAB_MAX_WRITERS; Index++) {
+        if (Pool->Writers[Index].WorkAvailable != NULL) {
+            CloseHandle(Pool->Writers[Index].WorkAvailable);
+        }
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Pool->CompletedList, NULL);
+    while (ListEntry != NULL) {
+        File = CONTAINING_RECORD(ListEntry, YORI_LIB_CAB_FDI_FILE, CompletedListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Pool->CompletedList, ListEntry);
+        YoriLibRemoveListItem(&File->CompletedListEntry);
+        YoriLibCabFreeFdiFile(File);
+    }
+
+    if (Pool->WriteSlots != NULL) {
+        CloseHandle(Pool->WriteSlots);
+    }
+    if (Pool->Mutex != NULL) {
+        CloseHandle(Pool->Mutex);
+    }
+    YoriLibFreeStringContents(&Pool->ErrorPath);
+    YoriLibFree(Pool);
+}
+
+/**
+ Create a pool of threads to write files being extracted.  One thread is
+ created per processor, up to YORI_LIB_CAB_MAX_WRITERS.
+
+ @return Pointer to the writer pool, or NULL if it could not be created, in
+         which case files should be written synchronously.
+ */
+PYORI_LIB_CAB_WRITER_POOL
+YoriLibCabCreateWriterPool(VOID)
+{
+    PYORI_LIB_CAB_WRITER_POOL Pool;
+    SYSTEM_INFO SysInfo;
+    DWORD WritersWanted;
+    DWORD Index;
+    DWORD ThreadId;
+
+    Pool = YoriLibMalloc(sizeof(YORI_LIB_CAB_WRITER_POOL));
+    if (Pool == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Pool, sizeof(YORI_LIB_CAB_WRITER_POOL));
+    YoriLibInitializeListHead(&Pool->CompletedList);
+
+    Pool->Mutex = CreateMutex(NULL, FALSE, NULL);
+    Pool->WriteSlots = CreateSemaphore(NULL, YORI_LIB_CAB_MAX_PENDING_WRITES, YORI_LIB_CAB_MAX_PENDING_WRITES, NULL);
+    if (Pool->Mutex == NULL || Pool->WriteSlots == NULL) {
+        YoriLibCabDestroyWriterPool(Pool);
+        return NULL;
+    }
+
+    GetSystemInfo(&SysInfo);
+    WritersWanted = SysInfo.dwNumberOfProcessors;
+    if (WritersWanted > YORI_LIB_CAB_MAX_WRITERS) {
+        WritersWanted = YORI_LIB_CAB_MAX_WRITERS;
+    }
+    if (WritersWanted == 0) {
+        WritersWanted = 1;
+    }
+
+    for (Index = 0; Index < WritersWanted; Index++) {
+        Pool->Writers[Index].Pool = Pool;
+        YoriLibInitializeListHead(&Pool->Writers[Index].WorkList);
+        Pool->Writers[Index].WorkAvailable = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+        if (Pool->Writers[Index].WorkAvailable == NULL) {
+            break;
+        }
+        Pool->Writers[Index].Thread = CreateThread(NULL, 0, YoriLibCabWriterThread, &Pool->Writers[Index], 0, &ThreadId);
+        if (Pool->Writers[Index].Thread == NULL) {
+            break;
+        }
+        Pool->WriterCount++;
+    }
+
+    if (Pool->WriterCount == 0) {
+        YoriLibCabDestroyWriterPool(Pool);
+        return NULL;
+    }
+
+    return Pool;
+}
+
+/**
+ Invoke the complete extract callback for all files that writer threads
+ have finished writing.  This is called on the extracting thread so that
+ callbacks are never invoked concurrently.
+
+ @param ExpandContext Pointer to the context for the extract operation.
+ */
+VOID
+YoriLibCabProcessCompletedFiles(
+    __in PYORI_LIB_CAB_EXPAND_CONTEXT ExpandContext
+    )
+{
+    PYORI_LIB_CAB_WRITER_POOL Pool;
+    YORI_LIST_ENTRY CompletedList;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_CAB_FDI_FILE File;
+
+    Pool = ExpandContext->WriterPool;
+    YoriLibInitializeListHead(&CompletedList);
+
+    WaitForSingleObject(Pool->Mutex, INFINITE);
+    ListEntry = YoriLibGetNextListEntry(&Pool->CompletedList, NULL);
+    while (ListEntry != NULL) {
+        YoriLibRemoveListItem(ListEntry);
+        YoriLibAppendList(&CompletedList, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Pool->CompletedList, NULL);
+    }
+    ReleaseMutex(Pool->Mutex);
+
+    ListEntry = YoriLibGetNextListEntry(&CompletedList, NULL);
+    while (ListEntry != NULL) {
+        File = CONTAINING_RECORD(ListEntry, YORI_LIB_CAB_FDI_FILE, CompletedListEntry);
+        ListEntry = YoriLibGetNextListEntry(&CompletedList, ListEntry);
+        YoriLibRemoveListItem(&File->CompletedListEntry);
+
+        if (ExpandContext->CompleteExtractCallback != NULL) {
+            ExpandContext->CompleteExtractCallback(&File->FullPath, &File->FileName, ExpandContext->UserContext);
+        }
+        YoriLibCabFreeFdiFile(File);
+    }
+}
+
 /**
  A callback invoked during FDICopy to allocate memory.
 
@@ -256,7 +737,8 @@ YoriLibCabFciFileOpen(
 
  @param PMode No idea (per MSDN.)
 
- @return File handle.
+ @return Pointer to a YORI_LIB_CAB_FDI_FILE describing the opened file,
+         or INVALID_HANDLE_VALUE on failure.
  */
 DWORD_PTR DIAMONDAPI
 YoriLibCabFdiFileOpen(
@@ -265,7 +747,23 @@ YoriLibCabFdiFileOpen(
     __in INT PMode
     )
 {
-    return YoriLibCabFciFileOpen(FileName, OFlag, PMode, NULL, NULL);
+    PYORI_LIB_CAB_FDI_FILE File;
+    DWORD_PTR Handle;
+
+    File = YoriLibMalloc(sizeof(YORI_LIB_CAB_FDI_FILE));
+    if (File == NULL) {
+        return (DWORD_PTR)INVALID_HANDLE_VALUE;
+    }
+
+    Handle = YoriLibCabFciFileOpen(FileName, OFlag, PMode, NULL, NULL);
+    if (Handle == (DWORD_PTR)INVALID_HANDLE_VALUE) {
+        YoriLibFree(File);
+        return Handle;
+    }
+
+    ZeroMemory(File, sizeof(YORI_LIB_CAB_FDI_FILE));
+    File->FileHandle = (HANDLE)Handle;
+    return (DWORD_PTR)File;
 }
 
 
@@ -517,7 +1015,7 @@ YoriLibCabFciFileRead(
  A callback invoked during FDICopy to read from a file.  Note that these
  callbacks always refer to the "current file position".
  
- @param FileHandle The file to read from.
+ @param FileHandle Pointer to the YORI_LIB_CAB_FDI_FILE to read from.
  
  @param Buffer Pointer to a block of memory to place read data.
 
@@ -532,7 +1030,9 @@ YoriLibCabFdiFileRead(
     __in DWORD ByteCount
     )
 {
-    return YoriLibCabFciFileRead(FileHandle, Buffer, ByteCount, NULL, NULL);
+    PYORI_LIB_CAB_FDI_FILE File;
+    File = (PYORI_LIB_CAB_FDI_FILE)FileHandle;
+    return YoriLibCabFciFileRead((DWORD_PTR)File->FileHandle, Buffer, ByteCount, NULL, NULL);
 }
 
 /**
@@ -579,7 +1079,11 @@ YoriLibCabFciFileWrite(
  A callback invoked during FDICopy to write to file.  Note that these
  callbacks always refer to the "current file position".
  
- @param FileHandle The file to write to.
+ If the file is being written by a writer thread, the data is copied and
+ queued to the writer, and this function returns without waiting for the
+ write to occur.  Any failure is reported when extraction completes.
+
+ @param FileHandle Pointer to the YORI_LIB_CAB_FDI_FILE to write to.
  
  @param Buffer Pointer to a block of memory containing data to write.
 
@@ -594,7 +1098,28 @@ YoriLibCabFdiFileWrite(
     __in DWORD ByteCount
     )
 {
-    return YoriLibCabFciFileWrite(FileHandle, Buffer, ByteCount, NULL, NULL);
+    PYORI_LIB_CAB_FDI_FILE File;
+    PYORI_LIB_CAB_WORK_ITEM WorkItem;
+
+    File = (PYORI_LIB_CAB_FDI_FILE)FileHandle;
+    if (File->Writer == NULL) {
+        return YoriLibCabFciFileWrite((DWORD_PTR)File->FileHandle, Buffer, ByteCount, NULL, NULL);
+    }
+
+    WorkItem = YoriLibMalloc(sizeof(YORI_LIB_CAB_WORK_ITEM) + ByteCount);
+    if (WorkItem == NULL) {
+        return (DWORD)-1;
+    }
+
+    ZeroMemory(WorkItem, sizeof(YORI_LIB_CAB_WORK_ITEM));
+    WorkItem->Type = YoriLibCabWorkWrite;
+    WorkItem->File = File;
+    WorkItem->Length = ByteCount;
+    memcpy(WorkItem + 1, Buffer, ByteCount);
+
+    WaitForSingleObject(File->Writer->Pool->WriteSlots, INFINITE);
+    YoriLibCabQueueWork(File->Writer, WorkItem);
+    return ByteCount;
 }
 
 /**
@@ -626,7 +1151,7 @@ YoriLibCabFciFileClose(
 /**
  A callback invoked during FDICopy to close a file.
  
- @param FileHandle The file to close.
+ @param FileHandle Pointer to the YORI_LIB_CAB_FDI_FILE to close.
 
  @return Zero for success, nonzero to indicate an error.
  */
@@ -635,7 +1160,39 @@ YoriLibCabFdiFileClose(
     __in DWORD_PTR FileHandle
     )
 {
-    return YoriLibCabFciFileClose(FileHandle, NULL, NULL);
+    PYORI_LIB_CAB_FDI_FILE File;
+    PYORI_LIB_CAB_WORK_ITEM WorkItem;
+
+    File = (PYORI_LIB_CAB_FDI_FILE)FileHandle;
+
+    //
+    //  If the file has a writer, the close needs to happen after any
+    //  queued writes.  FDI only closes files it didn't open itself when
+    //  extraction is being abandoned, so the file is not reported as
+    //  complete.
+    //
+
+    if (File->Writer != NULL) {
+        WorkItem = YoriLibMalloc(sizeof(YORI_LIB_CAB_WORK_ITEM));
+        if (WorkItem != NULL) {
+            ZeroMemory(WorkItem, sizeof(YORI_LIB_CAB_WORK_ITEM));
+            WorkItem->Type = YoriLibCabWorkAbortClose;
+            WorkItem->File = File;
+            YoriLibCabQueueWork(File->Writer, WorkItem);
+            return 0;
+        }
+
+        //
+        //  If memory can't be allocated, orphan the file rather than
+        //  closing its handle while a writer may be using it.
+        //
+
+        return -1;
+    }
+
+    YoriLibCabFciFileClose((DWORD_PTR)File->FileHandle, NULL, NULL);
+    YoriLibCabFreeFdiFile(File);
+    return 0;
 }
 
 /**
@@ -679,7 +1236,8 @@ YoriLibCabFciFileSeek(
 /**
  A callback invoked during FDICopy to change current file position.
  
- @param FileHandle The file to set current position on.
+ @param FileHandle Pointer to the YORI_LIB_CAB_FDI_FILE to set current
+        position on.
 
  @param DistanceToMove The number of bytes to move.
 
@@ -694,7 +1252,9 @@ YoriLibCabFdiFileSeek(
     __in INT SeekType
     )
 {
-    return YoriLibCabFciFileSeek(FileHandle, DistanceToMove, SeekType, NULL, NULL);
+    PYORI_LIB_CAB_FDI_FILE File;
+    File = (PYORI_LIB_CAB_FDI_FILE)FileHandle;
+    return YoriLibCabFciFileSeek((DWORD_PTR)File->FileHandle, DistanceToMove, SeekType, NULL, NULL);
 }
 
 /**
@@ -866,7 +1426,7 @@ YoriLibCabFciGetOpenInfo(
     UNREFERENCED_PARAMETER(Err);
     UNREFERENCED_PARAMETER(Context);
 
-    Handle = YoriLibCabFdiFileOpen(FileName, YORI_LIB_CAB_OPEN_READONLY, 0);
+    Handle = YoriLibCabFciFileOpen(FileName, YORI_LIB_CAB_OPEN_READONLY, 0, NULL, NULL);
     if (Handle == (DWORD_PTR)INVALID_HANDLE_VALUE) {
         return Handle;
     }
@@ -905,6 +1465,9 @@ YoriLibCabNotify(
     LARGE_INTEGER liTemp;
     TIME_ZONE_INFORMATION Tzi;
     PYORI_LIB_CAB_EXPAND_CONTEXT ExpandContext;
+    PYORI_LIB_CAB_WRITER_POOL Pool;
+    PYORI_LIB_CAB_FDI_FILE File;
+    PYORI_LIB_CAB_WORK_ITEM WorkItem;
     YORI_STRING FullPath;
     YORI_STRING FileName;
     DWORD_PTR Handle;
@@ -929,6 +1492,33 @@ YoriLibCabNotify(
             } else {
                 Handle = 0;
             }
+
+            if (Handle != 0 && Handle != (DWORD_PTR)INVALID_HANDLE_VALUE) {
+                File = YoriLibMalloc(sizeof(YORI_LIB_CAB_FDI_FILE));
+                if (File == NULL) {
+                    CloseHandle((HANDLE)Handle);
+                    Handle = (DWORD_PTR)INVALID_HANDLE_VALUE;
+                } else {
+                    ZeroMemory(File, sizeof(YORI_LIB_CAB_FDI_FILE));
+                    File->FileHandle = (HANDLE)Handle;
+                    YoriLibCloneString(&File->FullPath, &FullPath);
+                    YoriLibCloneString(&File->FileName, &FileName);
+
+                    //
+                    //  If writer threads are available, distribute files
+                    //  across them.  All writes to a single file are
+                    //  performed by the same writer so they occur in order.
+                    //
+
+                    Pool = ExpandContext->WriterPool;
+                    if (Pool != NULL && Pool->WriterCount > 0) {
+                        File->Writer = &Pool->Writers[Pool->NextWriter % Pool->WriterCount];
+                        Pool->NextWriter++;
+                    }
+                    Handle = (DWORD_PTR)File;
+                }
+            }
+
             YoriLibFreeStringContents(&FullPath);
             YoriLibFreeStringContents(&FileName);
             return Handle;
@@ -951,23 +1541,44 @@ YoriLibCabNotify(
             TimeToSet.dwLowDateTime = liTemp.LowPart;
             TimeToSet.dwHighDateTime = liTemp.HighPart;
 
+            ExpandContext = (PYORI_LIB_CAB_EXPAND_CONTEXT)Notification->Context;
+            File = (PYORI_LIB_CAB_FDI_FILE)Notification->FileHandle;
+
             //
-            //  Set the time on the file
+            //  If the file is being written by a writer thread, ask it to
+            //  set the time and attributes and close the file once all
+            //  writes are complete.  The complete callback is invoked from
+            //  this thread once the writer has finished.
             //
 
-            SetFileTime((HANDLE)Notification->FileHandle, &TimeToSet, &TimeToSet, &TimeToSet);
-            YoriLibCabFdiFileClose(Notification->FileHandle);
+            if (File->Writer != NULL) {
+                WorkItem = YoriLibMalloc(sizeof(YORI_LIB_CAB_WORK_ITEM));
+                if (WorkItem == NULL) {
+                    return (DWORD_PTR)-1;
+                }
+                ZeroMemory(WorkItem, sizeof(YORI_LIB_CAB_WORK_ITEM));
+                WorkItem->Type = YoriLibCabWorkClose;
+                WorkItem->File = File;
+                WorkItem->FileTime = TimeToSet;
+                WorkItem->Attributes = Notification->HalfAttributes;
+                YoriLibCabQueueWork(File->Writer, WorkItem);
+
+                YoriLibCabProcessCompletedFiles(ExpandContext);
+                return 1;
+            }
+
+            //
+            //  Set the time on the file
+            //
 
-            ExpandContext = (PYORI_LIB_CAB_EXPAND_CONTEXT)Notification->Context;
-            if (YoriLibCabBuildFileNames(ExpandContext->TargetDirectory, Notification->String1, &FullPath, &FileName)) {
-                SetFileAttributes(FullPath.StartOfString, Notification->HalfAttributes);
+            SetFileTime(File->FileHandle, &TimeToSet, &TimeToSet, &TimeToSet);
+            CloseHandle(File->FileHandle);
+            SetFileAttributes(File->FullPath.StartOfString, Notification->HalfAttributes);
 
-                if (ExpandContext->CompleteExtractCallback != NULL) {
-                    ExpandContext->CompleteExtractCallback(&FullPath, &FileName, ExpandContext->UserContext);
-                }
-                YoriLibFreeStringContents(&FullPath);
-                YoriLibFreeStringContents(&FileName);
+            if (ExpandContext->CompleteExtractCallback != NULL) {
+                ExpandContext->CompleteExtractCallback(&File->FullPath, &File->FileName, ExpandContext->UserContext);
             }
+            YoriLibCabFreeFdiFile(File);
             return 1;
         case YoriLibCabNotifyNextCabinet:
             if (Notification->FdiError != 0) {
@@ -1158,6 +1769,14 @@ YoriLibExtractCab(
 
     ExpandContext.TargetDirectory = &FullTargetDirectory;
 
+    //
+    //  Writes to extracted files are performed by a pool of writer threads
+    //  so that decompression is not stalled waiting for the disk.  If the
+    //  pool can't be created, files are written synchronously.
+    //
+
+    ExpandContext.WriterPool = YoriLibCabCreateWriterPool();
+
     if (!DllCabinet.pFdiCopy(hFdi,
                              AnsiCabFileName,
                              AnsiCabParentDirectory,
@@ -1174,6 +1793,27 @@ YoriLibExtractCab(
     Result = TRUE;
 Exit:
 
+    //
+    //  Wait for all outstanding writes to complete, invoke callbacks for
+    //  the files that were written, and report the first write failure.
+    //
+
+    if (ExpandContext.WriterPool != NULL) {
+        YoriLibCabStopWriterPool(ExpandContext.WriterPool);
+        YoriLibCabProcessCompletedFiles(&ExpandContext);
+        if (ExpandContext.WriterPool->Error != ERROR_SUCCESS) {
+            Result = FALSE;
+            if (ErrorString != NULL && ErrorString->LengthInChars == 0) {
+                LPTSTR ErrText;
+                ErrText = YoriLibGetWinErrorText(ExpandContext.WriterPool->Error);
+                YoriLibYPrintf(ErrorString, _T("Error writing %y: %s"), &ExpandContext.WriterPool->ErrorPath, ErrText);
+                YoriLibFreeWinErrorText(ErrText);
+            }
+        }
+        YoriLibCabDestroyWriterPool(ExpandContext.WriterPool);
+        ExpandContext.WriterPool = NULL;
+    }
+
     if (DllCabinet.pFdiDestroy != NULL && hFdi != NULL) {
         DllCabinet.pFdiDestroy(hFdi);
     }
@@ -774,6 +774,50 @@ YoriCallGetHistoryStrings(
     return pYoriApiGetHistoryStrings(MaximumNumber, HistoryStrings);
 }
 
+/**
+ Prototype for the @ref YoriApiGetJobAccounting function.
+ */
+typedef BOOL YORI_API_GET_JOB_ACCOUNTING(DWORD, PYORI_LIB_JOB_ACCOUNTING);
+
+/**
+ Prototype for a pointer to the @ref YoriApiGetJobAccounting function.
+ */
+typedef YORI_API_GET_JOB_ACCOUNTING *PYORI_API_GET_JOB_ACCOUNTING;
+
+/**
+ Pointer to the @ref YoriApiGetJobAccounting function.
+ */
+PYORI_API_GET_JOB_ACCOUNTING pYoriApiGetJobAccounting;
+
+/**
+ Returns resource usage for all processes that have executed within a job.
+
+ @param JobId The ID to query resource usage for.
+
+ @param Accounting On successful completion, populated with the resource
+        usage of the job.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriCallGetJobAccounting(
+    __in DWORD JobId,
+    __out PYORI_LIB_JOB_ACCOUNTING Accounting
+    )
+{
+    if (pYoriApiGetJobAccounting == NULL) {
+        HMODULE hYori;
+
+        hYori = GetModuleHandle(NULL);
+        pYoriApiGetJobAccounting = (PYORI_API_GET_JOB_ACCOUNTING)GetProcAddress(hYori, "YoriApiGetJobAccounting");
+        if (pYoriApiGetJobAccounting == NULL) {
+            return FALSE;
+        }
+    }
+    return pYoriApiGetJobAccounting(JobId, Accounting);
+}
+
 /**
  Prototype for the @ref YoriApiGetJobInformation function.
  */
@@ -34,9 +34,9 @@
 typedef struct _YORILIB_PENDING_ACTION {
 
     /**
-     A list of files requiring compression.
+     The work queue item for this file.
      */
-    YORI_LIST_ENTRY CompressList;
+    YORI_LIB_WORK_ITEM WorkItem;
 
     /**
      The file name to compress.
@@ -51,6 +51,13 @@ typedef struct _YORILIB_PENDING_ACTION {
 
 } YORILIB_PENDING_ACTION, *PYORILIB_PENDING_ACTION;
 
+BOOL
+YoriLibCompressWorkItem(
+    __in PVOID Context,
+    __in PYORI_LIB_WORK_ITEM WorkItem,
+    __in BOOL Cancelled
+    );
+
 /**
  Set up the compress context to contain support for the compression thread pool.
 
@@ -68,9 +75,6 @@ YoriLibInitializeCompressContext(
     __in YORILIB_COMPRESS_ALGORITHM CompressionAlgorithm
     )
 {
-    SYSTEM_INFO SystemInfo;
-    GetSystemInfo(&SystemInfo);
-
     CompressContext->CompressionAlgorithm = CompressionAlgorithm;
 
     //
@@ -81,32 +85,7 @@ YoriLibInitializeCompressContext(
     //  the threadpool to prevent bottlenecking the copy.
     //
 
-    CompressContext->MaxThreads = SystemInfo.dwNumberOfProcessors;
-    if (CompressContext->MaxThreads < 1) {
-        CompressContext->MaxThreads = 1;
-    }
-    if (CompressContext->MaxThreads > 32) {
-        CompressContext->MaxThreads = 32;
-    }
-
-    YoriLibInitializeListHead(&CompressContext->PendingList);
-    CompressContext->WorkerWaitEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
-    if (CompressContext->WorkerWaitEvent == NULL) {
-        return FALSE;
-    }
-
-    CompressContext->WorkerShutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-    if (CompressContext->WorkerShutdownEvent == NULL) {
-        return FALSE;
-    }
-
-    CompressContext->Mutex = CreateMutex(NULL, FALSE, NULL);
-    if (CompressContext->Mutex == NULL) {
-        return FALSE;
-    }
-
-    CompressContext->Threads = YoriLibMalloc(sizeof(HANDLE) * CompressContext->MaxThreads);
-    if (CompressContext->Threads == NULL) {
+    if (!YoriLibWorkQueueInitialize(&CompressContext->WorkQueue, 0, 0, YoriLibCompressWorkItem, NULL, CompressContext)) {
         return FALSE;
     }
 
@@ -126,32 +105,7 @@ YoriLibFreeCompressContext(
     __in PYORILIB_COMPRESS_CONTEXT CompressContext
     )
 {
-    if (CompressContext->ThreadsAllocated > 0) {
-        DWORD Index;
-        SetEvent(CompressContext->WorkerShutdownEvent);
-        WaitForMultipleObjects(CompressContext->ThreadsAllocated, CompressContext->Threads, TRUE, INFINITE);
-        for (Index = 0; Index < CompressContext->ThreadsAllocated; Index++) {
-            CloseHandle(CompressContext->Threads[Index]);
-            CompressContext->Threads[Index] = NULL;
-        }
-        ASSERT(YoriLibIsListEmpty(&CompressContext->PendingList));
-    }
-    if (CompressContext->WorkerWaitEvent != NULL) {
-        CloseHandle(CompressContext->WorkerWaitEvent);
-        CompressContext->WorkerWaitEvent = NULL;
-    }
-    if (CompressContext->WorkerShutdownEvent != NULL) {
-        CloseHandle(CompressContext->WorkerShutdownEvent);
-        CompressContext->WorkerShutdownEvent = NULL;
-    }
-    if (CompressContext->Mutex != NULL) {
-        CloseHandle(CompressContext->Mutex);
-        CompressContext->Mutex = NULL;
-    }
-    if (CompressContext->Threads != NULL) {
-        YoriLibFree(CompressContext->Threads);
-        CompressContext->Threads = NULL;
-    }
+    YoriLibWorkQueueCleanup(&CompressContext->WorkQueue);
 }
 
 /**
@@ -405,79 +359,46 @@ YoriLibDecompressSingleFile(
 
 
 /**
- A background thread which will attempt to compress any items that it finds on
- a list of files requiring compression.
+ Compress or decompress a single file on a work queue thread.
 
  @param Context Pointer to the compress context.
 
- @return TRUE to indicate success, FALSE to indicate one or more compression
-         operations failed.
+ @param WorkItem Pointer to the work item embedded in the pending action.
+        The pending action is deallocated within this function.
+
+ @param Cancelled TRUE if the user has cancelled the operation, in which case
+        the file is not processed.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
  */
-DWORD WINAPI
-YoriLibCompressWorker(
-    __in LPVOID Context
+BOOL
+YoriLibCompressWorkItem(
+    __in PVOID Context,
+    __in PYORI_LIB_WORK_ITEM WorkItem,
+    __in BOOL Cancelled
     )
 {
     PYORILIB_COMPRESS_CONTEXT CompressContext = (PYORILIB_COMPRESS_CONTEXT)Context;
-    DWORD FoundEvent;
     PYORILIB_PENDING_ACTION PendingAction;
-    BOOL Result = TRUE;
-
-    while (TRUE) {
-
-        //
-        //  Wait for an indication of more work or shutdown.
-        //
 
-        FoundEvent = WaitForMultipleObjects(2, &CompressContext->WorkerWaitEvent, FALSE, INFINITE);
-
-        //
-        //  Process any queued work.
-        //
-
-        while (TRUE) {
-            WaitForSingleObject(CompressContext->Mutex, INFINITE);
-            if (!YoriLibIsListEmpty(&CompressContext->PendingList)) {
-                PendingAction = CONTAINING_RECORD(CompressContext->PendingList.Next, YORILIB_PENDING_ACTION, CompressList);
-                ASSERT(CompressContext->ItemsQueued > 0);
-                CompressContext->ItemsQueued--;
-                YoriLibRemoveListItem(&PendingAction->CompressList);
-                ReleaseMutex(CompressContext->Mutex);
-
-                if (PendingAction->Compress) {
-                    if (!YoriLibCompressSingleFile(PendingAction, CompressContext->CompressionAlgorithm)) {
-                        Result = FALSE;
-                    }
-                } else {
-                    if (!YoriLibDecompressSingleFile(PendingAction)) {
-                        Result = FALSE;
-                    }
-                }
-
-            } else {
-                ASSERT(CompressContext->ItemsQueued == 0);
-                ReleaseMutex(CompressContext->Mutex);
-                break;
-            }
-        }
+    PendingAction = CONTAINING_RECORD(WorkItem, YORILIB_PENDING_ACTION, WorkItem);
 
-        //
-        //  If shutdown was requested, terminate the thread.
-        //
+    if (Cancelled) {
+        YoriLibFree(PendingAction);
+        return FALSE;
+    }
 
-        if (FoundEvent == (WAIT_OBJECT_0 + 1)) {
-            break;
-        }
+    if (PendingAction->Compress) {
+        return YoriLibCompressSingleFile(PendingAction, CompressContext->CompressionAlgorithm);
     }
 
-    return Result;
+    return YoriLibDecompressSingleFile(PendingAction);
 }
 
 /**
  Add a pending action to the queue of items to be performed by background
- threads.  If the background threads already have an excessively large
- queue of work, this function returns FALSE to indicate it should be
- completed by the foreground thread.
+ threads.  If the background threads already have a full queue of work,
+ this function waits for them to take an item.
 
  @param CompressContext Pointer to the compress context describing the state
         of background threads.
@@ -485,7 +406,7 @@ YoriLibCompressWorker(
  @param PendingAction Pointer to the action to perform.
 
  @return TRUE if the action was queued to be processed by background threads,
-         or FALSE if it should be completed by the foreground thread.
+         or FALSE if it could not be queued.
  */
 BOOL
 YoriLibAddToBackgroundCompressQueue(
@@ -493,35 +414,20 @@ YoriLibAddToBackgroundCompressQueue(
     __in PYORILIB_PENDING_ACTION PendingAction
     )
 {
-    BOOL Result = FALSE;
-    DWORD ThreadId;
-
-    WaitForSingleObject(CompressContext->Mutex, INFINITE);
-    if (CompressContext->ThreadsAllocated == 0 ||
-        (CompressContext->ItemsQueued > CompressContext->ThreadsAllocated * 2 &&
-         CompressContext->ThreadsAllocated < CompressContext->MaxThreads)) {
-
-        CompressContext->Threads[CompressContext->ThreadsAllocated] = CreateThread(NULL, 0, YoriLibCompressWorker, CompressContext, 0, &ThreadId);
-        if (CompressContext->Threads[CompressContext->ThreadsAllocated] != NULL) {
-            CompressContext->ThreadsAllocated++;
-            if (CompressContext->Verbose) {
-                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Created compression thread %i\n"), CompressContext->ThreadsAllocated);
-            }
-        }
+    DWORD WorkersStarted;
+
+    WorkersStarted = CompressContext->WorkQueue.WorkersStarted;
+    if (!YoriLibWorkQueueSubmit(&CompressContext->WorkQueue, &PendingAction->WorkItem)) {
+        return FALSE;
     }
 
-    if (CompressContext->ThreadsAllocated > 0 &&
-        CompressContext->ItemsQueued < CompressContext->MaxThreads * 2) {
+    if (CompressContext->Verbose &&
+        CompressContext->WorkQueue.WorkersStarted != WorkersStarted) {
 
-        YoriLibAppendList(&CompressContext->PendingList, &PendingAction->CompressList);
-        CompressContext->ItemsQueued++;
-        Result = TRUE;
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Created compression thread %i\n"), CompressContext->WorkQueue.WorkersStarted);
     }
 
-    ReleaseMutex(CompressContext->Mutex);
-
-    SetEvent(CompressContext->WorkerWaitEvent);
-    return Result;
+    return TRUE;
 }
 
 /**
@@ -565,15 +471,20 @@ YoriLibCompressFileInBackground(
     Result = TRUE;
 
     //
-    //  If the threads in the pool are all busy (we have too many items
-    //  waiting) do the compression on the main thread.  This is mainly done to
-    //  prevent the main thread from continuing to pile in more items that the
-    //  pool can't get to.
+    //  The work queue waits for space if its workers are busy, so this only
+    //  occurs if the operation was cancelled or no worker could be created.
+    //  If it was cancelled, skip the file; otherwise, compress it on the
+    //  main thread.
     //
 
     if (PendingAction != NULL) {
+        if (YoriLibIsOperationCancelled()) {
+            YoriLibFree(PendingAction);
+            Result = FALSE;
+            goto Exit;
+        }
         if (CompressContext->Verbose) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Compressing %y on main thread for back pressure\n"), FileName);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Compressing %y on main thread\n"), FileName);
         }
         if (!YoriLibCompressSingleFile(PendingAction, CompressContext->CompressionAlgorithm)) {
             Result = FALSE;
@@ -624,15 +535,20 @@ YoriLibDecompressFileInBackground(
     Result = TRUE;
 
     //
-    //  If the threads in the pool are all busy (we have too many items
-    //  waiting) do the decompression on the main thread.  This is mainly done
-    //  to prevent the main thread from continuing to pile in more items that
-    //  the pool can't get to.
+    //  The work queue waits for space if its workers are busy, so this only
+    //  occurs if the operation was cancelled or no worker could be created.
+    //  If it was cancelled, skip the file; otherwise, decompress it on the
+    //  main thread.
     //
 
     if (PendingAction != NULL) {
+        if (YoriLibIsOperationCancelled()) {
+            YoriLibFree(PendingAction);
+            Result = FALSE;
+            goto Exit;
+        }
         if (CompressContext->Verbose) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Decompressing %y on main thread for back pressure\n"), FileName);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Decompressing %y on main thread\n"), FileName);
         }
         if (!YoriLibDecompressSingleFile(PendingAction)) {
             Result = FALSE;
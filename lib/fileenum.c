@@ -27,6 +27,23 @@
 #include "yoripch.h"
 #include "yorilib.h"
 
+/**
+ Values for YoriLibFileEnumLargeFetchState, indicating whether the running
+ system supports large fetch enumeration.  The state is determined on the
+ first enumeration and reused for every directory after that.
+ */
+#define YORILIB_FILEENUM_LARGE_FETCH_UNKNOWN     0
+#define YORILIB_FILEENUM_LARGE_FETCH_UNSUPPORTED 1
+#define YORILIB_FILEENUM_LARGE_FETCH_SUPPORTED   2
+
+/**
+ Whether the running system supports large fetch enumeration, as one of
+ the YORILIB_FILEENUM_LARGE_FETCH_ values.  A single value is used so
+ that threads enumerating concurrently either see the final answer or
+ compute the same answer again.
+ */
+DWORD YoriLibFileEnumLargeFetchState;
+
 
 /**
  A dynamically allocated structure so as to avoid putting excessive load
@@ -91,6 +108,65 @@ typedef struct _YORILIB_FOREACHFILE_CONTEXT {
 
 } YORILIB_FOREACHFILE_CONTEXT, *PYORILIB_FOREACHFILE_CONTEXT;
 
+/**
+ Begin enumerating a directory.  On systems that support it, this asks the
+ file system to return results in larger batches, which reduces the number
+ of round trips for large directories, and if the caller has indicated that
+ short file names are not needed, avoids fetching them.  On older systems
+ this is equivalent to FindFirstFile.
+
+ @param FileSpec Pointer to a NULL terminated enumeration criteria.
+
+ @param MatchFlags Specifies the behavior of the match.  This routine only
+        checks for YORILIB_FILEENUM_NO_SHORT_NAMES.
+
+ @param FindData On successful completion, populated with information about
+        the first object found.
+
+ @return A handle to the enumeration, or INVALID_HANDLE_VALUE on failure.
+ */
+HANDLE
+YoriLibFileEnumFindFirst(
+    __in LPCTSTR FileSpec,
+    __in DWORD MatchFlags,
+    __out PWIN32_FIND_DATA FindData
+    )
+{
+    DWORD OsMajor;
+    DWORD OsMinor;
+    DWORD OsBuild;
+    DWORD InfoLevel;
+
+    if (YoriLibFileEnumLargeFetchState == YORILIB_FILEENUM_LARGE_FETCH_UNKNOWN) {
+        YoriLibGetOsVersion(&OsMajor, &OsMinor, &OsBuild);
+
+        //
+        //  Large fetch and the basic information level were added in
+        //  Windows 7.  Earlier versions fail the call if either is
+        //  specified.
+        //
+
+        if (DllKernel32.pFindFirstFileExW != NULL &&
+            (OsMajor > 6 || (OsMajor == 6 && OsMinor >= 1))) {
+
+            YoriLibFileEnumLargeFetchState = YORILIB_FILEENUM_LARGE_FETCH_SUPPORTED;
+        } else {
+            YoriLibFileEnumLargeFetchState = YORILIB_FILEENUM_LARGE_FETCH_UNSUPPORTED;
+        }
+    }
+
+    if (YoriLibFileEnumLargeFetchState == YORILIB_FILEENUM_LARGE_FETCH_SUPPORTED) {
+        InfoLevel = YORI_FIND_EX_INFO_STANDARD;
+        if ((MatchFlags & YORILIB_FILEENUM_NO_SHORT_NAMES) != 0) {
+            InfoLevel = YORI_FIND_EX_INFO_BASIC;
+        }
+
+        return DllKernel32.pFindFirstFileExW(FileSpec, InfoLevel, FindData, YORI_FIND_EX_SEARCH_NAME_MATCH, NULL, FIND_FIRST_EX_LARGE_FETCH);
+    }
+
+    return FindFirstFile(FileSpec, FindData);
+}
+
 /**
  Call a callback for every file matching a specified file pattern.
 
@@ -341,14 +417,14 @@ YoriLibForEachFileEnum(
             (MatchFlags & YORILIB_FILEENUM_RECURSE_PRESERVE_WILD) != 0) {
 
             ForEachContext->FullPath.LengthInChars = YoriLibSPrintfS(ForEachContext->FullPath.StartOfString, ForEachContext->FullPath.LengthAllocated, _T("%y\\*"), &ForEachContext->ParentFullPath);
-            hFind = FindFirstFile(ForEachContext->FullPath.StartOfString, &ForEachContext->FileInfo);
+            hFind = YoriLibFileEnumFindFirst(ForEachContext->FullPath.StartOfString, MatchFlags, &ForEachContext->FileInfo);
         } else {
             if (FinalSlashFound) {
                 ForEachContext->FullPath.LengthInChars = YoriLibSPrintfS(ForEachContext->FullPath.StartOfString, ForEachContext->FullPath.LengthAllocated, _T("%y\\%s"), &ForEachContext->ParentFullPath, &ForEachContext->EffectiveFileSpec.StartOfString[ForEachContext->CharsToFinalSlash]);
             } else {
                 ForEachContext->FullPath.LengthInChars = YoriLibSPrintfS(ForEachContext->FullPath.StartOfString, ForEachContext->FullPath.LengthAllocated, _T("%y\\%y"), &ForEachContext->ParentFullPath, &ForEachContext->EffectiveFileSpec);
             }
-            hFind = FindFirstFile(ForEachContext->FullPath.StartOfString, &ForEachContext->FileInfo);
+            hFind = YoriLibFileEnumFindFirst(ForEachContext->FullPath.StartOfString, MatchFlags, &ForEachContext->FileInfo);
 
             //
             //  If we can't enumerate it because it's a volume root, cook up
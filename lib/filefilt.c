@@ -738,6 +738,40 @@ YoriLibFileFiltParseColorString(
     return YoriLibFileFiltParseFilterStringInternal(Filter, ColorString, YoriLibFileFiltParseColorElement, sizeof(YORI_LIB_FILE_FILT_COLOR_CRITERIA), ErrorSubstring);
 }
 
+/**
+ Return the access that the collection functions used by a filter need on a
+ handle to a file, so that a file information session can open a single
+ handle suitable for all of them.
+
+ @param Filter Pointer to the filter object.
+
+ @return The access mask needed to evaluate the filter against a file.
+ */
+DWORD
+YoriLibFileFiltGetAccessNeeded(
+    __in PYORI_LIB_FILE_FILTER Filter
+    )
+{
+    DWORD Index;
+    DWORD DesiredAccess;
+    PYORI_LIB_FILE_FILT_MATCH_CRITERIA Criteria;
+
+    //
+    //  Color criteria begin with match criteria, so walk the array by
+    //  element size to handle either.
+    //
+
+    DesiredAccess = 0;
+    for (Index = 0; Index < Filter->NumberCriteria; Index++) {
+        Criteria = (PYORI_LIB_FILE_FILT_MATCH_CRITERIA)YoriLibAddToPointer(Filter->Criteria, Index * Filter->ElementSize);
+        if (Criteria->CollectFn != NULL) {
+            DesiredAccess |= YoriLibFileInfoAccessForCollectFn(Criteria->CollectFn);
+        }
+    }
+
+    return DesiredAccess;
+}
+
 /**
  Evaluate whether a found file meets the criteria specified by the user
  supplied filter string.
@@ -750,6 +784,11 @@ YoriLibFileFiltParseColorString(
  @param FileInfo Pointer to the information returned from directory
         enumeration.
 
+ @param Session Optionally points to a file information session that the
+        caller has already used to collect information about the file, so
+        that its handle and queried information are reused.  If NULL, a
+        session is created for the duration of this call.
+
  @return TRUE to indicate the file meets all of the filter criteria and
          should be included, FALSE to indicate the file has failed one or
          more criteria and should be excluded.
@@ -759,11 +798,14 @@ BOOL
 YoriLibFileFiltCheckFilterMatch(
     __in PYORI_LIB_FILE_FILTER Filter,
     __in PYORI_STRING FilePath,
-    __in PWIN32_FIND_DATA FileInfo
+    __in PWIN32_FIND_DATA FileInfo,
+    __in_opt PYORI_LIB_FILE_INFO_SESSION Session
     )
 {
     DWORD Count;
+    BOOL Result;
     YORI_FILE_INFO CompareEntry;
+    YORI_LIB_FILE_INFO_SESSION LocalSession;
     PYORI_LIB_FILE_FILT_MATCH_CRITERIA CriteriaArray;
     PYORI_LIB_FILE_FILT_MATCH_CRITERIA Criteria;
     
@@ -774,20 +816,35 @@ YoriLibFileFiltCheckFilterMatch(
     ZeroMemory(&CompareEntry, sizeof(CompareEntry));
 
     CriteriaArray = (PYORI_LIB_FILE_FILT_MATCH_CRITERIA)Filter->Criteria;
+
+    if (Session == NULL) {
+        YoriLibFileInfoSessionInitialize(&LocalSession, YoriLibFileFiltGetAccessNeeded(Filter));
+        CompareEntry.Session = &LocalSession;
+    } else {
+        CompareEntry.Session = Session;
+    }
+
+    Result = TRUE;
     for (Count = 0; Count < Filter->NumberCriteria; Count++) {
         Criteria = &CriteriaArray[Count];
         if (Criteria->CollectFn != NULL &&
             !Criteria->CollectFn(&CompareEntry, FileInfo, FilePath)) {
 
-            return FALSE;
+            Result = FALSE;
+            break;
         }
 
         if (!Criteria->TruthStates[Criteria->CompareFn(&CompareEntry, &Criteria->CompareEntry)]) {
-            return FALSE;
+            Result = FALSE;
+            break;
         }
     }
 
-    return TRUE;
+    if (Session == NULL) {
+        YoriLibFileInfoSessionCleanup(&LocalSession);
+    }
+
+    return Result;
 }
 
 /**
@@ -802,6 +859,11 @@ YoriLibFileFiltCheckFilterMatch(
  @param FileInfo Pointer to the information returned from directory
         enumeration.
 
+ @param Session Optionally points to a file information session that the
+        caller has already used to collect information about the file, so
+        that its handle and queried information are reused.  If NULL, a
+        session is created for the duration of this call.
+
  @param Attribute On successful completion, updated with the color to use to
         display the file.
 
@@ -814,6 +876,7 @@ YoriLibFileFiltCheckColorMatch(
     __in PYORI_LIB_FILE_FILTER Filter,
     __in PYORI_STRING FilePath,
     __in PWIN32_FIND_DATA FileInfo,
+    __in_opt PYORI_LIB_FILE_INFO_SESSION Session,
     __out PYORILIB_COLOR_ATTRIBUTES Attribute
     )
 {
@@ -823,6 +886,8 @@ YoriLibFileFiltCheckColorMatch(
     PYORI_LIB_FILE_FILT_COLOR_CRITERIA ThisApply;
     PYORI_LIB_FILE_FILT_COLOR_CRITERIA ColorsToApply;
     YORI_FILE_INFO CompareEntry;
+    YORI_LIB_FILE_INFO_SESSION LocalSession;
+    BOOL Result;
 
     ZeroMemory(&CompareEntry, sizeof(CompareEntry));
 
@@ -842,13 +907,22 @@ YoriLibFileFiltCheckColorMatch(
            Filter->ElementSize == sizeof(YORI_LIB_FILE_FILT_COLOR_CRITERIA));
 
     ColorsToApply = (PYORI_LIB_FILE_FILT_COLOR_CRITERIA)Filter->Criteria;
+
+    if (Session == NULL) {
+        YoriLibFileInfoSessionInitialize(&LocalSession, YoriLibFileFiltGetAccessNeeded(Filter));
+        CompareEntry.Session = &LocalSession;
+    } else {
+        CompareEntry.Session = Session;
+    }
+
+    Result = FALSE;
     for (Index = 0; Index < Filter->NumberCriteria; Index++) {
         ThisApply = &ColorsToApply[Index];
 
         if (ThisApply->Match.CollectFn != NULL &&
             !ThisApply->Match.CollectFn(&CompareEntry, FileInfo, FilePath)) {
 
-            return FALSE;
+            goto Exit;
         }
 
         if (ThisApply->Match.TruthStates[ThisApply->Match.CompareFn(&CompareEntry, &ThisApply->Match.CompareEntry)]) {
@@ -864,7 +938,8 @@ YoriLibFileFiltCheckColorMatch(
 
                 Attribute->Ctrl = ThisAttribute.Ctrl;
                 Attribute->Win32Attr = ThisAttribute.Win32Attr;
-                return TRUE;
+                Result = TRUE;
+                goto Exit;
             }
 
             ThisAttribute.Ctrl = (UCHAR)(ThisAttribute.Ctrl & ~(YORILIB_ATTRCTRL_CONTINUE));
@@ -881,12 +956,18 @@ YoriLibFileFiltCheckColorMatch(
 
         Attribute->Ctrl = ThisAttribute.Ctrl;
         Attribute->Win32Attr = ThisAttribute.Win32Attr;
-        return TRUE;
+    } else {
+        Attribute->Ctrl = PreviousAttributes.Ctrl;
+        Attribute->Win32Attr = PreviousAttributes.Win32Attr;
     }
+    Result = TRUE;
 
-    Attribute->Ctrl = PreviousAttributes.Ctrl;
-    Attribute->Win32Attr = PreviousAttributes.Win32Attr;
-    return TRUE;
+Exit:
+    if (Session == NULL) {
+        YoriLibFileInfoSessionCleanup(&LocalSession);
+    }
+
+    return Result;
 }
 
 /**
@@ -163,6 +163,371 @@ YoriLibCopyFileName(
 }
 
 
+/**
+ Prepare a session that allows collection functions operating on a single
+ file to share a handle to the file and the information queried from it.
+ The handle is not opened until a collection function needs it.
+
+ @param Session Pointer to the session to initialize.
+
+ @param DesiredAccess The access to request when the handle is opened.  This
+        is expected to be the union of the access needed by all of the
+        collection functions that will be invoked on the file, as returned by
+        @ref YoriLibFileInfoAccessForCollectFn .
+ */
+VOID
+YoriLibFileInfoSessionInitialize(
+    __out PYORI_LIB_FILE_INFO_SESSION Session,
+    __in DWORD DesiredAccess
+    )
+{
+    ZeroMemory(Session, sizeof(YORI_LIB_FILE_INFO_SESSION));
+    Session->FileHandle = INVALID_HANDLE_VALUE;
+    Session->DesiredAccess = DesiredAccess;
+}
+
+/**
+ Close any handle opened as part of a file information session.
+
+ @param Session Pointer to the session to clean up.
+ */
+VOID
+YoriLibFileInfoSessionCleanup(
+    __inout PYORI_LIB_FILE_INFO_SESSION Session
+    )
+{
+    if (Session->FileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(Session->FileHandle);
+        Session->FileHandle = INVALID_HANDLE_VALUE;
+    }
+    Session->GrantedAccess = 0;
+    Session->QueriedInfo = 0;
+}
+
+/**
+ Return the access that a collection function needs on a handle to the file
+ being collected, so that a caller can open a single handle that is suitable
+ for every collection function it intends to invoke.
+
+ @param CollectFn Pointer to the collection function.
+
+ @return The access mask needed by the collection function, or zero if the
+         function does not open the file.
+ */
+DWORD
+YoriLibFileInfoAccessForCollectFn(
+    __in YORI_LIB_FILE_FILT_COLLECT_FN CollectFn
+    )
+{
+    if (CollectFn == YoriLibCollectAllocatedRangeCount) {
+        return FILE_READ_ATTRIBUTES | FILE_READ_DATA;
+    }
+
+    if (CollectFn == YoriLibCollectAllocationSize ||
+        CollectFn == YoriLibCollectCompressionAlgorithm ||
+        CollectFn == YoriLibCollectFileId ||
+        CollectFn == YoriLibCollectFragmentCount ||
+        CollectFn == YoriLibCollectLinkCount ||
+        CollectFn == YoriLibCollectObjectId ||
+        CollectFn == YoriLibCollectUsn) {
+
+        return FILE_READ_ATTRIBUTES;
+    }
+
+    return 0;
+}
+
+/**
+ Open a handle to a file for use by a collection function.  If the entry
+ being collected has a session, the handle is shared with other collection
+ functions on the same file, and is opened with the access requested by the
+ session so that one handle can serve all of them.  Otherwise, a new handle
+ is opened.  The handle must be released with
+ @ref YoriLibFileInfoReleaseHandle .
+
+ @param Entry The directory entry being populated.
+
+ @param FullPath Pointer to a string to the full file name.
+
+ @param DesiredAccess The access needed by the collection function.
+
+ @param FileHandle On successful completion, updated to contain a handle to
+        the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibFileInfoAcquireHandle(
+    __in PYORI_FILE_INFO Entry,
+    __in PYORI_STRING FullPath,
+    __in DWORD DesiredAccess,
+    __out PHANDLE FileHandle
+    )
+{
+    PYORI_LIB_FILE_INFO_SESSION Session;
+    HANDLE hFile;
+    DWORD Access;
+
+    ASSERT(YoriLibIsStringNullTerminated(FullPath));
+
+    Session = Entry->Session;
+    if (Session == NULL) {
+        hFile = CreateFile(FullPath->StartOfString,
+                           DesiredAccess,
+                           FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                           NULL,
+                           OPEN_EXISTING,
+                           FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
+                           NULL);
+
+        if (hFile == INVALID_HANDLE_VALUE) {
+            return FALSE;
+        }
+
+        *FileHandle = hFile;
+        return TRUE;
+    }
+
+    if (Session->FileHandle != INVALID_HANDLE_VALUE &&
+        (Session->GrantedAccess & DesiredAccess) == DesiredAccess) {
+
+        *FileHandle = Session->FileHandle;
+        return TRUE;
+    }
+
+    //
+    //  Try to open with everything the session expects to need.  If that
+    //  fails, which can happen if the user can read attributes but not data,
+    //  fall back to what this caller needs.  Remember access that failed so
+    //  later collection functions don't keep retrying it.
+    //
+
+    Access = Session->DesiredAccess | Session->GrantedAccess | DesiredAccess;
+    hFile = INVALID_HANDLE_VALUE;
+
+    while (TRUE) {
+        if (Access != Session->FailedAccess) {
+            hFile = CreateFile(FullPath->StartOfString,
+                               Access,
+                               FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                               NULL,
+                               OPEN_EXISTING,
+                               FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
+                               NULL);
+
+            if (hFile != INVALID_HANDLE_VALUE) {
+                break;
+            }
+
+            Session->FailedAccess = Access;
+        }
+
+        if (Access == DesiredAccess) {
+            return FALSE;
+        }
+
+        Session->DesiredAccess = 0;
+        Access = DesiredAccess;
+    }
+
+    if (Session->FileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(Session->FileHandle);
+    }
+
+    Session->FileHandle = hFile;
+    Session->GrantedAccess = Access;
+    *FileHandle = hFile;
+    return TRUE;
+}
+
+/**
+ Release a handle returned from @ref YoriLibFileInfoAcquireHandle .  If the
+ handle belongs to a session, it remains open for other collection functions
+ and is closed when the session is cleaned up.
+
+ @param Entry The directory entry being populated.
+
+ @param FileHandle The handle to release.
+ */
+VOID
+YoriLibFileInfoReleaseHandle(
+    __in PYORI_FILE_INFO Entry,
+    __in HANDLE FileHandle
+    )
+{
+    if (Entry->Session == NULL || Entry->Session->FileHandle != FileHandle) {
+        CloseHandle(FileHandle);
+    }
+}
+
+/**
+ Query the information returned by GetFileInformationByHandle for a file.
+ If the entry being collected has a session, the information is queried
+ once and shared by all collection functions that need it.
+
+ @param Entry The directory entry being populated.
+
+ @param FullPath Pointer to a string to the full file name.
+
+ @param FileInfo On successful completion, populated with the information
+        about the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibFileInfoQueryHandleInfo(
+    __in PYORI_FILE_INFO Entry,
+    __in PYORI_STRING FullPath,
+    __out PBY_HANDLE_FILE_INFORMATION FileInfo
+    )
+{
+    PYORI_LIB_FILE_INFO_SESSION Session;
+    HANDLE hFile;
+    BOOL Result;
+
+    Session = Entry->Session;
+    if (Session != NULL && (Session->QueriedInfo & YORI_LIB_FILE_INFO_SESSION_HANDLE_INFO)) {
+        if (Session->QueriedInfo & YORI_LIB_FILE_INFO_SESSION_HANDLE_INFO_VALID) {
+            memcpy(FileInfo, &Session->HandleInfo, sizeof(BY_HANDLE_FILE_INFORMATION));
+            return TRUE;
+        }
+        return FALSE;
+    }
+
+    Result = FALSE;
+    if (YoriLibFileInfoAcquireHandle(Entry, FullPath, FILE_READ_ATTRIBUTES, &hFile)) {
+        Result = GetFileInformationByHandle(hFile, FileInfo);
+        YoriLibFileInfoReleaseHandle(Entry, hFile);
+    }
+
+    if (Session != NULL) {
+        Session->QueriedInfo |= YORI_LIB_FILE_INFO_SESSION_HANDLE_INFO;
+        if (Result) {
+            Session->QueriedInfo |= YORI_LIB_FILE_INFO_SESSION_HANDLE_INFO_VALID;
+            memcpy(&Session->HandleInfo, FileInfo, sizeof(BY_HANDLE_FILE_INFORMATION));
+        }
+    }
+
+    return Result;
+}
+
+/**
+ Query the standard information for a file.  If the entry being collected
+ has a session, the information is queried once and shared by all
+ collection functions that need it.
+
+ @param Entry The directory entry being populated.
+
+ @param FullPath Pointer to a string to the full file name.
+
+ @param StandardInfo On successful completion, populated with the standard
+        information about the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibFileInfoQueryStandardInfo(
+    __in PYORI_FILE_INFO Entry,
+    __in PYORI_STRING FullPath,
+    __out PFILE_STANDARD_INFO StandardInfo
+    )
+{
+    PYORI_LIB_FILE_INFO_SESSION Session;
+    HANDLE hFile;
+    BOOL Result;
+
+    if (DllKernel32.pGetFileInformationByHandleEx == NULL) {
+        return FALSE;
+    }
+
+    Session = Entry->Session;
+    if (Session != NULL && (Session->QueriedInfo & YORI_LIB_FILE_INFO_SESSION_STANDARD_INFO)) {
+        if (Session->QueriedInfo & YORI_LIB_FILE_INFO_SESSION_STANDARD_INFO_VALID) {
+            memcpy(StandardInfo, &Session->StandardInfo, sizeof(FILE_STANDARD_INFO));
+            return TRUE;
+        }
+        return FALSE;
+    }
+
+    Result = FALSE;
+    if (YoriLibFileInfoAcquireHandle(Entry, FullPath, FILE_READ_ATTRIBUTES, &hFile)) {
+        Result = DllKernel32.pGetFileInformationByHandleEx(hFile, FileStandardInfo, StandardInfo, sizeof(FILE_STANDARD_INFO));
+        YoriLibFileInfoReleaseHandle(Entry, hFile);
+    }
+
+    if (Session != NULL) {
+        Session->QueriedInfo |= YORI_LIB_FILE_INFO_SESSION_STANDARD_INFO;
+        if (Result) {
+            Session->QueriedInfo |= YORI_LIB_FILE_INFO_SESSION_STANDARD_INFO_VALID;
+            memcpy(&Session->StandardInfo, StandardInfo, sizeof(FILE_STANDARD_INFO));
+        }
+    }
+
+    return Result;
+}
+
+/**
+ Generate information typically returned from a directory enumeration by
+ querying a file through a file information session.  This is equivalent to
+ @ref YoriLibUpdateFindDataFromFileInformation , except the handle and the
+ information queried from it remain in the session, so collection functions
+ later invoked on the same file with the same session do not open it again.
+
+ @param Session Pointer to the session.
+
+ @param FindData On successful completion, populated with information
+        typically returned by the system when enumerating files.
+
+ @param FullPath Pointer to a NULL terminated string referring to the full
+        path to the file.
+
+ @param CopyName TRUE if the full path's file name component should also be
+        copied into the find data structure.  FALSE if the caller does not
+        need this or will do it manually.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibFileInfoSessionUpdateFindData(
+    __inout PYORI_LIB_FILE_INFO_SESSION Session,
+    __out PWIN32_FIND_DATA FindData,
+    __in PYORI_STRING FullPath,
+    __in BOOL CopyName
+    )
+{
+    YORI_FILE_INFO Entry;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    LPTSTR FinalSlash;
+
+    ZeroMemory(&Entry, sizeof(Entry));
+    Entry.Session = Session;
+
+    if (!YoriLibFileInfoQueryHandleInfo(&Entry, FullPath, &FileInfo)) {
+        return FALSE;
+    }
+
+    FindData->dwFileAttributes = FileInfo.dwFileAttributes;
+    FindData->ftCreationTime = FileInfo.ftCreationTime;
+    FindData->ftLastAccessTime = FileInfo.ftLastAccessTime;
+    FindData->ftLastWriteTime = FileInfo.ftLastWriteTime;
+    FindData->nFileSizeHigh = FileInfo.nFileSizeHigh;
+    FindData->nFileSizeLow  = FileInfo.nFileSizeLow;
+
+    if (CopyName) {
+        FinalSlash = _tcsrchr(FullPath->StartOfString, '\\');
+        if (FinalSlash) {
+            YoriLibSPrintfS(FindData->cFileName, MAX_PATH, _T("%s"), FinalSlash + 1);
+        } else {
+            YoriLibSPrintfS(FindData->cFileName, MAX_PATH, _T("%y"), FullPath);
+        }
+    }
+    return TRUE;
+}
+
 /**
  Collect information from a directory enumerate and full file name relating
  to the file's access time.
@@ -217,15 +582,7 @@ YoriLibCollectAllocatedRangeCount (
     Entry->AllocatedRangeCount.HighPart = 0;
     Entry->AllocatedRangeCount.LowPart = 0;
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES|FILE_READ_DATA,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
-
-    if (hFile != INVALID_HANDLE_VALUE) {
+    if (YoriLibFileInfoAcquireHandle(Entry, FullPath, FILE_READ_ATTRIBUTES|FILE_READ_DATA, &hFile)) {
 
         FILE_ALLOCATED_RANGE_BUFFER StartBuffer;
         union {
@@ -281,7 +638,7 @@ YoriLibCollectAllocatedRangeCount (
             }
         }
 
-        CloseHandle(hFile);
+        YoriLibFileInfoReleaseHandle(Entry, hFile);
     }
     return TRUE;
 }
@@ -306,31 +663,13 @@ YoriLibCollectAllocationSize (
     )
 {
     BOOL RealAllocSize = FALSE;
+    FILE_STANDARD_INFO StandardInfo;
 
     ASSERT(YoriLibIsStringNullTerminated(FullPath));
 
-    if (DllKernel32.pGetFileInformationByHandleEx) {
-
-        HANDLE hFile;
-
-        hFile = CreateFile(FullPath->StartOfString,
-                           FILE_READ_ATTRIBUTES,
-                           FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                           NULL,
-                           OPEN_EXISTING,
-                           FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                           NULL);
-    
-        if (hFile != INVALID_HANDLE_VALUE) {
-            FILE_STANDARD_INFO StandardInfo;
-    
-            if (DllKernel32.pGetFileInformationByHandleEx(hFile, FileStandardInfo, &StandardInfo, sizeof(StandardInfo))) {
-                Entry->AllocationSize = StandardInfo.AllocationSize;
-                RealAllocSize = TRUE;
-            }
-
-            CloseHandle(hFile);
-        }
+    if (YoriLibFileInfoQueryStandardInfo(Entry, FullPath, &StandardInfo)) {
+        Entry->AllocationSize = StandardInfo.AllocationSize;
+        RealAllocSize = TRUE;
     }
 
     if (!RealAllocSize) {
@@ -560,15 +899,7 @@ YoriLibCollectCompressionAlgorithm (
 
     Entry->CompressionAlgorithm = YoriLibCompressionNone;
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
-
-    if (hFile != INVALID_HANDLE_VALUE) {
+    if (YoriLibFileInfoAcquireHandle(Entry, FullPath, FILE_READ_ATTRIBUTES, &hFile)) {
 
         USHORT NtfsCompressionAlgorithm;
         DWORD BytesReturned;
@@ -612,7 +943,7 @@ YoriLibCollectCompressionAlgorithm (
             }
         }
 
-        CloseHandle(hFile);
+        YoriLibFileInfoReleaseHandle(Entry, hFile);
     }
     return TRUE;
 }
@@ -950,30 +1281,16 @@ YoriLibCollectFileId (
     __in PYORI_STRING FullPath
     )
 {
-    HANDLE hFile;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
 
     UNREFERENCED_PARAMETER(FindData);
     ASSERT(YoriLibIsStringNullTerminated(FullPath));
 
     Entry->FileId.QuadPart = 0;
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
-
-    if (hFile != INVALID_HANDLE_VALUE) {
-        BY_HANDLE_FILE_INFORMATION FileInfo;
-
-        if (GetFileInformationByHandle(hFile, &FileInfo)) {
-            Entry->FileId.LowPart = FileInfo.nFileIndexLow;
-            Entry->FileId.HighPart = FileInfo.nFileIndexHigh;
-        }
-
-        CloseHandle(hFile);
+    if (YoriLibFileInfoQueryHandleInfo(Entry, FullPath, &FileInfo)) {
+        Entry->FileId.LowPart = FileInfo.nFileIndexLow;
+        Entry->FileId.HighPart = FileInfo.nFileIndexHigh;
     }
     return TRUE;
 }
@@ -1143,15 +1460,7 @@ YoriLibCollectFragmentCount (
     Entry->FragmentCount.HighPart = 0;
     Entry->FragmentCount.LowPart = 0;
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
-
-    if (hFile != INVALID_HANDLE_VALUE) {
+    if (YoriLibFileInfoAcquireHandle(Entry, FullPath, FILE_READ_ATTRIBUTES, &hFile)) {
 
         STARTING_VCN_INPUT_BUFFER StartBuffer;
         union {
@@ -1198,7 +1507,7 @@ YoriLibCollectFragmentCount (
             StartBuffer.StartingVcn.QuadPart = u.Extents.Extents[u.Extents.ExtentCount - 1].NextVcn.QuadPart;
         }
 
-        CloseHandle(hFile);
+        YoriLibFileInfoReleaseHandle(Entry, hFile);
     }
     return TRUE;
 }
@@ -1222,29 +1531,15 @@ YoriLibCollectLinkCount (
     __in PYORI_STRING FullPath
     )
 {
-    HANDLE hFile;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
 
     UNREFERENCED_PARAMETER(FindData);
     ASSERT(YoriLibIsStringNullTerminated(FullPath));
 
     Entry->LinkCount = 0;
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
-
-    if (hFile != INVALID_HANDLE_VALUE) {
-        BY_HANDLE_FILE_INFORMATION FileInfo;
-
-        if (GetFileInformationByHandle(hFile, &FileInfo)) {
-            Entry->LinkCount = FileInfo.nNumberOfLinks;
-        }
-
-        CloseHandle(hFile);
+    if (YoriLibFileInfoQueryHandleInfo(Entry, FullPath, &FileInfo)) {
+        Entry->LinkCount = FileInfo.nNumberOfLinks;
     }
     return TRUE;
 }
@@ -1277,19 +1572,11 @@ YoriLibCollectObjectId (
 
     ZeroMemory(&Entry->ObjectId, sizeof(Entry->ObjectId));
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
-
-    if (hFile != INVALID_HANDLE_VALUE) {
+    if (YoriLibFileInfoAcquireHandle(Entry, FullPath, FILE_READ_ATTRIBUTES, &hFile)) {
         if (DeviceIoControl(hFile, FSCTL_GET_OBJECT_ID, NULL, 0, &Buffer, sizeof(Buffer), &BytesReturned, NULL)) {
             memcpy(&Entry->ObjectId, &Buffer.ObjectId, sizeof(Buffer.ObjectId));
         }
-        CloseHandle(hFile);
+        YoriLibFileInfoReleaseHandle(Entry, hFile);
     }
     return TRUE;
 }
@@ -1565,15 +1852,8 @@ YoriLibCollectUsn (
     ASSERT(YoriLibIsStringNullTerminated(FullPath));
 
     Entry->Usn.QuadPart = 0;
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
 
-    if (hFile != INVALID_HANDLE_VALUE) {
+    if (YoriLibFileInfoAcquireHandle(Entry, FullPath, FILE_READ_ATTRIBUTES, &hFile)) {
 
         struct {
             USN_RECORD UsnRecord;
@@ -1585,7 +1865,7 @@ YoriLibCollectUsn (
             Entry->Usn.QuadPart = s1.UsnRecord.Usn;
         }
 
-        CloseHandle(hFile);
+        YoriLibFileInfoReleaseHandle(Entry, hFile);
     }
     return TRUE;
 }
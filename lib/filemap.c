@@ -0,0 +1,403 @@
+/**
+ * @file lib/filemap.c
+ *
+ * Yori routines to read files as spans of bytes, mapping regular files
+ *
+ * Copyright (c) 2020 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ The size of the buffer to use when a stream cannot be mapped and must be
+ read.
+ */
+#define YORI_LIB_BYTE_SPAN_BUFFER_SIZE (1024 * 1024)
+
+/**
+ TRUE if regular files can be mapped.  If the contents of a mapped view
+ cannot be paged in, for example because a network connection is lost, the
+ process raises an exception rather than failing a read.  Mapping is only
+ enabled by standalone tools, so this cannot terminate the shell when it or
+ its builtins read scripts, history or redirected input.
+ */
+BOOLEAN g_FileMappingEnabled;
+
+/**
+ Allow regular files read by byte span readers, including the line reader,
+ to be mapped rather than read into a buffer.  This should only be called by
+ standalone tools and not by code which may be running in the shell process.
+ */
+VOID
+YoriLibEnableFileMapping()
+{
+    g_FileMappingEnabled = TRUE;
+}
+
+/**
+ Create a mapping object describing the current contents of the file, and
+ record the size of the file that the mapping describes.
+
+ @param Reader Pointer to the reader.
+
+ @return Handle to the mapping object, or NULL on failure.
+ */
+HANDLE
+YoriLibByteSpanCreateMapping(
+    __inout PYORI_LIB_BYTE_SPAN_READER Reader
+    )
+{
+    HANDLE MappingHandle;
+    LARGE_INTEGER FileSize;
+
+    FileSize.LowPart = GetFileSize(Reader->FileHandle, (LPDWORD)&FileSize.HighPart);
+    if (FileSize.LowPart == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) {
+        return NULL;
+    }
+
+    //
+    //  Mapping a zero length file fails, so there's nothing to do.
+    //
+
+    if (FileSize.QuadPart == 0) {
+        return NULL;
+    }
+
+    MappingHandle = CreateFileMapping(Reader->FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (MappingHandle == NULL) {
+        return NULL;
+    }
+
+    Reader->MappedSize.QuadPart = FileSize.QuadPart;
+    return MappingHandle;
+}
+
+/**
+ Prepare to read a stream as a series of spans of bytes.  If the stream is a
+ regular file and mapping has been enabled with
+ @ref YoriLibEnableFileMapping , it is mapped in windows of bounded size so
+ the data can be processed without copying.  Otherwise, the data is read
+ into a buffer.
+
+ @param Reader Pointer to the reader to initialize.
+
+ @param FileHandle Handle to the stream to read.  This must remain open
+        until the reader is closed.
+
+ @param StartOffset Optionally points to the offset within the stream to
+        start reading from.  If not specified, reading starts at the current
+        file position.  If the stream cannot seek, reading starts at the
+        current position, and the caller can determine this from the offset
+        of returned spans.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibByteSpanReaderOpen(
+    __out PYORI_LIB_BYTE_SPAN_READER Reader,
+    __in HANDLE FileHandle,
+    __in_opt PLARGE_INTEGER StartOffset
+    )
+{
+    SYSTEM_INFO SysInfo;
+    LARGE_INTEGER Position;
+
+    ZeroMemory(Reader, sizeof(YORI_LIB_BYTE_SPAN_READER));
+    Reader->FileHandle = FileHandle;
+
+    //
+    //  Find the position to start reading from.  If the stream can't seek,
+    //  it's treated as starting from zero.
+    //
+
+    if (StartOffset != NULL) {
+        Position.QuadPart = StartOffset->QuadPart;
+    } else {
+        Position.HighPart = 0;
+        Position.LowPart = SetFilePointer(FileHandle, 0, &Position.HighPart, FILE_CURRENT);
+        if (Position.LowPart == INVALID_SET_FILE_POINTER && GetLastError() != NO_ERROR) {
+            Position.QuadPart = 0;
+        }
+    }
+
+    if (g_FileMappingEnabled && GetFileType(FileHandle) == FILE_TYPE_DISK) {
+        Reader->MappingHandle = YoriLibByteSpanCreateMapping(Reader);
+        if (Reader->MappingHandle != NULL) {
+            GetSystemInfo(&SysInfo);
+            Reader->Mapped = TRUE;
+            Reader->Granularity = SysInfo.dwAllocationGranularity;
+            Reader->SpanOffset.QuadPart = Position.QuadPart;
+            return TRUE;
+        }
+    }
+
+    //
+    //  The stream can't be mapped, so read it into a buffer.
+    //
+
+    Reader->Buffer = YoriLibMalloc(YORI_LIB_BYTE_SPAN_BUFFER_SIZE);
+    if (Reader->Buffer == NULL) {
+        return FALSE;
+    }
+    Reader->BufferLength = YORI_LIB_BYTE_SPAN_BUFFER_SIZE;
+
+    if (StartOffset != NULL &&
+        SetFilePointer(FileHandle, Position.LowPart, &Position.HighPart, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+        GetLastError() != NO_ERROR) {
+
+        Position.QuadPart = 0;
+    }
+
+    Reader->SpanOffset.QuadPart = Position.QuadPart;
+    return TRUE;
+}
+
+/**
+ Advance a mapped reader to the next window of the file.
+
+ @param Reader Pointer to the reader.
+
+ @param BytesToRetain The number of bytes at the end of the current span
+        which should be included at the start of the next span.
+
+ @return TRUE if the span contains new data, FALSE if the end of the file
+         has been reached or the window could not be mapped.
+ */
+__success(return)
+BOOL
+YoriLibByteSpanReaderNextMapped(
+    __inout PYORI_LIB_BYTE_SPAN_READER Reader,
+    __in DWORD BytesToRetain
+    )
+{
+    LARGE_INTEGER NextOffset;
+    LARGE_INTEGER ViewOffset;
+    LARGE_INTEGER EndOfSpan;
+    DWORDLONG ViewLength;
+    HANDLE NewMappingHandle;
+    PUCHAR NewView;
+
+    EndOfSpan.QuadPart = Reader->SpanOffset.QuadPart + Reader->SpanLength;
+    NextOffset.QuadPart = EndOfSpan.QuadPart - BytesToRetain;
+
+    //
+    //  If the mapping has been consumed, check whether the file has grown
+    //  since it was mapped.  If so, a new mapping is needed to see the new
+    //  data.
+    //
+
+    NewMappingHandle = NULL;
+    if (EndOfSpan.QuadPart >= Reader->MappedSize.QuadPart) {
+        LARGE_INTEGER FileSize;
+        FileSize.LowPart = GetFileSize(Reader->FileHandle, (LPDWORD)&FileSize.HighPart);
+        if ((FileSize.LowPart == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) ||
+            FileSize.QuadPart <= Reader->MappedSize.QuadPart) {
+
+            Reader->EndOfStream = TRUE;
+            return FALSE;
+        }
+
+        NewMappingHandle = YoriLibByteSpanCreateMapping(Reader);
+        if (NewMappingHandle == NULL) {
+            return FALSE;
+        }
+    }
+
+    //
+    //  Views must start on an allocation granularity boundary, so the view
+    //  may start before the data that was asked for.  If the data to retain
+    //  is so large that no new data would fit in the window, give up.
+    //
+
+    ViewOffset.QuadPart = NextOffset.QuadPart - (NextOffset.QuadPart % Reader->Granularity);
+    ViewLength = Reader->MappedSize.QuadPart - ViewOffset.QuadPart;
+    if (ViewLength > YORI_LIB_BYTE_SPAN_WINDOW_SIZE) {
+        ViewLength = YORI_LIB_BYTE_SPAN_WINDOW_SIZE;
+    }
+
+    if (ViewOffset.QuadPart + ViewLength <= (DWORDLONG)EndOfSpan.QuadPart) {
+        if (NewMappingHandle != NULL) {
+            CloseHandle(NewMappingHandle);
+        }
+        return FALSE;
+    }
+
+    if (NewMappingHandle != NULL) {
+        NewView = MapViewOfFile(NewMappingHandle, FILE_MAP_READ, ViewOffset.HighPart, ViewOffset.LowPart, (SIZE_T)ViewLength);
+    } else {
+        NewView = MapViewOfFile(Reader->MappingHandle, FILE_MAP_READ, ViewOffset.HighPart, ViewOffset.LowPart, (SIZE_T)ViewLength);
+    }
+
+    if (NewView == NULL) {
+        if (NewMappingHandle != NULL) {
+            CloseHandle(NewMappingHandle);
+        }
+        return FALSE;
+    }
+
+    //
+    //  The new view is mapped before the old one is unmapped, since the
+    //  caller's retained data may still be referenced until this returns.
+    //
+
+    if (Reader->View != NULL) {
+        UnmapViewOfFile(Reader->View);
+    }
+    if (NewMappingHandle != NULL) {
+        CloseHandle(Reader->MappingHandle);
+        Reader->MappingHandle = NewMappingHandle;
+    }
+
+    Reader->View = NewView;
+    Reader->Span = Reader->View + (DWORD)(NextOffset.QuadPart - ViewOffset.QuadPart);
+    Reader->SpanLength = (DWORD)(ViewLength - (NextOffset.QuadPart - ViewOffset.QuadPart));
+    Reader->SpanOffset.QuadPart = NextOffset.QuadPart;
+    return TRUE;
+}
+
+/**
+ Advance a reader that is not mapped by reading more data into its buffer.
+
+ @param Reader Pointer to the reader.
+
+ @param BytesToRetain The number of bytes at the end of the current span
+        which should be included at the start of the next span.
+
+ @return TRUE if the span contains new data, FALSE if the end of the stream
+         has been reached or the buffer is full.
+ */
+__success(return)
+BOOL
+YoriLibByteSpanReaderNextBuffered(
+    __inout PYORI_LIB_BYTE_SPAN_READER Reader,
+    __in DWORD BytesToRetain
+    )
+{
+    DWORD BytesRead;
+
+    //
+    //  Move any retained data to the front of the buffer, so the span
+    //  describes it even if no more data can be read.
+    //
+
+    if (BytesToRetain > 0 && Reader->Span + Reader->SpanLength - BytesToRetain != Reader->Buffer) {
+        memmove(Reader->Buffer, Reader->Span + Reader->SpanLength - BytesToRetain, BytesToRetain);
+    }
+
+    Reader->SpanOffset.QuadPart = Reader->SpanOffset.QuadPart + Reader->SpanLength - BytesToRetain;
+    Reader->Span = Reader->Buffer;
+    Reader->SpanLength = BytesToRetain;
+
+    if (BytesToRetain >= Reader->BufferLength) {
+        return FALSE;
+    }
+
+    BytesRead = 0;
+    if (!ReadFile(Reader->FileHandle, Reader->Buffer + BytesToRetain, Reader->BufferLength - BytesToRetain, &BytesRead, NULL) ||
+        BytesRead == 0) {
+
+        Reader->EndOfStream = TRUE;
+        return FALSE;
+    }
+
+    Reader->SpanLength = BytesToRetain + BytesRead;
+    return TRUE;
+}
+
+/**
+ Advance the reader to the next span of bytes.  On success, the Span,
+ SpanLength and SpanOffset fields of the reader describe the new span.
+
+ @param Reader Pointer to the reader.
+
+ @param BytesToRetain The number of bytes at the end of the current span
+        which should be included at the start of the next span.  This allows
+        a caller to process data that crosses the end of a span, such as a
+        partial line, without copying it.  This must not exceed the length
+        of the current span, and is ignored on the first call.
+
+ @return TRUE if the span contains new data.  FALSE if no more data can be
+         returned, either because the end of the stream was reached (in
+         which case EndOfStream is set) or because the data to retain is too
+         large.  On failure, Span and SpanLength describe the retained data.
+ */
+__success(return)
+BOOL
+YoriLibByteSpanReaderNext(
+    __inout PYORI_LIB_BYTE_SPAN_READER Reader,
+    __in DWORD BytesToRetain
+    )
+{
+    if (Reader->Span == NULL) {
+        BytesToRetain = 0;
+    }
+
+    ASSERT(BytesToRetain <= Reader->SpanLength);
+
+    if (Reader->EndOfStream) {
+        return FALSE;
+    }
+
+    if (Reader->Mapped) {
+        if (!YoriLibByteSpanReaderNextMapped(Reader, BytesToRetain)) {
+            if (Reader->Span != NULL) {
+                Reader->Span = Reader->Span + Reader->SpanLength - BytesToRetain;
+                Reader->SpanOffset.QuadPart = Reader->SpanOffset.QuadPart + Reader->SpanLength - BytesToRetain;
+                Reader->SpanLength = BytesToRetain;
+            }
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    return YoriLibByteSpanReaderNextBuffered(Reader, BytesToRetain);
+}
+
+/**
+ Release any resources associated with a byte span reader.  The file handle
+ is not closed.
+
+ @param Reader Pointer to the reader.
+ */
+VOID
+YoriLibByteSpanReaderClose(
+    __inout PYORI_LIB_BYTE_SPAN_READER Reader
+    )
+{
+    if (Reader->View != NULL) {
+        UnmapViewOfFile(Reader->View);
+        Reader->View = NULL;
+    }
+    if (Reader->MappingHandle != NULL) {
+        CloseHandle(Reader->MappingHandle);
+        Reader->MappingHandle = NULL;
+    }
+    if (Reader->Buffer != NULL) {
+        YoriLibFree(Reader->Buffer);
+        Reader->Buffer = NULL;
+    }
+    Reader->Span = NULL;
+    Reader->SpanLength = 0;
+}
+
+// vim:sw=4:ts=4:et:
@@ -27,179 +27,136 @@
 #include "yoripch.h"
 #include "yorilib.h"
 
+
 /**
- Generate a line of up to YORI_LIB_HEXDUMP_BYTES_PER_LINE in of bytes to
- include into a C file.
+ The maximum number of characters that can be generated for a single line
+ of YoriLibHexDump output.  This is larger than any combination of offset,
+ hex data, characters and line terminator.
+ */
+#define YORI_LIB_HEXDUMP_MAX_LINE_CHARS (8 * YORI_LIB_HEXDUMP_BYTES_PER_LINE + 32)
 
- @param Output Pointer to a string to populate with the result.
+/**
+ The number of lines of YoriLibHexDump output to accumulate before writing
+ them to the output device.
+ */
+#define YORI_LIB_HEXDUMP_LINES_PER_WRITE 256
 
- @param Buffer Pointer to the start of the buffer.
+/**
+ The characters used to display each nibble in hex form.
+ */
+CONST TCHAR YoriLibHexDigits[] = _T("0123456789abcdef");
 
- @param BytesToDisplay Number of bytes to display, can be equal to or less
-        than YORI_LIB_HEXDUMP_BYTES_PER_LINE.
+/**
+ Write a single byte as two hex digits.
 
- @param MoreFollowing If TRUE, the line should be terminated with a comma
-        because more data remains.  If FALSE, this is the final line and
-        it should be terminated with a newline.
+ @param Output Pointer to a buffer which must be at least two characters
+        long.
 
- @return TRUE to indicate success, FALSE to indicate failure.
+ @param Byte The byte to write.
  */
-BOOL
-YoriLibHexByteCStyle(
-    __inout PYORI_STRING Output,
-    __in_ecount(BytesToDisplay) UCHAR CONST * Buffer,
-    __in DWORD BytesToDisplay,
-    __in BOOLEAN MoreFollowing
+VOID
+YoriLibHexWriteByte(
+    __out_ecount(2) LPTSTR Output,
+    __in UCHAR Byte
     )
 {
-    UCHAR WordToDisplay = 0;
-    DWORD WordIndex;
-    BOOL DisplayWord;
-    DWORD OutputIndex = 0;
-    YORI_STRING Subset;
+    Output[0] = YoriLibHexDigits[Byte >> 4];
+    Output[1] = YoriLibHexDigits[Byte & 0xf];
+}
 
-    if (BytesToDisplay > YORI_LIB_HEXDUMP_BYTES_PER_LINE) {
-        return FALSE;
-    }
+/**
+ Write a 32 bit value as eight hex digits.
 
-    Subset.StartOfString = &Output->StartOfString[OutputIndex];
-    Subset.LengthAllocated = Output->LengthAllocated - OutputIndex;
-    Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                           Subset.LengthAllocated,
-                                           _T("        "));
-    OutputIndex += Subset.LengthInChars;
+ @param Output Pointer to a buffer which must be at least eight characters
+        long.
 
-    for (WordIndex = 0; WordIndex < YORI_LIB_HEXDUMP_BYTES_PER_LINE / sizeof(WordToDisplay); WordIndex++) {
+ @param Value The value to write.
+ */
+VOID
+YoriLibHexWriteDword(
+    __out_ecount(8) LPTSTR Output,
+    __in DWORD Value
+    )
+{
+    YoriLibHexWriteByte(&Output[0], (UCHAR)(Value >> 24));
+    YoriLibHexWriteByte(&Output[2], (UCHAR)(Value >> 16));
+    YoriLibHexWriteByte(&Output[4], (UCHAR)(Value >> 8));
+    YoriLibHexWriteByte(&Output[6], (UCHAR)Value);
+}
 
-        WordToDisplay = 0;
-        DisplayWord = FALSE;
+/**
+ Write the escape sequence that begins a hex value or character in a
+ display which hilights some values.
 
-        if (WordIndex * sizeof(WordToDisplay) < BytesToDisplay) {
-            DisplayWord = TRUE;
-            WordToDisplay = (UCHAR)Buffer[WordIndex];
-        }
+ @param Output Pointer to a buffer which must be at least six characters
+        long.
 
-        if (DisplayWord) {
-            Subset.StartOfString = &Output->StartOfString[OutputIndex];
-            Subset.LengthAllocated = Output->LengthAllocated - OutputIndex;
+ @param Hilight TRUE if the value should be hilighted, FALSE if it should
+        be displayed with the default attributes.
 
-            if (WordIndex + 1 == BytesToDisplay && !MoreFollowing) {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T("%02x"),
-                                                       WordToDisplay);
-            } else {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T("%02x, "),
-                                                       WordToDisplay);
-            }
-            OutputIndex += Subset.LengthInChars;
-        }
+ @return The number of characters written.
+ */
+DWORD
+YoriLibHexWriteHilight(
+    __out_ecount(6) LPTSTR Output,
+    __in BOOLEAN Hilight
+    )
+{
+    Output[0] = '\x1b';
+    Output[1] = '[';
+    Output[2] = '0';
+    if (Hilight) {
+        Output[3] = ';';
+        Output[4] = '1';
+        Output[5] = 'm';
+        return 6;
     }
-    Output->LengthInChars = OutputIndex;
-
-    return TRUE;
+    Output[3] = 'm';
+    return 4;
 }
 
 /**
- Generate a line of up to YORI_LIB_HEXDUMP_BYTES_PER_LINE in units of one
- UCHAR.
-
- @param Output Pointer to a string to populate with the result.
-
- @param Buffer Pointer to the start of the buffer.
+ Write the offset of a line into a buffer.
 
- @param BytesToDisplay Number of bytes to display, can be equal to or less
-        than YORI_LIB_HEXDUMP_BYTES_PER_LINE.
+ @param Output Pointer to a buffer which must be at least twenty characters
+        long.
 
- @param HilightBits The set of bytes that should be hilighted.  This is
-        a bitmask with YORI_LIB_HEXDUMP_BYTES_PER_LINE bits where the high
-        order bit corresponds to the first byte.
+ @param Offset The offset to display.
 
- @param DisplaySeperator If TRUE, display a character at the midpoint of
-        each line.
+ @param DumpFlags Flags for the operation.  This determines whether the
+        offset is displayed, and whether it is displayed as a 32 or 64 bit
+        value.
 
- @return TRUE to indicate success, FALSE to indicate failure.
+ @return The number of characters written.
  */
-BOOL
-YoriLibHexByteLine(
-    __inout PYORI_STRING Output,
-    __in_ecount(BytesToDisplay) UCHAR CONST * Buffer,
-    __in DWORD BytesToDisplay,
-    __in DWORD HilightBits,
-    __in BOOLEAN DisplaySeperator
+DWORD
+YoriLibHexWriteOffset(
+    __out_ecount(20) LPTSTR Output,
+    __in LARGE_INTEGER Offset,
+    __in DWORD DumpFlags
     )
 {
-    UCHAR WordToDisplay = 0;
-    DWORD WordIndex;
-    BOOL DisplayWord;
-    DWORD ByteIndex;
     DWORD OutputIndex = 0;
-    DWORD CurrentBit = (0x1 << (YORI_LIB_HEXDUMP_BYTES_PER_LINE - sizeof(WordToDisplay)));
 
-    if (BytesToDisplay > YORI_LIB_HEXDUMP_BYTES_PER_LINE) {
-        return FALSE;
+    if (DumpFlags & YORI_LIB_HEX_FLAG_DISPLAY_LARGE_OFFSET) {
+        YoriLibHexWriteDword(&Output[OutputIndex], Offset.HighPart);
+        Output[OutputIndex + 8] = '`';
+        OutputIndex += 9;
+    } else if ((DumpFlags & YORI_LIB_HEX_FLAG_DISPLAY_OFFSET) == 0) {
+        return 0;
     }
 
-    for (WordIndex = 0; WordIndex < YORI_LIB_HEXDUMP_BYTES_PER_LINE / sizeof(WordToDisplay); WordIndex++) {
-
-        if (DisplaySeperator && WordIndex == YORI_LIB_HEXDUMP_BYTES_PER_LINE / (sizeof(WordToDisplay) * 2)) {
-            if (OutputIndex + 1 < Output->LengthAllocated) {
-                Output->StartOfString[OutputIndex] = ':';
-                Output->StartOfString[OutputIndex + 1] = ' ';
-                OutputIndex += 2;
-            }
-        }
-
-        WordToDisplay = 0;
-        DisplayWord = FALSE;
-
-        for (ByteIndex = 0; ByteIndex < sizeof(WordToDisplay); ByteIndex++) {
-            if (WordIndex * sizeof(WordToDisplay) + ByteIndex < BytesToDisplay) {
-                DisplayWord = TRUE;
-                WordToDisplay = (UCHAR)(WordToDisplay + (Buffer[WordIndex * sizeof(WordToDisplay) + ByteIndex] << (ByteIndex * 8)));
-            }
-        }
-
-        if (DisplayWord) {
-            YORI_STRING Subset;
-            Subset.StartOfString = &Output->StartOfString[OutputIndex];
-            Subset.LengthAllocated = Output->LengthAllocated - OutputIndex;
-            Subset.LengthInChars = 0;
-            if (HilightBits) {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T("\x1b[0%sm%02x\x1b[0m "),
-                                                       (HilightBits & CurrentBit)?_T(";1"):_T(""),
-                                                       WordToDisplay);
-            } else {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T("%02x "),
-                                                       WordToDisplay);
-            }
-            OutputIndex += Subset.LengthInChars;
-        } else {
-            for (ByteIndex = 0;
-                 OutputIndex < Output->LengthAllocated && ByteIndex < (sizeof(WordToDisplay) * 2 + 1);
-                 ByteIndex++) {
-
-                Output->StartOfString[OutputIndex] = ' ';
-                OutputIndex++;
-            }
-        }
-
-        CurrentBit = CurrentBit >> sizeof(WordToDisplay);
-    }
-    Output->LengthInChars = OutputIndex;
+    YoriLibHexWriteDword(&Output[OutputIndex], Offset.LowPart);
+    Output[OutputIndex + 8] = ':';
+    Output[OutputIndex + 9] = ' ';
+    OutputIndex += 10;
 
-    return TRUE;
+    return OutputIndex;
 }
 
 /**
- Generate a line of up to YORI_LIB_HEXDUMP_BYTES_PER_LINE in units of one
- WORD.
+ Generate a line of up to YORI_LIB_HEXDUMP_BYTES_PER_LINE in of bytes to
+ include into a C file.
 
  @param Output Pointer to a string to populate with the result.
 
@@ -208,94 +165,53 @@ YoriLibHexByteLine(
  @param BytesToDisplay Number of bytes to display, can be equal to or less
         than YORI_LIB_HEXDUMP_BYTES_PER_LINE.
 
- @param HilightBits The set of bytes that should be hilighted.  This is
-        a bitmask with YORI_LIB_HEXDUMP_BYTES_PER_LINE bits where the high
-        order bit corresponds to the first byte.
-
- @param DisplaySeperator If TRUE, display a character at the midpoint of
-        each line.
+ @param MoreFollowing If TRUE, the line should be terminated with a comma
+        because more data remains.  If FALSE, this is the final line and
+        it should be terminated with a newline.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
-YoriLibHexWordLine(
+YoriLibHexByteCStyle(
     __inout PYORI_STRING Output,
-    __in UCHAR CONST * Buffer,
+    __in_ecount(BytesToDisplay) UCHAR CONST * Buffer,
     __in DWORD BytesToDisplay,
-    __in DWORD HilightBits,
-    __in BOOLEAN DisplaySeperator
+    __in BOOLEAN MoreFollowing
     )
 {
-    WORD WordToDisplay = 0;
     DWORD WordIndex;
-    BOOL DisplayWord;
-    DWORD ByteIndex;
-    DWORD OutputIndex = 0;
-    DWORD CurrentBit = (0x3 << (YORI_LIB_HEXDUMP_BYTES_PER_LINE - sizeof(WordToDisplay)));
+    DWORD OutputIndex;
 
     if (BytesToDisplay > YORI_LIB_HEXDUMP_BYTES_PER_LINE) {
         return FALSE;
     }
 
-    for (WordIndex = 0; WordIndex < YORI_LIB_HEXDUMP_BYTES_PER_LINE / sizeof(WordToDisplay); WordIndex++) {
-
-        if (DisplaySeperator && WordIndex == YORI_LIB_HEXDUMP_BYTES_PER_LINE / (sizeof(WordToDisplay) * 2)) {
-            if (OutputIndex + 1 < Output->LengthAllocated) {
-                Output->StartOfString[OutputIndex] = ':';
-                Output->StartOfString[OutputIndex + 1] = ' ';
-                OutputIndex += 2;
-            }
-        }
-
-        WordToDisplay = 0;
-        DisplayWord = FALSE;
+    if (Output->LengthAllocated < 8 + 4 * BytesToDisplay) {
+        return FALSE;
+    }
 
-        for (ByteIndex = 0; ByteIndex < sizeof(WordToDisplay); ByteIndex++) {
-            if (WordIndex * sizeof(WordToDisplay) + ByteIndex < BytesToDisplay) {
-                DisplayWord = TRUE;
-                WordToDisplay = (WORD)(WordToDisplay + (Buffer[WordIndex * sizeof(WordToDisplay) + ByteIndex] << (ByteIndex * 8)));
-            }
-        }
+    for (OutputIndex = 0; OutputIndex < 8; OutputIndex++) {
+        Output->StartOfString[OutputIndex] = ' ';
+    }
 
-        if (DisplayWord) {
-            YORI_STRING Subset;
-            Subset.StartOfString = &Output->StartOfString[OutputIndex];
-            Subset.LengthAllocated = Output->LengthAllocated - OutputIndex;
-            Subset.LengthInChars = 0;
-            if (HilightBits) {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T("\x1b[0%sm%04x\x1b[0m "),
-                                                       (HilightBits & CurrentBit)?_T(";1"):_T(""),
-                                                       WordToDisplay);
-            } else {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T("%04x "),
-                                                       WordToDisplay);
-            }
-            OutputIndex += Subset.LengthInChars;
-        } else {
-            for (ByteIndex = 0;
-                 OutputIndex < Output->LengthAllocated && ByteIndex < (sizeof(WordToDisplay) * 2 + 1);
-                 ByteIndex++) {
+    for (WordIndex = 0; WordIndex < BytesToDisplay; WordIndex++) {
+        YoriLibHexWriteByte(&Output->StartOfString[OutputIndex], Buffer[WordIndex]);
+        OutputIndex += 2;
 
-                Output->StartOfString[OutputIndex] = ' ';
-                OutputIndex++;
-            }
+        if (WordIndex + 1 != BytesToDisplay || MoreFollowing) {
+            Output->StartOfString[OutputIndex] = ',';
+            Output->StartOfString[OutputIndex + 1] = ' ';
+            OutputIndex += 2;
         }
-
-        CurrentBit = CurrentBit >> sizeof(WordToDisplay);
     }
     Output->LengthInChars = OutputIndex;
 
     return TRUE;
 }
 
-
 /**
- Generate a line of up to YORI_LIB_HEXDUMP_BYTES_PER_LINE in units of one
- DWORD.
+ Generate a line of up to YORI_LIB_HEXDUMP_BYTES_PER_LINE as a continuous
+ sequence of hex digits, with no seperators between values.
 
  @param Output Pointer to a string to populate with the result.
 
@@ -304,101 +220,49 @@ YoriLibHexWordLine(
  @param BytesToDisplay Number of bytes to display, can be equal to or less
         than YORI_LIB_HEXDUMP_BYTES_PER_LINE.
 
- @param HilightBits The set of bytes that should be hilighted.  This is
-        a bitmask with YORI_LIB_HEXDUMP_BYTES_PER_LINE bits where the high
-        order bit corresponds to the first byte.
-
- @param DisplaySeperator If TRUE, display a character at the midpoint of
-        each line.
-
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
-YoriLibHexDwordLine(
+YoriLibHexRawLine(
     __inout PYORI_STRING Output,
-    __in UCHAR CONST * Buffer,
-    __in DWORD BytesToDisplay,
-    __in DWORD HilightBits,
-    __in BOOLEAN DisplaySeperator
+    __in_ecount(BytesToDisplay) UCHAR CONST * Buffer,
+    __in DWORD BytesToDisplay
     )
 {
-    DWORD WordToDisplay = 0;
     DWORD WordIndex;
-    BOOL DisplayWord;
-    DWORD ByteIndex;
-    DWORD OutputIndex = 0;
-    DWORD CurrentBit = (0xf << (YORI_LIB_HEXDUMP_BYTES_PER_LINE - sizeof(WordToDisplay)));
 
     if (BytesToDisplay > YORI_LIB_HEXDUMP_BYTES_PER_LINE) {
         return FALSE;
     }
 
-    for (WordIndex = 0; WordIndex < YORI_LIB_HEXDUMP_BYTES_PER_LINE / sizeof(WordToDisplay); WordIndex++) {
-
-        if (DisplaySeperator && WordIndex == YORI_LIB_HEXDUMP_BYTES_PER_LINE / (sizeof(WordToDisplay) * 2)) {
-            if (OutputIndex + 1 < Output->LengthAllocated) {
-                Output->StartOfString[OutputIndex] = ':';
-                Output->StartOfString[OutputIndex + 1] = ' ';
-                OutputIndex += 2;
-            }
-        }
-
-        WordToDisplay = 0;
-        DisplayWord = FALSE;
-
-        for (ByteIndex = 0; ByteIndex < sizeof(WordToDisplay); ByteIndex++) {
-            if (WordIndex * sizeof(WordToDisplay) + ByteIndex < BytesToDisplay) {
-                DisplayWord = TRUE;
-                WordToDisplay = WordToDisplay + ((DWORD)Buffer[WordIndex * sizeof(WordToDisplay) + ByteIndex] << (ByteIndex * 8));
-            }
-        }
-
-        if (DisplayWord) {
-            YORI_STRING Subset;
-            Subset.StartOfString = &Output->StartOfString[OutputIndex];
-            Subset.LengthAllocated = Output->LengthAllocated - OutputIndex;
-            Subset.LengthInChars = 0;
-            if (HilightBits) {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T("\x1b[0%sm%08x\x1b[0m "),
-                                                       (HilightBits & CurrentBit)?_T(";1"):_T(""),
-                                                       WordToDisplay);
-            } else {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T("%08x "),
-                                                       WordToDisplay);
-            }
-            OutputIndex += Subset.LengthInChars;
-        } else {
-            for (ByteIndex = 0;
-                 OutputIndex < Output->LengthAllocated && ByteIndex < (sizeof(WordToDisplay) * 2 + 1);
-                 ByteIndex++) {
-
-                Output->StartOfString[OutputIndex] = ' ';
-                OutputIndex++;
-            }
-        }
+    if (Output->LengthAllocated < 2 * BytesToDisplay) {
+        return FALSE;
+    }
 
-        CurrentBit = CurrentBit >> sizeof(WordToDisplay);
+    for (WordIndex = 0; WordIndex < BytesToDisplay; WordIndex++) {
+        YoriLibHexWriteByte(&Output->StartOfString[WordIndex * 2], Buffer[WordIndex]);
     }
-    Output->LengthInChars = OutputIndex;
+    Output->LengthInChars = BytesToDisplay * 2;
 
     return TRUE;
 }
 
 /**
- Generate a line of up to YORI_LIB_HEXDUMP_BYTES_PER_LINE in units of one
- DWORDLONG.
+ Generate a line of up to YORI_LIB_HEXDUMP_BYTES_PER_LINE in units of
+ BytesPerWord.  Each word is interpreted as a little endian value, so the
+ final byte in each word is displayed first.
 
  @param Output Pointer to a string to populate with the result.
 
- @param Buffer Pointer to the start of the buffer.
+ @param Buffer Pointer to the start of the buffer.  This can be NULL if
+        BytesToDisplay is zero.
 
  @param BytesToDisplay Number of bytes to display, can be equal to or less
         than YORI_LIB_HEXDUMP_BYTES_PER_LINE.
 
+ @param BytesPerWord The number of bytes in each word.  Must be 1, 2, 4 or
+        8.
+
  @param HilightBits The set of bytes that should be hilighted.  This is
         a bitmask with YORI_LIB_HEXDUMP_BYTES_PER_LINE bits where the high
         order bit corresponds to the first byte.
@@ -409,77 +273,100 @@ YoriLibHexDwordLine(
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
-YoriLibHexDwordLongLine(
+YoriLibHexLine(
     __inout PYORI_STRING Output,
-    __in UCHAR CONST * Buffer,
+    __in_ecount_opt(BytesToDisplay) UCHAR CONST * Buffer,
     __in DWORD BytesToDisplay,
+    __in DWORD BytesPerWord,
     __in DWORD HilightBits,
     __in BOOLEAN DisplaySeperator
     )
 {
-    DWORDLONG WordToDisplay = 0;
     DWORD WordIndex;
-    BOOL DisplayWord;
+    DWORD WordCount;
+    DWORD WordOffset;
     DWORD ByteIndex;
     DWORD OutputIndex = 0;
-    DWORD CurrentBit = (0xff << (YORI_LIB_HEXDUMP_BYTES_PER_LINE - sizeof(WordToDisplay)));
+    DWORD CharsPerWord;
+    DWORD CurrentBit;
+    UCHAR ByteToDisplay;
+    LPTSTR OutputChars;
 
     if (BytesToDisplay > YORI_LIB_HEXDUMP_BYTES_PER_LINE) {
         return FALSE;
     }
 
-    for (WordIndex = 0; WordIndex < YORI_LIB_HEXDUMP_BYTES_PER_LINE / sizeof(WordToDisplay); WordIndex++) {
+    if (BytesPerWord != 1 && BytesPerWord != 2 && BytesPerWord != 4 && BytesPerWord != 8) {
+        return FALSE;
+    }
+
+    //
+    //  Each word is two characters per byte, a space, a backtick for 64 bit
+    //  values, and if hilighting, up to six characters to start the
+    //  hilight and four to end it.
+    //
+
+    CharsPerWord = BytesPerWord * 2 + 2;
+    if (HilightBits) {
+        CharsPerWord += 10;
+    }
+
+    WordCount = YORI_LIB_HEXDUMP_BYTES_PER_LINE / BytesPerWord;
+    CurrentBit = (((1 << BytesPerWord) - 1) << (YORI_LIB_HEXDUMP_BYTES_PER_LINE - BytesPerWord));
+    OutputChars = Output->StartOfString;
 
-        if (DisplaySeperator && WordIndex == YORI_LIB_HEXDUMP_BYTES_PER_LINE / (sizeof(WordToDisplay) * 2)) {
+    for (WordIndex = 0; WordIndex < WordCount; WordIndex++) {
+
+        if (DisplaySeperator && WordIndex == WordCount / 2) {
             if (OutputIndex + 1 < Output->LengthAllocated) {
-                Output->StartOfString[OutputIndex] = ':';
-                Output->StartOfString[OutputIndex + 1] = ' ';
+                OutputChars[OutputIndex] = ':';
+                OutputChars[OutputIndex + 1] = ' ';
                 OutputIndex += 2;
             }
         }
 
-        WordToDisplay = 0;
-        DisplayWord = FALSE;
+        if (OutputIndex + CharsPerWord > Output->LengthAllocated) {
+            break;
+        }
+
+        WordOffset = WordIndex * BytesPerWord;
 
-        for (ByteIndex = 0; ByteIndex < sizeof(WordToDisplay); ByteIndex++) {
-            if (WordIndex * sizeof(WordToDisplay) + ByteIndex < BytesToDisplay) {
-                DisplayWord = TRUE;
-                WordToDisplay = WordToDisplay + ((DWORDLONG)Buffer[WordIndex * sizeof(WordToDisplay) + ByteIndex] << (ByteIndex * 8));
+        if (WordOffset < BytesToDisplay) {
+            if (HilightBits) {
+                OutputIndex += YoriLibHexWriteHilight(&OutputChars[OutputIndex], (BOOLEAN)((HilightBits & CurrentBit) != 0));
+            }
+
+            //
+            //  Any bytes in a partial word beyond the end of the buffer are
+            //  displayed as zero.
+            //
+
+            for (ByteIndex = BytesPerWord; ByteIndex > 0; ByteIndex--) {
+                if (ByteIndex == 4 && BytesPerWord == 8) {
+                    OutputChars[OutputIndex] = '`';
+                    OutputIndex++;
+                }
+                ByteToDisplay = 0;
+                if (WordOffset + ByteIndex - 1 < BytesToDisplay) {
+                    ByteToDisplay = Buffer[WordOffset + ByteIndex - 1];
+                }
+                YoriLibHexWriteByte(&OutputChars[OutputIndex], ByteToDisplay);
+                OutputIndex += 2;
             }
-        }
 
-        if (DisplayWord) {
-            LARGE_INTEGER DisplayValue;
-            YORI_STRING Subset;
-            Subset.StartOfString = &Output->StartOfString[OutputIndex];
-            Subset.LengthAllocated = Output->LengthAllocated - OutputIndex;
-            Subset.LengthInChars = 0;
-            DisplayValue.QuadPart = WordToDisplay;
             if (HilightBits) {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T("\x1b[0%sm%08x`%08x\x1b[0m "),
-                                                       (HilightBits & CurrentBit)?_T(";1"):_T(""),
-                                                       DisplayValue.HighPart,
-                                                       DisplayValue.LowPart);
-            } else {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T("%08x`%08x "),
-                                                       DisplayValue.HighPart,
-                                                       DisplayValue.LowPart);
+                OutputIndex += YoriLibHexWriteHilight(&OutputChars[OutputIndex], FALSE);
             }
-            OutputIndex += Subset.LengthInChars;
+            OutputChars[OutputIndex] = ' ';
+            OutputIndex++;
         } else {
-            for (ByteIndex = 0;
-                 OutputIndex < Output->LengthAllocated && ByteIndex < (sizeof(WordToDisplay) * 2 + 1);
-                 ByteIndex++) {
-
-                Output->StartOfString[OutputIndex] = ' ';
+            for (ByteIndex = 0; ByteIndex < BytesPerWord * 2 + 1; ByteIndex++) {
+                OutputChars[OutputIndex] = ' ';
                 OutputIndex++;
             }
         }
-        CurrentBit = CurrentBit >> sizeof(WordToDisplay);
+
+        CurrentBit = CurrentBit >> BytesPerWord;
     }
     Output->LengthInChars = OutputIndex;
 
@@ -515,94 +402,98 @@ YoriLibHexDump(
 {
     DWORD LineCount = (BufferLength + YORI_LIB_HEXDUMP_BYTES_PER_LINE - 1) / YORI_LIB_HEXDUMP_BYTES_PER_LINE;
     DWORD LineIndex;
+    DWORD LineStart;
     DWORD WordIndex;
     DWORD BytesToDisplay;
     CHAR CharToDisplay;
     LARGE_INTEGER DisplayBufferOffset;
-    YORI_STRING LineBuffer;
+    CONST UCHAR * LineData;
+    YORI_STRING OutputBuffer;
     YORI_STRING Subset;
+    HANDLE hOut;
 
     if (BytesPerWord != 1 && BytesPerWord != 2 && BytesPerWord != 4 && BytesPerWord != 8) {
         return FALSE;
     }
 
     //
-    //  16 chars per byte: 6 chars to initiate a highlight; 4 to end it; and 4
-    //  is the worst case for the data itself, being two hex digits, a space,
-    //  and a character.
+    //  Generate many lines into a single buffer and write them together.
+    //  Each write to the output device is far more expensive than
+    //  formatting a line.
     //
 
-    if (!YoriLibAllocateString(&LineBuffer, 16 * YORI_LIB_HEXDUMP_BYTES_PER_LINE + 32)) {
+    if (!YoriLibAllocateString(&OutputBuffer, YORI_LIB_HEXDUMP_MAX_LINE_CHARS * YORI_LIB_HEXDUMP_LINES_PER_WRITE)) {
         return FALSE;
     }
 
-    Subset.StartOfString = LineBuffer.StartOfString;
-    Subset.LengthInChars = LineBuffer.LengthInChars;
-    Subset.LengthAllocated = LineBuffer.LengthAllocated;
-
+    hOut = GetStdHandle(STD_OUTPUT_HANDLE);
     DisplayBufferOffset.QuadPart = StartOfBufferOffset;
 
     for (LineIndex = 0; LineIndex < LineCount; LineIndex++) {
 
-        //
-        //  If the caller requested to display the buffer offset for each
-        //  line, display it
-        //
-
-        if (DumpFlags & YORI_LIB_HEX_FLAG_DISPLAY_LARGE_OFFSET) {
-            Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString, Subset.LengthAllocated, _T("%08x`%08x: "), DisplayBufferOffset.HighPart, DisplayBufferOffset.LowPart);
-            DisplayBufferOffset.QuadPart += YORI_LIB_HEXDUMP_BYTES_PER_LINE;
-        } else if (DumpFlags & YORI_LIB_HEX_FLAG_DISPLAY_OFFSET) {
-            Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString, Subset.LengthAllocated, _T("%08x: "), DisplayBufferOffset.LowPart);
-            DisplayBufferOffset.QuadPart += YORI_LIB_HEXDUMP_BYTES_PER_LINE;
+        if (OutputBuffer.LengthAllocated - OutputBuffer.LengthInChars < YORI_LIB_HEXDUMP_MAX_LINE_CHARS) {
+            YoriLibOutputString(hOut, 0, &OutputBuffer);
+            OutputBuffer.LengthInChars = 0;
         }
 
-        //
-        //  Advance the buffer
-        //
-
-        LineBuffer.LengthInChars += Subset.LengthInChars;
-        Subset.StartOfString += Subset.LengthInChars;
-        Subset.LengthAllocated -= Subset.LengthInChars;
+        LineStart = OutputBuffer.LengthInChars;
+        Subset.StartOfString = &OutputBuffer.StartOfString[LineStart];
+        Subset.LengthAllocated = YORI_LIB_HEXDUMP_MAX_LINE_CHARS;
         Subset.LengthInChars = 0;
 
         //
         //  Figure out how many hex bytes can be displayed on this line
         //
 
+        LineData = (CONST UCHAR *)&Buffer[LineIndex * YORI_LIB_HEXDUMP_BYTES_PER_LINE];
         BytesToDisplay = BufferLength - LineIndex * YORI_LIB_HEXDUMP_BYTES_PER_LINE;
         if (BytesToDisplay > YORI_LIB_HEXDUMP_BYTES_PER_LINE) {
             BytesToDisplay = YORI_LIB_HEXDUMP_BYTES_PER_LINE;
         }
 
+        //
+        //  Raw output consists of nothing but the hex digits, one line at a
+        //  time.
+        //
+
+        if (DumpFlags & YORI_LIB_HEX_FLAG_RAW) {
+            YoriLibHexRawLine(&Subset, LineData, BytesToDisplay);
+            Subset.StartOfString[Subset.LengthInChars] = '\n';
+            OutputBuffer.LengthInChars += Subset.LengthInChars + 1;
+            continue;
+        }
+
+        //
+        //  If the caller requested to display the buffer offset for each
+        //  line, display it
+        //
+
+        OutputBuffer.LengthInChars += YoriLibHexWriteOffset(Subset.StartOfString, DisplayBufferOffset, DumpFlags);
+        DisplayBufferOffset.QuadPart += YORI_LIB_HEXDUMP_BYTES_PER_LINE;
+
+        Subset.StartOfString = &OutputBuffer.StartOfString[OutputBuffer.LengthInChars];
+        Subset.LengthAllocated = YORI_LIB_HEXDUMP_MAX_LINE_CHARS - (OutputBuffer.LengthInChars - LineStart);
+
         //
         //  Depending on the requested display format, generate the data.
         //
 
         if (DumpFlags & YORI_LIB_HEX_FLAG_C_STYLE) {
             if (LineIndex + 1 == LineCount) {
-                YoriLibHexByteCStyle(&Subset, (CONST UCHAR *)&Buffer[LineIndex * YORI_LIB_HEXDUMP_BYTES_PER_LINE], BytesToDisplay, FALSE);
+                YoriLibHexByteCStyle(&Subset, LineData, BytesToDisplay, FALSE);
             } else {
-                YoriLibHexByteCStyle(&Subset, (CONST UCHAR *)&Buffer[LineIndex * YORI_LIB_HEXDUMP_BYTES_PER_LINE], BytesToDisplay, TRUE);
+                YoriLibHexByteCStyle(&Subset, LineData, BytesToDisplay, TRUE);
             }
-        } else if (BytesPerWord == 1) {
-            YoriLibHexByteLine(&Subset, (CONST UCHAR *)&Buffer[LineIndex * YORI_LIB_HEXDUMP_BYTES_PER_LINE], BytesToDisplay, 0, FALSE);
-        } else if (BytesPerWord == 2) {
-            YoriLibHexWordLine(&Subset, (CONST UCHAR *)&Buffer[LineIndex * YORI_LIB_HEXDUMP_BYTES_PER_LINE], BytesToDisplay, 0, FALSE);
-        } else if (BytesPerWord == 4) {
-            YoriLibHexDwordLine(&Subset, (CONST UCHAR *)&Buffer[LineIndex * YORI_LIB_HEXDUMP_BYTES_PER_LINE], BytesToDisplay, 0, FALSE);
-        } else if (BytesPerWord == 8) {
-            YoriLibHexDwordLongLine(&Subset, (CONST UCHAR *)&Buffer[LineIndex * YORI_LIB_HEXDUMP_BYTES_PER_LINE], BytesToDisplay, 0, FALSE);
+        } else {
+            YoriLibHexLine(&Subset, LineData, BytesToDisplay, BytesPerWord, 0, FALSE);
         }
 
         //
         //  Advance the buffer
         //
 
-        LineBuffer.LengthInChars += Subset.LengthInChars;
+        OutputBuffer.LengthInChars += Subset.LengthInChars;
         Subset.StartOfString += Subset.LengthInChars;
-        Subset.LengthAllocated -= Subset.LengthInChars;
-        Subset.LengthInChars = 0;
 
         //
         //  If the caller requested characters after the hex output, generate
@@ -610,42 +501,33 @@ YoriLibHexDump(
         //
 
         if (DumpFlags & YORI_LIB_HEX_FLAG_DISPLAY_CHARS) {
-            if (LineBuffer.LengthInChars < LineBuffer.LengthAllocated) {
-                Subset.StartOfString[0] = ' ';
-                Subset.StartOfString++;
-                LineBuffer.LengthInChars++;
-            }
+            Subset.StartOfString[0] = ' ';
+            Subset.StartOfString++;
+            OutputBuffer.LengthInChars++;
             for (WordIndex = 0; WordIndex < YORI_LIB_HEXDUMP_BYTES_PER_LINE; WordIndex++) {
                 if (WordIndex < BytesToDisplay) {
-                    CharToDisplay = Buffer[LineIndex * YORI_LIB_HEXDUMP_BYTES_PER_LINE + WordIndex];
+                    CharToDisplay = (CHAR)LineData[WordIndex];
                     if (CharToDisplay < 32) {
                         CharToDisplay = '.';
                     }
                 } else {
                     CharToDisplay = ' ';
                 }
-                Subset.StartOfString[0] = CharToDisplay;
-                Subset.StartOfString++;
-                LineBuffer.LengthInChars++;
-                if (LineBuffer.LengthInChars == LineBuffer.LengthAllocated) {
-                    break;
-                }
+                Subset.StartOfString[WordIndex] = CharToDisplay;
             }
+            Subset.StartOfString += YORI_LIB_HEXDUMP_BYTES_PER_LINE;
+            OutputBuffer.LengthInChars += YORI_LIB_HEXDUMP_BYTES_PER_LINE;
         }
 
-        if (LineBuffer.LengthInChars < LineBuffer.LengthAllocated) {
-            Subset.StartOfString[0] = '\n';
-            Subset.StartOfString++;
-            LineBuffer.LengthInChars++;
-        }
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &LineBuffer);
-        LineBuffer.LengthInChars = 0;
-        Subset.StartOfString = LineBuffer.StartOfString;
-        Subset.LengthInChars = LineBuffer.LengthInChars;
-        Subset.LengthAllocated = LineBuffer.LengthAllocated;
+        Subset.StartOfString[0] = '\n';
+        OutputBuffer.LengthInChars++;
     }
 
-    YoriLibFreeStringContents(&LineBuffer);
+    if (OutputBuffer.LengthInChars > 0) {
+        YoriLibOutputString(hOut, 0, &OutputBuffer);
+    }
+
+    YoriLibFreeStringContents(&OutputBuffer);
     return TRUE;
 }
 
@@ -701,7 +583,12 @@ YoriLibHexDiff(
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&LineBuffer, 32 * YORI_LIB_HEXDUMP_BYTES_PER_LINE + 64)) {
+    //
+    //  Each side can use up to 13 chars per byte for hex with hilighting,
+    //  plus 7 chars per byte for hilighted characters.
+    //
+
+    if (!YoriLibAllocateString(&LineBuffer, 48 * YORI_LIB_HEXDUMP_BYTES_PER_LINE + 64)) {
         return FALSE;
     }
 
@@ -729,13 +616,8 @@ YoriLibHexDiff(
         //  line, display it
         //
 
-        if (DumpFlags & YORI_LIB_HEX_FLAG_DISPLAY_LARGE_OFFSET) {
-            Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString, Subset.LengthAllocated, _T("%08x`%08x: "), DisplayBufferOffset.HighPart, DisplayBufferOffset.LowPart);
-            DisplayBufferOffset.QuadPart += YORI_LIB_HEXDUMP_BYTES_PER_LINE;
-        } else if (DumpFlags & YORI_LIB_HEX_FLAG_DISPLAY_OFFSET) {
-            Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString, Subset.LengthAllocated, _T("%08x: "), DisplayBufferOffset.LowPart);
-            DisplayBufferOffset.QuadPart += YORI_LIB_HEXDUMP_BYTES_PER_LINE;
-        }
+        Subset.LengthInChars = YoriLibHexWriteOffset(Subset.StartOfString, DisplayBufferOffset, DumpFlags);
+        DisplayBufferOffset.QuadPart += YORI_LIB_HEXDUMP_BYTES_PER_LINE;
 
         //
         //  Advance the buffer
@@ -781,20 +663,11 @@ YoriLibHexDiff(
                 }
             }
 
-
             //
-            //  Depending on the requested display format, display the data.
+            //  Display the data in the requested format.
             //
 
-            if (BytesPerWord == 1) {
-                YoriLibHexByteLine(&Subset, (CONST UCHAR *)BufferToDisplay, BytesToDisplay, HilightBits, TRUE);
-            } else if (BytesPerWord == 2) {
-                YoriLibHexWordLine(&Subset, (CONST UCHAR *)BufferToDisplay, BytesToDisplay, HilightBits, TRUE);
-            } else if (BytesPerWord == 4) {
-                YoriLibHexDwordLine(&Subset, (CONST UCHAR *)BufferToDisplay, BytesToDisplay, HilightBits, TRUE);
-            } else if (BytesPerWord == 8) {
-                YoriLibHexDwordLongLine(&Subset, (CONST UCHAR *)BufferToDisplay, BytesToDisplay, HilightBits, TRUE);
-            }
+            YoriLibHexLine(&Subset, (CONST UCHAR *)BufferToDisplay, BytesToDisplay, BytesPerWord, HilightBits, TRUE);
 
             //
             //  Advance the buffer
@@ -807,15 +680,15 @@ YoriLibHexDiff(
 
             //
             //  If the caller requested characters after the hex output,
-            //  generate them.
+            //  generate them.  Each character needs up to six chars to
+            //  indicate its hilight state.
             //
 
-            if (DumpFlags & YORI_LIB_HEX_FLAG_DISPLAY_CHARS) {
-                if (LineBuffer.LengthInChars < LineBuffer.LengthAllocated) {
-                    Subset.StartOfString[0] = ' ';
-                    Subset.StartOfString++;
-                    LineBuffer.LengthInChars++;
-                }
+            if ((DumpFlags & YORI_LIB_HEX_FLAG_DISPLAY_CHARS) != 0 &&
+                Subset.LengthAllocated > 1 + 7 * YORI_LIB_HEXDUMP_BYTES_PER_LINE) {
+
+                Subset.StartOfString[0] = ' ';
+                Subset.LengthInChars = 1;
                 CurrentBit = (0x1 << (YORI_LIB_HEXDUMP_BYTES_PER_LINE - sizeof(CharToDisplay)));
                 for (WordIndex = 0; WordIndex < YORI_LIB_HEXDUMP_BYTES_PER_LINE; WordIndex++) {
                     if (WordIndex < BytesToDisplay) {
@@ -827,30 +700,27 @@ YoriLibHexDiff(
                         CharToDisplay = ' ';
                     }
 
-                    Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                           Subset.LengthAllocated,
-                                                           _T("\x1b[0%sm%c"),
-                                                           (HilightBits & CurrentBit)?_T(";1"):_T(""),
-                                                           CharToDisplay);
-
-                    LineBuffer.LengthInChars += Subset.LengthInChars;
-                    Subset.StartOfString += Subset.LengthInChars;
-                    Subset.LengthAllocated -= Subset.LengthInChars;
-                    Subset.LengthInChars = 0;
+                    Subset.LengthInChars += YoriLibHexWriteHilight(&Subset.StartOfString[Subset.LengthInChars], (BOOLEAN)((HilightBits & CurrentBit) != 0));
+                    Subset.StartOfString[Subset.LengthInChars] = CharToDisplay;
+                    Subset.LengthInChars++;
 
                     CurrentBit = CurrentBit >> sizeof(CharToDisplay);
                 }
-            }
 
-            if (BufferIndex == 0) {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T(" | "));
                 LineBuffer.LengthInChars += Subset.LengthInChars;
                 Subset.StartOfString += Subset.LengthInChars;
                 Subset.LengthAllocated -= Subset.LengthInChars;
                 Subset.LengthInChars = 0;
             }
+
+            if (BufferIndex == 0 && Subset.LengthAllocated > 3) {
+                Subset.StartOfString[0] = ' ';
+                Subset.StartOfString[1] = '|';
+                Subset.StartOfString[2] = ' ';
+                LineBuffer.LengthInChars += 3;
+                Subset.StartOfString += 3;
+                Subset.LengthAllocated -= 3;
+            }
         }
 
         if (LineBuffer.LengthInChars < LineBuffer.LengthAllocated) {
@@ -858,7 +728,7 @@ YoriLibHexDiff(
             Subset.StartOfString++;
             LineBuffer.LengthInChars++;
         }
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &LineBuffer);
+        YoriLibOutputString(GetStdHandle(STD_OUTPUT_HANDLE), 0, &LineBuffer);
         LineBuffer.LengthInChars = 0;
         Subset.StartOfString = LineBuffer.StartOfString;
         Subset.LengthInChars = LineBuffer.LengthInChars;
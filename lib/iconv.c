@@ -135,9 +135,325 @@ YoriLibSetMultibyteInputEncoding(
     YoriLibActiveInputEncodingInitialized = TRUE;
 }
 
+/**
+ A mask which, when applied to a machine word containing 8 bit characters,
+ is nonzero if any character in the word is not ASCII.
+ */
+#define YORI_LIB_ICONV_NONASCII_BYTE_MASK (((DWORD_PTR)-1) / 0xFF * 0x80)
+
+/**
+ A mask which, when applied to a machine word containing 16 bit characters,
+ is nonzero if any character in the word is not ASCII.
+ */
+#define YORI_LIB_ICONV_NONASCII_WCHAR_MASK (((DWORD_PTR)-1) / 0xFFFF * 0xFF80)
+
+/**
+ The character used to replace input that cannot be represented.  This
+ matches the behavior of the system conversion routines.
+ */
+#define YORI_LIB_ICONV_REPLACEMENT_CHAR (0xFFFD)
+
+/**
+ Convert a UTF16 string into UTF8 in a single pass.  Runs of ASCII text are
+ checked a machine word at a time.  Unpaired surrogates are converted to
+ the replacement character.  If the output buffer is too small, conversion
+ stops at the last character that fits.
+
+ @param InputStringBuffer Pointer to a UTF16 string.
+
+ @param InputBufferLength The size of InputStringBuffer, in characters.
+
+ @param OutputStringBuffer Pointer to a buffer to be populated with the
+        UTF8 form of the string.
+
+ @param OutputBufferLength The length of the output buffer, in bytes.
+
+ @return The number of bytes written to OutputStringBuffer.
+ */
+DWORD
+YoriLibUtf16ToUtf8(
+    __in_ecount(InputBufferLength) LPCWSTR InputStringBuffer,
+    __in DWORD InputBufferLength,
+    __out_ecount(OutputBufferLength) LPSTR OutputStringBuffer,
+    __in DWORD OutputBufferLength
+    )
+{
+    DWORD InIndex;
+    DWORD OutIndex;
+    DWORD Char;
+    DWORD Index;
+    DWORD_PTR Word;
+    DWORD WordChars;
+
+    WordChars = sizeof(DWORD_PTR) / sizeof(WCHAR);
+    InIndex = 0;
+    OutIndex = 0;
+
+    while (InIndex < InputBufferLength) {
+
+        //
+        //  If the input is word aligned and at least one word remains in
+        //  both buffers, check whether the entire word is ASCII, and if so
+        //  copy it without further inspection.
+        //
+
+        if ((((DWORD_PTR)&InputStringBuffer[InIndex]) % sizeof(DWORD_PTR)) == 0) {
+            while (InIndex + WordChars <= InputBufferLength &&
+                   OutIndex + WordChars <= OutputBufferLength) {
+
+                Word = *(CONST DWORD_PTR *)&InputStringBuffer[InIndex];
+                if ((Word & YORI_LIB_ICONV_NONASCII_WCHAR_MASK) != 0) {
+                    break;
+                }
+                for (Index = 0; Index < WordChars; Index++) {
+                    OutputStringBuffer[OutIndex + Index] = (CHAR)InputStringBuffer[InIndex + Index];
+                }
+                InIndex += WordChars;
+                OutIndex += WordChars;
+            }
+
+            if (InIndex >= InputBufferLength) {
+                break;
+            }
+        }
+
+        Char = InputStringBuffer[InIndex];
+
+        if (Char < 0x80) {
+            if (OutIndex + 1 > OutputBufferLength) {
+                break;
+            }
+            OutputStringBuffer[OutIndex] = (CHAR)Char;
+            OutIndex++;
+            InIndex++;
+            continue;
+        }
+
+        if (Char < 0x800) {
+            if (OutIndex + 2 > OutputBufferLength) {
+                break;
+            }
+            OutputStringBuffer[OutIndex] = (CHAR)(0xC0 | (Char >> 6));
+            OutputStringBuffer[OutIndex + 1] = (CHAR)(0x80 | (Char & 0x3F));
+            OutIndex += 2;
+            InIndex++;
+            continue;
+        }
+
+        //
+        //  A high surrogate followed by a low surrogate describes a
+        //  character outside of the basic multilingual plane, which takes
+        //  four bytes.  Any other surrogate is unpaired and is replaced.
+        //
+
+        if (Char >= 0xD800 && Char <= 0xDBFF &&
+            InIndex + 1 < InputBufferLength &&
+            InputStringBuffer[InIndex + 1] >= 0xDC00 &&
+            InputStringBuffer[InIndex + 1] <= 0xDFFF) {
+
+            if (OutIndex + 4 > OutputBufferLength) {
+                break;
+            }
+            Char = 0x10000 + ((Char - 0xD800) << 10) + (InputStringBuffer[InIndex + 1] - 0xDC00);
+            OutputStringBuffer[OutIndex] = (CHAR)(0xF0 | (Char >> 18));
+            OutputStringBuffer[OutIndex + 1] = (CHAR)(0x80 | ((Char >> 12) & 0x3F));
+            OutputStringBuffer[OutIndex + 2] = (CHAR)(0x80 | ((Char >> 6) & 0x3F));
+            OutputStringBuffer[OutIndex + 3] = (CHAR)(0x80 | (Char & 0x3F));
+            OutIndex += 4;
+            InIndex += 2;
+            continue;
+        }
+
+        if (Char >= 0xD800 && Char <= 0xDFFF) {
+            Char = YORI_LIB_ICONV_REPLACEMENT_CHAR;
+        }
+
+        if (OutIndex + 3 > OutputBufferLength) {
+            break;
+        }
+        OutputStringBuffer[OutIndex] = (CHAR)(0xE0 | (Char >> 12));
+        OutputStringBuffer[OutIndex + 1] = (CHAR)(0x80 | ((Char >> 6) & 0x3F));
+        OutputStringBuffer[OutIndex + 2] = (CHAR)(0x80 | (Char & 0x3F));
+        OutIndex += 3;
+        InIndex++;
+    }
+
+    return OutIndex;
+}
+
+/**
+ Convert a UTF8 string into UTF16 in a single pass.  Runs of ASCII text are
+ checked a machine word at a time.  Malformed sequences, overlong encodings,
+ encoded surrogates and values beyond the Unicode range are converted to the
+ replacement character, one per maximal invalid subsequence.  If the output buffer is
+ too small, conversion stops at the last character that fits.
+
+ @param InputStringBuffer Pointer to a UTF8 string.
+
+ @param InputBufferLength The size of InputStringBuffer, in bytes.
+
+ @param OutputStringBuffer Pointer to a buffer to be populated with the
+        UTF16 form of the string.
+
+ @param OutputBufferLength The length of the output buffer, in characters.
+
+ @return The number of characters written to OutputStringBuffer.
+ */
+DWORD
+YoriLibUtf8ToUtf16(
+    __in_ecount(InputBufferLength) LPCSTR InputStringBuffer,
+    __in DWORD InputBufferLength,
+    __out_ecount(OutputBufferLength) LPWSTR OutputStringBuffer,
+    __in DWORD OutputBufferLength
+    )
+{
+    CONST UCHAR * Input;
+    DWORD InIndex;
+    DWORD OutIndex;
+    DWORD Char;
+    DWORD Index;
+    DWORD SequenceLength;
+    UCHAR SecondMin;
+    UCHAR SecondMax;
+    DWORD_PTR Word;
+
+    Input = (CONST UCHAR *)InputStringBuffer;
+    InIndex = 0;
+    OutIndex = 0;
+
+    while (InIndex < InputBufferLength) {
+
+        //
+        //  If the input is word aligned and at least one word remains in
+        //  both buffers, check whether the entire word is ASCII, and if so
+        //  widen it without further inspection.
+        //
+
+        if ((((DWORD_PTR)&Input[InIndex]) % sizeof(DWORD_PTR)) == 0) {
+            while (InIndex + sizeof(DWORD_PTR) <= InputBufferLength &&
+                   OutIndex + sizeof(DWORD_PTR) <= OutputBufferLength) {
+
+                Word = *(CONST DWORD_PTR *)&Input[InIndex];
+                if ((Word & YORI_LIB_ICONV_NONASCII_BYTE_MASK) != 0) {
+                    break;
+                }
+                for (Index = 0; Index < sizeof(DWORD_PTR); Index++) {
+                    OutputStringBuffer[OutIndex + Index] = Input[InIndex + Index];
+                }
+                InIndex += sizeof(DWORD_PTR);
+                OutIndex += sizeof(DWORD_PTR);
+            }
+
+            if (InIndex >= InputBufferLength) {
+                break;
+            }
+        }
+
+        Char = Input[InIndex];
+
+        if (Char < 0x80) {
+            if (OutIndex + 1 > OutputBufferLength) {
+                break;
+            }
+            OutputStringBuffer[OutIndex] = (WCHAR)Char;
+            OutIndex++;
+            InIndex++;
+            continue;
+        }
+
+        //
+        //  Determine the length of the sequence from the lead byte.  A
+        //  continuation byte or invalid lead byte is a one byte invalid
+        //  sequence.
+        //
+
+        if (Char >= 0xC2 && Char <= 0xDF) {
+            SequenceLength = 2;
+            Char = Char & 0x1F;
+        } else if (Char >= 0xE0 && Char <= 0xEF) {
+            SequenceLength = 3;
+            Char = Char & 0x0F;
+        } else if (Char >= 0xF0 && Char <= 0xF4) {
+            SequenceLength = 4;
+            Char = Char & 0x07;
+        } else {
+            SequenceLength = 1;
+            Char = YORI_LIB_ICONV_REPLACEMENT_CHAR;
+        }
+
+        //
+        //  Some lead bytes restrict the range of the following byte, which
+        //  is how overlong forms, encoded surrogates and values beyond the
+        //  Unicode range are excluded.
+        //
+
+        SecondMin = 0x80;
+        SecondMax = 0xBF;
+        if (Input[InIndex] == 0xE0) {
+            SecondMin = 0xA0;
+        } else if (Input[InIndex] == 0xED) {
+            SecondMax = 0x9F;
+        } else if (Input[InIndex] == 0xF0) {
+            SecondMin = 0x90;
+        } else if (Input[InIndex] == 0xF4) {
+            SecondMax = 0x8F;
+        }
+
+        //
+        //  Consume as many continuation bytes as are valid, up to the
+        //  length indicated by the lead byte.  If the sequence is truncated
+        //  or malformed, emit a single replacement character for the bytes
+        //  consumed, and resume at the first byte that was not part of the
+        //  sequence.
+        //
+
+        for (Index = 1; Index < SequenceLength; Index++) {
+            if (InIndex + Index >= InputBufferLength) {
+                break;
+            }
+            if (Index == 1) {
+                if (Input[InIndex + Index] < SecondMin ||
+                    Input[InIndex + Index] > SecondMax) {
+
+                    break;
+                }
+            } else if ((Input[InIndex + Index] & 0xC0) != 0x80) {
+                break;
+            }
+            Char = (Char << 6) | (Input[InIndex + Index] & 0x3F);
+        }
+
+        if (Index < SequenceLength) {
+            Char = YORI_LIB_ICONV_REPLACEMENT_CHAR;
+        }
+
+        if (Char >= 0x10000) {
+            if (OutIndex + 2 > OutputBufferLength) {
+                break;
+            }
+            Char = Char - 0x10000;
+            OutputStringBuffer[OutIndex] = (WCHAR)(0xD800 + (Char >> 10));
+            OutputStringBuffer[OutIndex + 1] = (WCHAR)(0xDC00 + (Char & 0x3FF));
+            OutIndex += 2;
+        } else {
+            if (OutIndex + 1 > OutputBufferLength) {
+                break;
+            }
+            OutputStringBuffer[OutIndex] = (WCHAR)Char;
+            OutIndex++;
+        }
+
+        InIndex += Index;
+    }
+
+    return OutIndex;
+}
+
 /**
  Returns the number of bytes needed to store a specified UTF16 string in
- the current output encoding.
+ the current output encoding.  For UTF8, this is an upper bound calculated
+ without inspecting the string, so the caller should use the length returned
+ from @ref YoriLibMultibyteOutput to determine the length of the result.
 
  @param StringBuffer The UTF16 string.
 
@@ -156,6 +472,15 @@ YoriLibGetMultibyteOutputSizeNeeded(
     if (Encoding == CP_UTF16) {
         return BufferLength * sizeof(WCHAR);
     }
+
+    //
+    //  Each UTF16 character takes at most three bytes.  A surrogate pair
+    //  takes four bytes for two characters.
+    //
+
+    if (Encoding == CP_UTF8) {
+        return BufferLength * 3;
+    }
     Return = WideCharToMultiByte(Encoding, 0, StringBuffer, BufferLength, NULL, 0, NULL, NULL);
     ASSERT(Return > 0 || BufferLength == 0);
     return Return;
@@ -179,8 +504,10 @@ YoriLibGetMultibyteOutputSizeNeeded(
         in the current output encoding.
 
  @param OutputBufferLength The length of the output buffer, in bytes.
+
+ @return The number of bytes written to OutputStringBuffer.
  */
-VOID
+DWORD
 YoriLibMultibyteOutput(
     __in_ecount(InputBufferLength) LPCTSTR InputStringBuffer,
     __in DWORD InputBufferLength,
@@ -194,9 +521,15 @@ YoriLibMultibyteOutput(
         ASSERT(OutputBufferLength >= InputBufferLength * sizeof(WCHAR));
         if (OutputBufferLength >= InputBufferLength * sizeof(WCHAR)) {
             memcpy(OutputStringBuffer, InputStringBuffer, InputBufferLength * sizeof(WCHAR));
+            return InputBufferLength * sizeof(WCHAR);
         }
-        return;
+        return 0;
     }
+
+    if (Encoding == CP_UTF8) {
+        return YoriLibUtf16ToUtf8(InputStringBuffer, InputBufferLength, OutputStringBuffer, OutputBufferLength);
+    }
+
     Return = WideCharToMultiByte(Encoding,
                                  0,
                                  InputStringBuffer,
@@ -210,35 +543,73 @@ YoriLibMultibyteOutput(
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("InputBufferLength %i OutputBufferLength %i\n"), InputBufferLength, OutputBufferLength);
         ASSERT(Return != 0);
     }
+
+    return Return;
 }
 
 /**
- Returns the number of bytes needed to store a string in the current input
- encoding into UTF16.
+ Returns the number of characters needed to store a string in a specified
+ encoding into UTF16.  For UTF8, this is an upper bound calculated without
+ inspecting the string, so the caller should use the length returned from
+ @ref YoriLibMultibyteInputEx to determine the length of the result.
 
- @param StringBuffer The string in the input encoding.
+ @param Encoding The encoding of the string.
+
+ @param StringBuffer The string in the specified encoding.
 
  @param BufferLength The length of the string, in bytes.
 
- @return The number of bytes needed to store the UTF16 form.
+ @return The number of characters needed to store the UTF16 form.
  */
 DWORD
-YoriLibGetMultibyteInputSizeNeeded(
+YoriLibGetMultibyteInputSizeNeededEx(
+    __in DWORD Encoding,
     __in LPCSTR StringBuffer,
     __in DWORD BufferLength
     )
 {
-    DWORD Encoding = YoriLibGetMultibyteInputEncoding();
     if (Encoding == CP_UTF16) {
         return BufferLength;
     }
+
+    //
+    //  Each UTF8 byte generates at most one UTF16 character.  A four byte
+    //  sequence generates two characters.
+    //
+
+    if (Encoding == CP_UTF8) {
+        return BufferLength;
+    }
     return MultiByteToWideChar(Encoding, 0, StringBuffer, BufferLength, NULL, 0);
 }
 
 /**
- Convert a string from the input encoding into UTF16.
+ Returns the number of characters needed to store a string in the current
+ input encoding into UTF16.  For UTF8, this is an upper bound calculated
+ without inspecting the string, so the caller should use the length returned
+ from @ref YoriLibMultibyteInput to determine the length of the result.
 
- @param InputStringBuffer Pointer to a string in input encoding form.
+ @param StringBuffer The string in the input encoding.
+
+ @param BufferLength The length of the string, in bytes.
+
+ @return The number of characters needed to store the UTF16 form.
+ */
+DWORD
+YoriLibGetMultibyteInputSizeNeeded(
+    __in LPCSTR StringBuffer,
+    __in DWORD BufferLength
+    )
+{
+    return YoriLibGetMultibyteInputSizeNeededEx(YoriLibGetMultibyteInputEncoding(), StringBuffer, BufferLength);
+}
+
+/**
+ Convert a string from a specified encoding into UTF16.
+
+ @param Encoding The encoding of the string.
+
+ @param InputStringBuffer Pointer to a string in the specified encoding.
 
  @param InputBufferLength The size of InputStringBuffer, in bytes.
 
@@ -246,9 +617,12 @@ YoriLibGetMultibyteInputSizeNeeded(
         in UTF16 format.
 
  @param OutputBufferLength The length of the output buffer, in characters.
+
+ @return The number of characters written to OutputStringBuffer.
  */
-VOID
-YoriLibMultibyteInput(
+DWORD
+YoriLibMultibyteInputEx(
+    __in DWORD Encoding,
     __in_ecount(InputBufferLength) LPCSTR InputStringBuffer,
     __in DWORD InputBufferLength,
     __out_ecount(OutputBufferLength) LPTSTR OutputStringBuffer,
@@ -256,14 +630,19 @@ YoriLibMultibyteInput(
     )
 {
     DWORD Return;
-    DWORD Encoding = YoriLibGetMultibyteInputEncoding();
     if (Encoding == CP_UTF16) {
         ASSERT(OutputBufferLength >= InputBufferLength);
         if (OutputBufferLength >= InputBufferLength) {
             memcpy(OutputStringBuffer, InputStringBuffer, InputBufferLength * sizeof(WCHAR));
+            return InputBufferLength;
         }
-        return;
+        return 0;
     }
+
+    if (Encoding == CP_UTF8) {
+        return YoriLibUtf8ToUtf16(InputStringBuffer, InputBufferLength, OutputStringBuffer, OutputBufferLength);
+    }
+
     Return = MultiByteToWideChar(Encoding,
                                  0,
                                  InputStringBuffer,
@@ -272,6 +651,32 @@ YoriLibMultibyteInput(
                                  OutputBufferLength);
 
     ASSERT(Return != 0);
+    return Return;
+}
+
+/**
+ Convert a string from the input encoding into UTF16.
+
+ @param InputStringBuffer Pointer to a string in input encoding form.
+
+ @param InputBufferLength The size of InputStringBuffer, in bytes.
+
+ @param OutputStringBuffer Pointer to a buffer to be populated with the string
+        in UTF16 format.
+
+ @param OutputBufferLength The length of the output buffer, in characters.
+
+ @return The number of characters written to OutputStringBuffer.
+ */
+DWORD
+YoriLibMultibyteInput(
+    __in_ecount(InputBufferLength) LPCSTR InputStringBuffer,
+    __in DWORD InputBufferLength,
+    __out_ecount(OutputBufferLength) LPTSTR OutputStringBuffer,
+    __in DWORD OutputBufferLength
+    )
+{
+    return YoriLibMultibyteInputEx(YoriLibGetMultibyteInputEncoding(), InputStringBuffer, InputBufferLength, OutputStringBuffer, OutputBufferLength);
 }
 
 // vim:sw=4:ts=4:et:
@@ -0,0 +1,1333 @@
+/**
+ * @file lib/ini.c
+ *
+ * Yori in memory INI file parsing and update
+ *
+ * Copyright (c) 2020 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ The number of hash buckets used to find a section within an INI file.
+ */
+#define YORI_LIB_INI_SECTION_BUCKETS (251)
+
+/**
+ The number of hash buckets used to find a key within a section.
+ */
+#define YORI_LIB_INI_KEY_BUCKETS (13)
+
+/**
+ The encoding of an INI file on disk.  Files are written back in the same
+ encoding they were read in.
+ */
+typedef enum _YORI_LIB_INI_ENCODING {
+    YoriLibIniEncodingAnsi = 0,
+    YoriLibIniEncodingUtf8 = 1,
+    YoriLibIniEncodingUtf16 = 2
+} YORI_LIB_INI_ENCODING;
+
+/**
+ A single line within a section of an INI file.  This is either a key value
+ pair, or a line that is preserved verbatim such as a comment or blank line.
+ */
+typedef struct _YORI_LIB_INI_LINE {
+
+    /**
+     The list of lines within the section, in file order.  The list head is
+     YORI_LIB_INI_SECTION's LineList member.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The entry for this key in the section's key hash table.  This is only
+     meaningful if InHash is TRUE.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     TRUE if HashEntry is inserted into the section's key hash table.  This
+     is FALSE for verbatim lines and for a key that is a duplicate of an
+     earlier key in the same section, which can never be found by lookup.
+     */
+    BOOLEAN InHash;
+
+    /**
+     The key name.  This is an empty string for a verbatim line.
+     */
+    YORI_STRING Key;
+
+    /**
+     The value of the key, or for a verbatim line, the text of the line.
+     This string is always NULL terminated.
+     */
+    YORI_STRING Value;
+} YORI_LIB_INI_LINE, *PYORI_LIB_INI_LINE;
+
+/**
+ A section within an INI file.
+ */
+typedef struct _YORI_LIB_INI_SECTION {
+
+    /**
+     The list of sections within the file, in file order.  The list head is
+     YORI_LIB_INI_FILE's SectionList member.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The entry for this section in the file's section hash table.  This is
+     only meaningful if InHash is TRUE.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     TRUE if HashEntry is inserted into the file's section hash table.  This
+     is FALSE for lines preceding the first section and for a section that is
+     a duplicate of an earlier section.
+     */
+    BOOLEAN InHash;
+
+    /**
+     The name of the section.  This string is always NULL terminated.
+     */
+    YORI_STRING Name;
+
+    /**
+     The list of lines within this section.
+     */
+    YORI_LIST_ENTRY LineList;
+
+    /**
+     A hash table of keys within this section.
+     */
+    PYORI_HASH_TABLE KeyTable;
+} YORI_LIB_INI_SECTION, *PYORI_LIB_INI_SECTION;
+
+/**
+ An INI file that has been loaded into memory.
+ */
+typedef struct _YORI_LIB_INI_FILE {
+
+    /**
+     The fully qualified path to the file.
+     */
+    YORI_STRING FileName;
+
+    /**
+     The list of sections in the file, in file order.  The first section is
+     always present, is unnamed, and contains any lines preceding the first
+     section header.
+     */
+    YORI_LIST_ENTRY SectionList;
+
+    /**
+     A hash table of sections within the file.
+     */
+    PYORI_HASH_TABLE SectionTable;
+
+    /**
+     The encoding of the file on disk.
+     */
+    YORI_LIB_INI_ENCODING Encoding;
+
+    /**
+     TRUE if the contents have been changed since the file was loaded.
+     */
+    BOOLEAN Modified;
+} YORI_LIB_INI_FILE, *PYORI_LIB_INI_FILE;
+
+/**
+ Return TRUE if the character is horizontal white space within an INI line.
+
+ @param Char The character to check.
+
+ @return TRUE if the character is white space, FALSE if it is not.
+ */
+BOOLEAN
+YoriLibIniIsSpace(
+    __in TCHAR Char
+    )
+{
+    if (Char == ' ' || Char == '\t') {
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ Allocate a new line and insert it into a section.
+
+ @param Section Pointer to the section to insert the line into.
+
+ @param InsertAfter Optionally points to a line to insert the new line
+        after.  If not specified, the line is added to the end of the
+        section.
+
+ @param Key Pointer to the key name, or an empty string for a verbatim line.
+        This string is referenced by the line, so it must be allocated with
+        YoriLibReferencedMalloc if it is not empty.
+
+ @param Value Pointer to the value, or the text of a verbatim line.  This
+        string is referenced by the line, so it must be allocated with
+        YoriLibReferencedMalloc if it is not empty, and must be NULL
+        terminated.
+
+ @return Pointer to the new line, or NULL on allocation failure.
+ */
+PYORI_LIB_INI_LINE
+YoriLibIniAddLine(
+    __in PYORI_LIB_INI_SECTION Section,
+    __in_opt PYORI_LIB_INI_LINE InsertAfter,
+    __in PYORI_STRING Key,
+    __in PYORI_STRING Value
+    )
+{
+    PYORI_LIB_INI_LINE Line;
+
+    Line = YoriLibMalloc(sizeof(YORI_LIB_INI_LINE));
+    if (Line == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Line, sizeof(YORI_LIB_INI_LINE));
+    YoriLibCloneString(&Line->Key, Key);
+    YoriLibCloneString(&Line->Value, Value);
+
+    if (Key->LengthInChars > 0 &&
+        YoriLibHashLookupByKey(Section->KeyTable, Key) == NULL) {
+
+        YoriLibHashInsertByKey(Section->KeyTable, &Line->Key, Line, &Line->HashEntry);
+        Line->InHash = TRUE;
+    }
+
+    if (InsertAfter != NULL) {
+        YoriLibInsertList(&InsertAfter->ListEntry, &Line->ListEntry);
+    } else {
+        YoriLibAppendList(&Section->LineList, &Line->ListEntry);
+    }
+
+    return Line;
+}
+
+/**
+ Remove a line from its section and free it.
+
+ @param Line Pointer to the line to free.
+ */
+VOID
+YoriLibIniFreeLine(
+    __in PYORI_LIB_INI_LINE Line
+    )
+{
+    YoriLibRemoveListItem(&Line->ListEntry);
+    if (Line->InHash) {
+        YoriLibHashRemoveByEntry(&Line->HashEntry);
+    }
+    YoriLibFreeStringContents(&Line->Key);
+    YoriLibFreeStringContents(&Line->Value);
+    YoriLibFree(Line);
+}
+
+/**
+ Allocate a new section and add it to the end of an INI file.
+
+ @param IniFile Pointer to the INI file.
+
+ @param Name Pointer to the name of the section.  This string is referenced
+        by the section, so it must be allocated with YoriLibReferencedMalloc
+        if it is not empty, and must be NULL terminated.
+
+ @param Hash TRUE if the section should be findable by name, FALSE if it
+        should not.  This is FALSE for the unnamed section preceding the
+        first section header.
+
+ @return Pointer to the new section, or NULL on allocation failure.
+ */
+PYORI_LIB_INI_SECTION
+YoriLibIniAddSection(
+    __in PYORI_LIB_INI_FILE IniFile,
+    __in PYORI_STRING Name,
+    __in BOOLEAN Hash
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+
+    Section = YoriLibMalloc(sizeof(YORI_LIB_INI_SECTION));
+    if (Section == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Section, sizeof(YORI_LIB_INI_SECTION));
+    Section->KeyTable = YoriLibAllocateHashTable(YORI_LIB_INI_KEY_BUCKETS);
+    if (Section->KeyTable == NULL) {
+        YoriLibFree(Section);
+        return NULL;
+    }
+
+    YoriLibCloneString(&Section->Name, Name);
+    YoriLibInitializeListHead(&Section->LineList);
+
+    if (Hash &&
+        YoriLibHashLookupByKey(IniFile->SectionTable, Name) == NULL) {
+
+        YoriLibHashInsertByKey(IniFile->SectionTable, &Section->Name, Section, &Section->HashEntry);
+        Section->InHash = TRUE;
+    }
+
+    YoriLibAppendList(&IniFile->SectionList, &Section->ListEntry);
+    return Section;
+}
+
+/**
+ Remove a section from its INI file and free it along with all of its lines.
+
+ @param Section Pointer to the section to free.
+ */
+VOID
+YoriLibIniFreeSection(
+    __in PYORI_LIB_INI_SECTION Section
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_LINE Line;
+
+    ListEntry = YoriLibGetNextListEntry(&Section->LineList, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Section->LineList, ListEntry);
+        YoriLibIniFreeLine(Line);
+    }
+
+    YoriLibRemoveListItem(&Section->ListEntry);
+    if (Section->InHash) {
+        YoriLibHashRemoveByEntry(&Section->HashEntry);
+    }
+    YoriLibFreeEmptyHashTable(Section->KeyTable);
+    YoriLibFreeStringContents(&Section->Name);
+    YoriLibFree(Section);
+}
+
+/**
+ Find a section within an INI file by name.
+
+ @param IniFile Pointer to the INI file.
+
+ @param SectionName Pointer to the name of the section to find.
+
+ @return Pointer to the section, or NULL if no section by that name exists.
+ */
+PYORI_LIB_INI_SECTION
+YoriLibIniFindSection(
+    __in PYORI_LIB_INI_FILE IniFile,
+    __in PCYORI_STRING SectionName
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+
+    HashEntry = YoriLibHashLookupByKey(IniFile->SectionTable, SectionName);
+    if (HashEntry == NULL) {
+        return NULL;
+    }
+
+    return HashEntry->Context;
+}
+
+/**
+ Find a key within a section by name.
+
+ @param Section Pointer to the section.
+
+ @param Key Pointer to the name of the key to find.
+
+ @return Pointer to the line containing the key, or NULL if no key by that
+         name exists.
+ */
+PYORI_LIB_INI_LINE
+YoriLibIniFindKey(
+    __in PYORI_LIB_INI_SECTION Section,
+    __in PCYORI_STRING Key
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+
+    HashEntry = YoriLibHashLookupByKey(Section->KeyTable, Key);
+    if (HashEntry == NULL) {
+        return NULL;
+    }
+
+    return HashEntry->Context;
+}
+
+/**
+ Convert the raw contents of an INI file into a NULL terminated UTF-16
+ buffer allocated with YoriLibReferencedMalloc.
+
+ @param IniFile Pointer to the INI file, whose encoding is updated to reflect
+        the encoding of the raw contents.
+
+ @param RawBuffer Pointer to the raw contents of the file.
+
+ @param RawLength The length of RawBuffer, in bytes.
+
+ @param Text On successful completion, populated with the contents of the
+        file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniDecode(
+    __in PYORI_LIB_INI_FILE IniFile,
+    __in_bcount(RawLength) PUCHAR RawBuffer,
+    __in DWORD RawLength,
+    __out PYORI_STRING Text
+    )
+{
+    DWORD CharsNeeded;
+
+    if (RawLength >= 2 && RawBuffer[0] == 0xFF && RawBuffer[1] == 0xFE) {
+        IniFile->Encoding = YoriLibIniEncodingUtf16;
+        CharsNeeded = (RawLength - 2) / sizeof(WCHAR);
+        if (!YoriLibAllocateString(Text, CharsNeeded + 1)) {
+            return FALSE;
+        }
+        memcpy(Text->StartOfString, RawBuffer + 2, CharsNeeded * sizeof(WCHAR));
+        Text->LengthInChars = CharsNeeded;
+    } else if (RawLength >= 3 && RawBuffer[0] == 0xEF && RawBuffer[1] == 0xBB && RawBuffer[2] == 0xBF) {
+        IniFile->Encoding = YoriLibIniEncodingUtf8;
+        CharsNeeded = RawLength - 3;
+        if (!YoriLibAllocateString(Text, CharsNeeded + 1)) {
+            return FALSE;
+        }
+        Text->LengthInChars = YoriLibUtf8ToUtf16((LPCSTR)RawBuffer + 3, RawLength - 3, Text->StartOfString, Text->LengthAllocated);
+    } else {
+        IniFile->Encoding = YoriLibIniEncodingAnsi;
+        CharsNeeded = RawLength;
+        if (!YoriLibAllocateString(Text, CharsNeeded + 1)) {
+            return FALSE;
+        }
+        Text->LengthInChars = 0;
+        if (RawLength > 0) {
+            Text->LengthInChars = MultiByteToWideChar(CP_ACP, 0, (LPCSTR)RawBuffer, RawLength, Text->StartOfString, Text->LengthAllocated);
+        }
+    }
+
+    Text->StartOfString[Text->LengthInChars] = '\0';
+    return TRUE;
+}
+
+/**
+ Parse the text of an INI file into sections and lines.  The resulting
+ strings refer to Text, which is modified in place to NULL terminate each
+ of them.
+
+ @param IniFile Pointer to the INI file, which should contain only the
+        unnamed initial section.
+
+ @param Text Pointer to the NULL terminated text of the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniParse(
+    __in PYORI_LIB_INI_FILE IniFile,
+    __inout PYORI_STRING Text
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    YORI_STRING Key;
+    YORI_STRING Value;
+    LPTSTR LineStart;
+    LPTSTR Line;
+    LPTSTR LineEnd;
+    LPTSTR Next;
+    LPTSTR Equals;
+    LPTSTR Close;
+    LPTSTR End;
+
+    Section = CONTAINING_RECORD(IniFile->SectionList.Next, YORI_LIB_INI_SECTION, ListEntry);
+    Line = Text->StartOfString;
+    End = Text->StartOfString + Text->LengthInChars;
+
+    while (Line < End) {
+
+        //
+        //  Find the end of this line and the start of the next one before
+        //  any terminators are written into the buffer.
+        //
+
+        LineEnd = Line;
+        while (LineEnd < End && *LineEnd != '\r' && *LineEnd != '\n') {
+            LineEnd++;
+        }
+        Next = LineEnd;
+        if (Next < End && *Next == '\r') {
+            Next++;
+        }
+        if (Next < End && *Next == '\n') {
+            Next++;
+        }
+
+        //
+        //  Key and Value describe ranges within Text.  Lines and sections
+        //  take their own reference on Text when they keep them.
+        //
+
+        YoriLibInitEmptyString(&Key);
+        YoriLibInitEmptyString(&Value);
+        Value.MemoryToFree = Text->MemoryToFree;
+
+        LineStart = Line;
+        while (Line < LineEnd && YoriLibIniIsSpace(*Line)) {
+            Line++;
+        }
+
+        Close = NULL;
+        Equals = NULL;
+        if (Line < LineEnd && *Line == '[') {
+            for (Close = Line + 1; Close < LineEnd; Close++) {
+                if (*Close == ']') {
+                    break;
+                }
+            }
+            if (Close == LineEnd) {
+                Close = NULL;
+            }
+        } else if (Line < LineEnd && *Line != ';') {
+            for (Equals = Line; Equals < LineEnd; Equals++) {
+                if (*Equals == '=') {
+                    break;
+                }
+            }
+            if (Equals == LineEnd) {
+                Equals = NULL;
+            }
+        }
+
+        if (Close != NULL) {
+
+            //
+            //  A section header.  Everything until the next header belongs
+            //  to this section.
+            //
+
+            Value.StartOfString = Line + 1;
+            while (Value.StartOfString < Close && YoriLibIniIsSpace(*Value.StartOfString)) {
+                Value.StartOfString++;
+            }
+            while (Close > Value.StartOfString && YoriLibIniIsSpace(Close[-1])) {
+                Close--;
+            }
+            Value.LengthInChars = (DWORD)(Close - Value.StartOfString);
+            *Close = '\0';
+
+            Section = YoriLibIniAddSection(IniFile, &Value, TRUE);
+            if (Section == NULL) {
+                return FALSE;
+            }
+
+        } else if (Equals != NULL && Equals > Line) {
+
+            //
+            //  A key value pair.  Remove white space around both, and
+            //  remove any quotes around the value.
+            //
+
+            Key.StartOfString = Line;
+            Key.LengthInChars = (DWORD)(Equals - Line);
+            while (Key.LengthInChars > 0 && YoriLibIniIsSpace(Key.StartOfString[Key.LengthInChars - 1])) {
+                Key.LengthInChars--;
+            }
+
+            Value.StartOfString = Equals + 1;
+            while (Value.StartOfString < LineEnd && YoriLibIniIsSpace(*Value.StartOfString)) {
+                Value.StartOfString++;
+            }
+            Value.LengthInChars = (DWORD)(LineEnd - Value.StartOfString);
+            while (Value.LengthInChars > 0 && YoriLibIniIsSpace(Value.StartOfString[Value.LengthInChars - 1])) {
+                Value.LengthInChars--;
+            }
+            if (Value.LengthInChars >= 2 &&
+                (Value.StartOfString[0] == '"' || Value.StartOfString[0] == '\'') &&
+                Value.StartOfString[Value.LengthInChars - 1] == Value.StartOfString[0]) {
+
+                Value.StartOfString++;
+                Value.LengthInChars -= 2;
+            }
+
+            Key.StartOfString[Key.LengthInChars] = '\0';
+            Key.MemoryToFree = Text->MemoryToFree;
+            Value.StartOfString[Value.LengthInChars] = '\0';
+
+            if (YoriLibIniAddLine(Section, NULL, &Key, &Value) == NULL) {
+                return FALSE;
+            }
+
+        } else {
+
+            //
+            //  A comment, blank line, or anything else that isn't
+            //  understood.  Keep it so it can be written back unchanged.
+            //
+
+            Value.StartOfString = LineStart;
+            Value.LengthInChars = (DWORD)(LineEnd - LineStart);
+            *LineEnd = '\0';
+
+            if (YoriLibIniAddLine(Section, NULL, &Key, &Value) == NULL) {
+                return FALSE;
+            }
+        }
+
+        Line = Next;
+    }
+
+    return TRUE;
+}
+
+/**
+ Close an INI file that was opened with YoriLibIniOpen.  Any changes that
+ have not been written with YoriLibIniWrite are discarded.
+
+ @param IniHandle The INI file to close.
+ */
+VOID
+YoriLibIniClose(
+    __in PVOID IniHandle
+    )
+{
+    PYORI_LIB_INI_FILE IniFile;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_SECTION Section;
+
+    IniFile = (PYORI_LIB_INI_FILE)IniHandle;
+
+    ListEntry = YoriLibGetNextListEntry(&IniFile->SectionList, NULL);
+    while (ListEntry != NULL) {
+        Section = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_SECTION, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&IniFile->SectionList, ListEntry);
+        YoriLibIniFreeSection(Section);
+    }
+
+    YoriLibFreeEmptyHashTable(IniFile->SectionTable);
+    YoriLibFreeStringContents(&IniFile->FileName);
+    YoriLibFree(IniFile);
+}
+
+/**
+ Load an INI file into memory.  The file is read and parsed once, after
+ which lookups do not access the file.  If the file does not exist, an empty
+ INI file is returned, which will be created by YoriLibIniWrite.
+
+ @param FileName Pointer to the fully qualified path to the INI file.
+
+ @return An opaque handle to the INI file, or NULL on failure.  The caller
+         should free this with YoriLibIniClose.
+ */
+__success(return != NULL)
+PVOID
+YoriLibIniOpen(
+    __in PCYORI_STRING FileName
+    )
+{
+    PYORI_LIB_INI_FILE IniFile;
+    YORI_STRING EmptyString;
+    YORI_STRING Text;
+    HANDLE FileHandle;
+    PUCHAR RawBuffer;
+    DWORD RawLength;
+    DWORD BytesRead;
+    DWORD Err;
+
+    IniFile = YoriLibMalloc(sizeof(YORI_LIB_INI_FILE));
+    if (IniFile == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(IniFile, sizeof(YORI_LIB_INI_FILE));
+    YoriLibInitializeListHead(&IniFile->SectionList);
+    IniFile->SectionTable = YoriLibAllocateHashTable(YORI_LIB_INI_SECTION_BUCKETS);
+    if (IniFile->SectionTable == NULL) {
+        YoriLibFree(IniFile);
+        return NULL;
+    }
+
+    if (!YoriLibAllocateString(&IniFile->FileName, FileName->LengthInChars + 1)) {
+        YoriLibFreeEmptyHashTable(IniFile->SectionTable);
+        YoriLibFree(IniFile);
+        return NULL;
+    }
+    memcpy(IniFile->FileName.StartOfString, FileName->StartOfString, FileName->LengthInChars * sizeof(TCHAR));
+    IniFile->FileName.LengthInChars = FileName->LengthInChars;
+    IniFile->FileName.StartOfString[IniFile->FileName.LengthInChars] = '\0';
+
+    YoriLibInitEmptyString(&EmptyString);
+    if (YoriLibIniAddSection(IniFile, &EmptyString, FALSE) == NULL) {
+        YoriLibIniClose(IniFile);
+        return NULL;
+    }
+
+    FileHandle = CreateFile(IniFile->FileName.StartOfString,
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL,
+                            NULL);
+
+    if (FileHandle == INVALID_HANDLE_VALUE) {
+        Err = GetLastError();
+        if (Err == ERROR_FILE_NOT_FOUND || Err == ERROR_PATH_NOT_FOUND) {
+            return IniFile;
+        }
+        YoriLibIniClose(IniFile);
+        return NULL;
+    }
+
+    RawLength = GetFileSize(FileHandle, NULL);
+    if (RawLength == (DWORD)-1) {
+        CloseHandle(FileHandle);
+        YoriLibIniClose(IniFile);
+        return NULL;
+    }
+
+    RawBuffer = YoriLibMalloc(RawLength + 1);
+    if (RawBuffer == NULL) {
+        CloseHandle(FileHandle);
+        YoriLibIniClose(IniFile);
+        return NULL;
+    }
+
+    if (!ReadFile(FileHandle, RawBuffer, RawLength, &BytesRead, NULL)) {
+        YoriLibFree(RawBuffer);
+        CloseHandle(FileHandle);
+        YoriLibIniClose(IniFile);
+        return NULL;
+    }
+    CloseHandle(FileHandle);
+
+    if (!YoriLibIniDecode(IniFile, RawBuffer, BytesRead, &Text)) {
+        YoriLibFree(RawBuffer);
+        YoriLibIniClose(IniFile);
+        return NULL;
+    }
+    YoriLibFree(RawBuffer);
+
+    if (!YoriLibIniParse(IniFile, &Text)) {
+        YoriLibFreeStringContents(&Text);
+        YoriLibIniClose(IniFile);
+        return NULL;
+    }
+
+    YoriLibFreeStringContents(&Text);
+    return IniFile;
+}
+
+/**
+ Find a value within an INI file.
+
+ @param IniHandle The INI file.
+
+ @param SectionName Pointer to the name of the section.
+
+ @param Key Pointer to the name of the key.
+
+ @param Value On successful completion, updated to refer to the value.  This
+        string is NULL terminated.  It is a reference to memory held by the
+        INI file, so the caller should free it with
+        YoriLibFreeStringContents, and should not modify it.
+
+ @return TRUE to indicate the value was found, FALSE if it was not.
+ */
+__success(return)
+BOOL
+YoriLibIniGetString(
+    __in PVOID IniHandle,
+    __in PCYORI_STRING SectionName,
+    __in PCYORI_STRING Key,
+    __out PYORI_STRING Value
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIB_INI_LINE Line;
+
+    Section = YoriLibIniFindSection(IniHandle, SectionName);
+    if (Section == NULL) {
+        return FALSE;
+    }
+
+    Line = YoriLibIniFindKey(Section, Key);
+    if (Line == NULL) {
+        return FALSE;
+    }
+
+    YoriLibCloneString(Value, &Line->Value);
+    return TRUE;
+}
+
+/**
+ Enumerate the key value pairs within a section of an INI file.
+
+ @param IniHandle The INI file.
+
+ @param SectionName Pointer to the name of the section.
+
+ @param PreviousKey Optionally points to the value previously returned from
+        this function.  If NULL, the first key in the section is returned.
+
+ @param Key On successful completion, updated to refer to the name of the
+        key.  This string is NULL terminated and refers to memory held by
+        the INI file; it remains valid until the key is changed or the file
+        is closed, and should not be freed or modified by the caller.
+
+ @param Value On successful completion, updated to refer to the value of the
+        key, with the same lifetime as Key.
+
+ @return An opaque pointer to pass as PreviousKey to find the next key, or
+         NULL if there are no more keys in the section.
+ */
+PVOID
+YoriLibIniGetNextKey(
+    __in PVOID IniHandle,
+    __in PCYORI_STRING SectionName,
+    __in_opt PVOID PreviousKey,
+    __out PYORI_STRING Key,
+    __out PYORI_STRING Value
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIB_INI_LINE Line;
+    PYORI_LIST_ENTRY ListEntry;
+
+    Section = YoriLibIniFindSection(IniHandle, SectionName);
+    if (Section == NULL) {
+        return NULL;
+    }
+
+    ListEntry = NULL;
+    if (PreviousKey != NULL) {
+        Line = (PYORI_LIB_INI_LINE)PreviousKey;
+        ListEntry = &Line->ListEntry;
+    }
+
+    while (TRUE) {
+        ListEntry = YoriLibGetNextListEntry(&Section->LineList, ListEntry);
+        if (ListEntry == NULL) {
+            return NULL;
+        }
+        Line = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+        if (Line->Key.LengthInChars > 0) {
+            break;
+        }
+    }
+
+    memcpy(Key, &Line->Key, sizeof(YORI_STRING));
+    memcpy(Value, &Line->Value, sizeof(YORI_STRING));
+    Key->MemoryToFree = NULL;
+    Value->MemoryToFree = NULL;
+    return Line;
+}
+
+/**
+ Enumerate the sections within an INI file.
+
+ @param IniHandle The INI file.
+
+ @param PreviousSection Optionally points to the value previously returned
+        from this function.  If NULL, the first section is returned.
+
+ @param SectionName On successful completion, updated to refer to the name
+        of the section.  This string is NULL terminated and refers to memory
+        held by the INI file; it remains valid until the section is deleted
+        or the file is closed, and should not be freed or modified by the
+        caller.
+
+ @return An opaque pointer to pass as PreviousSection to find the next
+         section, or NULL if there are no more sections.
+ */
+PVOID
+YoriLibIniGetNextSection(
+    __in PVOID IniHandle,
+    __in_opt PVOID PreviousSection,
+    __out PYORI_STRING SectionName
+    )
+{
+    PYORI_LIB_INI_FILE IniFile;
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIST_ENTRY ListEntry;
+
+    IniFile = (PYORI_LIB_INI_FILE)IniHandle;
+    ListEntry = NULL;
+    if (PreviousSection != NULL) {
+        Section = (PYORI_LIB_INI_SECTION)PreviousSection;
+        ListEntry = &Section->ListEntry;
+    }
+
+    while (TRUE) {
+        ListEntry = YoriLibGetNextListEntry(&IniFile->SectionList, ListEntry);
+        if (ListEntry == NULL) {
+            return NULL;
+        }
+        Section = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_SECTION, ListEntry);
+        if (Section->InHash) {
+            break;
+        }
+    }
+
+    memcpy(SectionName, &Section->Name, sizeof(YORI_STRING));
+    SectionName->MemoryToFree = NULL;
+    return Section;
+}
+
+/**
+ Allocate a NULL terminated copy of a string with YoriLibReferencedMalloc.
+
+ @param Dest On successful completion, populated with the copy.
+
+ @param Src Pointer to the string to copy.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniCopyString(
+    __out PYORI_STRING Dest,
+    __in PCYORI_STRING Src
+    )
+{
+    if (!YoriLibAllocateString(Dest, Src->LengthInChars + 1)) {
+        return FALSE;
+    }
+    memcpy(Dest->StartOfString, Src->StartOfString, Src->LengthInChars * sizeof(TCHAR));
+    Dest->LengthInChars = Src->LengthInChars;
+    Dest->StartOfString[Dest->LengthInChars] = '\0';
+    return TRUE;
+}
+
+/**
+ Set a value within an INI file, creating the section and key if they do not
+ already exist.  The change is made in memory and is not saved until
+ YoriLibIniWrite is called.
+
+ @param IniHandle The INI file.
+
+ @param SectionName Pointer to the name of the section.
+
+ @param Key Pointer to the name of the key.
+
+ @param Value Pointer to the new value.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniSetString(
+    __in PVOID IniHandle,
+    __in PCYORI_STRING SectionName,
+    __in PCYORI_STRING Key,
+    __in PCYORI_STRING Value
+    )
+{
+    PYORI_LIB_INI_FILE IniFile;
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIB_INI_LINE Line;
+    PYORI_LIB_INI_LINE InsertAfter;
+    PYORI_LIST_ENTRY ListEntry;
+    YORI_STRING NewName;
+    YORI_STRING NewKey;
+    YORI_STRING NewValue;
+
+    IniFile = (PYORI_LIB_INI_FILE)IniHandle;
+
+    if (Key->LengthInChars == 0) {
+        return FALSE;
+    }
+
+    if (!YoriLibIniCopyString(&NewValue, Value)) {
+        return FALSE;
+    }
+
+    Section = YoriLibIniFindSection(IniFile, SectionName);
+    if (Section == NULL) {
+        if (!YoriLibIniCopyString(&NewName, SectionName)) {
+            YoriLibFreeStringContents(&NewValue);
+            return FALSE;
+        }
+        Section = YoriLibIniAddSection(IniFile, &NewName, TRUE);
+        YoriLibFreeStringContents(&NewName);
+        if (Section == NULL) {
+            YoriLibFreeStringContents(&NewValue);
+            return FALSE;
+        }
+    }
+
+    IniFile->Modified = TRUE;
+
+    Line = YoriLibIniFindKey(Section, Key);
+    if (Line != NULL) {
+        YoriLibFreeStringContents(&Line->Value);
+        memcpy(&Line->Value, &NewValue, sizeof(YORI_STRING));
+        return TRUE;
+    }
+
+    if (!YoriLibIniCopyString(&NewKey, Key)) {
+        YoriLibFreeStringContents(&NewValue);
+        return FALSE;
+    }
+
+    //
+    //  Add the new key after the last key in the section, so that any
+    //  blank lines or comments that separate this section from the next
+    //  stay where they are.
+    //
+
+    InsertAfter = NULL;
+    ListEntry = YoriLibGetPreviousListEntry(&Section->LineList, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+        if (Line->Key.LengthInChars > 0) {
+            InsertAfter = Line;
+            break;
+        }
+        ListEntry = YoriLibGetPreviousListEntry(&Section->LineList, ListEntry);
+    }
+
+    if (InsertAfter == NULL &&
+        YoriLibGetNextListEntry(&Section->LineList, NULL) != NULL) {
+
+        Line = YoriLibIniAddLine(Section, NULL, &NewKey, &NewValue);
+        if (Line != NULL) {
+            YoriLibRemoveListItem(&Line->ListEntry);
+            YoriLibInsertList(&Section->LineList, &Line->ListEntry);
+        }
+    } else {
+        Line = YoriLibIniAddLine(Section, InsertAfter, &NewKey, &NewValue);
+    }
+
+    YoriLibFreeStringContents(&NewKey);
+    YoriLibFreeStringContents(&NewValue);
+
+    if (Line == NULL) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Delete a key, or an entire section, from an INI file.  The change is made
+ in memory and is not saved until YoriLibIniWrite is called.
+
+ @param IniHandle The INI file.
+
+ @param SectionName Pointer to the name of the section.
+
+ @param Key Optionally points to the name of the key to delete.  If NULL,
+        the entire section is deleted.
+
+ @return TRUE to indicate the key or section was deleted, FALSE if it was
+         not found.
+ */
+BOOL
+YoriLibIniDelete(
+    __in PVOID IniHandle,
+    __in PCYORI_STRING SectionName,
+    __in_opt PCYORI_STRING Key
+    )
+{
+    PYORI_LIB_INI_FILE IniFile;
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIB_INI_LINE Line;
+
+    IniFile = (PYORI_LIB_INI_FILE)IniHandle;
+
+    Section = YoriLibIniFindSection(IniFile, SectionName);
+    if (Section == NULL) {
+        return FALSE;
+    }
+
+    if (Key == NULL) {
+        YoriLibIniFreeSection(Section);
+        IniFile->Modified = TRUE;
+        return TRUE;
+    }
+
+    Line = YoriLibIniFindKey(Section, Key);
+    if (Line == NULL) {
+        return FALSE;
+    }
+
+    YoriLibIniFreeLine(Line);
+    IniFile->Modified = TRUE;
+    return TRUE;
+}
+
+/**
+ Return TRUE if a value needs to be enclosed in quotes when it is written,
+ so that reading it back returns the same value.  This is the case if the
+ value begins or ends with white space, which would otherwise be removed, or
+ if it begins and ends with the same quote character, which would otherwise
+ be removed as a pair of quotes.
+
+ @param Value Pointer to the value.
+
+ @return TRUE if the value should be enclosed in quotes, FALSE if it can be
+         written as is.
+ */
+BOOLEAN
+YoriLibIniValueNeedsQuotes(
+    __in PYORI_STRING Value
+    )
+{
+    TCHAR FirstChar;
+    TCHAR LastChar;
+
+    if (Value->LengthInChars == 0) {
+        return FALSE;
+    }
+
+    FirstChar = Value->StartOfString[0];
+    LastChar = Value->StartOfString[Value->LengthInChars - 1];
+
+    if (YoriLibIniIsSpace(FirstChar) || YoriLibIniIsSpace(LastChar)) {
+        return TRUE;
+    }
+
+    if (Value->LengthInChars >= 2 &&
+        (FirstChar == '"' || FirstChar == '\'') &&
+        LastChar == FirstChar) {
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ Generate the text of an INI file from its in memory representation.
+
+ @param IniFile Pointer to the INI file.
+
+ @param Text On successful completion, populated with the text of the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniBuildText(
+    __in PYORI_LIB_INI_FILE IniFile,
+    __out PYORI_STRING Text
+    )
+{
+    PYORI_LIST_ENTRY SectionEntry;
+    PYORI_LIST_ENTRY LineEntry;
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIB_INI_LINE Line;
+    DWORD CharsNeeded;
+    DWORD Index;
+
+    //
+    //  Calculate the size needed, then populate the buffer, so the text is
+    //  generated with a single allocation.
+    //
+
+    for (Index = 0; Index < 2; Index++) {
+        CharsNeeded = 0;
+        SectionEntry = YoriLibGetNextListEntry(&IniFile->SectionList, NULL);
+        while (SectionEntry != NULL) {
+            Section = CONTAINING_RECORD(SectionEntry, YORI_LIB_INI_SECTION, ListEntry);
+            if (SectionEntry != IniFile->SectionList.Next) {
+                if (Index == 1) {
+                    YoriLibSPrintf(&Text->StartOfString[CharsNeeded], _T("[%y]\r\n"), &Section->Name);
+                }
+                CharsNeeded += Section->Name.LengthInChars + 4;
+            }
+
+            LineEntry = YoriLibGetNextListEntry(&Section->LineList, NULL);
+            while (LineEntry != NULL) {
+                Line = CONTAINING_RECORD(LineEntry, YORI_LIB_INI_LINE, ListEntry);
+                if (Line->Key.LengthInChars > 0) {
+                    if (YoriLibIniValueNeedsQuotes(&Line->Value)) {
+                        if (Index == 1) {
+                            YoriLibSPrintf(&Text->StartOfString[CharsNeeded], _T("%y=\"%y\"\r\n"), &Line->Key, &Line->Value);
+                        }
+                        CharsNeeded += 2;
+                    } else if (Index == 1) {
+                        YoriLibSPrintf(&Text->StartOfString[CharsNeeded], _T("%y=%y\r\n"), &Line->Key, &Line->Value);
+                    }
+                    CharsNeeded += Line->Key.LengthInChars + 1;
+                } else if (Index == 1) {
+                    YoriLibSPrintf(&Text->StartOfString[CharsNeeded], _T("%y\r\n"), &Line->Value);
+                }
+                CharsNeeded += Line->Value.LengthInChars + 2;
+                LineEntry = YoriLibGetNextListEntry(&Section->LineList, LineEntry);
+            }
+
+            SectionEntry = YoriLibGetNextListEntry(&IniFile->SectionList, SectionEntry);
+        }
+
+        if (Index == 0) {
+            if (!YoriLibAllocateString(Text, CharsNeeded + 1)) {
+                return FALSE;
+            }
+        }
+    }
+
+    Text->LengthInChars = CharsNeeded;
+    return TRUE;
+}
+
+/**
+ Write any changes to an INI file back to disk.  The new contents are written
+ to a temporary file in the same directory, which then replaces the original
+ file, so a reader never observes a partially written file.  Where the
+ system supports it, the original file is replaced with ReplaceFile so that
+ its attributes and security descriptor are retained.
+
+ @param IniHandle The INI file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniWrite(
+    __in PVOID IniHandle
+    )
+{
+    PYORI_LIB_INI_FILE IniFile;
+    YORI_STRING Text;
+    YORI_STRING TempFileName;
+    PUCHAR RawBuffer;
+    DWORD RawLength;
+    DWORD BytesWritten;
+    HANDLE FileHandle;
+    BOOL Result;
+
+    IniFile = (PYORI_LIB_INI_FILE)IniHandle;
+    if (!IniFile->Modified) {
+        return TRUE;
+    }
+
+    if (!YoriLibIniBuildText(IniFile, &Text)) {
+        return FALSE;
+    }
+
+    //
+    //  Encode the text in the same form the file was read in.
+    //
+
+    if (IniFile->Encoding == YoriLibIniEncodingUtf16) {
+        RawBuffer = YoriLibMalloc(Text.LengthInChars * sizeof(WCHAR) + 2);
+        if (RawBuffer == NULL) {
+            YoriLibFreeStringContents(&Text);
+            return FALSE;
+        }
+        RawBuffer[0] = 0xFF;
+        RawBuffer[1] = 0xFE;
+        memcpy(RawBuffer + 2, Text.StartOfString, Text.LengthInChars * sizeof(WCHAR));
+        RawLength = Text.LengthInChars * sizeof(WCHAR) + 2;
+    } else if (IniFile->Encoding == YoriLibIniEncodingUtf8) {
+        RawBuffer = YoriLibMalloc(Text.LengthInChars * 3 + 3);
+        if (RawBuffer == NULL) {
+            YoriLibFreeStringContents(&Text);
+            return FALSE;
+        }
+        RawBuffer[0] = 0xEF;
+        RawBuffer[1] = 0xBB;
+        RawBuffer[2] = 0xBF;
+        RawLength = YoriLibUtf16ToUtf8(Text.StartOfString, Text.LengthInChars, (LPSTR)RawBuffer + 3, Text.LengthInChars * 3) + 3;
+    } else {
+        RawBuffer = YoriLibMalloc(Text.LengthInChars * 2 + 1);
+        if (RawBuffer == NULL) {
+            YoriLibFreeStringContents(&Text);
+            return FALSE;
+        }
+        RawLength = 0;
+        if (Text.LengthInChars > 0) {
+            RawLength = WideCharToMultiByte(CP_ACP, 0, Text.StartOfString, Text.LengthInChars, (LPSTR)RawBuffer, Text.LengthInChars * 2, NULL, NULL);
+        }
+    }
+    YoriLibFreeStringContents(&Text);
+
+    YoriLibInitEmptyString(&TempFileName);
+    YoriLibYPrintf(&TempFileName, _T("%y.%x.tmp"), &IniFile->FileName, GetCurrentProcessId());
+    if (TempFileName.StartOfString == NULL) {
+        YoriLibFree(RawBuffer);
+        return FALSE;
+    }
+
+    FileHandle = CreateFile(TempFileName.StartOfString,
+                            GENERIC_WRITE,
+                            0,
+                            NULL,
+                            CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL,
+                            NULL);
+
+    if (FileHandle == INVALID_HANDLE_VALUE) {
+        YoriLibFreeStringContents(&TempFileName);
+        YoriLibFree(RawBuffer);
+        return FALSE;
+    }
+
+    Result = WriteFile(FileHandle, RawBuffer, RawLength, &BytesWritten, NULL);
+    if (Result && BytesWritten != RawLength) {
+        Result = FALSE;
+    }
+    if (Result) {
+        Result = FlushFileBuffers(FileHandle);
+    }
+    CloseHandle(FileHandle);
+    YoriLibFree(RawBuffer);
+
+    //
+    //  ReplaceFile carries the attributes and security of the original file
+    //  to the new one, but requires the original to exist.  If it is not
+    //  available, or the file is new, move the temporary file into place.
+    //
+
+    if (Result) {
+        Result = FALSE;
+        if (DllKernel32.pReplaceFileW != NULL &&
+            GetFileAttributes(IniFile->FileName.StartOfString) != (DWORD)-1) {
+
+            Result = DllKernel32.pReplaceFileW(IniFile->FileName.StartOfString, TempFileName.StartOfString, NULL, 0, NULL, NULL);
+        }
+        if (!Result) {
+            Result = MoveFileEx(TempFileName.StartOfString, IniFile->FileName.StartOfString, MOVEFILE_REPLACE_EXISTING);
+        }
+    }
+
+    if (!Result) {
+        DeleteFile(TempFileName.StartOfString);
+    } else {
+        IniFile->Modified = FALSE;
+    }
+
+    YoriLibFreeStringContents(&TempFileName);
+    return Result;
+}
+
+// vim:sw=4:ts=4:et:
@@ -84,4 +84,57 @@ YoriLibLimitJobObjectPriority(
     return DllKernel32.pSetInformationJobObject(hJob, 2, &LimitInfo, sizeof(LimitInfo));
 }
 
+/**
+ Query resource usage for all processes that have executed within a job
+ object.  If this functionality is not supported by the host OS, returns
+ FALSE.
+
+ @param hJob Handle to the job object.
+
+ @param Accounting On successful completion, populated with the resource
+        usage of the job.
+
+ @return TRUE on success, FALSE on failure.
+ */
+__success(return)
+BOOL
+YoriLibQueryJobObjectAccounting(
+    __in HANDLE hJob,
+    __out PYORI_LIB_JOB_ACCOUNTING Accounting
+    )
+{
+    YORI_JOB_BASIC_AND_IO_ACCOUNTING_INFORMATION AccountingInfo;
+    YORI_JOB_EXTENDED_LIMIT_INFORMATION LimitInfo;
+    DWORD BytesReturned;
+
+    if (DllKernel32.pQueryInformationJobObject == NULL) {
+        return FALSE;
+    }
+
+    if (!DllKernel32.pQueryInformationJobObject(hJob, 8, &AccountingInfo, sizeof(AccountingInfo), &BytesReturned)) {
+        return FALSE;
+    }
+
+    ZeroMemory(Accounting, sizeof(YORI_LIB_JOB_ACCOUNTING));
+    Accounting->UserTime.QuadPart = AccountingInfo.BasicInfo.TotalUserTime.QuadPart;
+    Accounting->KernelTime.QuadPart = AccountingInfo.BasicInfo.TotalKernelTime.QuadPart;
+    Accounting->TotalProcesses = AccountingInfo.BasicInfo.TotalProcesses;
+    Accounting->ActiveProcesses = AccountingInfo.BasicInfo.ActiveProcesses;
+    Accounting->ReadBytes = AccountingInfo.IoInfo.ReadBytes;
+    Accounting->WriteBytes = AccountingInfo.IoInfo.WriteBytes;
+    Accounting->OtherBytes = AccountingInfo.IoInfo.OtherBytes;
+
+    //
+    //  Peak memory is only available from the extended limit information.
+    //  If this fails, leave it as zero rather than failing the query.
+    //
+
+    if (DllKernel32.pQueryInformationJobObject(hJob, 9, &LimitInfo, sizeof(LimitInfo), &BytesReturned)) {
+        Accounting->PeakProcessMemoryUsed = LimitInfo.PeakProcessMemoryUsed;
+        Accounting->PeakJobMemoryUsed = LimitInfo.PeakJobMemoryUsed;
+    }
+
+    return TRUE;
+}
+
 // vim:sw=4:ts=4:et:
@@ -61,6 +61,19 @@ typedef struct _YORI_LIB_LINE_READ_CONTEXT {
      */
     DWORD CurrentBufferOffset;
 
+    /**
+     The encoding of the input.  This is normally the process input
+     encoding when the context is created, but can be specified by the
+     caller with @ref YoriLibLineReadCreateContext .
+     */
+    DWORD Encoding;
+
+    /**
+     If TRUE, the first read has been performed and the input has been
+     examined to determine whether it can be mapped.
+     */
+    BOOLEAN Started;
+
     /**
      If TRUE, the read operation is performed on 16 bit characters.  If FALSE,
      the input contains 8 bit characters.  Unlike most other encodings, this
@@ -78,6 +91,24 @@ typedef struct _YORI_LIB_LINE_READ_CONTEXT {
      */
     BOOLEAN Terminated;
 
+    /**
+     If TRUE, the input is a regular file which is being mapped by
+     SpanReader, and lines are returned directly from the mapped view rather
+     than being read into PreviousBuffer.
+     */
+    BOOLEAN Mapped;
+
+    /**
+     The offset within the current span of SpanReader of data that has not
+     yet been returned.  Only meaningful if Mapped is TRUE.
+     */
+    DWORD SpanConsumed;
+
+    /**
+     The reader used to map the input.  Only meaningful if Mapped is TRUE.
+     */
+    YORI_LIB_BYTE_SPAN_READER SpanReader;
+
 } YORI_LIB_LINE_READ_CONTEXT, *PYORI_LIB_LINE_READ_CONTEXT;
 
 /**
@@ -85,6 +116,8 @@ typedef struct _YORI_LIB_LINE_READ_CONTEXT {
  is not large enough, it is reallocated.  This function performs encoding
  conversions to ensure the resulting string is in host (UTF16) encoding.
 
+ @param Encoding The encoding of SourceBuffer.
+
  @param UserString The user provided string to populate with a line.
 
  @param SourceBuffer Pointer to a buffer in input encoding format that
@@ -97,6 +130,7 @@ typedef struct _YORI_LIB_LINE_READ_CONTEXT {
  */
 BOOL
 YoriLibCopyLineToUserBufferW(
+    __in DWORD Encoding,
     __inout PYORI_STRING UserString,
     __in LPSTR SourceBuffer,
     __in DWORD CharsToCopy
@@ -107,7 +141,7 @@ YoriLibCopyLineToUserBufferW(
     if (CharsToCopy == 0) {
         CharsNeeded = 1;
     } else {
-        CharsNeeded = YoriLibGetMultibyteInputSizeNeeded(SourceBuffer, CharsToCopy) + 1;
+        CharsNeeded = YoriLibGetMultibyteInputSizeNeededEx(Encoding, SourceBuffer, CharsToCopy) + 1;
     }
 
     if (CharsNeeded > UserString->LengthAllocated) {
@@ -118,10 +152,11 @@ YoriLibCopyLineToUserBufferW(
     }
 
     if (CharsToCopy > 0) {
-        YoriLibMultibyteInput(SourceBuffer,
-                              CharsToCopy,
-                              UserString->StartOfString,
-                              UserString->LengthAllocated);
+        CharsNeeded = YoriLibMultibyteInputEx(Encoding,
+                                              SourceBuffer,
+                                              CharsToCopy,
+                                              UserString->StartOfString,
+                                              UserString->LengthAllocated - 1) + 1;
     }
 
     UserString->LengthInChars = CharsNeeded - 1;
@@ -133,6 +168,8 @@ YoriLibCopyLineToUserBufferW(
  Check for the existence of a byte order mark in the string, and return how
  many bytes are in it.
 
+ @param Encoding The encoding of the string.
+
  @param StringToCheck Pointer to a string to check for the existence of a BOM.
 
  @param BytesInString Specifies the number of bytes in StringToCheck.
@@ -141,11 +178,11 @@ YoriLibCopyLineToUserBufferW(
  */
 DWORD
 YoriLibBytesInBom(
+    __in DWORD Encoding,
     __in PCHAR StringToCheck,
     __in DWORD BytesInString
     )
 {
-    DWORD Encoding = YoriLibGetMultibyteInputEncoding();
     if (BytesInString >= 3 && Encoding == CP_UTF8) {
 
         if (StringToCheck[0] == 0xEF &&
@@ -173,6 +210,200 @@ YoriLibBytesInBom(
     return 0;
 }
 
+/**
+ Read a line from a regular file which is being mapped.  Lines are located
+ directly in the mapped view, and a line which crosses the end of the view is
+ handled by asking for the next view to include it.
+
+ @param UserString Pointer to a string to be updated to contain data for a
+        line.
+
+ @param ReadContext Pointer to the line read context.
+
+ @param LineEnding On successful completion, set to indicate the string of
+        characters used to terminate the line.
+
+ @return Pointer to the Line buffer for success, NULL on failure.
+ */
+PVOID
+YoriLibReadLineFromByteSpan(
+    __in PYORI_STRING UserString,
+    __inout PYORI_LIB_LINE_READ_CONTEXT ReadContext,
+    __out PYORI_LIB_LINE_ENDING LineEnding
+    )
+{
+    PYORI_LIB_BYTE_SPAN_READER Reader;
+    PUCHAR Buffer;
+    PWCHAR WideBuffer;
+    DWORD CharSize;
+    DWORD BytesRemaining;
+    DWORD CharsRemaining;
+    DWORD Count;
+    DWORD CharsToCopy;
+    DWORD CharsToSkip;
+    BOOL AtEnd;
+    BOOL LineFound;
+    YORI_LIB_LINE_ENDING LocalLineEnding;
+
+    Reader = &ReadContext->SpanReader;
+    CharSize = sizeof(UCHAR);
+    if (ReadContext->ReadWChars) {
+        CharSize = sizeof(WCHAR);
+    }
+    AtEnd = FALSE;
+
+    while (TRUE) {
+        Buffer = Reader->Span + ReadContext->SpanConsumed;
+        WideBuffer = (PWCHAR)Buffer;
+        BytesRemaining = Reader->SpanLength - ReadContext->SpanConsumed;
+        CharsRemaining = BytesRemaining / CharSize;
+
+        if (ReadContext->ReadWChars) {
+            for (Count = 0; Count < CharsRemaining; Count++) {
+                if (WideBuffer[Count] == 0xD || WideBuffer[Count] == 0xA) {
+                    break;
+                }
+            }
+        } else {
+            for (Count = 0; Count < CharsRemaining; Count++) {
+                if (Buffer[Count] == 0xD || Buffer[Count] == 0xA) {
+                    break;
+                }
+            }
+        }
+
+        //
+        //  If a line ending was found, determine its form.  A CR at the end
+        //  of the span might be followed by a LF in the next span, so that
+        //  can only be processed at the end of the file.
+        //
+
+        LineFound = FALSE;
+        CharsToCopy = Count;
+        LocalLineEnding = YoriLibLineEndingNone;
+        if (Count < CharsRemaining) {
+            if ((ReadContext->ReadWChars && WideBuffer[Count] == 0xA) ||
+                (!ReadContext->ReadWChars && Buffer[Count] == 0xA)) {
+
+                LineFound = TRUE;
+                LocalLineEnding = YoriLibLineEndingLF;
+                Count++;
+            } else if (Count + 1 < CharsRemaining) {
+                LineFound = TRUE;
+                LocalLineEnding = YoriLibLineEndingCR;
+                Count++;
+                if ((ReadContext->ReadWChars && WideBuffer[Count] == 0xA) ||
+                    (!ReadContext->ReadWChars && Buffer[Count] == 0xA)) {
+
+                    LocalLineEnding = YoriLibLineEndingCRLF;
+                    Count++;
+                }
+            } else if (AtEnd) {
+                LineFound = TRUE;
+                LocalLineEnding = YoriLibLineEndingCR;
+                Count++;
+            }
+        } else if (AtEnd) {
+
+            //
+            //  At the end of the file, return anything that remains as a
+            //  line without a line ending.
+            //
+
+            ReadContext->Terminated = TRUE;
+            if (CharsRemaining > 0) {
+                LineFound = TRUE;
+            }
+        }
+
+        if (LineFound) {
+            CharsToSkip = 0;
+            if (ReadContext->LinesRead == 0) {
+                CharsToSkip = YoriLibBytesInBom(ReadContext->Encoding, (PCHAR)Buffer, CharsToCopy * CharSize) / CharSize;
+                CharsToCopy -= CharsToSkip;
+            }
+            if (!YoriLibCopyLineToUserBufferW(ReadContext->Encoding, UserString, (LPSTR)(Buffer + CharsToSkip * CharSize), CharsToCopy)) {
+                break;
+            }
+            ReadContext->SpanConsumed += Count * CharSize;
+            ReadContext->LinesRead++;
+            *LineEnding = LocalLineEnding;
+            return UserString->StartOfString;
+        }
+
+        if (AtEnd || YoriLibIsOperationCancelled()) {
+            break;
+        }
+
+        //
+        //  Move to the next span, keeping the partial line.  If this fails
+        //  and the end of the file has not been reached, the line is too
+        //  long to be mapped in a single view, so give up.
+        //
+
+        if (!YoriLibByteSpanReaderNext(Reader, BytesRemaining)) {
+            if (!Reader->EndOfStream) {
+                break;
+            }
+            AtEnd = TRUE;
+        }
+        ReadContext->SpanConsumed = 0;
+    }
+
+    ReadContext->Terminated = TRUE;
+    UserString->LengthInChars = 0;
+    *LineEnding = YoriLibLineEndingNone;
+    return NULL;
+}
+
+
+/**
+ Allocate a line read context which decodes input in a specified encoding.
+ Normally a context is allocated on the first read and uses the process
+ input encoding at that time; this allows a caller to read in a different
+ encoding without changing the encoding used by the rest of the process.
+
+ @param Encoding The encoding of the input.
+
+ @param Context On successful completion, updated to point to the context.
+        This should be passed to @ref YoriLibReadLineToStringEx and freed
+        with @ref YoriLibLineReadClose .
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibLineReadCreateContext(
+    __in DWORD Encoding,
+    __out PVOID * Context
+    )
+{
+    PYORI_LIB_LINE_READ_CONTEXT ReadContext;
+
+    ReadContext = YoriLibMalloc(sizeof(YORI_LIB_LINE_READ_CONTEXT));
+    if (ReadContext == NULL) {
+        return FALSE;
+    }
+
+    ReadContext->PreviousBuffer = NULL;
+    ReadContext->BytesInBuffer = 0;
+    ReadContext->LengthOfBuffer = 0;
+    ReadContext->CurrentBufferOffset = 0;
+    ReadContext->LinesRead = 0;
+    ReadContext->Encoding = Encoding;
+    if (Encoding == CP_UTF16) {
+        ReadContext->ReadWChars = TRUE;
+    } else {
+        ReadContext->ReadWChars = FALSE;
+    }
+    ReadContext->Started = FALSE;
+    ReadContext->Terminated = FALSE;
+    ReadContext->Mapped = FALSE;
+    ReadContext->SpanConsumed = 0;
+
+    *Context = ReadContext;
+    return TRUE;
+}
 
 /**
  Read a line from an input stream.
@@ -183,8 +414,9 @@ YoriLibBytesInBom(
         reallocate the string to point to a new buffer.
 
  @param Context Pointer to a PVOID sized block of memory that should be
-        initialized to NULL for the first line read, and will be updated by
-        this function.
+        initialized to NULL for the first line read, or to a context from
+        @ref YoriLibLineReadCreateContext , and will be updated by this
+        function.
 
  @param ReturnFinalNonTerminatedLine If TRUE, treat any line at the end of the
         stream without a line ending character to be a line to return.  If
@@ -245,29 +477,41 @@ YoriLibReadLineToStringEx(
     //
 
     if (*Context == NULL) {
-        ReadContext = YoriLibMalloc(sizeof(YORI_LIB_LINE_READ_CONTEXT));
-        if (ReadContext == NULL) {
+        if (!YoriLibLineReadCreateContext(YoriLibGetMultibyteInputEncoding(), Context)) {
             UserString->LengthInChars = 0;
             *LineEnding = YoriLibLineEndingNone;
             return NULL;
         }
-        *Context = ReadContext;
-        ReadContext->PreviousBuffer = NULL;
-        ReadContext->BytesInBuffer = 0;
-        ReadContext->LengthOfBuffer = 0;
-        ReadContext->CurrentBufferOffset = 0;
-        ReadContext->LinesRead = 0;
-        if (YoriLibGetMultibyteInputEncoding() == CP_UTF16) {
-            ReadContext->ReadWChars = TRUE;
-        } else {
-            ReadContext->ReadWChars = FALSE;
-        }
-        ReadContext->Terminated = FALSE;
-    } else {
-        ReadContext = *Context;
-        if (ReadContext->Terminated) {
-            return NULL;
+    }
+
+    ReadContext = *Context;
+    if (!ReadContext->Started) {
+        ReadContext->Started = TRUE;
+
+        //
+        //  If the input is a regular file, the caller wants the whole file,
+        //  and the process has enabled mapping, map it rather than reading
+        //  it.  Callers waiting for more data to arrive continue to read,
+        //  since they are expecting pipe-like behavior.
+        //
+
+        if (FileType == FILE_TYPE_DISK &&
+            ReturnFinalNonTerminatedLine &&
+            MaximumDelay == INFINITE &&
+            YoriLibByteSpanReaderOpen(&ReadContext->SpanReader, FileHandle, NULL)) {
+
+            if (ReadContext->SpanReader.Mapped) {
+                ReadContext->Mapped = TRUE;
+            } else {
+                YoriLibByteSpanReaderClose(&ReadContext->SpanReader);
+            }
         }
+    } else if (ReadContext->Terminated) {
+        return NULL;
+    }
+
+    if (ReadContext->Mapped) {
+        return YoriLibReadLineFromByteSpan(UserString, ReadContext, LineEnding);
     }
 
     //
@@ -330,14 +574,14 @@ YoriLibReadLineToStringEx(
 
                         CharsToSkip = 0;
                         if (!BomFound && ReadContext->LinesRead == 0) {
-                            CharsToSkip = YoriLibBytesInBom(ReadContext->PreviousBuffer, CharsToCopy * sizeof(WCHAR));
+                            CharsToSkip = YoriLibBytesInBom(ReadContext->Encoding, ReadContext->PreviousBuffer, CharsToCopy * sizeof(WCHAR));
                             if (CharsToSkip > 0) {
                                 BomFound = TRUE;
                                 CharsToSkip = CharsToSkip / sizeof(WCHAR);
                                 CharsToCopy -= CharsToSkip;
                             }
                         }
-                        if (YoriLibCopyLineToUserBufferW(UserString, (LPSTR)&WideBuffer[CharsToSkip], CharsToCopy)) {
+                        if (YoriLibCopyLineToUserBufferW(ReadContext->Encoding, UserString, (LPSTR)&WideBuffer[CharsToSkip], CharsToCopy)) {
                             ReadContext->CurrentBufferOffset += Count * sizeof(WCHAR);
                             ReadContext->LinesRead++;
                             *LineEnding = LocalLineEnding;
@@ -382,13 +626,13 @@ YoriLibReadLineToStringEx(
 
                         CharsToSkip = 0;
                         if (!BomFound && ReadContext->LinesRead == 0) {
-                            CharsToSkip = YoriLibBytesInBom(ReadContext->PreviousBuffer, CharsToCopy);
+                            CharsToSkip = YoriLibBytesInBom(ReadContext->Encoding, ReadContext->PreviousBuffer, CharsToCopy);
                             if (CharsToSkip > 0) {
                                 BomFound = TRUE;
                                 CharsToCopy -= CharsToSkip;
                             }
                         }
-                        if (YoriLibCopyLineToUserBufferW(UserString, (LPSTR)&Buffer[CharsToSkip], CharsToCopy)) {
+                        if (YoriLibCopyLineToUserBufferW(ReadContext->Encoding, UserString, (LPSTR)&Buffer[CharsToSkip], CharsToCopy)) {
                             ReadContext->CurrentBufferOffset += Count;
                             ReadContext->LinesRead++;
                             *LineEnding = LocalLineEnding;
@@ -557,7 +801,7 @@ YoriLibReadLineToStringEx(
                     CharsToSkip = 0;
                     CharsToCopy = ReadContext->BytesInBuffer;
                     if (!BomFound && ReadContext->LinesRead == 0) {
-                        CharsToSkip = YoriLibBytesInBom(ReadContext->PreviousBuffer, CharsToCopy);
+                        CharsToSkip = YoriLibBytesInBom(ReadContext->Encoding, ReadContext->PreviousBuffer, CharsToCopy);
                         if (CharsToSkip > 0) {
                             BomFound = TRUE;
                             CharsToCopy -= CharsToSkip;
@@ -566,7 +810,7 @@ YoriLibReadLineToStringEx(
                     if (ReadContext->ReadWChars) {
                         CharsToCopy = CharsToCopy / sizeof(WCHAR);
                     }
-                    if (YoriLibCopyLineToUserBufferW(UserString, &ReadContext->PreviousBuffer[CharsToSkip], CharsToCopy)) {
+                    if (YoriLibCopyLineToUserBufferW(ReadContext->Encoding, UserString, &ReadContext->PreviousBuffer[CharsToSkip], CharsToCopy)) {
                         ReadContext->BytesInBuffer = 0;
                         *LineEnding = YoriLibLineEndingNone;
                         return UserString->StartOfString;
@@ -627,6 +871,9 @@ YoriLibLineReadClose(
         if (ReadContext->PreviousBuffer != NULL) {
             YoriLibFree(ReadContext->PreviousBuffer);
         }
+        if (ReadContext->Mapped) {
+            YoriLibByteSpanReaderClose(&ReadContext->SpanReader);
+        }
         YoriLibFree(ReadContext);
     }
 }
@@ -146,7 +146,7 @@ YoriLibOutputTextToMultibyteDevice(
 
 #ifdef UNICODE
     {
-        CHAR ansi_stack_buf[64 + 1];
+        CHAR ansi_stack_buf[256 + 1];
         DWORD AnsiBytesNeeded;
         LPSTR ansi_buf;
 
@@ -159,10 +159,10 @@ YoriLibOutputTextToMultibyteDevice(
         }
 
         if (ansi_buf != NULL) {
-            YoriLibMultibyteOutput(StringBuffer,
-                                   BufferLength,
-                                   ansi_buf,
-                                   AnsiBytesNeeded);
+            AnsiBytesNeeded = YoriLibMultibyteOutput(StringBuffer,
+                                                     BufferLength,
+                                                     ansi_buf,
+                                                     AnsiBytesNeeded);
 
             Result = WriteFile(hOutput, ansi_buf, AnsiBytesNeeded, &BytesTransferred, NULL);
 
@@ -842,6 +842,536 @@ YoriLibProcessVtEscapesOnNewStream(
     return Result;
 }
 
+//
+//  Batched console functions
+//
+
+/**
+ The number of cells to accumulate before writing to a console that does not
+ process VT sequences.  Cells are only accumulated within a single row, so
+ this only limits rows that are wider than this.
+ */
+#define YORI_LIB_CONSOLE_BATCH_CELLS 1024
+
+/**
+ State used to accumulate output to a console so that it can be written in
+ fewer, larger operations.  A pointer to this structure is passed to the
+ callback functions in place of the output handle.
+ */
+typedef struct _YORI_LIB_CONSOLE_BATCH_CONTEXT {
+
+    /**
+     Handle to the console to write to.
+     */
+    HANDLE hConsole;
+
+    /**
+     TRUE if the console processes VT sequences itself, so color escapes are
+     written to it unchanged.  FALSE if text is written as cells with
+     attributes calculated from the escapes.
+     */
+    BOOLEAN UseVt;
+
+    /**
+     TRUE if the console will interpret newline and carriage return and wrap
+     at the end of each row in the way that is emulated here, so text can be
+     written as cells.  FALSE if all text must be written with WriteConsole.
+     */
+    BOOLEAN UseCells;
+
+    /**
+     TRUE if Cursor has been moved by writing cells, so the console cursor
+     needs to be updated before text is written with WriteConsole or before
+     the stream ends.
+     */
+    BOOLEAN CursorMoved;
+
+    /**
+     The color that the console uses for text written with WriteConsole.
+     */
+    WORD AppliedColor;
+
+    /**
+     The color that the next text should be displayed in.  Escapes update
+     this value, and the console is only updated when text must be written
+     with WriteConsole or when the stream ends.
+     */
+    WORD DesiredColor;
+
+    /**
+     The size of the console screen buffer.
+     */
+    COORD BufferSize;
+
+    /**
+     The location where the next character will be displayed.
+     */
+    COORD Cursor;
+
+    /**
+     When using VT, points to text from the caller's string that has not yet
+     been written.  Text and escapes that are written unchanged are adjacent
+     in the caller's string, so they are written with a single call.
+     */
+    LPTSTR PendingText;
+
+    /**
+     When using VT, the number of characters in PendingText.
+     */
+    DWORD PendingLength;
+
+    /**
+     When not using VT, the location of the first cell in Cells.
+     */
+    COORD CellStart;
+
+    /**
+     When not using VT, the number of elements in Cells.
+     */
+    DWORD CellCount;
+
+    /**
+     When not using VT, cells waiting to be written to the console.  These
+     are all on a single row, starting from CellStart.
+     */
+    CHAR_INFO Cells[YORI_LIB_CONSOLE_BATCH_CELLS];
+} YORI_LIB_CONSOLE_BATCH_CONTEXT, *PYORI_LIB_CONSOLE_BATCH_CONTEXT;
+
+/**
+ Write any text or cells that have been accumulated to the console.
+
+ @param Batch Pointer to the batch context.
+ */
+VOID
+YoriLibConsoleBatchFlush(
+    __in PYORI_LIB_CONSOLE_BATCH_CONTEXT Batch
+    )
+{
+    DWORD CharsWritten;
+    COORD BufferSize;
+    COORD BufferCoord;
+    SMALL_RECT WriteRegion;
+
+    if (Batch->PendingLength > 0) {
+        WriteConsole(Batch->hConsole, Batch->PendingText, Batch->PendingLength, &CharsWritten, NULL);
+        Batch->PendingLength = 0;
+    }
+
+    if (Batch->CellCount > 0) {
+        BufferSize.X = (SHORT)Batch->CellCount;
+        BufferSize.Y = 1;
+        BufferCoord.X = 0;
+        BufferCoord.Y = 0;
+        WriteRegion.Left = Batch->CellStart.X;
+        WriteRegion.Top = Batch->CellStart.Y;
+        WriteRegion.Right = (SHORT)(Batch->CellStart.X + Batch->CellCount - 1);
+        WriteRegion.Bottom = Batch->CellStart.Y;
+        WriteConsoleOutput(Batch->hConsole, Batch->Cells, BufferSize, BufferCoord, &WriteRegion);
+        Batch->CellCount = 0;
+    }
+}
+
+/**
+ Return TRUE if a character can be written to the console as a single cell.
+ Control characters have effects that are not emulated here, and wide
+ characters occupy more than one cell on some consoles, so these are written
+ with WriteConsole.
+
+ @param Char The character to check.
+
+ @return TRUE if the character occupies exactly one cell, FALSE if it
+         should be written with WriteConsole.
+ */
+BOOLEAN
+YoriLibConsoleBatchIsCellChar(
+    __in TCHAR Char
+    )
+{
+    if (Char < 0x20 || Char == 0x7F) {
+        return FALSE;
+    }
+
+    if ((Char >= 0x1100 && Char <= 0x115F) ||
+        (Char >= 0x2E80 && Char <= 0xA4CF) ||
+        (Char >= 0xAC00 && Char <= 0xD7A3) ||
+        (Char >= 0xD800 && Char <= 0xDFFF) ||
+        (Char >= 0xF900 && Char <= 0xFAFF) ||
+        (Char >= 0xFE30 && Char <= 0xFE4F) ||
+        (Char >= 0xFF00 && Char <= 0xFF60) ||
+        (Char >= 0xFFE0 && Char <= 0xFFE6)) {
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Write text with WriteConsole, so that the console can interpret it.  Any
+ cells accumulated so far are written first, and the console's cursor and
+ color are updated to reflect the text that has been output.
+
+ @param Batch Pointer to the batch context.
+
+ @param StringBuffer Pointer to the text to write.
+
+ @param BufferLength The number of characters in the text.
+ */
+VOID
+YoriLibConsoleBatchWriteDirect(
+    __in PYORI_LIB_CONSOLE_BATCH_CONTEXT Batch,
+    __in LPTSTR StringBuffer,
+    __in DWORD BufferLength
+    )
+{
+    CONSOLE_SCREEN_BUFFER_INFO ConsoleInfo;
+    DWORD CharsWritten;
+
+    YoriLibConsoleBatchFlush(Batch);
+
+    if (Batch->CursorMoved) {
+        SetConsoleCursorPosition(Batch->hConsole, Batch->Cursor);
+        Batch->CursorMoved = FALSE;
+    }
+
+    if (Batch->AppliedColor != Batch->DesiredColor) {
+        SetConsoleTextAttribute(Batch->hConsole, Batch->DesiredColor);
+        Batch->AppliedColor = Batch->DesiredColor;
+    }
+
+    WriteConsole(Batch->hConsole, StringBuffer, BufferLength, &CharsWritten, NULL);
+
+    //
+    //  The console may have wrapped or scrolled, so find where it left the
+    //  cursor.  If that can't be determined, write everything else with
+    //  WriteConsole.
+    //
+
+    if (Batch->UseCells) {
+        if (GetConsoleScreenBufferInfo(Batch->hConsole, &ConsoleInfo)) {
+            Batch->Cursor.X = ConsoleInfo.dwCursorPosition.X;
+            Batch->Cursor.Y = ConsoleInfo.dwCursorPosition.Y;
+            Batch->BufferSize.X = ConsoleInfo.dwSize.X;
+            Batch->BufferSize.Y = ConsoleInfo.dwSize.Y;
+        } else {
+            Batch->UseCells = FALSE;
+        }
+    }
+}
+
+/**
+ Add a character to the cells waiting to be written, in the color requested
+ by previous escapes, and advance the cursor past it.  If the row is full,
+ the cursor wraps to the next row as the console would.
+
+ @param Batch Pointer to the batch context.
+
+ @param Char The character to add.
+ */
+VOID
+YoriLibConsoleBatchAppendCell(
+    __in PYORI_LIB_CONSOLE_BATCH_CONTEXT Batch,
+    __in TCHAR Char
+    )
+{
+    if (Batch->CellCount == YORI_LIB_CONSOLE_BATCH_CELLS) {
+        YoriLibConsoleBatchFlush(Batch);
+    }
+
+    if (Batch->CellCount == 0) {
+        Batch->CellStart.X = Batch->Cursor.X;
+        Batch->CellStart.Y = Batch->Cursor.Y;
+    }
+
+    Batch->Cells[Batch->CellCount].Char.UnicodeChar = Char;
+    Batch->Cells[Batch->CellCount].Attributes = Batch->DesiredColor;
+    Batch->CellCount++;
+    Batch->Cursor.X++;
+    Batch->CursorMoved = TRUE;
+
+    if (Batch->Cursor.X >= Batch->BufferSize.X) {
+        YoriLibConsoleBatchFlush(Batch);
+        Batch->Cursor.X = 0;
+        Batch->Cursor.Y++;
+    }
+}
+
+/**
+ Initialize a batched console output stream by capturing the console's
+ current color, cursor position, and whether it processes VT sequences.
+
+ @param hOutput Pointer to the batch context, which contains the console
+        handle.
+
+ @return TRUE for success, FALSE on failure.
+ */
+BOOL
+YoriLibConsoleBatchInitializeStream(
+    __in HANDLE hOutput
+    )
+{
+    PYORI_LIB_CONSOLE_BATCH_CONTEXT Batch = (PYORI_LIB_CONSOLE_BATCH_CONTEXT)hOutput;
+    CONSOLE_SCREEN_BUFFER_INFO ConsoleInfo;
+    DWORD Mode;
+    BOOL HaveInfo;
+
+    ConsoleInfo.wAttributes = DEFAULT_COLOR;
+    HaveInfo = GetConsoleScreenBufferInfo(Batch->hConsole, &ConsoleInfo);
+
+    if (!YoriLibVtResetColorSet) {
+        YoriLibVtResetColor = ConsoleInfo.wAttributes;
+        YoriLibVtResetColorSet = TRUE;
+    }
+
+    Batch->AppliedColor = ConsoleInfo.wAttributes;
+    Batch->DesiredColor = ConsoleInfo.wAttributes;
+    Batch->PendingText = NULL;
+    Batch->PendingLength = 0;
+    Batch->CellCount = 0;
+    Batch->CursorMoved = FALSE;
+    Batch->UseVt = FALSE;
+    Batch->UseCells = FALSE;
+
+    if (!GetConsoleMode(Batch->hConsole, &Mode)) {
+        return TRUE;
+    }
+
+    if ((Mode & ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0) {
+        Batch->UseVt = TRUE;
+        return TRUE;
+    }
+
+    //
+    //  Cells can only be used if the console processes newlines and wraps
+    //  in the way that is emulated when writing cells.
+    //
+
+    if (HaveInfo &&
+        (Mode & ENABLE_PROCESSED_OUTPUT) != 0 &&
+        (Mode & ENABLE_WRAP_AT_EOL_OUTPUT) != 0 &&
+        (Mode & DISABLE_NEWLINE_AUTO_RETURN) == 0) {
+
+        Batch->UseCells = TRUE;
+        Batch->Cursor.X = ConsoleInfo.dwCursorPosition.X;
+        Batch->Cursor.Y = ConsoleInfo.dwCursorPosition.Y;
+        Batch->BufferSize.X = ConsoleInfo.dwSize.X;
+        Batch->BufferSize.Y = ConsoleInfo.dwSize.Y;
+    }
+
+    return TRUE;
+}
+
+/**
+ End a batched console output stream by writing anything that is buffered,
+ and leaving the console's cursor and color where the text requested.
+
+ @param hOutput Pointer to the batch context.
+
+ @return TRUE for success, FALSE on failure.
+ */
+BOOL
+YoriLibConsoleBatchEndStream(
+    __in HANDLE hOutput
+    )
+{
+    PYORI_LIB_CONSOLE_BATCH_CONTEXT Batch = (PYORI_LIB_CONSOLE_BATCH_CONTEXT)hOutput;
+
+    YoriLibConsoleBatchFlush(Batch);
+
+    if (Batch->CursorMoved) {
+        SetConsoleCursorPosition(Batch->hConsole, Batch->Cursor);
+        Batch->CursorMoved = FALSE;
+    }
+
+    if (!Batch->UseVt && Batch->AppliedColor != Batch->DesiredColor) {
+        SetConsoleTextAttribute(Batch->hConsole, Batch->DesiredColor);
+        Batch->AppliedColor = Batch->DesiredColor;
+    }
+
+    return TRUE;
+}
+
+/**
+ Add text to the pending region of the caller's string when using VT.  If
+ the text does not immediately follow the pending region, the pending region
+ is written first.
+
+ @param Batch Pointer to the batch context.
+
+ @param StringBuffer Pointer to the text within the caller's string.
+
+ @param BufferLength The number of characters in the text.
+ */
+VOID
+YoriLibConsoleBatchAppendPending(
+    __in PYORI_LIB_CONSOLE_BATCH_CONTEXT Batch,
+    __in LPTSTR StringBuffer,
+    __in DWORD BufferLength
+    )
+{
+    if (Batch->PendingLength > 0 &&
+        Batch->PendingText + Batch->PendingLength != StringBuffer) {
+
+        YoriLibConsoleBatchFlush(Batch);
+    }
+
+    if (Batch->PendingLength == 0) {
+        Batch->PendingText = StringBuffer;
+    }
+    Batch->PendingLength += BufferLength;
+}
+
+/**
+ Add text between escapes to a batched console output stream.
+
+ @param hOutput Pointer to the batch context.
+
+ @param StringBuffer Pointer to the string to output.
+
+ @param BufferLength Number of characters in the string.
+
+ @return TRUE for success, FALSE on failure.
+ */
+BOOL
+YoriLibConsoleBatchProcessAndOutputText(
+    __in HANDLE hOutput,
+    __in LPTSTR StringBuffer,
+    __in DWORD BufferLength
+    )
+{
+    PYORI_LIB_CONSOLE_BATCH_CONTEXT Batch = (PYORI_LIB_CONSOLE_BATCH_CONTEXT)hOutput;
+    DWORD Index;
+    TCHAR Char;
+
+    if (BufferLength == 0) {
+        return TRUE;
+    }
+
+    if (Batch->UseVt) {
+        YoriLibConsoleBatchAppendPending(Batch, StringBuffer, BufferLength);
+        return TRUE;
+    }
+
+    if (!Batch->UseCells) {
+        YoriLibConsoleBatchWriteDirect(Batch, StringBuffer, BufferLength);
+        return TRUE;
+    }
+
+    for (Index = 0; Index < BufferLength; Index++) {
+        Char = StringBuffer[Index];
+
+        //
+        //  Newlines and carriage returns that don't need the console to
+        //  scroll only move the cursor.  Writing to the last cell of the
+        //  buffer would also scroll, so let the console do it.
+        //
+
+        if (Char == '\n' && Batch->Cursor.Y + 1 < Batch->BufferSize.Y) {
+            YoriLibConsoleBatchFlush(Batch);
+            Batch->Cursor.X = 0;
+            Batch->Cursor.Y++;
+            Batch->CursorMoved = TRUE;
+        } else if (Char == '\r') {
+            YoriLibConsoleBatchFlush(Batch);
+            Batch->Cursor.X = 0;
+            Batch->CursorMoved = TRUE;
+        } else if (YoriLibConsoleBatchIsCellChar(Char) &&
+                   (Batch->Cursor.Y + 1 < Batch->BufferSize.Y ||
+                    Batch->Cursor.X + 1 < Batch->BufferSize.X)) {
+
+            YoriLibConsoleBatchAppendCell(Batch, Char);
+        } else {
+            YoriLibConsoleBatchWriteDirect(Batch, &StringBuffer[Index], 1);
+            if (!Batch->UseCells) {
+                if (Index + 1 < BufferLength) {
+                    YoriLibConsoleBatchWriteDirect(Batch, &StringBuffer[Index + 1], BufferLength - Index - 1);
+                }
+                break;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Process an escape in a batched console output stream.  If the console
+ processes VT sequences, color escapes are written to it unchanged.
+ Otherwise the color is calculated from the color requested by previous
+ escapes rather than by querying the console, and is used for any cells
+ written later.
+
+ @param hOutput Pointer to the batch context.
+
+ @param StringBuffer Pointer to a buffer describing the escape.
+
+ @param BufferLength The number of characters in the escape.
+
+ @return TRUE for success, FALSE for failure.
+ */
+BOOL
+YoriLibConsoleBatchProcessAndOutputEscape(
+    __in HANDLE hOutput,
+    __in LPTSTR StringBuffer,
+    __in DWORD BufferLength
+    )
+{
+    PYORI_LIB_CONSOLE_BATCH_CONTEXT Batch = (PYORI_LIB_CONSOLE_BATCH_CONTEXT)hOutput;
+    YORI_STRING EscapeCode;
+    WORD NewColor;
+
+    YoriLibInitEmptyString(&EscapeCode);
+    EscapeCode.StartOfString = StringBuffer;
+    EscapeCode.LengthInChars = BufferLength;
+
+    if (Batch->UseVt) {
+        if (BufferLength >= 3 && StringBuffer[BufferLength - 1] == 'm') {
+            YoriLibConsoleBatchAppendPending(Batch, StringBuffer, BufferLength);
+        }
+        return TRUE;
+    }
+
+    if (YoriLibVtFinalColorFromSequence(Batch->DesiredColor, &EscapeCode, &NewColor)) {
+        Batch->DesiredColor = NewColor;
+    }
+    return TRUE;
+}
+
+/**
+ Output a string containing VT100 escapes to a console.  On a console that
+ processes VT sequences, the text and color escapes are written unchanged in
+ as few calls as possible.  Otherwise, the escapes are translated into
+ colors and the text is written as cells, so that a change in color does not
+ require a separate write.
+
+ @param hOutput Handle to the console.
+
+ @param String Pointer to the string to output.
+
+ @param StringLength The number of characters in the string.
+
+ @return TRUE for success, FALSE for failure.
+ */
+BOOL
+YoriLibConsoleBatchProcessVtEscapes(
+    __in HANDLE hOutput,
+    __in LPTSTR String,
+    __in DWORD StringLength
+    )
+{
+    YORI_LIB_VT_CALLBACK_FUNCTIONS Callbacks;
+    YORI_LIB_CONSOLE_BATCH_CONTEXT Batch;
+
+    Batch.hConsole = hOutput;
+
+    Callbacks.InitializeStream = YoriLibConsoleBatchInitializeStream;
+    Callbacks.EndStream = YoriLibConsoleBatchEndStream;
+    Callbacks.ProcessAndOutputText = YoriLibConsoleBatchProcessAndOutputText;
+    Callbacks.ProcessAndOutputEscape = YoriLibConsoleBatchProcessAndOutputEscape;
+
+    return YoriLibProcessVtEscapesOnNewStream(String, StringLength, (HANDLE)&Batch, &Callbacks);
+}
+
 /**
  Output a printf-style formatted string to the specified output stream.
 
@@ -870,19 +1400,21 @@ YoriLibOutputInternal(
     YORI_LIB_VT_CALLBACK_FUNCTIONS Callbacks;
     DWORD CurrentMode;
     BOOL Result;
+    BOOL Batched;
 
     //
     //  Check if we're writing to a console supporting color or a file
     //  that doesn't
     //
 
+    Batched = FALSE;
     if (GetConsoleMode(hOut, &CurrentMode)) {
         if ((Flags & YORI_LIB_OUTPUT_STRIP_VT) != 0) {
             YoriLibConsoleNoEscapeSetFunctions(&Callbacks);
         } else if ((Flags & YORI_LIB_OUTPUT_PASSTHROUGH_VT) != 0) {
             YoriLibConsoleIncludeEscapeSetFunctions(&Callbacks);
         } else {
-            YoriLibConsoleSetFunctions(&Callbacks);
+            Batched = TRUE;
         }
     } else if ((Flags & YORI_LIB_OUTPUT_STRIP_VT) != 0) {
         YoriLibUtf8TextNoEscapesSetFunctions(&Callbacks);
@@ -904,7 +1436,11 @@ YoriLibOutputInternal(
     marker = savedmarker;
     len = YoriLibVSPrintf(buf, len, szFmt, marker);
 
-    Result = YoriLibProcessVtEscapesOnNewStream(buf, len, hOut, &Callbacks);
+    if (Batched) {
+        Result = YoriLibConsoleBatchProcessVtEscapes(hOut, buf, len);
+    } else {
+        Result = YoriLibProcessVtEscapesOnNewStream(buf, len, hOut, &Callbacks);
+    }
 
     if (buf != stack_buf) {
         YoriLibFree(buf);
@@ -982,7 +1518,7 @@ YoriLibOutputString(
         } else if ((Flags & YORI_LIB_OUTPUT_PASSTHROUGH_VT) != 0) {
             YoriLibConsoleIncludeEscapeSetFunctions(&Callbacks);
         } else {
-            YoriLibConsoleSetFunctions(&Callbacks);
+            return YoriLibConsoleBatchProcessVtEscapes(hOut, String->StartOfString, String->LengthInChars);
         }
     } else if ((Flags & YORI_LIB_OUTPUT_STRIP_VT) != 0) {
         YoriLibUtf8TextNoEscapesSetFunctions(&Callbacks);
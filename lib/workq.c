@@ -0,0 +1,525 @@
+/**
+ * @file lib/workq.c
+ *
+ * Yori shell queue of work processed by a pool of threads
+ *
+ * Copyright (c) 2020 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ Find an item for a worker to process.  Each worker processes items from its
+ own list in the order they were submitted.  If its own list is empty, it
+ takes the most recently submitted item from another worker's list.
+
+ @param Worker Pointer to the worker looking for an item.
+
+ @return Pointer to the item to process, or NULL if no item was found.
+ */
+PYORI_LIB_WORK_ITEM
+YoriLibWorkQueueFindItem(
+    __in PYORI_LIB_WORK_QUEUE_WORKER Worker
+    )
+{
+    PYORI_LIB_WORK_QUEUE Queue;
+    PYORI_LIB_WORK_QUEUE_WORKER Victim;
+    PYORI_LIST_ENTRY ListEntry;
+    DWORD Index;
+
+    Queue = Worker->Queue;
+
+    WaitForSingleObject(Worker->Mutex, INFINITE);
+    ListEntry = YoriLibGetNextListEntry(&Worker->Items, NULL);
+    if (ListEntry != NULL) {
+        YoriLibRemoveListItem(ListEntry);
+        ReleaseMutex(Worker->Mutex);
+        return CONTAINING_RECORD(ListEntry, YORI_LIB_WORK_ITEM, ListEntry);
+    }
+    ReleaseMutex(Worker->Mutex);
+
+    for (Index = 1; Index < Queue->MaxWorkers; Index++) {
+        Victim = &Queue->Workers[(Worker->Index + Index) % Queue->MaxWorkers];
+        WaitForSingleObject(Victim->Mutex, INFINITE);
+        ListEntry = YoriLibGetPreviousListEntry(&Victim->Items, NULL);
+        if (ListEntry != NULL) {
+            YoriLibRemoveListItem(ListEntry);
+            ReleaseMutex(Victim->Mutex);
+            return CONTAINING_RECORD(ListEntry, YORI_LIB_WORK_ITEM, ListEntry);
+        }
+        ReleaseMutex(Victim->Mutex);
+    }
+
+    return NULL;
+}
+
+/**
+ Indicate that a number of items have been fully processed, and wake anyone
+ waiting for the queue to become idle if no items remain.
+
+ @param Queue Pointer to the work queue.
+
+ @param Count The number of items that have been fully processed.
+ */
+VOID
+YoriLibWorkQueueItemsRetired(
+    __in PYORI_LIB_WORK_QUEUE Queue,
+    __in DWORD Count
+    )
+{
+    if (Count == 0) {
+        return;
+    }
+
+    WaitForSingleObject(Queue->Mutex, INFINITE);
+    ASSERT(Queue->ItemsOutstanding >= Count);
+    Queue->ItemsOutstanding -= Count;
+    if (Queue->ItemsOutstanding == 0) {
+        SetEvent(Queue->IdleEvent);
+    }
+    ReleaseMutex(Queue->Mutex);
+}
+
+/**
+ Handle an item that has been processed by a worker.  If the queue has a
+ completion routine, items are held until every item submitted before them
+ has completed, and the completion routine is invoked on them in the order
+ they were submitted.
+
+ @param Queue Pointer to the work queue.
+
+ @param Item Pointer to the item that has been processed.
+ */
+VOID
+YoriLibWorkQueueCompleteItem(
+    __in PYORI_LIB_WORK_QUEUE Queue,
+    __in PYORI_LIB_WORK_ITEM Item
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_WORK_ITEM Completed;
+    DWORD Count;
+
+    if (Queue->CompleteFn == NULL) {
+        YoriLibWorkQueueItemsRetired(Queue, 1);
+        return;
+    }
+
+    WaitForSingleObject(Queue->CompletionMutex, INFINITE);
+
+    //
+    //  Items usually complete in roughly the order they were submitted, so
+    //  search from the end of the list for the insertion point.
+    //
+
+    ListEntry = YoriLibGetPreviousListEntry(&Queue->CompletedItems, NULL);
+    while (ListEntry != NULL) {
+        Completed = CONTAINING_RECORD(ListEntry, YORI_LIB_WORK_ITEM, ListEntry);
+        if ((LONG)(Completed->Sequence - Item->Sequence) < 0) {
+            break;
+        }
+        ListEntry = YoriLibGetPreviousListEntry(&Queue->CompletedItems, ListEntry);
+    }
+
+    if (ListEntry == NULL) {
+        YoriLibInsertList(&Queue->CompletedItems, &Item->ListEntry);
+    } else {
+        YoriLibInsertList(ListEntry, &Item->ListEntry);
+    }
+
+    Count = 0;
+    while (TRUE) {
+        ListEntry = YoriLibGetNextListEntry(&Queue->CompletedItems, NULL);
+        if (ListEntry == NULL) {
+            break;
+        }
+        Completed = CONTAINING_RECORD(ListEntry, YORI_LIB_WORK_ITEM, ListEntry);
+        if (Completed->Sequence != Queue->NextSequenceToComplete) {
+            break;
+        }
+        YoriLibRemoveListItem(ListEntry);
+        Queue->NextSequenceToComplete++;
+        Queue->CompleteFn(Queue->Context, Completed);
+        Count++;
+    }
+
+    ReleaseMutex(Queue->CompletionMutex);
+
+    //
+    //  Items with a completion routine occupy a slot until they have been
+    //  completed, which bounds the number of items held behind an item
+    //  that is taking a long time to process.
+    //
+
+    if (Count > 0) {
+        ReleaseSemaphore(Queue->SlotsAvailable, Count, NULL);
+    }
+
+    YoriLibWorkQueueItemsRetired(Queue, Count);
+}
+
+/**
+ A worker thread which processes items submitted to a work queue until the
+ queue is shut down.
+
+ @param Context Pointer to the worker structure for this thread.
+
+ @return Zero.
+ */
+DWORD WINAPI
+YoriLibWorkQueueWorker(
+    __in LPVOID Context
+    )
+{
+    PYORI_LIB_WORK_QUEUE_WORKER Worker;
+    PYORI_LIB_WORK_QUEUE Queue;
+    PYORI_LIB_WORK_ITEM Item;
+    HANDLE WaitHandles[2];
+    DWORD WaitResult;
+    BOOL Cancelled;
+
+    Worker = (PYORI_LIB_WORK_QUEUE_WORKER)Context;
+    Queue = Worker->Queue;
+
+    WaitHandles[0] = Queue->ItemsAvailable;
+    WaitHandles[1] = Queue->ShutdownEvent;
+
+    while (TRUE) {
+
+        //
+        //  Waits are satisfied by the first signalled object, so any queued
+        //  items are processed before shutdown is observed.
+        //
+
+        WaitResult = WaitForMultipleObjects(2, WaitHandles, FALSE, INFINITE);
+        if (WaitResult != WAIT_OBJECT_0) {
+            break;
+        }
+
+        //
+        //  Each count on the semaphore corresponds to an item on some
+        //  worker's list, so an item must be found.
+        //
+
+        Item = YoriLibWorkQueueFindItem(Worker);
+        ASSERT(Item != NULL);
+        if (Item == NULL) {
+            continue;
+        }
+
+        if (Queue->CompleteFn == NULL) {
+            ReleaseSemaphore(Queue->SlotsAvailable, 1, NULL);
+        }
+
+        Cancelled = YoriLibIsOperationCancelled();
+        Item->Result = Queue->WorkFn(Queue->Context, Item, Cancelled);
+        if (!Item->Result) {
+            InterlockedIncrement(&Queue->ItemsFailed);
+        }
+
+        YoriLibWorkQueueCompleteItem(Queue, Item);
+    }
+
+    return 0;
+}
+
+/**
+ Initialize a work queue.  Worker threads are not created until work is
+ submitted.
+
+ @param Queue Pointer to the work queue to initialize.
+
+ @param MaxWorkers The maximum number of worker threads.  If zero, this is
+        the number of processors in the system.
+
+ @param MaxQueued The maximum number of items that can be waiting for a
+        worker before submission blocks.  If zero, this is twice the number
+        of workers.  If CompleteFn is specified, items being processed or
+        waiting for earlier items to complete are also counted, so this
+        is increased by the number of workers to allow each worker to be
+        busy while items are waiting.
+
+ @param WorkFn Pointer to a function to invoke on a worker thread for each
+        item.
+
+ @param CompleteFn Optionally points to a function to invoke for each item
+        after it has been processed.  If specified, this is invoked on items
+        in the order they were submitted, one at a time.  If not specified,
+        WorkFn is responsible for any cleanup of the item.
+
+ @param Context Pointer to caller context passed to WorkFn and CompleteFn.
+
+ @return TRUE to indicate success, FALSE to indicate failure.  On failure,
+         the queue should be cleaned up with @ref YoriLibWorkQueueCleanup .
+ */
+__success(return)
+BOOL
+YoriLibWorkQueueInitialize(
+    __out PYORI_LIB_WORK_QUEUE Queue,
+    __in DWORD MaxWorkers,
+    __in DWORD MaxQueued,
+    __in YORI_LIB_WORK_QUEUE_FN WorkFn,
+    __in_opt YORI_LIB_WORK_QUEUE_COMPLETE_FN CompleteFn,
+    __in_opt PVOID Context
+    )
+{
+    SYSTEM_INFO SystemInfo;
+    DWORD Index;
+
+    ZeroMemory(Queue, sizeof(YORI_LIB_WORK_QUEUE));
+    YoriLibInitializeListHead(&Queue->CompletedItems);
+    Queue->WorkFn = WorkFn;
+    Queue->CompleteFn = CompleteFn;
+    Queue->Context = Context;
+
+    if (MaxWorkers == 0) {
+        GetSystemInfo(&SystemInfo);
+        MaxWorkers = SystemInfo.dwNumberOfProcessors;
+        if (MaxWorkers < 1) {
+            MaxWorkers = 1;
+        }
+    }
+
+    if (MaxQueued == 0) {
+        MaxQueued = MaxWorkers * 2;
+    }
+
+    if (CompleteFn != NULL) {
+        MaxQueued = MaxQueued + MaxWorkers;
+    }
+
+    Queue->MaxQueued = MaxQueued;
+
+    Queue->Mutex = CreateMutex(NULL, FALSE, NULL);
+    if (Queue->Mutex == NULL) {
+        return FALSE;
+    }
+
+    Queue->CompletionMutex = CreateMutex(NULL, FALSE, NULL);
+    if (Queue->CompletionMutex == NULL) {
+        return FALSE;
+    }
+
+    Queue->ItemsAvailable = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+    if (Queue->ItemsAvailable == NULL) {
+        return FALSE;
+    }
+
+    Queue->SlotsAvailable = CreateSemaphore(NULL, MaxQueued, MaxQueued, NULL);
+    if (Queue->SlotsAvailable == NULL) {
+        return FALSE;
+    }
+
+    Queue->ShutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (Queue->ShutdownEvent == NULL) {
+        return FALSE;
+    }
+
+    Queue->IdleEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
+    if (Queue->IdleEvent == NULL) {
+        return FALSE;
+    }
+
+    Queue->Workers = YoriLibMalloc(sizeof(YORI_LIB_WORK_QUEUE_WORKER) * MaxWorkers);
+    if (Queue->Workers == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(Queue->Workers, sizeof(YORI_LIB_WORK_QUEUE_WORKER) * MaxWorkers);
+    for (Index = 0; Index < MaxWorkers; Index++) {
+        YoriLibInitializeListHead(&Queue->Workers[Index].Items);
+        Queue->Workers[Index].Queue = Queue;
+        Queue->Workers[Index].Index = Index;
+        Queue->Workers[Index].Mutex = CreateMutex(NULL, FALSE, NULL);
+        if (Queue->Workers[Index].Mutex == NULL) {
+            return FALSE;
+        }
+        Queue->MaxWorkers++;
+    }
+
+    return TRUE;
+}
+
+/**
+ Submit an item to a work queue.  If the queue already has the maximum number
+ of items waiting for a worker, this call waits until a worker takes one, so
+ a caller cannot generate work faster than it can be processed.
+
+ @param Queue Pointer to the work queue.
+
+ @param Item Pointer to the item to submit.  This is typically embedded in a
+        larger caller structure.  On success, the item is owned by the queue
+        until it has been passed to the work or completion function.
+
+ @return TRUE to indicate the item was submitted, FALSE if it was not because
+         the operation was cancelled while waiting or no worker could be
+         created.  On failure, the caller retains ownership of the item.
+ */
+__success(return)
+BOOL
+YoriLibWorkQueueSubmit(
+    __in PYORI_LIB_WORK_QUEUE Queue,
+    __in PYORI_LIB_WORK_ITEM Item
+    )
+{
+    PYORI_LIB_WORK_QUEUE_WORKER Worker;
+    HANDLE WaitHandles[2];
+    DWORD HandleCount;
+    DWORD WaitResult;
+    DWORD ThreadId;
+
+    //
+    //  Wait for space in the queue, unless the user cancels the operation.
+    //
+
+    WaitHandles[0] = Queue->SlotsAvailable;
+    HandleCount = 1;
+    if (YoriLibCancelGetEvent() != NULL) {
+        WaitHandles[1] = YoriLibCancelGetEvent();
+        HandleCount++;
+    }
+
+    WaitResult = WaitForMultipleObjects(HandleCount, WaitHandles, FALSE, INFINITE);
+    if (WaitResult != WAIT_OBJECT_0) {
+        return FALSE;
+    }
+
+    WaitForSingleObject(Queue->Mutex, INFINITE);
+
+    //
+    //  Create a worker if none exist, or if items are waiting faster than
+    //  the existing workers can take them.
+    //
+
+    if (Queue->WorkersStarted == 0 ||
+        (Queue->ItemsOutstanding > Queue->WorkersStarted * 2 &&
+         Queue->WorkersStarted < Queue->MaxWorkers)) {
+
+        Worker = &Queue->Workers[Queue->WorkersStarted];
+        Worker->Thread = CreateThread(NULL, 0, YoriLibWorkQueueWorker, Worker, 0, &ThreadId);
+        if (Worker->Thread != NULL) {
+            Queue->WorkersStarted++;
+        }
+    }
+
+    if (Queue->WorkersStarted == 0) {
+        ReleaseMutex(Queue->Mutex);
+        ReleaseSemaphore(Queue->SlotsAvailable, 1, NULL);
+        return FALSE;
+    }
+
+    Item->Sequence = Queue->NextSequence;
+    Queue->NextSequence++;
+    Worker = &Queue->Workers[Queue->NextWorker % Queue->WorkersStarted];
+    Queue->NextWorker++;
+
+    if (Queue->ItemsOutstanding == 0) {
+        ResetEvent(Queue->IdleEvent);
+    }
+    Queue->ItemsOutstanding++;
+    ReleaseMutex(Queue->Mutex);
+
+    WaitForSingleObject(Worker->Mutex, INFINITE);
+    YoriLibAppendList(&Worker->Items, &Item->ListEntry);
+    ReleaseMutex(Worker->Mutex);
+
+    ReleaseSemaphore(Queue->ItemsAvailable, 1, NULL);
+    return TRUE;
+}
+
+/**
+ Wait for every item submitted to a work queue to be processed and, if the
+ queue has a completion function, completed.
+
+ @param Queue Pointer to the work queue.
+ */
+VOID
+YoriLibWorkQueueWaitForIdle(
+    __in PYORI_LIB_WORK_QUEUE Queue
+    )
+{
+    WaitForSingleObject(Queue->IdleEvent, INFINITE);
+}
+
+/**
+ Wait for all outstanding work in a work queue to be processed, terminate the
+ worker threads, and free the queue's internal allocations.  The queue
+ structure itself is not freed, since it is typically embedded in another
+ structure or on the stack.
+
+ @param Queue Pointer to the work queue to clean up.
+ */
+VOID
+YoriLibWorkQueueCleanup(
+    __in PYORI_LIB_WORK_QUEUE Queue
+    )
+{
+    DWORD Index;
+
+    if (Queue->WorkersStarted > 0) {
+        SetEvent(Queue->ShutdownEvent);
+        for (Index = 0; Index < Queue->WorkersStarted; Index++) {
+            WaitForSingleObject(Queue->Workers[Index].Thread, INFINITE);
+            CloseHandle(Queue->Workers[Index].Thread);
+            Queue->Workers[Index].Thread = NULL;
+        }
+        Queue->WorkersStarted = 0;
+        ASSERT(Queue->ItemsOutstanding == 0);
+    }
+
+    if (Queue->Workers != NULL) {
+        for (Index = 0; Index < Queue->MaxWorkers; Index++) {
+            ASSERT(YoriLibIsListEmpty(&Queue->Workers[Index].Items));
+            CloseHandle(Queue->Workers[Index].Mutex);
+        }
+        YoriLibFree(Queue->Workers);
+        Queue->Workers = NULL;
+        Queue->MaxWorkers = 0;
+    }
+
+    if (Queue->IdleEvent != NULL) {
+        CloseHandle(Queue->IdleEvent);
+        Queue->IdleEvent = NULL;
+    }
+    if (Queue->ShutdownEvent != NULL) {
+        CloseHandle(Queue->ShutdownEvent);
+        Queue->ShutdownEvent = NULL;
+    }
+    if (Queue->SlotsAvailable != NULL) {
+        CloseHandle(Queue->SlotsAvailable);
+        Queue->SlotsAvailable = NULL;
+    }
+    if (Queue->ItemsAvailable != NULL) {
+        CloseHandle(Queue->ItemsAvailable);
+        Queue->ItemsAvailable = NULL;
+    }
+    if (Queue->CompletionMutex != NULL) {
+        CloseHandle(Queue->CompletionMutex);
+        Queue->CompletionMutex = NULL;
+    }
+    if (Queue->Mutex != NULL) {
+        CloseHandle(Queue->Mutex);
+        Queue->Mutex = NULL;
+    }
+}
+
+// vim:sw=4:ts=4:et:
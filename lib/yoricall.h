@@ -119,6 +119,12 @@ YoriCallGetHistoryStrings(
     __out PYORI_STRING HistoryStrings
     );
 
+BOOL
+YoriCallGetJobAccounting(
+    __in DWORD JobId,
+    __out PYORI_LIB_JOB_ACCOUNTING Accounting
+    );
+
 BOOL
 YoriCallGetJobInformation(
     __in DWORD JobId,
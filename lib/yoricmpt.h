@@ -39,6 +39,14 @@
 #define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
 #endif
 
+#ifndef DISABLE_NEWLINE_AUTO_RETURN
+/**
+ If the console supports it, a newline moves to the next line without
+ returning to the first column.
+ */
+#define DISABLE_NEWLINE_AUTO_RETURN 0x0008
+#endif
+
 #ifndef ENABLE_QUICK_EDIT_MODE
 /**
  Mouse selection capability owned by the console.
@@ -145,6 +153,35 @@ typedef _Return_type_success_(return >= 0) long HRESULT;
 #define SE_MANAGE_VOLUME_NAME             _T("SeManageVolumePrivilege")
 #endif
 
+#ifndef FIND_FIRST_EX_LARGE_FETCH
+/**
+ Request FindFirstFileEx to use larger buffers when querying directory
+ contents, for compilation environments that don't define it.  Only
+ supported on Windows 7 and above.
+ */
+#define FIND_FIRST_EX_LARGE_FETCH         0x00000002
+#endif
+
+/**
+ The FindFirstFileEx information level that returns all data including
+ short file names.  This is FindExInfoStandard, defined here as a value so
+ that compilation environments without the enumeration can use it.
+ */
+#define YORI_FIND_EX_INFO_STANDARD        0
+
+/**
+ The FindFirstFileEx information level that does not return short file
+ names.  This is FindExInfoBasic, which is only supported on Windows 7 and
+ above.
+ */
+#define YORI_FIND_EX_INFO_BASIC           1
+
+/**
+ The FindFirstFileEx search operation that filters by name only.  This is
+ FindExSearchNameMatch.
+ */
+#define YORI_FIND_EX_SEARCH_NAME_MATCH    0
+
 /**
  Definition of an IO_STATUS_BLOCK for compilation environments that don't
  define it.
@@ -2874,6 +2911,59 @@ typedef struct _YORI_JOB_ASSOCIATE_COMPLETION_PORT {
     HANDLE Port;
 } YORI_JOB_ASSOCIATE_COMPLETION_PORT, *PYORI_JOB_ASSOCIATE_COMPLETION_PORT;
 
+/**
+ Structure to query basic accounting information about a job including IO
+ counters.
+ */
+typedef struct _YORI_JOB_BASIC_AND_IO_ACCOUNTING_INFORMATION {
+
+    /**
+     Basic accounting information about the job.
+     */
+    YORI_JOB_BASIC_ACCOUNTING_INFORMATION BasicInfo;
+
+    /**
+     IO counters for all processes that have executed within the job.
+     */
+    YORI_IO_COUNTERS IoInfo;
+} YORI_JOB_BASIC_AND_IO_ACCOUNTING_INFORMATION, *PYORI_JOB_BASIC_AND_IO_ACCOUNTING_INFORMATION;
+
+/**
+ Structure to query or change extended information about a job.
+ */
+typedef struct _YORI_JOB_EXTENDED_LIMIT_INFORMATION {
+
+    /**
+     Basic limit information about the job.
+     */
+    YORI_JOB_BASIC_LIMIT_INFORMATION BasicInfo;
+
+    /**
+     Field not needed/supported by YoriLib.
+     */
+    YORI_IO_COUNTERS Unused1;
+
+    /**
+     Field not needed/supported by YoriLib.
+     */
+    SIZE_T Unused2;
+
+    /**
+     Field not needed/supported by YoriLib.
+     */
+    SIZE_T Unused3;
+
+    /**
+     The largest amount of memory committed by any single process in the job.
+     */
+    SIZE_T PeakProcessMemoryUsed;
+
+    /**
+     The largest amount of memory committed by all processes in the job.
+     */
+    SIZE_T PeakJobMemoryUsed;
+} YORI_JOB_EXTENDED_LIMIT_INFORMATION, *PYORI_JOB_EXTENDED_LIMIT_INFORMATION;
+
 #ifndef HSHELL_RUDEAPPACTIVATED
 /**
  A definition for HSHELL_RUDEAPPACTIVATED if it is not defined by the current
@@ -4807,6 +4897,19 @@ CREATE_SYMBOLIC_LINKW(LPTSTR, LPTSTR, DWORD);
  */
 typedef CREATE_SYMBOLIC_LINKW *PCREATE_SYMBOLIC_LINKW;
 
+/**
+ A prototype for the FindFirstFileExW function.  The information level and
+ search operation are enumerations, which are passed as DWORDs.
+ */
+typedef
+HANDLE WINAPI
+FIND_FIRST_FILE_EXW(LPCWSTR, DWORD, LPVOID, DWORD, LPVOID, DWORD);
+
+/**
+ A prototype for a pointer to the FindFirstFileExW function.
+ */
+typedef FIND_FIRST_FILE_EXW *PFIND_FIRST_FILE_EXW;
+
 /**
  A prototype for the FindFirstStreamW function.
  */
@@ -5191,6 +5294,18 @@ REGISTER_APPLICATION_RESTART(LPCWSTR, DWORD);
  */
 typedef REGISTER_APPLICATION_RESTART *PREGISTER_APPLICATION_RESTART;
 
+/**
+ A prototype for the ReplaceFileW function.
+ */
+typedef
+BOOL WINAPI
+REPLACE_FILEW(LPCWSTR, LPCWSTR, LPCWSTR, DWORD, LPVOID, LPVOID);
+
+/**
+ A prototype for a pointer to the ReplaceFileW function.
+ */
+typedef REPLACE_FILEW *PREPLACE_FILEW;
+
 /**
  A prototype for the RtlCaptureStackBackTrace function.
  */
@@ -5323,6 +5438,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PCREATE_SYMBOLIC_LINKW pCreateSymbolicLinkW;
 
+    /**
+     If it's available on the current system, a pointer to FindFirstFileExW.
+     */
+    PFIND_FIRST_FILE_EXW pFindFirstFileExW;
+
     /**
      If it's available on the current system, a pointer to FindFirstStreamW.
      */
@@ -5483,6 +5603,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PREGISTER_APPLICATION_RESTART pRegisterApplicationRestart;
 
+    /**
+     If it's available on the current system, a pointer to ReplaceFileW.
+     */
+    PREPLACE_FILEW pReplaceFileW;
+
     /**
      If it's available on the current system, a pointer to RtlCaptureStackBackTrace.
      */
@@ -179,6 +179,75 @@ enum {
     YoriLibCompressionXpress16k
 } YoriLibCompressionAlgorithms;
 
+/**
+ Set in a file information session once GetFileInformationByHandle has been
+ attempted.
+ */
+#define YORI_LIB_FILE_INFO_SESSION_HANDLE_INFO         0x0001
+
+/**
+ Set in a file information session if GetFileInformationByHandle succeeded.
+ */
+#define YORI_LIB_FILE_INFO_SESSION_HANDLE_INFO_VALID   0x0002
+
+/**
+ Set in a file information session once the standard information has been
+ queried.
+ */
+#define YORI_LIB_FILE_INFO_SESSION_STANDARD_INFO       0x0004
+
+/**
+ Set in a file information session if the standard information query
+ succeeded.
+ */
+#define YORI_LIB_FILE_INFO_SESSION_STANDARD_INFO_VALID 0x0008
+
+/**
+ State shared between collection functions operating on a single file, so
+ that the file is opened once and each type of information is queried once
+ regardless of how many collection functions need it.
+ */
+typedef struct _YORI_LIB_FILE_INFO_SESSION {
+
+    /**
+     A handle to the file, or INVALID_HANDLE_VALUE if it has not been opened.
+     */
+    HANDLE FileHandle;
+
+    /**
+     The access to request when opening the file.  This is the union of the
+     access needed by the collection functions expected to run.
+     */
+    DWORD DesiredAccess;
+
+    /**
+     The access that FileHandle was opened with.
+     */
+    DWORD GrantedAccess;
+
+    /**
+     The most recent access mask that could not be opened, so it is not
+     retried by each collection function.
+     */
+    DWORD FailedAccess;
+
+    /**
+     A combination of YORI_LIB_FILE_INFO_SESSION_* flags indicating which
+     information has been queried.
+     */
+    DWORD QueriedInfo;
+
+    /**
+     The information returned from GetFileInformationByHandle.
+     */
+    BY_HANDLE_FILE_INFORMATION HandleInfo;
+
+    /**
+     The standard information about the file.
+     */
+    FILE_STANDARD_INFO StandardInfo;
+} YORI_LIB_FILE_INFO_SESSION, *PYORI_LIB_FILE_INFO_SESSION;
+
 /**
  Information about a single file.  This is typically only partially populated
  depending on the information of interest to the user.  Note this is expected
@@ -346,6 +415,13 @@ typedef struct _YORI_FILE_INFO {
      Pointer to the extension within the file name string.
      */
     TCHAR *       Extension;
+
+    /**
+     Optionally points to a session used to share a handle and queried
+     information between collection functions.  This is only valid while
+     the file is being collected.
+     */
+    PYORI_LIB_FILE_INFO_SESSION Session;
 } YORI_FILE_INFO, *PYORI_FILE_INFO;
 
 /**
@@ -362,6 +438,186 @@ typedef struct _YORI_FILE_INFO {
 #define YoriLibSubtractFromPointer(PTR, OFFSET) \
     (PVOID)(((PUCHAR)(PTR)) - (OFFSET))
 
+/**
+ A single item of work submitted to a work queue.  This is expected to be
+ embedded in a larger structure describing the work to perform.
+ */
+typedef struct _YORI_LIB_WORK_ITEM {
+
+    /**
+     The list linkage of the item while it is waiting for a worker or
+     waiting to be completed in order.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The order in which the item was submitted.
+     */
+    DWORD Sequence;
+
+    /**
+     The result returned from processing the item.
+     */
+    BOOL Result;
+} YORI_LIB_WORK_ITEM, *PYORI_LIB_WORK_ITEM;
+
+/**
+ A function to process an item on a worker thread.  The first parameter is
+ the queue context, the second is the item, and the third is TRUE if the
+ operation has been cancelled and the item should be discarded without
+ performing work.
+ */
+typedef BOOL (* YORI_LIB_WORK_QUEUE_FN)(PVOID, PYORI_LIB_WORK_ITEM, BOOL);
+
+/**
+ A function to invoke on items in submission order after they have been
+ processed.
+ */
+typedef VOID (* YORI_LIB_WORK_QUEUE_COMPLETE_FN)(PVOID, PYORI_LIB_WORK_ITEM);
+
+/**
+ Forward declaration of a work queue.
+ */
+typedef struct _YORI_LIB_WORK_QUEUE *PYORI_LIB_WORK_QUEUE;
+
+/**
+ State for a single worker thread in a work queue.
+ */
+typedef struct _YORI_LIB_WORK_QUEUE_WORKER {
+
+    /**
+     The list of items submitted to this worker.  Other workers can take
+     items from this list if their own lists are empty.
+     */
+    YORI_LIST_ENTRY Items;
+
+    /**
+     A mutex to synchronize the list of items.
+     */
+    HANDLE Mutex;
+
+    /**
+     A handle to the worker thread, or NULL if it has not been started.
+     */
+    HANDLE Thread;
+
+    /**
+     Pointer to the queue that this worker belongs to.
+     */
+    PYORI_LIB_WORK_QUEUE Queue;
+
+    /**
+     The index of this worker within the queue's array of workers.
+     */
+    DWORD Index;
+} YORI_LIB_WORK_QUEUE_WORKER, *PYORI_LIB_WORK_QUEUE_WORKER;
+
+/**
+ A queue of work processed by a pool of worker threads.
+ */
+typedef struct _YORI_LIB_WORK_QUEUE {
+
+    /**
+     An array of workers.  The number of elements is MaxWorkers.
+     */
+    PYORI_LIB_WORK_QUEUE_WORKER Workers;
+
+    /**
+     The maximum number of worker threads.
+     */
+    DWORD MaxWorkers;
+
+    /**
+     The number of worker threads that have been started.
+     */
+    DWORD WorkersStarted;
+
+    /**
+     The maximum number of items waiting for a worker before submission
+     blocks.  If the queue has a completion function, this also includes
+     items being processed or held for ordered completion.
+     */
+    DWORD MaxQueued;
+
+    /**
+     The worker to submit the next item to.
+     */
+    DWORD NextWorker;
+
+    /**
+     The sequence number to assign to the next submitted item.
+     */
+    DWORD NextSequence;
+
+    /**
+     The sequence number of the next item to pass to the completion function.
+     */
+    DWORD NextSequenceToComplete;
+
+    /**
+     The number of items that have been submitted but not fully processed.
+     */
+    DWORD ItemsOutstanding;
+
+    /**
+     The number of items whose work function returned FALSE.
+     */
+    LONG ItemsFailed;
+
+    /**
+     A mutex to synchronize worker creation and submission.
+     */
+    HANDLE Mutex;
+
+    /**
+     A mutex to synchronize in order completion.
+     */
+    HANDLE CompletionMutex;
+
+    /**
+     A semaphore with a count for each item waiting for a worker.
+     */
+    HANDLE ItemsAvailable;
+
+    /**
+     A semaphore with a count for each item that can be submitted without
+     waiting.  If the queue has a completion function, a count is returned
+     when the item is completed rather than when a worker takes it, so that
+     items waiting behind a slow item cannot accumulate without limit.
+     */
+    HANDLE SlotsAvailable;
+
+    /**
+     An event signalled when workers should terminate.
+     */
+    HANDLE ShutdownEvent;
+
+    /**
+     An event signalled when no items are outstanding.
+     */
+    HANDLE IdleEvent;
+
+    /**
+     A list of processed items waiting for earlier items to complete.
+     */
+    YORI_LIST_ENTRY CompletedItems;
+
+    /**
+     The function to process each item.
+     */
+    YORI_LIB_WORK_QUEUE_FN WorkFn;
+
+    /**
+     Optionally points to a function to complete items in order.
+     */
+    YORI_LIB_WORK_QUEUE_COMPLETE_FN CompleteFn;
+
+    /**
+     Caller context passed to WorkFn and CompleteFn.
+     */
+    PVOID Context;
+} YORI_LIB_WORK_QUEUE;
+
 #ifdef _M_IX86
 
 /**
@@ -932,31 +1188,10 @@ typedef union _YORILIB_COMPRESS_ALGORITHM {
  */
 typedef struct _YORILIB_COMPRESS_CONTEXT {
     /**
-     The list of files requiring compression.
-     */
-    YORI_LIST_ENTRY PendingList;
-
-    /**
-     A mutex to synchronize the list of files requiring compression.
+     The queue of files requiring compression and the threads processing
+     them.
      */
-    HANDLE Mutex;
-
-    /**
-     An event signalled when there is a file to be compressed inserted into
-     the list.
-     */
-    HANDLE WorkerWaitEvent;
-
-    /**
-     An event signalled when compression threads should complete outstanding
-     work then terminate.
-     */
-    HANDLE WorkerShutdownEvent;
-
-    /**
-     An array of handles to threads allocated to compress file contents.
-     */
-    PHANDLE Threads;
+    YORI_LIB_WORK_QUEUE WorkQueue;
 
     /**
      If the target should be written as compressed, this specifies the
@@ -964,23 +1199,6 @@ typedef struct _YORILIB_COMPRESS_CONTEXT {
      */
     YORILIB_COMPRESS_ALGORITHM CompressionAlgorithm;
 
-    /**
-     The maximum number of compress threads.  This corresponds to the size of
-     the Threads array.
-     */
-    DWORD MaxThreads;
-
-    /**
-     The number of threads allocated to compress file contents.  This is
-     less than or equal to MaxThreads.
-     */
-    DWORD ThreadsAllocated;
-
-    /**
-     The number of items currently queued in the list.
-     */
-    DWORD ItemsQueued;
-
     /**
      If TRUE, output is generated describing thread creation and throttling.
      */
@@ -1090,6 +1308,12 @@ typedef YORILIB_FILE_ENUM_FN *PYORILIB_FILE_ENUM_FN;
  */
 #define YORILIB_FILEENUM_DIRECTORY_CONTENTS      0x00000100
 
+/**
+ The caller does not need short file names, allowing the enumeration to
+ use a cheaper information level where the system supports it.
+ */
+#define YORILIB_FILEENUM_NO_SHORT_NAMES          0x00000200
+
 __success(return)
 BOOL
 YoriLibForEachFile(
@@ -1218,12 +1442,18 @@ YoriLibFileFiltParseColorString(
     __out PYORI_STRING ErrorSubstring
     );
 
+DWORD
+YoriLibFileFiltGetAccessNeeded(
+    __in PYORI_LIB_FILE_FILTER Filter
+    );
+
 __success(return)
 BOOL
 YoriLibFileFiltCheckFilterMatch(
     __in PYORI_LIB_FILE_FILTER Filter,
     __in PYORI_STRING FilePath,
-    __in PWIN32_FIND_DATA FileInfo
+    __in PWIN32_FIND_DATA FileInfo,
+    __in_opt PYORI_LIB_FILE_INFO_SESSION Session
     );
 
 __success(return)
@@ -1232,6 +1462,7 @@ YoriLibFileFiltCheckColorMatch(
     __in PYORI_LIB_FILE_FILTER Filter,
     __in PYORI_STRING FilePath,
     __in PWIN32_FIND_DATA FileInfo,
+    __in_opt PYORI_LIB_FILE_INFO_SESSION Session,
     __out PYORILIB_COLOR_ATTRIBUTES Attribute
     );
 
@@ -1320,6 +1551,31 @@ YoriLibIsExecutableGui(
     __in PYORI_STRING FullPath
     );
 
+VOID
+YoriLibFileInfoSessionInitialize(
+    __out PYORI_LIB_FILE_INFO_SESSION Session,
+    __in DWORD DesiredAccess
+    );
+
+VOID
+YoriLibFileInfoSessionCleanup(
+    __inout PYORI_LIB_FILE_INFO_SESSION Session
+    );
+
+DWORD
+YoriLibFileInfoAccessForCollectFn(
+    __in YORI_LIB_FILE_FILT_COLLECT_FN CollectFn
+    );
+
+__success(return)
+BOOL
+YoriLibFileInfoSessionUpdateFindData(
+    __inout PYORI_LIB_FILE_INFO_SESSION Session,
+    __out PWIN32_FIND_DATA FindData,
+    __in PYORI_STRING FullPath,
+    __in BOOL CopyName
+    );
+
 BOOL
 YoriLibCollectAccessTime (
     __inout PYORI_FILE_INFO Entry,
@@ -1911,6 +2167,105 @@ YoriLibGenerateWriteTime(
     __in PYORI_STRING String
     );
 
+// *** FILEMAP.C ***
+
+/**
+ The largest view of a file to map at any one time.  This must be a multiple
+ of the system allocation granularity.
+ */
+#define YORI_LIB_BYTE_SPAN_WINDOW_SIZE (32 * 1024 * 1024)
+
+/**
+ State for reading a stream as a series of spans of bytes.  Regular files
+ are mapped in windows of at most YORI_LIB_BYTE_SPAN_WINDOW_SIZE bytes, and
+ other streams are read into a buffer.
+ */
+typedef struct _YORI_LIB_BYTE_SPAN_READER {
+
+    /**
+     The stream being read.
+     */
+    HANDLE FileHandle;
+
+    /**
+     The file mapping object, or NULL if the stream is not mapped.
+     */
+    HANDLE MappingHandle;
+
+    /**
+     The currently mapped view of the file, or NULL if no view is mapped.
+     */
+    PUCHAR View;
+
+    /**
+     The buffer to read into if the stream is not mapped.
+     */
+    PUCHAR Buffer;
+
+    /**
+     The size of Buffer, in bytes.
+     */
+    DWORD BufferLength;
+
+    /**
+     The alignment required for the start of each view.
+     */
+    DWORD Granularity;
+
+    /**
+     The size of the file described by MappingHandle.
+     */
+    LARGE_INTEGER MappedSize;
+
+    /**
+     Pointer to the current span of bytes.
+     */
+    PUCHAR Span;
+
+    /**
+     The number of bytes in the current span.
+     */
+    DWORD SpanLength;
+
+    /**
+     The offset within the stream of the first byte in the current span.
+     */
+    LARGE_INTEGER SpanOffset;
+
+    /**
+     TRUE if the stream is mapped, FALSE if it is being read into a buffer.
+     */
+    BOOLEAN Mapped;
+
+    /**
+     TRUE once the end of the stream has been reached.
+     */
+    BOOLEAN EndOfStream;
+} YORI_LIB_BYTE_SPAN_READER, *PYORI_LIB_BYTE_SPAN_READER;
+
+VOID
+YoriLibEnableFileMapping();
+
+__success(return)
+BOOL
+YoriLibByteSpanReaderOpen(
+    __out PYORI_LIB_BYTE_SPAN_READER Reader,
+    __in HANDLE FileHandle,
+    __in_opt PLARGE_INTEGER StartOffset
+    );
+
+__success(return)
+BOOL
+YoriLibByteSpanReaderNext(
+    __inout PYORI_LIB_BYTE_SPAN_READER Reader,
+    __in DWORD BytesToRetain
+    );
+
+VOID
+YoriLibByteSpanReaderClose(
+    __inout PYORI_LIB_BYTE_SPAN_READER Reader
+    );
+
 // *** FULLPATH.C ***
 
 /**
@@ -2134,6 +2489,13 @@ YoriLibHashRemoveByKey(
  */
 #define YORI_LIB_HEX_FLAG_C_STYLE              (0x00000008)
 
+/**
+ If set, output only a continuous sequence of hex digits for each line, with
+ no offset, spacing or characters.  This takes precedence over other flags
+ and ignores the number of bytes per word.
+ */
+#define YORI_LIB_HEX_FLAG_RAW                  (0x00000010)
+
 BOOL
 YoriLibHexDump(
     __in LPCSTR Buffer,
@@ -2192,13 +2554,29 @@ YoriLibSetMultibyteInputEncoding(
     __in DWORD Encoding
     );
 
+DWORD
+YoriLibUtf16ToUtf8(
+    __in_ecount(InputBufferLength) LPCWSTR InputStringBuffer,
+    __in DWORD InputBufferLength,
+    __out_ecount(OutputBufferLength) LPSTR OutputStringBuffer,
+    __in DWORD OutputBufferLength
+    );
+
+DWORD
+YoriLibUtf8ToUtf16(
+    __in_ecount(InputBufferLength) LPCSTR InputStringBuffer,
+    __in DWORD InputBufferLength,
+    __out_ecount(OutputBufferLength) LPWSTR OutputStringBuffer,
+    __in DWORD OutputBufferLength
+    );
+
 DWORD
 YoriLibGetMultibyteOutputSizeNeeded(
     __in LPCTSTR StringBuffer,
     __in DWORD BufferLength
     );
 
-VOID
+DWORD
 YoriLibMultibyteOutput(
     __in_ecount(InputBufferLength) LPCTSTR InputStringBuffer,
     __in DWORD InputBufferLength,
@@ -2206,13 +2584,29 @@ YoriLibMultibyteOutput(
     __in DWORD OutputBufferLength
     );
 
+DWORD
+YoriLibGetMultibyteInputSizeNeededEx(
+    __in DWORD Encoding,
+    __in LPCSTR StringBuffer,
+    __in DWORD BufferLength
+    );
+
 DWORD
 YoriLibGetMultibyteInputSizeNeeded(
     __in LPCSTR StringBuffer,
     __in DWORD BufferLength
     );
 
-VOID
+DWORD
+YoriLibMultibyteInputEx(
+    __in DWORD Encoding,
+    __in_ecount(InputBufferLength) LPCSTR InputStringBuffer,
+    __in DWORD InputBufferLength,
+    __out_ecount(OutputBufferLength) LPTSTR OutputStringBuffer,
+    __in DWORD OutputBufferLength
+    );
+
+DWORD
 YoriLibMultibyteInput(
     __in_ecount(InputBufferLength) LPCSTR InputStringBuffer,
     __in DWORD InputBufferLength,
@@ -2220,8 +2614,123 @@ YoriLibMultibyteInput(
     __in DWORD OutputBufferLength
     );
 
+// *** INI.C ***
+
+VOID
+YoriLibIniClose(
+    __in PVOID IniHandle
+    );
+
+__success(return != NULL)
+PVOID
+YoriLibIniOpen(
+    __in PCYORI_STRING FileName
+    );
+
+__success(return)
+BOOL
+YoriLibIniGetString(
+    __in PVOID IniHandle,
+    __in PCYORI_STRING SectionName,
+    __in PCYORI_STRING Key,
+    __out PYORI_STRING Value
+    );
+
+PVOID
+YoriLibIniGetNextKey(
+    __in PVOID IniHandle,
+    __in PCYORI_STRING SectionName,
+    __in_opt PVOID PreviousKey,
+    __out PYORI_STRING Key,
+    __out PYORI_STRING Value
+    );
+
+PVOID
+YoriLibIniGetNextSection(
+    __in PVOID IniHandle,
+    __in_opt PVOID PreviousSection,
+    __out PYORI_STRING SectionName
+    );
+
+__success(return)
+BOOL
+YoriLibIniSetString(
+    __in PVOID IniHandle,
+    __in PCYORI_STRING SectionName,
+    __in PCYORI_STRING Key,
+    __in PCYORI_STRING Value
+    );
+
+BOOL
+YoriLibIniDelete(
+    __in PVOID IniHandle,
+    __in PCYORI_STRING SectionName,
+    __in_opt PCYORI_STRING Key
+    );
+
+__success(return)
+BOOL
+YoriLibIniWrite(
+    __in PVOID IniHandle
+    );
+
 // *** JOBOBJ.C ***
 
+/**
+ Resource usage of all processes that have executed within a job object.
+ */
+typedef struct _YORI_LIB_JOB_ACCOUNTING {
+
+    /**
+     The total amount of user mode processing consumed by the job, in 100ns
+     units.
+     */
+    LARGE_INTEGER UserTime;
+
+    /**
+     The total amount of kernel mode processing consumed by the job, in 100ns
+     units.
+     */
+    LARGE_INTEGER KernelTime;
+
+    /**
+     The number of bytes read by processes in the job.
+     */
+    DWORDLONG ReadBytes;
+
+    /**
+     The number of bytes written by processes in the job.
+     */
+    DWORDLONG WriteBytes;
+
+    /**
+     The number of bytes transferred by other IO requests from processes in
+     the job.
+     */
+    DWORDLONG OtherBytes;
+
+    /**
+     The largest amount of memory committed by any single process in the
+     job.
+     */
+    DWORDLONG PeakProcessMemoryUsed;
+
+    /**
+     The largest amount of memory committed by all processes in the job.
+     */
+    DWORDLONG PeakJobMemoryUsed;
+
+    /**
+     The total number of processes that have executed within the job.
+     */
+    DWORD TotalProcesses;
+
+    /**
+     The number of processes currently executing within the job.
+     */
+    DWORD ActiveProcesses;
+} YORI_LIB_JOB_ACCOUNTING, *PYORI_LIB_JOB_ACCOUNTING;
+
 HANDLE
 YoriLibCreateJobObject(
     );
@@ -2238,6 +2747,13 @@ YoriLibLimitJobObjectPriority(
     __in DWORD Priority
     );
 
+__success(return)
+BOOL
+YoriLibQueryJobObjectAccounting(
+    __in HANDLE hJob,
+    __out PYORI_LIB_JOB_ACCOUNTING Accounting
+    );
+
 // *** LICENSE.C ***
 
 BOOL
@@ -2275,6 +2791,13 @@ YoriLibReadLineToString(
     __in HANDLE FileHandle
     );
 
+__success(return)
+BOOL
+YoriLibLineReadCreateContext(
+    __in DWORD Encoding,
+    __out PVOID * Context
+    );
+
 PVOID
 YoriLibReadLineToStringEx(
     __in PYORI_STRING UserString,
@@ -3509,4 +4032,34 @@ YoriLibIsPathUrl(
 
 BOOL YoriLibIsStdInConsole();
 
+// *** WORKQ.C ***
+
+__success(return)
+BOOL
+YoriLibWorkQueueInitialize(
+    __out PYORI_LIB_WORK_QUEUE Queue,
+    __in DWORD MaxWorkers,
+    __in DWORD MaxQueued,
+    __in YORI_LIB_WORK_QUEUE_FN WorkFn,
+    __in_opt YORI_LIB_WORK_QUEUE_COMPLETE_FN CompleteFn,
+    __in_opt PVOID Context
+    );
+
+__success(return)
+BOOL
+YoriLibWorkQueueSubmit(
+    __in PYORI_LIB_WORK_QUEUE Queue,
+    __in PYORI_LIB_WORK_ITEM Item
+    );
+
+VOID
+YoriLibWorkQueueWaitForIdle(
+    __in PYORI_LIB_WORK_QUEUE Queue
+    );
+
+VOID
+YoriLibWorkQueueCleanup(
+    __in PYORI_LIB_WORK_QUEUE Queue
+    );
+
 // vim:sw=4:ts=4:et:
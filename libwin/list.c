@@ -29,6 +29,17 @@
 #include "yoriwin.h"
 #include "winpriv.h"
 
+/**
+ The maximum number of characters that can be typed to search for an item
+ in the list.
+ */
+#define YORI_WIN_LIST_SEARCH_MAX (64)
+
+/**
+ The number of milliseconds after a key is typed before the next key starts
+ a new search rather than extending the current one.
+ */
+#define YORI_WIN_LIST_SEARCH_TIMEOUT (1000)
 
 /**
  A structure describing the contents of a list control.
@@ -55,6 +66,49 @@ typedef struct _YORI_WIN_CTRL_LIST {
      */
     YORI_WIN_ITEM_ARRAY ItemArray;
 
+    /**
+     If non-NULL, the list does not store its items in ItemArray.  Instead
+     this callback is invoked to obtain the text of each item as it is
+     displayed.
+     */
+    PYORI_WIN_LIST_GET_ITEM_TEXT DataSourceCallback;
+
+    /**
+     Context to pass to DataSourceCallback.
+     */
+    PVOID DataSourceContext;
+
+    /**
+     The number of items available from DataSourceCallback.
+     */
+    DWORD DataSourceCount;
+
+    /**
+     The number of elements allocated in DataSourceFlags.
+     */
+    DWORD DataSourceFlagsAllocated;
+
+    /**
+     An array of flags for each item available from DataSourceCallback,
+     used to record selection on multiselect lists.
+     */
+    PUCHAR DataSourceFlags;
+
+    /**
+     The tick count when a key was last typed to search for an item.
+     */
+    DWORD LastSearchTick;
+
+    /**
+     The number of characters in SearchBuffer.
+     */
+    DWORD SearchLength;
+
+    /**
+     Characters typed to search for an item.
+     */
+    TCHAR SearchBuffer[YORI_WIN_LIST_SEARCH_MAX];
+
     /**
      The index within ItemArray of the first array element to display in the
      list
@@ -89,8 +143,146 @@ typedef struct _YORI_WIN_CTRL_LIST {
      */
     BOOLEAN DeselectOnLoseFocus;
 
+    /**
+     If TRUE, the items in the list are sorted by their text, so a search
+     for typed characters can be a binary search.
+     */
+    BOOLEAN ItemsSorted;
+
 } YORI_WIN_CTRL_LIST, *PYORI_WIN_CTRL_LIST;
 
+/**
+ Return the number of items in the list.
+
+ @param List Pointer to the list control.
+
+ @return The number of items in the list.
+ */
+DWORD
+YoriWinListGetItemCount(
+    __in PYORI_WIN_CTRL_LIST List
+    )
+{
+    if (List->DataSourceCallback != NULL) {
+        return List->DataSourceCount;
+    }
+    return List->ItemArray.Count;
+}
+
+/**
+ Obtain the text of an item in the list.  The returned string is not
+ allocated and should not be freed.  It is valid until the next item is
+ requested or the list is modified.
+
+ @param List Pointer to the list control.
+
+ @param Index Specifies the item to obtain.
+
+ @param Text On successful completion, updated to point to the text of the
+        item.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriWinListGetItemString(
+    __in PYORI_WIN_CTRL_LIST List,
+    __in DWORD Index,
+    __out PYORI_STRING Text
+    )
+{
+    if (List->DataSourceCallback != NULL) {
+        YoriLibInitEmptyString(Text);
+        if (Index >= List->DataSourceCount) {
+            return FALSE;
+        }
+        return List->DataSourceCallback(&List->Ctrl, List->DataSourceContext, Index, Text);
+    }
+
+    if (Index >= List->ItemArray.Count) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(Text);
+    Text->StartOfString = List->ItemArray.Items[Index].String.StartOfString;
+    Text->LengthInChars = List->ItemArray.Items[Index].String.LengthInChars;
+    return TRUE;
+}
+
+/**
+ Return TRUE if an item in a multiselect list is selected.
+
+ @param List Pointer to the list control.
+
+ @param Index Specifies the item to check.
+
+ @return TRUE if the item is selected, FALSE if it is not.
+ */
+BOOLEAN
+YoriWinListIsItemSelected(
+    __in PYORI_WIN_CTRL_LIST List,
+    __in DWORD Index
+    )
+{
+    if (List->DataSourceCallback != NULL) {
+        if (Index < List->DataSourceCount &&
+            (List->DataSourceFlags[Index] & YORI_WIN_ITEM_SELECTED)) {
+
+            return TRUE;
+        }
+        return FALSE;
+    }
+
+    if (Index < List->ItemArray.Count &&
+        (List->ItemArray.Items[Index].Flags & YORI_WIN_ITEM_SELECTED)) {
+
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ Toggle whether an item in a multiselect list is selected.
+
+ @param List Pointer to the list control.
+
+ @param Index Specifies the item to toggle.
+ */
+VOID
+YoriWinListToggleItemSelected(
+    __in PYORI_WIN_CTRL_LIST List,
+    __in DWORD Index
+    )
+{
+    if (List->DataSourceCallback != NULL) {
+        ASSERT(Index < List->DataSourceCount);
+        List->DataSourceFlags[Index] = (UCHAR)(List->DataSourceFlags[Index] ^ YORI_WIN_ITEM_SELECTED);
+    } else {
+        ASSERT(Index < List->ItemArray.Count);
+        List->ItemArray.Items[Index].Flags = List->ItemArray.Items[Index].Flags ^ YORI_WIN_ITEM_SELECTED;
+    }
+}
+
+/**
+ Discard any data source associated with the list.
+
+ @param List Pointer to the list control.
+ */
+VOID
+YoriWinListCleanupDataSource(
+    __in PYORI_WIN_CTRL_LIST List
+    )
+{
+    if (List->DataSourceFlags != NULL) {
+        YoriLibFree(List->DataSourceFlags);
+        List->DataSourceFlags = NULL;
+    }
+    List->DataSourceFlagsAllocated = 0;
+    List->DataSourceCount = 0;
+    List->DataSourceCallback = NULL;
+    List->DataSourceContext = NULL;
+}
+
 /**
  Move the first displayed option in the list to ensure that the currently
  selected item is within the display.
@@ -112,8 +304,8 @@ YoriWinListEnsureActiveItemVisible(
     YoriWinGetControlClientSize(&List->Ctrl, &ClientSize);
     ElementCountToDisplay = ClientSize.Y;
 
-    if (List->ItemArray.Count < ElementCountToDisplay) {
-        ElementCountToDisplay = (WORD)List->ItemArray.Count;
+    if (YoriWinListGetItemCount(List) < ElementCountToDisplay) {
+        ElementCountToDisplay = (WORD)YoriWinListGetItemCount(List);
     }
 
     if (List->ActiveOption < List->FirstDisplayedOption) {
@@ -146,19 +338,21 @@ YoriWinListPaint(
     WORD ElementCountToDisplay;
     WORD Attributes;
     WORD WindowAttributes;
-    PYORI_WIN_ITEM_ENTRY Element;
+    YORI_STRING ItemText;
     COORD ClientSize;
 
     WindowAttributes = List->Ctrl.DefaultAttributes;
     YoriWinGetControlClientSize(&List->Ctrl, &ClientSize);
     ElementCountToDisplay = ClientSize.Y;
 
-    if (List->ItemArray.Count < ElementCountToDisplay) {
-        ElementCountToDisplay = (WORD)List->ItemArray.Count;
+    if (YoriWinListGetItemCount(List) < ElementCountToDisplay) {
+        ElementCountToDisplay = (WORD)YoriWinListGetItemCount(List);
     }
 
     for (RowIndex = 0; RowIndex < ElementCountToDisplay; RowIndex++) {
-        Element = &List->ItemArray.Items[List->FirstDisplayedOption + RowIndex];
+        if (!YoriWinListGetItemString(List, List->FirstDisplayedOption + RowIndex, &ItemText)) {
+            YoriLibInitEmptyString(&ItemText);
+        }
         Attributes = WindowAttributes;
         if (List->ItemActive &&
             RowIndex + List->FirstDisplayedOption == List->ActiveOption) {
@@ -167,17 +361,17 @@ YoriWinListPaint(
         }
         if (List->MultiSelect) {
             CharsToDisplay = (WORD)(ClientSize.X - 2);
-            if (CharsToDisplay > Element->String.LengthInChars) {
-                CharsToDisplay = (WORD)Element->String.LengthInChars;
+            if (CharsToDisplay > ItemText.LengthInChars) {
+                CharsToDisplay = (WORD)ItemText.LengthInChars;
             }
-            if (Element->Flags & YORI_WIN_ITEM_SELECTED) {
+            if (YoriWinListIsItemSelected(List, List->FirstDisplayedOption + RowIndex)) {
                 YoriWinSetControlClientCell(&List->Ctrl, 0, RowIndex, '*', Attributes);
             } else {
                 YoriWinSetControlClientCell(&List->Ctrl, 0, RowIndex, ' ', Attributes);
             }
             YoriWinSetControlClientCell(&List->Ctrl, 1, RowIndex, ' ', Attributes);
             for (CellIndex = 0; CellIndex < CharsToDisplay; CellIndex++) {
-                YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellIndex + 2), RowIndex, Element->String.StartOfString[CellIndex], Attributes);
+                YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellIndex + 2), RowIndex, ItemText.StartOfString[CellIndex], Attributes);
             }
             for (;CellIndex < ClientSize.X - 2; CellIndex++) {
                 YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellIndex + 2), RowIndex, ' ', Attributes);
@@ -185,11 +379,11 @@ YoriWinListPaint(
 
         } else {
             CharsToDisplay = ClientSize.X;
-            if (CharsToDisplay > Element->String.LengthInChars) {
-                CharsToDisplay = (WORD)Element->String.LengthInChars;
+            if (CharsToDisplay > ItemText.LengthInChars) {
+                CharsToDisplay = (WORD)ItemText.LengthInChars;
             }
             for (CellIndex = 0; CellIndex < CharsToDisplay; CellIndex++) {
-                YoriWinSetControlClientCell(&List->Ctrl, CellIndex, RowIndex, Element->String.StartOfString[CellIndex], Attributes);
+                YoriWinSetControlClientCell(&List->Ctrl, CellIndex, RowIndex, ItemText.StartOfString[CellIndex], Attributes);
             }
             for (;CellIndex < ClientSize.X; CellIndex++) {
                 YoriWinSetControlClientCell(&List->Ctrl, CellIndex, RowIndex, ' ', Attributes);
@@ -209,8 +403,8 @@ YoriWinListPaint(
 
     if (List->VScrollCtrl) {
         DWORD MaximumTopValue;
-        if (List->ItemArray.Count > (DWORD)ClientSize.Y) {
-            MaximumTopValue = List->ItemArray.Count - ClientSize.Y;
+        if (YoriWinListGetItemCount(List) > (DWORD)ClientSize.Y) {
+            MaximumTopValue = YoriWinListGetItemCount(List) - ClientSize.Y;
         } else {
             MaximumTopValue = 0;
         }
@@ -252,6 +446,7 @@ YoriWinListClearAllItems(
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
 
     YoriWinItemArrayCleanup(&List->ItemArray);
+    YoriWinListCleanupDataSource(List);
     List->FirstDisplayedOption = 0;
     List->ActiveOption = 0;
     if (List->ItemActive) {
@@ -296,16 +491,16 @@ YoriWinListNotifyScrollChange(
     ElementCountToDisplay = ClientSize.Y;
 
     ScrollValue = YoriWinScrollBarGetPosition(ScrollCtrl);
-    ASSERT(ScrollValue <= List->ItemArray.Count);
-    if (ScrollValue + ElementCountToDisplay > List->ItemArray.Count) {
-        if (List->ItemArray.Count >= ElementCountToDisplay) {
-            List->FirstDisplayedOption = List->ItemArray.Count - ElementCountToDisplay;
+    ASSERT(ScrollValue <= YoriWinListGetItemCount(List));
+    if (ScrollValue + ElementCountToDisplay > YoriWinListGetItemCount(List)) {
+        if (YoriWinListGetItemCount(List) >= ElementCountToDisplay) {
+            List->FirstDisplayedOption = YoriWinListGetItemCount(List) - ElementCountToDisplay;
         } else {
             List->FirstDisplayedOption = 0;
         }
     } else {
 
-        if (ScrollValue < List->ItemArray.Count) {
+        if (ScrollValue < YoriWinListGetItemCount(List)) {
             List->FirstDisplayedOption = (DWORD)ScrollValue;
         }
     }
@@ -343,9 +538,9 @@ YoriWinListNotifyMouseWheel(
             List->FirstDisplayedOption = List->FirstDisplayedOption - LinesToMove;
         }
     } else {
-        if (List->FirstDisplayedOption + LinesToMove + ElementCountToDisplay > List->ItemArray.Count) {
-            if (List->ItemArray.Count >= ElementCountToDisplay) {
-                List->FirstDisplayedOption = List->ItemArray.Count - ElementCountToDisplay;
+        if (List->FirstDisplayedOption + LinesToMove + ElementCountToDisplay > YoriWinListGetItemCount(List)) {
+            if (YoriWinListGetItemCount(List) >= ElementCountToDisplay) {
+                List->FirstDisplayedOption = YoriWinListGetItemCount(List) - ElementCountToDisplay;
             } else {
                 List->FirstDisplayedOption = 0;
             }
@@ -357,6 +552,115 @@ YoriWinListNotifyMouseWheel(
 }
 
 
+/**
+ Process a typed character by searching for the first item whose text starts
+ with the characters typed recently.  If the list is sorted, this is a binary
+ search.  Otherwise items are scanned from the active item, and typing the
+ same first character repeatedly moves between items starting with it.
+
+ @param List Pointer to the list control.
+
+ @param Char The character that was typed.
+ */
+VOID
+YoriWinListTypeAhead(
+    __in PYORI_WIN_CTRL_LIST List,
+    __in TCHAR Char
+    )
+{
+    YORI_STRING Prefix;
+    YORI_STRING ItemText;
+    DWORD ItemCount;
+    DWORD CurrentTick;
+    DWORD Low;
+    DWORD High;
+    DWORD Mid;
+    DWORD Index;
+    DWORD Start;
+    BOOLEAN Found;
+
+    ItemCount = YoriWinListGetItemCount(List);
+    if (ItemCount == 0) {
+        return;
+    }
+
+    CurrentTick = GetTickCount();
+    if (CurrentTick - List->LastSearchTick > YORI_WIN_LIST_SEARCH_TIMEOUT) {
+        List->SearchLength = 0;
+    }
+    List->LastSearchTick = CurrentTick;
+
+    if (List->SearchLength < YORI_WIN_LIST_SEARCH_MAX) {
+        List->SearchBuffer[List->SearchLength] = Char;
+        List->SearchLength++;
+    }
+
+    YoriLibInitEmptyString(&Prefix);
+    Prefix.StartOfString = List->SearchBuffer;
+    Prefix.LengthInChars = List->SearchLength;
+
+    Found = FALSE;
+    Index = 0;
+
+    if (List->ItemsSorted) {
+
+        //
+        //  Find the first item which is not less than the prefix.  If it
+        //  starts with the prefix, it's the match.
+        //
+
+        Low = 0;
+        High = ItemCount;
+        while (Low < High) {
+            Mid = Low + (High - Low) / 2;
+            if (!YoriWinListGetItemString(List, Mid, &ItemText)) {
+                return;
+            }
+            if (YoriLibCompareStringInsensitiveCount(&ItemText, &Prefix, Prefix.LengthInChars) < 0) {
+                Low = Mid + 1;
+            } else {
+                High = Mid;
+            }
+        }
+
+        if (Low < ItemCount &&
+            YoriWinListGetItemString(List, Low, &ItemText) &&
+            YoriLibCompareStringInsensitiveCount(&ItemText, &Prefix, Prefix.LengthInChars) == 0) {
+
+            Found = TRUE;
+            Index = Low;
+        }
+    } else {
+        Start = 0;
+        if (List->ItemActive) {
+            Start = List->ActiveOption;
+            if (List->SearchLength == 1) {
+                Start++;
+            }
+        }
+
+        for (Mid = 0; Mid < ItemCount; Mid++) {
+            Index = (Start + Mid) % ItemCount;
+            if (YoriWinListGetItemString(List, Index, &ItemText) &&
+                YoriLibCompareStringInsensitiveCount(&ItemText, &Prefix, Prefix.LengthInChars) == 0) {
+
+                Found = TRUE;
+                break;
+            }
+        }
+    }
+
+    if (Found) {
+        List->ItemActive = TRUE;
+        List->ActiveOption = Index;
+        YoriWinListEnsureActiveItemVisible(List);
+        if (List->SelectionChangeCallback) {
+            List->SelectionChangeCallback(&List->Ctrl);
+        }
+        YoriWinListPaint(List);
+    }
+}
+
 /**
  Process input events for a list control.
 
@@ -393,7 +697,7 @@ YoriWinListEventHandler(
                             }
                             YoriWinListPaint(List);
                         }
-                    } else if (List->ItemArray.Count > 0) {
+                    } else if (YoriWinListGetItemCount(List) > 0) {
                         List->ItemActive = TRUE;
                         List->ActiveOption = 0;
                         YoriWinListEnsureActiveItemVisible(List);
@@ -404,7 +708,7 @@ YoriWinListEventHandler(
                     }
                 } else if (Event->KeyDown.VirtualKeyCode == VK_DOWN) {
                     if (List->ItemActive) {
-                        if (List->ActiveOption + 1 < List->ItemArray.Count) {
+                        if (List->ActiveOption + 1 < YoriWinListGetItemCount(List)) {
                             List->ActiveOption++;
                             YoriWinListEnsureActiveItemVisible(List);
                             if (List->SelectionChangeCallback) {
@@ -412,7 +716,7 @@ YoriWinListEventHandler(
                             }
                             YoriWinListPaint(List);
                         }
-                    } else if (List->ItemArray.Count > 0) {
+                    } else if (YoriWinListGetItemCount(List) > 0) {
                         List->ItemActive = TRUE;
                         List->ActiveOption = 0;
                         YoriWinListEnsureActiveItemVisible(List);
@@ -434,7 +738,7 @@ YoriWinListEventHandler(
                         } else {
                             List->ActiveOption = 0;
                         }
-                    } else if (List->ItemArray.Count > 0) {
+                    } else if (YoriWinListGetItemCount(List) > 0) {
                         List->ItemActive = TRUE;
                         List->ActiveOption = 0;
                     }
@@ -450,14 +754,14 @@ YoriWinListEventHandler(
                         YoriWinGetControlClientSize(&List->Ctrl, &ClientSize);
                         ElementCountToDisplay = ClientSize.Y;
                         if (List->ActiveOption < List->FirstDisplayedOption + ElementCountToDisplay - 1 &&
-                            List->FirstDisplayedOption + ElementCountToDisplay - 1 < List->ItemArray.Count) {
+                            List->FirstDisplayedOption + ElementCountToDisplay - 1 < YoriWinListGetItemCount(List)) {
                             List->ActiveOption = List->FirstDisplayedOption + ElementCountToDisplay - 1;
-                        } else if (List->ActiveOption + ElementCountToDisplay < List->ItemArray.Count) {
+                        } else if (List->ActiveOption + ElementCountToDisplay < YoriWinListGetItemCount(List)) {
                             List->ActiveOption = List->ActiveOption + ElementCountToDisplay;
                         } else {
-                            List->ActiveOption = List->ItemArray.Count - 1;
+                            List->ActiveOption = YoriWinListGetItemCount(List) - 1;
                         }
-                    } else if (List->ItemArray.Count > 0) {
+                    } else if (YoriWinListGetItemCount(List) > 0) {
                         List->ItemActive = TRUE;
                         List->ActiveOption = 0;
                     }
@@ -469,31 +773,30 @@ YoriWinListEventHandler(
                 } else if (Event->KeyDown.Char == ' ' &&
                            List->ItemActive &&
                            List->MultiSelect) {
-                    PYORI_WIN_ITEM_ENTRY Element;
 
-                    ASSERT(List->ActiveOption < List->ItemArray.Count);
-                    Element = &List->ItemArray.Items[List->ActiveOption];
-                    Element->Flags = Element->Flags ^ YORI_WIN_ITEM_SELECTED;
+                    YoriWinListToggleItemSelected(List, List->ActiveOption);
                     if (List->SelectionChangeCallback) {
                         List->SelectionChangeCallback(&List->Ctrl);
                     }
                     YoriWinListPaint(List);
+                } else if (Event->KeyDown.Char >= ' ') {
+                    YoriWinListTypeAhead(List, Event->KeyDown.Char);
                 }
+            } else if (Event->KeyDown.CtrlMask == SHIFT_PRESSED &&
+                       Event->KeyDown.Char >= ' ') {
+                YoriWinListTypeAhead(List, Event->KeyDown.Char);
             }
             break;
         case YoriWinEventMouseDownInClient:
-            if (Event->MouseDown.Location.Y + List->FirstDisplayedOption < List->ItemArray.Count) {
+            if (Event->MouseDown.Location.Y + List->FirstDisplayedOption < YoriWinListGetItemCount(List)) {
                 DWORD NewOption;
-                PYORI_WIN_ITEM_ENTRY Element;
 
                 NewOption = List->FirstDisplayedOption + Event->MouseDown.Location.Y;
 
                 List->ItemActive = TRUE;
                 if (List->ActiveOption == NewOption && List->MultiSelect) {
-
-                    Element = &List->ItemArray.Items[List->ActiveOption];
-                    Element->Flags = Element->Flags ^ YORI_WIN_ITEM_SELECTED;
-                } 
+                    YoriWinListToggleItemSelected(List, List->ActiveOption);
+                }
                 List->ActiveOption = List->FirstDisplayedOption + Event->MouseDown.Location.Y;
                 if (List->SelectionChangeCallback) {
                     List->SelectionChangeCallback(&List->Ctrl);
@@ -503,17 +806,15 @@ YoriWinListEventHandler(
 
             break;
         case YoriWinEventMouseDoubleClickInClient:
-            if (Event->MouseDown.Location.Y + List->FirstDisplayedOption < List->ItemArray.Count) {
+            if (Event->MouseDown.Location.Y + List->FirstDisplayedOption < YoriWinListGetItemCount(List)) {
                 YORI_WIN_EVENT DefaultEvent;
                 DWORD NewOption;
-                PYORI_WIN_ITEM_ENTRY Element;
 
                 NewOption = List->FirstDisplayedOption + Event->MouseDown.Location.Y;
                 List->ItemActive = TRUE;
                 List->ActiveOption = NewOption;
                 if (List->MultiSelect) {
-                    Element = &List->ItemArray.Items[List->ActiveOption];
-                    Element->Flags = Element->Flags ^ YORI_WIN_ITEM_SELECTED;
+                    YoriWinListToggleItemSelected(List, List->ActiveOption);
                 }
 
                 if (List->SelectionChangeCallback) {
@@ -581,6 +882,7 @@ YoriWinListEventHandler(
 
         case YoriWinEventParentDestroyed:
             YoriWinItemArrayCleanup(&List->ItemArray);
+            YoriWinListCleanupDataSource(List);
             YoriWinDestroyControl(Ctrl);
             YoriLibDereference(List);
             break;
@@ -638,7 +940,7 @@ YoriWinListSetActiveOption(
     Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
 
-    if (ActiveOption < List->ItemArray.Count) {
+    if (ActiveOption < YoriWinListGetItemCount(List)) {
         List->ItemActive = TRUE;
         List->ActiveOption = ActiveOption;
         YoriWinListEnsureActiveItemVisible(List);
@@ -674,9 +976,9 @@ YoriWinListIsOptionSelected(
     Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
 
-    if (Index < List->ItemArray.Count) {
+    if (Index < YoriWinListGetItemCount(List)) {
         if (List->MultiSelect) {
-            if (List->ItemArray.Items[Index].Flags & YORI_WIN_ITEM_SELECTED) {
+            if (YoriWinListIsItemSelected(List, Index)) {
                 return TRUE;
             }
         } else {
@@ -715,6 +1017,10 @@ YoriWinListAddItems(
     Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
 
+    if (List->DataSourceCallback != NULL) {
+        return FALSE;
+    }
+
     if (!YoriWinItemArrayAddItems(&List->ItemArray, ListOptions, NumberOptions)) {
         return FALSE;
     }
@@ -746,6 +1052,10 @@ YoriWinListAddItemArray(
     Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
 
+    if (List->DataSourceCallback != NULL) {
+        return FALSE;
+    }
+
     if (!YoriWinItemArrayAddItemArray(&List->ItemArray, NewItems)) {
         return FALSE;
     }
@@ -755,6 +1065,159 @@ YoriWinListAddItemArray(
     return TRUE;
 }
 
+/**
+ Configure the list to obtain its items from a callback rather than storing
+ them.  The callback is only invoked for items as they are displayed or
+ searched, so a list with a very large number of items can be displayed
+ without copying each of them.  Any existing items are removed.
+
+ @param CtrlHandle Pointer to the list control.
+
+ @param Callback Pointer to a function to invoke to obtain the text of an
+        item.
+
+ @param Context Context to pass to the callback.
+
+ @param ItemCount The number of items initially available from the callback.
+        This can be increased later with @ref YoriWinListSetItemCount .
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriWinListSetDataSource(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in PYORI_WIN_LIST_GET_ITEM_TEXT Callback,
+    __in_opt PVOID Context,
+    __in DWORD ItemCount
+    )
+{
+    PYORI_WIN_CTRL Ctrl;
+    PYORI_WIN_CTRL_LIST List;
+
+    Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
+    List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
+
+    YoriWinItemArrayCleanup(&List->ItemArray);
+    YoriWinListCleanupDataSource(List);
+
+    List->DataSourceCallback = Callback;
+    List->DataSourceContext = Context;
+    List->FirstDisplayedOption = 0;
+    List->ActiveOption = 0;
+    if (List->ItemActive) {
+        List->ItemActive = FALSE;
+        if (List->SelectionChangeCallback) {
+            List->SelectionChangeCallback(&List->Ctrl);
+        }
+    }
+
+    return YoriWinListSetItemCount(CtrlHandle, ItemCount);
+}
+
+/**
+ Change the number of items available from a list's data source callback.
+ This allows items to be appended while they are still being enumerated.
+
+ @param CtrlHandle Pointer to the list control.
+
+ @param ItemCount The number of items available from the callback.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriWinListSetItemCount(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in DWORD ItemCount
+    )
+{
+    PYORI_WIN_CTRL Ctrl;
+    PYORI_WIN_CTRL_LIST List;
+
+    Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
+    List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
+
+    if (List->DataSourceCallback == NULL) {
+        return FALSE;
+    }
+
+    //
+    //  Grow the flags array geometrically so that repeated appends don't
+    //  copy it each time.
+    //
+
+    if (ItemCount > List->DataSourceFlagsAllocated) {
+        PUCHAR NewFlags;
+        DWORD NewAllocated;
+
+        NewAllocated = List->DataSourceFlagsAllocated * 2;
+        if (NewAllocated < ItemCount) {
+            NewAllocated = ItemCount;
+        }
+        if (NewAllocated < 0x1000) {
+            NewAllocated = 0x1000;
+        }
+
+        NewFlags = YoriLibMalloc(NewAllocated * sizeof(UCHAR));
+        if (NewFlags == NULL) {
+            return FALSE;
+        }
+
+        if (List->DataSourceFlags != NULL) {
+            memcpy(NewFlags, List->DataSourceFlags, List->DataSourceCount * sizeof(UCHAR));
+            YoriLibFree(List->DataSourceFlags);
+        }
+        List->DataSourceFlags = NewFlags;
+        List->DataSourceFlagsAllocated = NewAllocated;
+    }
+
+    if (ItemCount > List->DataSourceCount) {
+        ZeroMemory(&List->DataSourceFlags[List->DataSourceCount], (ItemCount - List->DataSourceCount) * sizeof(UCHAR));
+    }
+
+    List->DataSourceCount = ItemCount;
+
+    if (List->FirstDisplayedOption >= ItemCount) {
+        List->FirstDisplayedOption = 0;
+    }
+
+    if (List->ItemActive && List->ActiveOption >= ItemCount) {
+        List->ItemActive = FALSE;
+        List->ActiveOption = 0;
+        if (List->SelectionChangeCallback) {
+            List->SelectionChangeCallback(&List->Ctrl);
+        }
+    }
+
+    YoriWinListEnsureActiveItemVisible(List);
+    YoriWinListPaint(List);
+    return TRUE;
+}
+
+/**
+ Indicate whether the items in the list are sorted by their text.  When they
+ are, searching for typed characters can use a binary search.
+
+ @param CtrlHandle Pointer to the list control.
+
+ @param ItemsSorted TRUE if the items are sorted by text, FALSE if they are
+        not.
+ */
+VOID
+YoriWinListSetItemsSorted(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in BOOLEAN ItemsSorted
+    )
+{
+    PYORI_WIN_CTRL Ctrl;
+    PYORI_WIN_CTRL_LIST List;
+
+    Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
+    List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
+    List->ItemsSorted = ItemsSorted;
+}
+
 /**
  Return the text within a specified element of a list control.
 
@@ -777,16 +1240,17 @@ YoriWinListGetItemText(
 {
     PYORI_WIN_CTRL Ctrl;
     PYORI_WIN_CTRL_LIST List;
+    YORI_STRING SourceString;
     PYORI_STRING Source;
 
     Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
 
-    if (Index >= List->ItemArray.Count) {
+    if (!YoriWinListGetItemString(List, Index, &SourceString)) {
         return FALSE;
     }
 
-    Source = &List->ItemArray.Items[Index].String;
+    Source = &SourceString;
 
     if (Text->LengthAllocated < Source->LengthInChars + 1) {
         YORI_STRING NewString;
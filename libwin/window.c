@@ -97,6 +97,51 @@ typedef struct _YORI_WIN_WINDOW {
      */
     PCHAR_INFO Contents;
 
+    /**
+     An array of cells describing the contents of the window as they were
+     most recently written to the console.  When this is valid, it is
+     compared against Contents so only changed cells are written.
+     */
+    PCHAR_INFO DisplayedContents;
+
+    /**
+     A buffer used to construct VT sequences when the window manager is
+     configured to display via VT rather than by writing cells.
+     */
+    YORI_STRING VtBuffer;
+
+    /**
+     The attribute most recently emitted into VtBuffer, or -1 if no
+     attribute has been emitted.
+     */
+    DWORD VtAttribute;
+
+#if DBG
+    /**
+     The number of cells written to the console by the display operation
+     that is currently in progress.
+     */
+    DWORD DbgCellsWrittenThisFlush;
+
+    /**
+     The number of cells written to the console by the most recently
+     completed display operation, to allow the effectiveness of comparing
+     against DisplayedContents to be inspected from a debugger.
+     */
+    DWORD DbgCellsWrittenLastFlush;
+
+    /**
+     The number of display operations which wrote at least one cell.
+     */
+    DWORD DbgFlushCount;
+
+    /**
+     The total number of cells written to the console over the lifetime of
+     the window.
+     */
+    DWORDLONG DbgTotalCellsWritten;
+#endif
+
     /**
      The control that currently has keyboard focus.  This can be NULL if no
      control currently has keyboard focus.
@@ -210,6 +255,13 @@ typedef struct _YORI_WIN_WINDOW {
      */
     BOOLEAN Hidden;
 
+    /**
+     If TRUE, DisplayedContents reflects what is currently on the console
+     for this window.  If FALSE, the next display writes the entire dirty
+     region without comparing.
+     */
+    BOOLEAN DisplayedContentsValid;
+
     /**
      If TRUE, SavedCursorInfo contains state about the cursor when the window
      was launched.  This can be restored when the window is destroyed.
@@ -502,7 +554,145 @@ YoriWinSetWindowClientCell(
 
 
 /**
- Display the window buffer into the console.
+ When comparing the window contents against the cells most recently written
+ to the console, changed regions on a row which are separated by fewer than
+ this many unchanged cells are written as a single region, since an extra
+ console call costs more than rewriting a few unchanged cells.
+ */
+#define YORI_WIN_DISPLAY_SPAN_GAP (8)
+
+/**
+ Return TRUE if two console cells have the same character and attributes.
+ */
+#define YoriWinCellsEqual(A, B) \
+    ((A)->Char.UnicodeChar == (B)->Char.UnicodeChar && (A)->Attributes == (B)->Attributes)
+
+/**
+ Append VT sequences describing a region of the window to the window's VT
+ buffer.  The buffer is assumed to have been sized by the caller to hold
+ the entire dirty region.
+
+ @param Window Pointer to the window.
+
+ @param Region The region to append, in window coordinates, inclusive.
+ */
+VOID
+YoriWinAppendVtForRegion(
+    __in PYORI_WIN_WINDOW Window,
+    __in PSMALL_RECT Region
+    )
+{
+    TCHAR EscapeStringBuffer[YORI_MAX_INTERNAL_VT_ESCAPE_CHARS];
+    YORI_STRING EscapeString;
+    PYORI_STRING VtBuffer;
+    SMALL_RECT WinMgrRect;
+    PCHAR_INFO Cell;
+    TCHAR Char;
+    SHORT X;
+    SHORT Y;
+
+    YoriLibInitEmptyString(&EscapeString);
+    EscapeString.StartOfString = EscapeStringBuffer;
+    EscapeString.LengthAllocated = sizeof(EscapeStringBuffer)/sizeof(EscapeStringBuffer[0]);
+
+    YoriWinGetWinMgrLocation(Window->WinMgrHandle, &WinMgrRect);
+    VtBuffer = &Window->VtBuffer;
+
+    for (Y = Region->Top; Y <= Region->Bottom; Y++) {
+
+        //
+        //  VT positions are one based and relative to the visible window,
+        //  whereas the window is located in screen buffer coordinates.
+        //
+
+        VtBuffer->LengthInChars += YoriLibSPrintfS(&VtBuffer->StartOfString[VtBuffer->LengthInChars],
+                                                   VtBuffer->LengthAllocated - VtBuffer->LengthInChars,
+                                                   _T("%c[%i;%iH"),
+                                                   27,
+                                                   Window->Ctrl.FullRect.Top + Y - WinMgrRect.Top + 1,
+                                                   Window->Ctrl.FullRect.Left + Region->Left - WinMgrRect.Left + 1);
+
+        for (X = Region->Left; X <= Region->Right; X++) {
+            Cell = &Window->Contents[Y * Window->WindowSize.X + X];
+            if (Cell->Attributes != Window->VtAttribute) {
+                YoriLibVtStringForTextAttribute(&EscapeString, 0, Cell->Attributes);
+                memcpy(&VtBuffer->StartOfString[VtBuffer->LengthInChars], EscapeString.StartOfString, EscapeString.LengthInChars * sizeof(TCHAR));
+                VtBuffer->LengthInChars += EscapeString.LengthInChars;
+                Window->VtAttribute = Cell->Attributes;
+            }
+
+            //
+            //  Control characters would be interpreted by the terminal
+            //  rather than displayed, so don't send them.
+            //
+
+            Char = Cell->Char.UnicodeChar;
+            if (Char < ' ' || Char == 0x7F) {
+                Char = ' ';
+            }
+            VtBuffer->StartOfString[VtBuffer->LengthInChars] = Char;
+            VtBuffer->LengthInChars++;
+        }
+    }
+}
+
+/**
+ Write a region of the window buffer to the console, and record that the
+ region has been displayed.
+
+ @param Window Pointer to the window.
+
+ @param Region The region to write, in window coordinates, inclusive.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriWinDisplayWindowRegion(
+    __in PYORI_WIN_WINDOW Window,
+    __in PSMALL_RECT Region
+    )
+{
+    COORD BufferPosition;
+    SMALL_RECT RedrawWindow;
+    HANDLE hConOut;
+    DWORD Offset;
+    SHORT Y;
+
+    if (YoriWinMgrUseVtOutput(Window->WinMgrHandle)) {
+        YoriWinAppendVtForRegion(Window, Region);
+    } else {
+        BufferPosition.X = Region->Left;
+        BufferPosition.Y = Region->Top;
+
+        RedrawWindow.Left = (SHORT)(Window->Ctrl.FullRect.Left + Region->Left);
+        RedrawWindow.Right = (SHORT)(Window->Ctrl.FullRect.Left + Region->Right);
+        RedrawWindow.Top = (SHORT)(Window->Ctrl.FullRect.Top + Region->Top);
+        RedrawWindow.Bottom = (SHORT)(Window->Ctrl.FullRect.Top + Region->Bottom);
+
+        hConOut = YoriWinGetConsoleOutputHandle(Window->WinMgrHandle);
+        if (!WriteConsoleOutput(hConOut, Window->Contents, Window->WindowSize, BufferPosition, &RedrawWindow)) {
+            return FALSE;
+        }
+    }
+
+#if DBG
+    Window->DbgCellsWrittenThisFlush = Window->DbgCellsWrittenThisFlush +
+        (Region->Right - Region->Left + 1) * (Region->Bottom - Region->Top + 1);
+#endif
+
+    for (Y = Region->Top; Y <= Region->Bottom; Y++) {
+        Offset = Y * Window->WindowSize.X + Region->Left;
+        memcpy(&Window->DisplayedContents[Offset], &Window->Contents[Offset], (Region->Right - Region->Left + 1) * sizeof(CHAR_INFO));
+    }
+
+    return TRUE;
+}
+
+/**
+ Display the window buffer into the console.  If the window knows what is
+ currently displayed, only the cells which have changed are written, as a
+ set of rectangles that cover the changed spans on each row.
 
  @param WindowHandle Pointer to the window to display.
 
@@ -514,9 +704,26 @@ YoriWinDisplayWindowContents(
     )
 {
     PYORI_WIN_WINDOW Window;
-    COORD BufferPosition;
-    SMALL_RECT RedrawWindow;
-    HANDLE hConOut;
+    PCHAR_INFO Row;
+    PCHAR_INFO DisplayedRow;
+    SMALL_RECT DirtyRect;
+    SMALL_RECT Pending;
+    SMALL_RECT Region;
+    DWORD PendingCells;
+    DWORD SpanCells;
+    DWORD UnionCells;
+    DWORD RowSpanCount;
+    SHORT X;
+    SHORT Y;
+    SHORT Gap;
+    SHORT SpanLeft;
+    SHORT SpanRight;
+    SHORT RowSpanLeft;
+    SHORT RowSpanRight;
+    SHORT UnionLeft;
+    SHORT UnionRight;
+    BOOLEAN PendingValid;
+    BOOLEAN UseVt;
 
     Window = (PYORI_WIN_WINDOW)WindowHandle;
 
@@ -524,18 +731,225 @@ YoriWinDisplayWindowContents(
         return TRUE;
     }
 
-    BufferPosition.X = Window->DirtyRect.Left;
-    BufferPosition.Y = Window->DirtyRect.Top;
+    DirtyRect.Left = Window->DirtyRect.Left;
+    DirtyRect.Top = Window->DirtyRect.Top;
+    DirtyRect.Right = Window->DirtyRect.Right;
+    DirtyRect.Bottom = Window->DirtyRect.Bottom;
 
-    RedrawWindow.Left = (SHORT)(Window->Ctrl.FullRect.Left + Window->DirtyRect.Left);
-    RedrawWindow.Right = (SHORT)(Window->Ctrl.FullRect.Left + Window->DirtyRect.Right);
-    RedrawWindow.Top = (SHORT)(Window->Ctrl.FullRect.Top + Window->DirtyRect.Top);
-    RedrawWindow.Bottom = (SHORT)(Window->Ctrl.FullRect.Top + Window->DirtyRect.Bottom);
+    if (DirtyRect.Right >= Window->WindowSize.X) {
+        DirtyRect.Right = (SHORT)(Window->WindowSize.X - 1);
+    }
 
-    hConOut = YoriWinGetConsoleOutputHandle(Window->WinMgrHandle);
-    if (!WriteConsoleOutput(hConOut, Window->Contents, Window->WindowSize, BufferPosition, &RedrawWindow)) {
-        return FALSE;
+    if (DirtyRect.Bottom >= Window->WindowSize.Y) {
+        DirtyRect.Bottom = (SHORT)(Window->WindowSize.Y - 1);
+    }
+
+    //
+    //  If displaying via VT, make sure the buffer can describe every cell
+    //  in the dirty region with an attribute change, plus a position for
+    //  every row, plus saving and restoring the cursor.
+    //
+
+    UseVt = YoriWinMgrUseVtOutput(Window->WinMgrHandle);
+    if (UseVt) {
+        DWORD CharsNeeded;
+        CharsNeeded = (DirtyRect.Right - DirtyRect.Left + 1) * (YORI_MAX_INTERNAL_VT_ESCAPE_CHARS + 1);
+        CharsNeeded = (CharsNeeded + sizeof("E[999;999H")) * (DirtyRect.Bottom - DirtyRect.Top + 1);
+        CharsNeeded = CharsNeeded + 2 * sizeof("E7");
+
+        Window->VtBuffer.LengthInChars = 0;
+        if (Window->VtBuffer.LengthAllocated < CharsNeeded) {
+            if (!YoriLibReallocateStringWithoutPreservingContents(&Window->VtBuffer, CharsNeeded)) {
+                return FALSE;
+            }
+        }
+
+        Window->VtAttribute = (DWORD)-1;
+        Window->VtBuffer.StartOfString[0] = 27;
+        Window->VtBuffer.StartOfString[1] = '7';
+        Window->VtBuffer.LengthInChars = 2;
+    }
+
+#if DBG
+    Window->DbgCellsWrittenThisFlush = 0;
+#endif
+
+    if (!Window->DisplayedContentsValid) {
+
+        //
+        //  Nothing is known about what is on the console, so write the
+        //  entire dirty region.  If that covers the window, from now on
+        //  the console contents are known.
+        //
+
+        if (!YoriWinDisplayWindowRegion(Window, &DirtyRect)) {
+            return FALSE;
+        }
+
+        if (DirtyRect.Left == 0 &&
+            DirtyRect.Top == 0 &&
+            DirtyRect.Right == Window->WindowSize.X - 1 &&
+            DirtyRect.Bottom == Window->WindowSize.Y - 1) {
+
+            Window->DisplayedContentsValid = TRUE;
+        }
+    } else {
+
+        //
+        //  Walk through each row finding spans of changed cells.  Rows with
+        //  a single span are merged with spans on adjacent rows into a
+        //  rectangle, provided that doesn't result in writing more than
+        //  twice as many cells as changed.  Rows with multiple spans write
+        //  each span separately.
+        //
+
+        PendingValid = FALSE;
+        PendingCells = 0;
+        RowSpanLeft = 0;
+        RowSpanRight = 0;
+        Pending.Left = 0;
+        Pending.Top = 0;
+        Pending.Right = 0;
+        Pending.Bottom = 0;
+
+        for (Y = DirtyRect.Top; Y <= DirtyRect.Bottom; Y++) {
+            Row = &Window->Contents[Y * Window->WindowSize.X];
+            DisplayedRow = &Window->DisplayedContents[Y * Window->WindowSize.X];
+            RowSpanCount = 0;
+            X = DirtyRect.Left;
+
+            while (TRUE) {
+                while (X <= DirtyRect.Right && YoriWinCellsEqual(&Row[X], &DisplayedRow[X])) {
+                    X++;
+                }
+
+                if (X > DirtyRect.Right) {
+                    break;
+                }
+
+                SpanLeft = X;
+                SpanRight = X;
+                Gap = 0;
+                for (X++; X <= DirtyRect.Right; X++) {
+                    if (!YoriWinCellsEqual(&Row[X], &DisplayedRow[X])) {
+                        SpanRight = X;
+                        Gap = 0;
+                    } else {
+                        Gap++;
+                        if (Gap >= YORI_WIN_DISPLAY_SPAN_GAP) {
+                            break;
+                        }
+                    }
+                }
+
+                if (RowSpanCount == 0) {
+                    RowSpanLeft = SpanLeft;
+                    RowSpanRight = SpanRight;
+                } else {
+                    if (RowSpanCount == 1) {
+                        if (PendingValid) {
+                            if (!YoriWinDisplayWindowRegion(Window, &Pending)) {
+                                return FALSE;
+                            }
+                            PendingValid = FALSE;
+                        }
+
+                        Region.Left = RowSpanLeft;
+                        Region.Right = RowSpanRight;
+                        Region.Top = Y;
+                        Region.Bottom = Y;
+                        if (!YoriWinDisplayWindowRegion(Window, &Region)) {
+                            return FALSE;
+                        }
+                    }
+
+                    Region.Left = SpanLeft;
+                    Region.Right = SpanRight;
+                    Region.Top = Y;
+                    Region.Bottom = Y;
+                    if (!YoriWinDisplayWindowRegion(Window, &Region)) {
+                        return FALSE;
+                    }
+                }
+
+                RowSpanCount++;
+            }
+
+            if (RowSpanCount != 1) {
+                continue;
+            }
+
+            SpanCells = RowSpanRight - RowSpanLeft + 1;
+
+            if (PendingValid && Pending.Bottom == Y - 1) {
+                UnionLeft = Pending.Left;
+                if (RowSpanLeft < UnionLeft) {
+                    UnionLeft = RowSpanLeft;
+                }
+                UnionRight = Pending.Right;
+                if (RowSpanRight > UnionRight) {
+                    UnionRight = RowSpanRight;
+                }
+
+                UnionCells = (Y - Pending.Top + 1) * (UnionRight - UnionLeft + 1);
+                if (UnionCells <= 2 * (PendingCells + SpanCells)) {
+                    Pending.Left = UnionLeft;
+                    Pending.Right = UnionRight;
+                    Pending.Bottom = Y;
+                    PendingCells = PendingCells + SpanCells;
+                    continue;
+                }
+            }
+
+            if (PendingValid) {
+                if (!YoriWinDisplayWindowRegion(Window, &Pending)) {
+                    return FALSE;
+                }
+            }
+
+            Pending.Left = RowSpanLeft;
+            Pending.Right = RowSpanRight;
+            Pending.Top = Y;
+            Pending.Bottom = Y;
+            PendingCells = SpanCells;
+            PendingValid = TRUE;
+        }
+
+        if (PendingValid) {
+            if (!YoriWinDisplayWindowRegion(Window, &Pending)) {
+                return FALSE;
+            }
+        }
+    }
+
+    //
+    //  When using VT, everything has been accumulated into a single buffer.
+    //  Restore the cursor position and attributes after the update and send
+    //  the whole thing in one write.
+    //
+
+    if (UseVt && Window->VtBuffer.LengthInChars > 2) {
+        HANDLE hConOut;
+        DWORD CharsWritten;
+
+        Window->VtBuffer.StartOfString[Window->VtBuffer.LengthInChars] = 27;
+        Window->VtBuffer.StartOfString[Window->VtBuffer.LengthInChars + 1] = '8';
+        Window->VtBuffer.LengthInChars += 2;
+
+        hConOut = YoriWinGetConsoleOutputHandle(Window->WinMgrHandle);
+        if (!WriteConsole(hConOut, Window->VtBuffer.StartOfString, Window->VtBuffer.LengthInChars, &CharsWritten, NULL)) {
+            Window->DisplayedContentsValid = FALSE;
+            return FALSE;
+        }
+    }
+
+#if DBG
+    Window->DbgCellsWrittenLastFlush = Window->DbgCellsWrittenThisFlush;
+    if (Window->DbgCellsWrittenThisFlush > 0) {
+        Window->DbgFlushCount++;
+        Window->DbgTotalCellsWritten = Window->DbgTotalCellsWritten + Window->DbgCellsWrittenThisFlush;
     }
+#endif
 
     Window->Dirty = FALSE;
 
@@ -699,6 +1113,7 @@ YoriWinRestoreSavedWindowContents(
 
     hConOut = YoriWinGetConsoleOutputHandle(Window->WinMgrHandle);
     WriteConsoleOutput(hConOut, Window->SavedContents, Window->WindowSize, BufferPosition, &WriteRect);
+    Window->DisplayedContentsValid = FALSE;
 }
 
 
@@ -737,6 +1152,7 @@ YoriWinDestroyWindow(
     }
 
     YoriLibFreeStringContents(&Window->Title);
+    YoriLibFreeStringContents(&Window->VtBuffer);
     YoriLibDereference(Window);
 }
 
@@ -1150,13 +1566,14 @@ YoriWinCreateWindowEx(
     CellCount = Window->WindowSize.X;
     CellCount *= Window->WindowSize.Y;
 
-    Window->SavedContents = YoriLibMalloc(CellCount * sizeof(CHAR_INFO) * 2);
+    Window->SavedContents = YoriLibMalloc(CellCount * sizeof(CHAR_INFO) * 3);
     if (Window->SavedContents == NULL) {
         YoriWinDestroyWindow(Window);
         return FALSE;
     }
 
     Window->Contents = Window->SavedContents + CellCount;
+    Window->DisplayedContents = Window->Contents + CellCount;
 
     if (!YoriWinSaveWindowContents(Window)) {
         YoriLibFree(Window->SavedContents);
@@ -1381,7 +1798,7 @@ YoriWinWindowReposition(
     CellCount = NewWindowSize.X;
     CellCount *= NewWindowSize.Y;
 
-    NewSavedContents = YoriLibMalloc(CellCount * sizeof(CHAR_INFO) * 2);
+    NewSavedContents = YoriLibMalloc(CellCount * sizeof(CHAR_INFO) * 3);
     if (NewSavedContents == NULL) {
         return FALSE;
     }
@@ -1394,6 +1811,8 @@ YoriWinWindowReposition(
     YoriLibFree(Window->SavedContents);
     Window->SavedContents = NewSavedContents;
     Window->Contents = Window->SavedContents + CellCount;
+    Window->DisplayedContents = Window->Contents + CellCount;
+    Window->DisplayedContentsValid = FALSE;
     Window->WindowSize.X = NewWindowSize.X;
     Window->WindowSize.Y = NewWindowSize.Y;
 
@@ -30,6 +30,28 @@
 
 #include "winpriv.h"
 
+/**
+ The maximum number of objects, in addition to console input, that the window
+ manager can wait on.  This must be less than MAXIMUM_WAIT_OBJECTS.
+ */
+#define YORI_WIN_MAX_WAIT_OBJECTS (8)
+
+/**
+ The shortest interval, in milliseconds, between checks for viewport changes
+ that the console doesn't report.  This is used immediately after input is
+ received, when the user is most likely to be resizing the window.
+ */
+#define YORI_WIN_VIEWPORT_POLL_MIN (100)
+
+/**
+ The longest interval, in milliseconds, between checks for viewport changes
+ that the console doesn't report.  Each check that finds no change doubles
+ the interval until this limit is reached.  This matches the interval that
+ was always used previously, so a resize is never noticed later than it
+ used to be.
+ */
+#define YORI_WIN_VIEWPORT_POLL_MAX (400)
+
 /**
  A structure describing a window manager
  */
@@ -68,6 +90,33 @@ typedef struct _YORI_WIN_WINDOW_MANAGER {
      */
     CONSOLE_SCREEN_BUFFER_INFO SavedScreenBufferInfo;
 
+    /**
+     An array of objects that the window manager should wait on in addition
+     to console input.  When one of these becomes signalled, the
+     corresponding entry in WaitObjectCallbacks is invoked from the input
+     loop, allowing background work to be merged into the UI thread.
+     */
+    HANDLE WaitObjects[YORI_WIN_MAX_WAIT_OBJECTS];
+
+    /**
+     An array of callbacks to invoke when the corresponding entry in
+     WaitObjects becomes signalled.
+     */
+    PYORI_WIN_NOTIFY_OBJECT_SIGNALLED WaitObjectCallbacks[YORI_WIN_MAX_WAIT_OBJECTS];
+
+    /**
+     The number of elements populated in WaitObjects and
+     WaitObjectCallbacks.
+     */
+    DWORD WaitObjectCount;
+
+    /**
+     The number of milliseconds to wait for input before checking whether
+     the viewport has changed, or INFINITE if the console reports all
+     changes via WINDOW_BUFFER_SIZE_EVENT and no checking is needed.
+     */
+    DWORD ViewportPollInterval;
+
     /**
      The mouse buttons that were pressed last time a mouse event was
      processed.  This is used to detect which buttons were pressed or
@@ -83,6 +132,28 @@ typedef struct _YORI_WIN_WINDOW_MANAGER {
      */
     BOOLEAN IsConhostv2;
 
+    /**
+     Set to TRUE if window contents should be sent to the console as VT
+     sequences rather than via WriteConsoleOutput.  This is enabled by
+     setting YORIWINVT=1 on consoles that support VT processing, and can
+     substantially reduce the amount of data sent over remote sessions.
+     */
+    BOOLEAN UseVtOutput;
+
+    /**
+     Set to TRUE if the viewport can change without the console reporting
+     it.  This happens when the screen buffer is larger than the viewport,
+     because changing the viewport height doesn't change the buffer.  If
+     FALSE, the input loop waits indefinitely.
+     */
+    BOOLEAN PollViewport;
+
+    /**
+     Set to TRUE if the user has disabled viewport polling by setting
+     YORIWINPOLL=0.
+     */
+    BOOLEAN PollViewportDisabled;
+
     /**
      Set to TRUE to indicate that SavedCursorInfo is valid and should be
      restored on exit.
@@ -118,6 +189,10 @@ YoriWinCloseWindowManager(
         SetConsoleCursorInfo(WinMgr->hConOut, &WinMgr->SavedCursorInfo);
     }
 
+    if (WinMgr->UseVtOutput) {
+        SetConsoleMode(WinMgr->hConOut, ENABLE_PROCESSED_OUTPUT | ENABLE_WRAP_AT_EOL_OUTPUT);
+    }
+
     if (WinMgr->hConOriginal != NULL) {
         SetConsoleActiveScreenBuffer(WinMgr->hConOriginal);
         CloseHandle(WinMgr->hConOriginal);
@@ -138,6 +213,37 @@ YoriWinCloseWindowManager(
 }
 
 
+/**
+ Determine whether changes to the viewport need to be detected by polling.
+ If the screen buffer is the same size as the viewport, any change to the
+ viewport changes the buffer, which the console reports.  If the buffer is
+ larger, the viewport height can change without any notification.
+
+ @param WinMgr Pointer to the window manager.
+ */
+VOID
+YoriWinMgrUpdateViewportPolling(
+    __in PYORI_WIN_WINDOW_MANAGER WinMgr
+    )
+{
+    PCONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
+
+    ScreenInfo = &WinMgr->SavedScreenBufferInfo;
+    WinMgr->PollViewport = FALSE;
+    if (!WinMgr->PollViewportDisabled &&
+        (ScreenInfo->srWindow.Right - ScreenInfo->srWindow.Left + 1 != ScreenInfo->dwSize.X ||
+         ScreenInfo->srWindow.Bottom - ScreenInfo->srWindow.Top + 1 != ScreenInfo->dwSize.Y)) {
+
+        WinMgr->PollViewport = TRUE;
+    }
+
+    if (WinMgr->PollViewport) {
+        WinMgr->ViewportPollInterval = YORI_WIN_VIEWPORT_POLL_MIN;
+    } else {
+        WinMgr->ViewportPollInterval = INFINITE;
+    }
+}
+
 /**
  Initialize and open a window manager.  This should be called once per process
  that is interacting with the display via UI.
@@ -159,6 +265,7 @@ YoriWinOpenWindowManager(
     )
 {
     PYORI_WIN_WINDOW_MANAGER WinMgr;
+    LONGLONG llTemp;
 
     WinMgr = YoriLibMalloc(sizeof(YORI_WIN_WINDOW_MANAGER));
     if (WinMgr == NULL) {
@@ -166,6 +273,11 @@ YoriWinOpenWindowManager(
     }
 
     WinMgr->hConOriginal = NULL;
+    WinMgr->WaitObjectCount = 0;
+    WinMgr->UseVtOutput = FALSE;
+    WinMgr->PollViewport = FALSE;
+    WinMgr->PollViewportDisabled = FALSE;
+    WinMgr->ViewportPollInterval = INFINITE;
     YoriLibInitializeListHead(&WinMgr->TopLevelWindowList);
 
     WinMgr->hConOut = CreateFile(_T("CONOUT$"), GENERIC_READ|GENERIC_WRITE, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
@@ -214,19 +326,42 @@ YoriWinOpenWindowManager(
     WinMgr->IsConhostv2 = FALSE;
     if (SetConsoleMode(WinMgr->hConOut, ENABLE_PROCESSED_OUTPUT | ENABLE_VIRTUAL_TERMINAL_PROCESSING)) {
         WinMgr->IsConhostv2 = TRUE;
+
+        //
+        //  If the user has asked for VT output, leave VT processing enabled
+        //  and wrapping disabled, so writing to the final column doesn't
+        //  scroll the buffer.
+        //
+
+        if (YoriLibGetEnvironmentVariableAsNumber(_T("YORIWINVT"), &llTemp) &&
+            llTemp == 1) {
+
+            WinMgr->UseVtOutput = TRUE;
+        }
     }
 
-    SetConsoleMode(WinMgr->hConOut, ENABLE_PROCESSED_OUTPUT | ENABLE_WRAP_AT_EOL_OUTPUT);
+    if (!WinMgr->UseVtOutput) {
+        SetConsoleMode(WinMgr->hConOut, ENABLE_PROCESSED_OUTPUT | ENABLE_WRAP_AT_EOL_OUTPUT);
+    }
 
     //
     //  Set the standard input flags and clear any extended flags.  This can
     //  fail on old systems that don't understand extended flags, so do it
     //  again without extended flags since on systems with them they're
-    //  already clear.
+    //  already clear.  Window input is requested so the console reports
+    //  buffer size changes rather than requiring them to be polled.
     //
 
-    SetConsoleMode(WinMgr->hConIn, ENABLE_MOUSE_INPUT | ENABLE_EXTENDED_FLAGS);
-    SetConsoleMode(WinMgr->hConIn, ENABLE_MOUSE_INPUT);
+    SetConsoleMode(WinMgr->hConIn, ENABLE_MOUSE_INPUT | ENABLE_WINDOW_INPUT | ENABLE_EXTENDED_FLAGS);
+    SetConsoleMode(WinMgr->hConIn, ENABLE_MOUSE_INPUT | ENABLE_WINDOW_INPUT);
+
+    if (YoriLibGetEnvironmentVariableAsNumber(_T("YORIWINPOLL"), &llTemp) &&
+        llTemp == 0) {
+
+        WinMgr->PollViewportDisabled = TRUE;
+    }
+
+    YoriWinMgrUpdateViewportPolling(WinMgr);
 
     *WinMgrHandle = WinMgr;
     return TRUE;
@@ -282,6 +417,24 @@ YoriWinIsConhostv2(
     return WinMgr->IsConhostv2;
 }
 
+/**
+ Return TRUE if window contents should be sent to the console as VT
+ sequences rather than as cells via WriteConsoleOutput.
+
+ @param WinMgrHandle Pointer to the window manager.
+
+ @return TRUE to indicate VT output should be used, FALSE if cells should be
+         written directly.
+ */
+BOOLEAN
+YoriWinMgrUseVtOutput(
+    __in PYORI_WIN_WINDOW_MANAGER_HANDLE WinMgrHandle
+    )
+{
+    PYORI_WIN_WINDOW_MANAGER WinMgr = (PYORI_WIN_WINDOW_MANAGER)WinMgrHandle;
+    return WinMgr->UseVtOutput;
+}
+
 /**
  Return the size of the window manager, meaning the size of the addressable
  window when the window manager was initialized.
@@ -385,6 +538,72 @@ YoriWinSetPreviousMouseButtonState(
     WinMgr->PreviousMouseButtonState = PreviousMouseButtonState;
 }
 
+/**
+ Register an object that the window manager should wait on in addition to
+ console input.  When the object becomes signalled, the callback is invoked
+ from the thread processing input, so it can safely manipulate windows and
+ controls.  This allows background threads to hand work to the UI thread.
+
+ @param WinMgrHandle Pointer to the window manager.
+
+ @param Object The object to wait on.  Note that this object should be an
+        auto reset event or similar, since if it remains signalled the
+        callback will be invoked repeatedly.
+
+ @param Callback Pointer to a function to invoke when the object is
+        signalled.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriWinMgrRegisterWaitObject(
+    __in PYORI_WIN_WINDOW_MANAGER_HANDLE WinMgrHandle,
+    __in HANDLE Object,
+    __in PYORI_WIN_NOTIFY_OBJECT_SIGNALLED Callback
+    )
+{
+    PYORI_WIN_WINDOW_MANAGER WinMgr = (PYORI_WIN_WINDOW_MANAGER)WinMgrHandle;
+
+    if (WinMgr->WaitObjectCount >= YORI_WIN_MAX_WAIT_OBJECTS) {
+        return FALSE;
+    }
+
+    WinMgr->WaitObjects[WinMgr->WaitObjectCount] = Object;
+    WinMgr->WaitObjectCallbacks[WinMgr->WaitObjectCount] = Callback;
+    WinMgr->WaitObjectCount++;
+    return TRUE;
+}
+
+/**
+ Indicate that the window manager should no longer wait on an object that
+ was previously registered with @ref YoriWinMgrRegisterWaitObject .
+
+ @param WinMgrHandle Pointer to the window manager.
+
+ @param Object The object to stop waiting on.
+ */
+VOID
+YoriWinMgrUnregisterWaitObject(
+    __in PYORI_WIN_WINDOW_MANAGER_HANDLE WinMgrHandle,
+    __in HANDLE Object
+    )
+{
+    PYORI_WIN_WINDOW_MANAGER WinMgr = (PYORI_WIN_WINDOW_MANAGER)WinMgrHandle;
+    DWORD Index;
+
+    for (Index = 0; Index < WinMgr->WaitObjectCount; Index++) {
+        if (WinMgr->WaitObjects[Index] == Object) {
+            WinMgr->WaitObjectCount--;
+            for (; Index < WinMgr->WaitObjectCount; Index++) {
+                WinMgr->WaitObjects[Index] = WinMgr->WaitObjects[Index + 1];
+                WinMgr->WaitObjectCallbacks[Index] = WinMgr->WaitObjectCallbacks[Index + 1];
+            }
+            break;
+        }
+    }
+}
+
 /**
  Add a window to the stack of windows which will process events.  The newly
  added window is on top of the stack (and conceptually on top of other
@@ -474,12 +693,22 @@ YoriWinMgrTopMostNonClosingWindow(
 }
 
 /**
- Read console input, and periodically check if the window has changed at all.
- New versions of conhost emit WINDOW_BUFFER_SIZE_EVENT when the window is
- resized to the right, but resizing the bottom does not emit this event and
- was possible with traditional consoles which didn't emit it either.  So this
- function periodically polls the window dimensions, and if a change is
- found, it synthesises a buffer size event.
+ Read console input, waiting for either input or a registered object to be
+ signalled.  Changes to the screen buffer size are reported by the console
+ as WINDOW_BUFFER_SIZE_EVENT, which covers every viewport change when the
+ buffer is the same size as the viewport.  When the buffer is larger than
+ the viewport, resizing the bottom of the window changes the viewport
+ without changing the buffer, and no event is generated.  In that case only,
+ this function checks the viewport dimensions after a timeout, and if a
+ change is found, it synthesises a buffer size event.  The timeout starts
+ short after input and doubles while nothing changes, up to the limit of
+ @ref YORI_WIN_VIEWPORT_POLL_MAX.  An idle application therefore continues
+ to wake periodically when the viewport is smaller than the buffer, and
+ only waits without a timeout when the console reports all changes.  If an
+ object registered with @ref YoriWinMgrRegisterWaitObject is signalled,
+ such as a waitable timer or an event indicating background work has
+ completed, its callback is invoked and this function returns with no input
+ events.
 
  @param WinMgr Pointer to the window manager.
 
@@ -503,18 +732,42 @@ YoriWinReadConsoleInputDetectWindowChange(
     )
 {
     DWORD Err;
+    DWORD Index;
+    DWORD WaitCount;
+    HANDLE WaitHandles[YORI_WIN_MAX_WAIT_OBJECTS + 1];
+    PYORI_WIN_NOTIFY_OBJECT_SIGNALLED Callback;
+
     while (TRUE) {
 
-        Err = WaitForSingleObject(WinMgr->hConIn, 400);
+        //
+        //  Console input is first so that it is favored if multiple objects
+        //  are signalled.
+        //
+
+        WaitHandles[0] = WinMgr->hConIn;
+        WaitCount = WinMgr->WaitObjectCount;
+        for (Index = 0; Index < WaitCount; Index++) {
+            WaitHandles[Index + 1] = WinMgr->WaitObjects[Index];
+        }
+
+        Err = WaitForMultipleObjects(WaitCount + 1, WaitHandles, FALSE, WinMgr->ViewportPollInterval);
 
-        if (Err == WAIT_TIMEOUT) {
+        if (Err > WAIT_OBJECT_0 && Err <= WAIT_OBJECT_0 + WaitCount) {
+            Index = Err - WAIT_OBJECT_0 - 1;
+            Callback = WinMgr->WaitObjectCallbacks[Index];
+            Callback(WinMgr, WaitHandles[Index + 1]);
+            *NumberOfEventsRead = 0;
+            return TRUE;
+        } else if (Err == WAIT_TIMEOUT) {
             CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
 
             GetConsoleScreenBufferInfo(WinMgr->hConOut, &ScreenInfo);
             if (ScreenInfo.srWindow.Left != WinMgr->SavedScreenBufferInfo.srWindow.Left ||
                 ScreenInfo.srWindow.Top != WinMgr->SavedScreenBufferInfo.srWindow.Top ||
                 ScreenInfo.srWindow.Right != WinMgr->SavedScreenBufferInfo.srWindow.Right ||
-                ScreenInfo.srWindow.Bottom != WinMgr->SavedScreenBufferInfo.srWindow.Bottom) {
+                ScreenInfo.srWindow.Bottom != WinMgr->SavedScreenBufferInfo.srWindow.Bottom ||
+                ScreenInfo.dwSize.X != WinMgr->SavedScreenBufferInfo.dwSize.X ||
+                ScreenInfo.dwSize.Y != WinMgr->SavedScreenBufferInfo.dwSize.Y) {
 
                 Buffer->EventType = WINDOW_BUFFER_SIZE_EVENT;
                 Buffer->Event.WindowBufferSizeEvent.dwSize.X = ScreenInfo.dwSize.X;
@@ -523,7 +776,19 @@ YoriWinReadConsoleInputDetectWindowChange(
                 *NumberOfEventsRead = 1;
                 return TRUE;
             }
+
+            //
+            //  Nothing changed, so check less frequently until more input
+            //  arrives.
+            //
+
+            if (WinMgr->ViewportPollInterval < YORI_WIN_VIEWPORT_POLL_MAX) {
+                WinMgr->ViewportPollInterval = WinMgr->ViewportPollInterval * 2;
+            }
         } else {
+            if (WinMgr->PollViewport) {
+                WinMgr->ViewportPollInterval = YORI_WIN_VIEWPORT_POLL_MIN;
+            }
             return ReadConsoleInput(WinMgr->hConIn, Buffer, BufferLength, NumberOfEventsRead);
         }
     }
@@ -831,6 +1096,23 @@ YoriWinMgrProcessEvents(
                 GetConsoleScreenBufferInfo(hConOut, &NewScreenBufferInfo);
                 ListEntry = NULL;
 
+                //
+                //  The console reports buffer changes that don't move the
+                //  viewport.  Record the new buffer size, since it affects
+                //  whether the viewport needs to be polled, but don't
+                //  redraw anything.
+                //
+
+                if (NewScreenBufferInfo.srWindow.Left == OldScreenBufferInfo.srWindow.Left &&
+                    NewScreenBufferInfo.srWindow.Top == OldScreenBufferInfo.srWindow.Top &&
+                    NewScreenBufferInfo.srWindow.Right == OldScreenBufferInfo.srWindow.Right &&
+                    NewScreenBufferInfo.srWindow.Bottom == OldScreenBufferInfo.srWindow.Bottom) {
+
+                    memcpy(&WinMgr->SavedScreenBufferInfo, &NewScreenBufferInfo, sizeof(CONSOLE_SCREEN_BUFFER_INFO));
+                    YoriWinMgrUpdateViewportPolling(WinMgr);
+                    continue;
+                }
+
                 //
                 //  Move from the top to the bottom of open windows, hiding
                 //  them.  This is restoring the contents of the underlying
@@ -851,6 +1133,7 @@ YoriWinMgrProcessEvents(
                 }
 
                 memcpy(&WinMgr->SavedScreenBufferInfo, &NewScreenBufferInfo, sizeof(CONSOLE_SCREEN_BUFFER_INFO));
+                YoriWinMgrUpdateViewportPolling(WinMgr);
 
                 //
                 //  From the bottom of the stack to the top of the stack,
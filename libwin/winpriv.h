@@ -716,6 +716,11 @@ YoriWinIsConhostv2(
     __in PYORI_WIN_WINDOW_MANAGER_HANDLE WinMgrHandle
     );
 
+BOOLEAN
+YoriWinMgrUseVtOutput(
+    __in PYORI_WIN_WINDOW_MANAGER_HANDLE WinMgrHandle
+    );
+
 DWORD
 YoriWinGetPreviousMouseButtonState(
     __in PYORI_WIN_WINDOW_MANAGER_HANDLE WinMgrHandle
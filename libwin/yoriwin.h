@@ -351,6 +351,19 @@ YoriWinLabelReposition(
  */
 #define YORI_WIN_LIST_STYLE_DESELECT_ON_LOSE_FOCUS (0x0004)
 
+/**
+ A prototype for a callback function that returns the text of an item in a
+ list whose items are supplied by the application.  The string should point
+ to memory owned by the application and remain valid until the next call.
+ */
+typedef BOOLEAN YORI_WIN_LIST_GET_ITEM_TEXT(PYORI_WIN_CTRL_HANDLE, PVOID, DWORD, PYORI_STRING);
+
+/**
+ A pointer to a callback function that returns the text of an item in a list
+ whose items are supplied by the application.
+ */
+typedef YORI_WIN_LIST_GET_ITEM_TEXT *PYORI_WIN_LIST_GET_ITEM_TEXT;
+
 PYORI_WIN_CTRL_HANDLE
 YoriWinListCreate(
     __in PYORI_WIN_WINDOW_HANDLE Parent,
@@ -391,6 +404,28 @@ YoriWinListAddItems(
     __in DWORD NumberOptions
     );
 
+__success(return)
+BOOLEAN
+YoriWinListSetDataSource(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in PYORI_WIN_LIST_GET_ITEM_TEXT Callback,
+    __in_opt PVOID Context,
+    __in DWORD ItemCount
+    );
+
+__success(return)
+BOOLEAN
+YoriWinListSetItemCount(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in DWORD ItemCount
+    );
+
+VOID
+YoriWinListSetItemsSorted(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in BOOLEAN ItemsSorted
+    );
+
 BOOLEAN
 YoriWinListGetItemText(
     __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
@@ -817,6 +852,18 @@ YoriWinProcessInputForWindow(
 
 // *** WINMGR.C ***
 
+/**
+ A function prototype that can be invoked when an object registered with the
+ window manager becomes signalled.
+ */
+typedef VOID YORI_WIN_NOTIFY_OBJECT_SIGNALLED(PYORI_WIN_WINDOW_MANAGER_HANDLE, HANDLE);
+
+/**
+ A pointer to a function that can be invoked when an object registered with
+ the window manager becomes signalled.
+ */
+typedef YORI_WIN_NOTIFY_OBJECT_SIGNALLED *PYORI_WIN_NOTIFY_OBJECT_SIGNALLED;
+
 __success(return)
 BOOLEAN
 YoriWinOpenWindowManager(
@@ -838,6 +885,20 @@ YoriWinGetWinMgrLocation(
     __out PSMALL_RECT Rect
     );
 
+__success(return)
+BOOLEAN
+YoriWinMgrRegisterWaitObject(
+    __in PYORI_WIN_WINDOW_MANAGER_HANDLE WinMgrHandle,
+    __in HANDLE Object,
+    __in PYORI_WIN_NOTIFY_OBJECT_SIGNALLED Callback
+    );
+
+VOID
+YoriWinMgrUnregisterWaitObject(
+    __in PYORI_WIN_WINDOW_MANAGER_HANDLE WinMgrHandle,
+    __in HANDLE Object
+    );
+
 VOID
 YoriWinCloseWindowManager(
     __in PYORI_WIN_WINDOW_MANAGER_HANDLE WinMgrHandle
@@ -101,6 +101,219 @@ typedef struct _LINES_CONTEXT {
     LONGLONG TotalLinesFound;
 } LINES_CONTEXT, *PLINES_CONTEXT;
 
+/**
+ Count the line endings in a buffer of 8 bit characters.  A line ending is a
+ LF, a CR, or a CR followed by a LF, which matches the line reader.  The
+ buffer is scanned a machine word at a time, and words without any CR or LF
+ characters are skipped without examining individual bytes.
+
+ @param Buffer Pointer to the buffer to scan.
+
+ @param Length The number of bytes in the buffer.
+
+ @param LineEndings On completion, incremented by the number of line endings
+        found.
+
+ @return The number of bytes at the end of the buffer which could not be
+         processed.  This is one if the buffer ends in a CR, since it may be
+         followed by a LF in subsequent data, and zero otherwise.
+ */
+DWORD
+LinesCountLineEndings(
+    __in PUCHAR Buffer,
+    __in DWORD Length,
+    __inout PLONGLONG LineEndings
+    )
+{
+    DWORD Index;
+    DWORD_PTR LowBits;
+    DWORD_PTR HighBits;
+    DWORD_PTR LfPattern;
+    DWORD_PTR CrPattern;
+    DWORD_PTR Word;
+    DWORD_PTR LfBits;
+    DWORD_PTR CrBits;
+    LONGLONG Found;
+
+    //
+    //  LowBits has the low bit of each byte set, and HighBits has the high
+    //  bit of each byte set.  (x - LowBits) & ~x & HighBits is nonzero if
+    //  and only if some byte in x is zero, so XORing a word with a repeated
+    //  character first finds whether the character is present.
+    //
+
+    LowBits = ((DWORD_PTR)-1) / 0xFF;
+    HighBits = LowBits * 0x80;
+    LfPattern = LowBits * 0x0A;
+    CrPattern = LowBits * 0x0D;
+    Found = 0;
+
+    Index = 0;
+    while (Index < Length) {
+        if (((DWORD_PTR)&Buffer[Index] % sizeof(DWORD_PTR)) == 0) {
+            while (Index + sizeof(DWORD_PTR) <= Length) {
+                Word = *(PDWORD_PTR)&Buffer[Index];
+                LfBits = Word ^ LfPattern;
+                CrBits = Word ^ CrPattern;
+                if ((((LfBits - LowBits) & ~LfBits) | ((CrBits - LowBits) & ~CrBits)) & HighBits) {
+                    break;
+                }
+                Index += sizeof(DWORD_PTR);
+            }
+            if (Index >= Length) {
+                break;
+            }
+        }
+
+        if (Buffer[Index] == 0xA) {
+            Found++;
+        } else if (Buffer[Index] == 0xD) {
+            if (Index + 1 == Length) {
+                *LineEndings += Found;
+                return 1;
+            }
+            Found++;
+            if (Buffer[Index + 1] == 0xA) {
+                Index++;
+            }
+        }
+        Index++;
+    }
+
+    *LineEndings += Found;
+    return 0;
+}
+
+/**
+ Count the line endings in a buffer of 16 bit characters.  A line ending is
+ a LF, a CR, or a CR followed by a LF, which matches the line reader.
+
+ @param Buffer Pointer to the buffer to scan.
+
+ @param Length The number of bytes in the buffer.
+
+ @param LineEndings On completion, incremented by the number of line endings
+        found.
+
+ @return The number of bytes at the end of the buffer which could not be
+         processed.  This includes a trailing CR, since it may be followed
+         by a LF in subsequent data, and any incomplete character.
+ */
+DWORD
+LinesCountWideLineEndings(
+    __in PUCHAR Buffer,
+    __in DWORD Length,
+    __inout PLONGLONG LineEndings
+    )
+{
+    PWCHAR WideBuffer;
+    DWORD CharCount;
+    DWORD Index;
+    LONGLONG Found;
+
+    WideBuffer = (PWCHAR)Buffer;
+    CharCount = Length / sizeof(WCHAR);
+    Found = 0;
+
+    for (Index = 0; Index < CharCount; Index++) {
+        if (WideBuffer[Index] == 0xA) {
+            Found++;
+        } else if (WideBuffer[Index] == 0xD) {
+            if (Index + 1 == CharCount) {
+                *LineEndings += Found;
+                return sizeof(WCHAR) + Length % sizeof(WCHAR);
+            }
+            Found++;
+            if (WideBuffer[Index + 1] == 0xA) {
+                Index++;
+            }
+        }
+    }
+
+    *LineEndings += Found;
+    return Length % sizeof(WCHAR);
+}
+
+/**
+ Count the lines in a regular file by scanning for line endings in the file
+ contents without converting them into lines.
+
+ @param Reader Pointer to a reader which has been opened on the file.
+
+ @param LinesContext Specifies the context to record line count information.
+ */
+VOID
+LinesCountMappedFile(
+    __inout PYORI_LIB_BYTE_SPAN_READER Reader,
+    __in PLINES_CONTEXT LinesContext
+    )
+{
+    DWORD BytesToRetain;
+    DWORD BytesProcessed;
+    DWORD CharSize;
+    BOOLEAN DataFound;
+    BOOLEAN EndsInLineEnding;
+    WCHAR LastChar;
+
+    CharSize = sizeof(UCHAR);
+    if (YoriLibGetMultibyteInputEncoding() == CP_UTF16) {
+        CharSize = sizeof(WCHAR);
+    }
+
+    DataFound = FALSE;
+    EndsInLineEnding = FALSE;
+    BytesToRetain = 0;
+
+    while (YoriLibByteSpanReaderNext(Reader, BytesToRetain)) {
+        if (YoriLibIsOperationCancelled()) {
+            return;
+        }
+
+        if (CharSize == sizeof(WCHAR)) {
+            BytesToRetain = LinesCountWideLineEndings(Reader->Span, Reader->SpanLength, &LinesContext->FileLinesFound);
+        } else {
+            BytesToRetain = LinesCountLineEndings(Reader->Span, Reader->SpanLength, &LinesContext->FileLinesFound);
+        }
+
+        //
+        //  Remember whether the processed data ends with a line ending,
+        //  which determines whether there is a final line without one.
+        //
+
+        BytesProcessed = Reader->SpanLength - BytesToRetain;
+        if (BytesProcessed >= CharSize) {
+            DataFound = TRUE;
+            if (CharSize == sizeof(WCHAR)) {
+                LastChar = *(PWCHAR)(Reader->Span + BytesProcessed - CharSize);
+            } else {
+                LastChar = Reader->Span[BytesProcessed - CharSize];
+            }
+            EndsInLineEnding = (BOOLEAN)(LastChar == 0xA || LastChar == 0xD);
+        }
+    }
+
+    //
+    //  At the end of the file, the span describes any data that could not
+    //  be processed.  This is either a CR, which is a line ending, possibly
+    //  followed by an incomplete character, or just an incomplete character,
+    //  which is part of a final line without a line ending.
+    //
+
+    if (Reader->SpanLength >= CharSize &&
+        ((CharSize == sizeof(WCHAR) && *(PWCHAR)Reader->Span == 0xD) ||
+         (CharSize == sizeof(UCHAR) && *Reader->Span == 0xD))) {
+
+        LinesContext->FileLinesFound++;
+        if (Reader->SpanLength > CharSize) {
+            LinesContext->FileLinesFound++;
+        }
+    } else if (Reader->SpanLength > 0) {
+        LinesContext->FileLinesFound++;
+    } else if (DataFound && !EndsInLineEnding) {
+        LinesContext->FileLinesFound++;
+    }
+}
+
 /**
  Count the lines in an opened stream.
 
@@ -118,6 +331,7 @@ LinesProcessStream(
 {
     PVOID LineContext = NULL;
     YORI_STRING LineString;
+    YORI_LIB_BYTE_SPAN_READER Reader;
 
     YoriLibInitEmptyString(&LineString);
 
@@ -125,6 +339,21 @@ LinesProcessStream(
     LinesContext->FilesFoundThisArg++;
     LinesContext->FileLinesFound = 0;
 
+    //
+    //  If the source is a regular file, count line endings directly from
+    //  a mapped view of the file.
+    //
+
+    if (YoriLibByteSpanReaderOpen(&Reader, hSource, NULL)) {
+        if (Reader.Mapped) {
+            LinesCountMappedFile(&Reader, LinesContext);
+            YoriLibByteSpanReaderClose(&Reader);
+            LinesContext->TotalLinesFound += LinesContext->FileLinesFound;
+            return TRUE;
+        }
+        YoriLibByteSpanReaderClose(&Reader);
+    }
+
     while (TRUE) {
 
         if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
@@ -357,6 +586,8 @@ ENTRYPOINT(
 
 #if YORI_BUILTIN
     YoriLibCancelEnable();
+#else
+    YoriLibEnableFileMapping();
 #endif
 
     //
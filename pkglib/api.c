@@ -44,14 +44,19 @@ YoriPkgUpgradeInstalledPackages(
 {
     YORI_STRING PkgIniFile;
     YORI_STRING InstalledSection;
-    LPTSTR ThisLine;
-    LPTSTR Equals;
+    YORI_STRING UpgradePathKey;
     YORI_STRING PkgNameOnly;
     YORI_STRING InstalledVersion;
+    YORI_STRING IniValue;
     YORI_STRING UpgradePath;
     YORI_STRING RedirectedPath;
-    DWORD LineLength;
+    PYORI_STRING UpgradeUrls;
+    PVOID IniFile;
+    PVOID Position;
     DWORD Error;
+    DWORD Index;
+    DWORD PackageCount;
+    DWORD UpgradeCount;
     BOOL Result;
     BOOL UpgradeThisPackage;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
@@ -65,39 +70,63 @@ YoriPkgUpgradeInstalledPackages(
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
+    if (!YoriLibAllocateString(&UpgradePath, YORIPKG_MAX_FIELD_LENGTH)) {
         YoriPkgDeletePendingPackages(&PendingPackages);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&UpgradePath, YORIPKG_MAX_FIELD_LENGTH)) {
+    IniFile = YoriLibIniOpen(&PkgIniFile);
+    if (IniFile == NULL) {
         YoriPkgDeletePendingPackages(&PendingPackages);
-        YoriLibFreeStringContents(&InstalledSection);
+        YoriLibFreeStringContents(&UpgradePath);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    InstalledSection.LengthInChars = GetPrivateProfileSection(_T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated, PkgIniFile.StartOfString);
+    YoriLibConstantString(&InstalledSection, _T("Installed"));
+    YoriLibConstantString(&UpgradePathKey, _T("UpgradePath"));
 
-    YoriLibInitEmptyString(&PkgNameOnly);
-    ThisLine = InstalledSection.StartOfString;
+    //
+    //  Count the installed packages to find the largest number of packages
+    //  that could be upgraded.
+    //
+
+    PackageCount = 0;
+    Position = YoriLibIniGetNextKey(IniFile, &InstalledSection, NULL, &PkgNameOnly, &InstalledVersion);
+    while (Position != NULL) {
+        PackageCount++;
+        Position = YoriLibIniGetNextKey(IniFile, &InstalledSection, Position, &PkgNameOnly, &InstalledVersion);
+    }
 
     Result = FALSE;
-    while (*ThisLine != '\0') {
-        LineLength = _tcslen(ThisLine);
-        PkgNameOnly.StartOfString = ThisLine;
-        Equals = _tcschr(ThisLine, '=');
-        if (Equals != NULL) {
-            PkgNameOnly.LengthInChars = (DWORD)(Equals - ThisLine);
-            *Equals = '\0';
-            YoriLibConstantString(&InstalledVersion, Equals + 1);
-        } else {
-            PkgNameOnly.LengthInChars = LineLength;
-            YoriLibInitEmptyString(&InstalledVersion);
+    UpgradeCount = 0;
+    UpgradeUrls = NULL;
+    if (PackageCount > 0) {
+        UpgradeUrls = YoriLibMalloc(PackageCount * sizeof(YORI_STRING));
+        if (UpgradeUrls == NULL) {
+            goto Exit;
+        }
+    }
+
+    Position = YoriLibIniGetNextKey(IniFile, &InstalledSection, NULL, &PkgNameOnly, &InstalledVersion);
+    while (Position != NULL && UpgradeCount < PackageCount) {
+
+        //
+        //  The upgrade path may be rewritten for a new architecture, so
+        //  copy it into a buffer owned by this function.
+        //
+
+        UpgradePath.LengthInChars = 0;
+        if (YoriLibIniGetString(IniFile, &PkgNameOnly, &UpgradePathKey, &IniValue)) {
+            if (IniValue.LengthInChars < UpgradePath.LengthAllocated) {
+                memcpy(UpgradePath.StartOfString, IniValue.StartOfString, IniValue.LengthInChars * sizeof(TCHAR));
+                UpgradePath.LengthInChars = IniValue.LengthInChars;
+            }
+            YoriLibFreeStringContents(&IniValue);
         }
+        UpgradePath.StartOfString[UpgradePath.LengthInChars] = '\0';
 
-        UpgradePath.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString, _T("UpgradePath"), _T(""), UpgradePath.StartOfString, UpgradePath.LengthAllocated, PkgIniFile.StartOfString);
         if (UpgradePath.LengthInChars > 0) {
             UpgradeThisPackage = TRUE;
             YoriLibInitEmptyString(&RedirectedPath);
@@ -112,33 +141,62 @@ YoriPkgUpgradeInstalledPackages(
             }
             if (UpgradeThisPackage) {
                 if (RedirectedPath.LengthInChars > 0) {
-                    Error = YoriPkgPreparePackageForInstallRedirectBuild(&PkgIniFile, NULL, &PendingPackages, &RedirectedPath);
-                    YoriLibFreeStringContents(&RedirectedPath);
+                    memcpy(&UpgradeUrls[UpgradeCount], &RedirectedPath, sizeof(YORI_STRING));
                 } else {
-                    Error = YoriPkgPreparePackageForInstallRedirectBuild(&PkgIniFile, NULL, &PendingPackages, &UpgradePath);
-                }
-                if (Error != ERROR_SUCCESS) {
-                    YoriPkgDisplayErrorStringForInstallFailure(Error);
-                    goto Exit;
+                    YoriLibFreeStringContents(&RedirectedPath);
+                    if (!YoriLibAllocateString(&UpgradeUrls[UpgradeCount], UpgradePath.LengthInChars + 1)) {
+                        goto Exit;
+                    }
+                    UpgradeUrls[UpgradeCount].LengthInChars = YoriLibSPrintf(UpgradeUrls[UpgradeCount].StartOfString, _T("%y"), &UpgradePath);
                 }
+                YoriPkgQueuePrefetchForUpgrade(&PendingPackages, &PkgIniFile, &UpgradeUrls[UpgradeCount]);
+                UpgradeCount++;
             }
         }
-        if (Equals) {
-            *Equals = '=';
-        }
 
-        ThisLine += LineLength;
-        ThisLine++;
+        Position = YoriLibIniGetNextKey(IniFile, &InstalledSection, Position, &PkgNameOnly, &InstalledVersion);
+    }
+
+    //
+    //  Fetch every package being upgraded concurrently, using the local
+    //  package cache if one is configured, then prepare each for install.
+    //
+
+    YoriPkgExecutePrefetch(&PkgIniFile);
+
+    for (Index = 0; Index < UpgradeCount; Index++) {
+        Error = YoriPkgPreparePackageForInstallRedirectBuild(&PkgIniFile, NULL, &PendingPackages, &UpgradeUrls[Index]);
+        if (Error != ERROR_SUCCESS) {
+            YoriPkgDisplayErrorStringForInstallFailure(Error);
+            goto Exit;
+        }
     }
 
     //
-    //  Upgrade all packages which specify an upgrade path.
+    //  Upgrade all packages which specify an upgrade path.  The install
+    //  updates the INI file on disk, so the copy in memory is discarded
+    //  first.
     //
 
+    YoriLibIniClose(IniFile);
+    IniFile = NULL;
     Result = YoriPkgInstallPendingPackages(&PkgIniFile, NULL, &PendingPackages);
 
 Exit:
 
+    if (IniFile != NULL) {
+        YoriLibIniClose(IniFile);
+    }
+
+    if (UpgradeUrls != NULL) {
+        for (Index = 0; Index < UpgradeCount; Index++) {
+            YoriLibFreeStringContents(&UpgradeUrls[Index]);
+        }
+        YoriLibFree(UpgradeUrls);
+    }
+
+    YoriPkgFreePrefetchedPackages();
+
     //
     //  If there's any backup left, abort the install of those packages.
     //
@@ -150,7 +208,6 @@ Exit:
     YoriPkgDeletePendingPackages(&PendingPackages);
 
     YoriLibFreeStringContents(&PkgIniFile);
-    YoriLibFreeStringContents(&InstalledSection);
     YoriLibFreeStringContents(&UpgradePath);
 
     return TRUE;
@@ -216,6 +273,14 @@ YoriPkgUpgradeSinglePackage(
         YoriPkgBuildUpgradeLocationForNewArchitecture(PackageName, NewArchitecture, &PkgIniFile, &IniValue);
     }
 
+    //
+    //  Fetch the package through the local package cache if one is
+    //  configured.
+    //
+
+    YoriPkgQueuePrefetchForUpgrade(&PendingPackages, &PkgIniFile, &IniValue);
+    YoriPkgExecutePrefetch(&PkgIniFile);
+
     Result = FALSE;
     Error = YoriPkgPreparePackageForInstallRedirectBuild(&PkgIniFile, NULL, &PendingPackages, &IniValue);
     if (Error != ERROR_SUCCESS) {
@@ -231,6 +296,7 @@ Exit:
     }
 
     YoriPkgDeletePendingPackages(&PendingPackages);
+    YoriPkgFreePrefetchedPackages();
 
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&IniValue);
@@ -305,11 +371,12 @@ YoriPkgInstallSourceForInstalledPackages(
 {
     YORI_STRING PkgIniFile;
     YORI_STRING InstalledSection;
-    LPTSTR ThisLine;
-    LPTSTR Equals;
+    YORI_STRING SourcePathKey;
     YORI_STRING PkgNameOnly;
+    YORI_STRING PkgVersion;
     YORI_STRING SourcePath;
-    DWORD LineLength;
+    PVOID IniFile;
+    PVOID Position;
     DWORD Error;
     BOOL Result;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
@@ -323,63 +390,57 @@ YoriPkgInstallSourceForInstalledPackages(
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
+    IniFile = YoriLibIniOpen(&PkgIniFile);
+    if (IniFile == NULL) {
         YoriPkgDeletePendingPackages(&PendingPackages);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&SourcePath, YORIPKG_MAX_FIELD_LENGTH)) {
-        YoriPkgDeletePendingPackages(&PendingPackages);
-        YoriLibFreeStringContents(&InstalledSection);
-        YoriLibFreeStringContents(&PkgIniFile);
-        return FALSE;
-    }
-
-    InstalledSection.LengthInChars = GetPrivateProfileSection(_T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated, PkgIniFile.StartOfString);
-
-    YoriLibInitEmptyString(&PkgNameOnly);
-    ThisLine = InstalledSection.StartOfString;
+    YoriLibConstantString(&InstalledSection, _T("Installed"));
+    YoriLibConstantString(&SourcePathKey, _T("SourcePath"));
 
     Result = FALSE;
-    while (*ThisLine != '\0') {
-        LineLength = _tcslen(ThisLine);
-        PkgNameOnly.StartOfString = ThisLine;
-        Equals = _tcschr(ThisLine, '=');
-        if (Equals != NULL) {
-            PkgNameOnly.LengthInChars = (DWORD)(Equals - ThisLine);
-            *Equals = '\0';
-        } else {
-            PkgNameOnly.LengthInChars = LineLength;
+    Position = YoriLibIniGetNextKey(IniFile, &InstalledSection, NULL, &PkgNameOnly, &PkgVersion);
+    while (Position != NULL) {
+
+        if (!YoriLibIniGetString(IniFile, &PkgNameOnly, &SourcePathKey, &SourcePath)) {
+            YoriLibInitEmptyString(&SourcePath);
         }
 
-        SourcePath.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString, _T("SourcePath"), _T(""), SourcePath.StartOfString, SourcePath.LengthAllocated, PkgIniFile.StartOfString);
         if (SourcePath.LengthInChars > 0) {
+
             if (YoriLibIsPathUrl(&SourcePath)) {
                 YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Downloading source for %y from %y...\n"), &PkgNameOnly, &SourcePath);
             }
             Error = YoriPkgPreparePackageForInstall(&PkgIniFile, NULL, &PendingPackages, &SourcePath, NULL);
+            YoriLibFreeStringContents(&SourcePath);
             if (Error != ERROR_SUCCESS) {
                 YoriPkgDisplayErrorStringForInstallFailure(Error);
                 goto Exit;
             }
         }
-        if (Equals) {
-            *Equals = '=';
-        }
+        YoriLibFreeStringContents(&SourcePath);
 
-        ThisLine += LineLength;
-        ThisLine++;
+        Position = YoriLibIniGetNextKey(IniFile, &InstalledSection, Position, &PkgNameOnly, &PkgVersion);
     }
 
     //
-    //  Install all packages which specify a source path.
+    //  Install all packages which specify a source path.  The install
+    //  updates the INI file on disk, so the copy in memory is discarded
+    //  first.
     //
 
+    YoriLibIniClose(IniFile);
+    IniFile = NULL;
     Result = YoriPkgInstallPendingPackages(&PkgIniFile, NULL, &PendingPackages);
 
 Exit:
 
+    if (IniFile != NULL) {
+        YoriLibIniClose(IniFile);
+    }
+
     //
     //  If there's any backup left, abort the install of those packages.
     //
@@ -391,8 +452,6 @@ Exit:
     YoriPkgDeletePendingPackages(&PendingPackages);
 
     YoriLibFreeStringContents(&PkgIniFile);
-    YoriLibFreeStringContents(&InstalledSection);
-    YoriLibFreeStringContents(&SourcePath);
 
     return TRUE;
 }
@@ -485,11 +544,12 @@ YoriPkgInstallSymbolsForInstalledPackages(
 {
     YORI_STRING PkgIniFile;
     YORI_STRING InstalledSection;
-    LPTSTR ThisLine;
-    LPTSTR Equals;
+    YORI_STRING SymbolPathKey;
     YORI_STRING PkgNameOnly;
+    YORI_STRING PkgVersion;
     YORI_STRING SymbolPath;
-    DWORD LineLength;
+    PVOID IniFile;
+    PVOID Position;
     DWORD TotalCount;
     DWORD Error;
     BOOL Result;
@@ -504,65 +564,59 @@ YoriPkgInstallSymbolsForInstalledPackages(
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
-        YoriPkgDeletePendingPackages(&PendingPackages);
-        YoriLibFreeStringContents(&PkgIniFile);
-        return FALSE;
-    }
-
-    if (!YoriLibAllocateString(&SymbolPath, YORIPKG_MAX_FIELD_LENGTH)) {
+    IniFile = YoriLibIniOpen(&PkgIniFile);
+    if (IniFile == NULL) {
         YoriPkgDeletePendingPackages(&PendingPackages);
-        YoriLibFreeStringContents(&InstalledSection);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    InstalledSection.LengthInChars = GetPrivateProfileSection(_T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated, PkgIniFile.StartOfString);
-
-    YoriLibInitEmptyString(&PkgNameOnly);
-    ThisLine = InstalledSection.StartOfString;
+    YoriLibConstantString(&InstalledSection, _T("Installed"));
+    YoriLibConstantString(&SymbolPathKey, _T("SymbolPath"));
 
     TotalCount = 0;
     Result = FALSE;
-    while (*ThisLine != '\0') {
-        LineLength = _tcslen(ThisLine);
-        PkgNameOnly.StartOfString = ThisLine;
-        Equals = _tcschr(ThisLine, '=');
-        if (Equals != NULL) {
-            PkgNameOnly.LengthInChars = (DWORD)(Equals - ThisLine);
-            *Equals = '\0';
-        } else {
-            PkgNameOnly.LengthInChars = LineLength;
+    Position = YoriLibIniGetNextKey(IniFile, &InstalledSection, NULL, &PkgNameOnly, &PkgVersion);
+    while (Position != NULL) {
+
+        if (!YoriLibIniGetString(IniFile, &PkgNameOnly, &SymbolPathKey, &SymbolPath)) {
+            YoriLibInitEmptyString(&SymbolPath);
         }
 
-        SymbolPath.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString, _T("SymbolPath"), _T(""), SymbolPath.StartOfString, SymbolPath.LengthAllocated, PkgIniFile.StartOfString);
         if (SymbolPath.LengthInChars > 0) {
+
             if (YoriLibIsPathUrl(&SymbolPath)) {
                 YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Downloading symbols for %y from %y...\n"), &PkgNameOnly, &SymbolPath);
             }
             Error = YoriPkgPreparePackageForInstall(&PkgIniFile, NULL, &PendingPackages, &SymbolPath, NULL);
+            YoriLibFreeStringContents(&SymbolPath);
             if (Error != ERROR_SUCCESS) {
                 YoriPkgDisplayErrorStringForInstallFailure(Error);
                 goto Exit;
             }
             TotalCount++;
         }
-        if (Equals) {
-            *Equals = '=';
-        }
+        YoriLibFreeStringContents(&SymbolPath);
 
-        ThisLine += LineLength;
-        ThisLine++;
+        Position = YoriLibIniGetNextKey(IniFile, &InstalledSection, Position, &PkgNameOnly, &PkgVersion);
     }
 
     //
-    //  Install all packages which specify a source path.
+    //  Install all packages which specify a source path.  The install
+    //  updates the INI file on disk, so the copy in memory is discarded
+    //  first.
     //
 
+    YoriLibIniClose(IniFile);
+    IniFile = NULL;
     Result = YoriPkgInstallPendingPackages(&PkgIniFile, NULL, &PendingPackages);
 
 Exit:
 
+    if (IniFile != NULL) {
+        YoriLibIniClose(IniFile);
+    }
+
     //
     //  If there's any backup left, abort the install of those packages.
     //
@@ -574,8 +628,6 @@ Exit:
     YoriPkgDeletePendingPackages(&PendingPackages);
 
     YoriLibFreeStringContents(&PkgIniFile);
-    YoriLibFreeStringContents(&InstalledSection);
-    YoriLibFreeStringContents(&SymbolPath);
 
     return TRUE;
 }
@@ -672,63 +724,48 @@ YoriPkgListInstalledPackages(
 {
     YORI_STRING PkgIniFile;
     YORI_STRING InstalledSection;
-    LPTSTR ThisLine;
-    LPTSTR Equals;
+    YORI_STRING ArchitectureKey;
     YORI_STRING PkgNameOnly;
     YORI_STRING PkgVersion;
     YORI_STRING PkgArch;
+    PVOID IniFile;
+    PVOID Position;
 
     if (!YoriPkgGetPackageIniFile(NULL, &PkgIniFile)) {
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
-        YoriLibFreeStringContents(&PkgIniFile);
-        return FALSE;
-    }
+    //
+    //  Parse the INI file once rather than asking the system to reparse it
+    //  for each installed package.
+    //
 
-    if (!YoriLibAllocateString(&PkgArch, YORIPKG_MAX_FIELD_LENGTH)) {
-        YoriLibFreeStringContents(&InstalledSection);
-        YoriLibFreeStringContents(&PkgIniFile);
+    IniFile = YoriLibIniOpen(&PkgIniFile);
+    YoriLibFreeStringContents(&PkgIniFile);
+    if (IniFile == NULL) {
         return FALSE;
     }
 
-    InstalledSection.LengthInChars = GetPrivateProfileSection(_T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated, PkgIniFile.StartOfString);
-
-    YoriLibInitEmptyString(&PkgNameOnly);
-    YoriLibInitEmptyString(&PkgVersion);
-    ThisLine = InstalledSection.StartOfString;
-
-    while (*ThisLine != '\0') {
-        PkgNameOnly.StartOfString = ThisLine;
-        Equals = _tcschr(ThisLine, '=');
-        if (Equals != NULL) {
-            PkgNameOnly.LengthInChars = (DWORD)(Equals - ThisLine);
-            PkgVersion.StartOfString = Equals + 1;
-            PkgVersion.LengthInChars = _tcslen(Equals + 1);
-        } else {
-            PkgNameOnly.LengthInChars = _tcslen(ThisLine);
-            PkgVersion.StartOfString = NULL;
-            PkgVersion.LengthInChars = 0;
-        }
+    YoriLibConstantString(&InstalledSection, _T("Installed"));
+    YoriLibConstantString(&ArchitectureKey, _T("Architecture"));
 
-        ThisLine += _tcslen(ThisLine);
-        ThisLine++;
-
-        PkgNameOnly.StartOfString[PkgNameOnly.LengthInChars] = '\0';
-
-        PkgArch.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString, _T("Architecture"), _T(""), PkgArch.StartOfString, PkgArch.LengthAllocated, PkgIniFile.StartOfString);
+    Position = YoriLibIniGetNextKey(IniFile, &InstalledSection, NULL, &PkgNameOnly, &PkgVersion);
+    while (Position != NULL) {
 
         if (Verbose) {
+            if (!YoriLibIniGetString(IniFile, &PkgNameOnly, &ArchitectureKey, &PkgArch)) {
+                YoriLibInitEmptyString(&PkgArch);
+            }
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %y (%y)\n"), &PkgNameOnly, &PkgVersion, &PkgArch);
+            YoriLibFreeStringContents(&PkgArch);
         } else {
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &PkgNameOnly);
         }
+
+        Position = YoriLibIniGetNextKey(IniFile, &InstalledSection, Position, &PkgNameOnly, &PkgVersion);
     }
 
-    YoriLibFreeStringContents(&PkgIniFile);
-    YoriLibFreeStringContents(&InstalledSection);
-    YoriLibFreeStringContents(&PkgArch);
+    YoriLibIniClose(IniFile);
 
     return TRUE;
 }
@@ -0,0 +1,575 @@
+/**
+ * @file pkglib/prefetch.c
+ *
+ * Yori package manager concurrent package download and local cache
+ *
+ * Copyright (c) 2020 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "yoripkg.h"
+#include "yoripkgp.h"
+
+/**
+ The maximum number of packages to download at the same time.
+ */
+#define YORIPKG_PREFETCH_MAX_THREADS (4)
+
+/**
+ Information about a single package that is being, or has been, fetched
+ ahead of the point where it is needed.
+ */
+typedef struct _YORIPKG_PREFETCH_ENTRY {
+
+    /**
+     The list of packages that have been queued for prefetch.  The list head
+     is YoriPkgPrefetchList.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The package path as it will later be supplied to
+     YoriPkgPackagePathToLocalPath.  This may be local or remote.
+     */
+    YORI_STRING PackagePath;
+
+    /**
+     Optionally, a fully qualified path in the local package cache where this
+     package is stored once fetched.  This is an empty string if there is no
+     package cache.
+     */
+    YORI_STRING CachePath;
+
+    /**
+     On successful completion, a fully qualified local path to the package.
+     */
+    YORI_STRING LocalPath;
+
+    /**
+     TRUE if LocalPath refers to a temporary file that should be deleted
+     once processing is complete.
+     */
+    BOOL DeleteWhenFinished;
+
+    /**
+     The result of fetching the package.  Only packages that were fetched
+     successfully are returned to callers; if anything went wrong, the
+     package is fetched again at the point it is needed so that the error
+     is reported in context.
+     */
+    DWORD Result;
+} YORIPKG_PREFETCH_ENTRY, *PYORIPKG_PREFETCH_ENTRY;
+
+/**
+ The list of packages that have been queued for prefetch.
+ */
+YORI_LIST_ENTRY YoriPkgPrefetchList;
+
+/**
+ TRUE once YoriPkgPrefetchList has been initialized.
+ */
+BOOL YoriPkgPrefetchListInitialized;
+
+/**
+ TRUE while worker threads are fetching packages.  During this time the
+ results are not available to YoriPkgTakePrefetchedPackage, which is
+ important because the worker threads themselves call
+ YoriPkgPackagePathToLocalPath.
+ */
+BOOL YoriPkgPrefetchActive;
+
+/**
+ Context shared between each prefetch worker thread.
+ */
+typedef struct _YORIPKG_PREFETCH_CONTEXT {
+
+    /**
+     An array of pointers to the packages to fetch.
+     */
+    PYORIPKG_PREFETCH_ENTRY *Entries;
+
+    /**
+     The number of elements in the Entries array.
+     */
+    DWORD EntryCount;
+
+    /**
+     The index of the next entry for a worker to process.  This is updated
+     with interlocked operations.
+     */
+    LONG NextEntry;
+
+    /**
+     Optionally points to the package INI file, used to resolve mirrors.
+     */
+    PYORI_STRING IniFilePath;
+} YORIPKG_PREFETCH_CONTEXT, *PYORIPKG_PREFETCH_CONTEXT;
+
+/**
+ Determine the path within the local package cache that would hold a
+ specified package.  The package cache is configured by the Directory value
+ in the [Cache] section of the package INI file; if this is not present,
+ there is no package cache.
+
+ Since package lists do not publish a hash of each package, the package is
+ identified by its name, version and architecture, which a package source is
+ not expected to reuse for different contents.
+
+ @param IniFilePath Pointer to the package INI file.
+
+ @param PackageName Pointer to the name of the package.
+
+ @param Version Pointer to the version of the package.
+
+ @param Architecture Pointer to the architecture of the package.
+
+ @param CachePath On successful completion, populated with a fully qualified
+        path to the package within the cache.
+
+ @return TRUE to indicate a package cache is configured and CachePath has
+         been populated, FALSE if there is no package cache.
+ */
+__success(return)
+BOOL
+YoriPkgGetPackageCachePath(
+    __in PYORI_STRING IniFilePath,
+    __in PYORI_STRING PackageName,
+    __in PYORI_STRING Version,
+    __in PYORI_STRING Architecture,
+    __out PYORI_STRING CachePath
+    )
+{
+    YORI_STRING IniValue;
+    YORI_STRING CacheDirectory;
+    DWORD Index;
+    DWORD PrefixLength;
+    TCHAR Char;
+
+    if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+        return FALSE;
+    }
+
+    IniValue.LengthInChars = GetPrivateProfileString(_T("Cache"), _T("Directory"), _T(""), IniValue.StartOfString, IniValue.LengthAllocated, IniFilePath->StartOfString);
+    if (IniValue.LengthInChars == 0) {
+        YoriLibFreeStringContents(&IniValue);
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&CacheDirectory);
+    if (!YoriLibUserStringToSingleFilePath(&IniValue, FALSE, &CacheDirectory)) {
+        YoriLibFreeStringContents(&IniValue);
+        return FALSE;
+    }
+    YoriLibFreeStringContents(&IniValue);
+
+    YoriLibInitEmptyString(CachePath);
+    YoriLibYPrintf(CachePath, _T("%y\\%y-%y-%y.cab"), &CacheDirectory, PackageName, Version, Architecture);
+    PrefixLength = CacheDirectory.LengthInChars + 1;
+    YoriLibFreeStringContents(&CacheDirectory);
+    if (CachePath->StartOfString == NULL) {
+        return FALSE;
+    }
+
+    //
+    //  The name, version and architecture come from a remote package list,
+    //  so don't allow them to refer to anything outside of the cache
+    //  directory.
+    //
+
+    for (Index = PrefixLength; Index < CachePath->LengthInChars; Index++) {
+        Char = CachePath->StartOfString[Index];
+        if (!((Char >= 'a' && Char <= 'z') ||
+              (Char >= 'A' && Char <= 'Z') ||
+              (Char >= '0' && Char <= '9') ||
+              Char == '.' || Char == '-' || Char == '_')) {
+
+            CachePath->StartOfString[Index] = '_';
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Add a package to the list of packages to fetch by the next call to
+ YoriPkgExecutePrefetch.
+
+ @param PackagePath Pointer to the path to the package, as it will later be
+        supplied to YoriPkgPackagePathToLocalPath.
+
+ @param CachePath Optionally points to a path in the local package cache
+        for the package, as returned from YoriPkgGetPackageCachePath.
+
+ @return TRUE to indicate the package was queued, FALSE if it was not.
+         Failure to queue a package is not fatal; it will be fetched when
+         it is needed.
+ */
+__success(return)
+BOOL
+YoriPkgQueuePrefetch(
+    __in PYORI_STRING PackagePath,
+    __in_opt PYORI_STRING CachePath
+    )
+{
+    PYORIPKG_PREFETCH_ENTRY Entry;
+
+    if (!YoriPkgPrefetchListInitialized) {
+        YoriLibInitializeListHead(&YoriPkgPrefetchList);
+        YoriPkgPrefetchListInitialized = TRUE;
+    }
+
+    Entry = YoriLibMalloc(sizeof(YORIPKG_PREFETCH_ENTRY));
+    if (Entry == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(Entry, sizeof(YORIPKG_PREFETCH_ENTRY));
+    if (!YoriLibAllocateString(&Entry->PackagePath, PackagePath->LengthInChars + 1)) {
+        YoriLibFree(Entry);
+        return FALSE;
+    }
+    memcpy(Entry->PackagePath.StartOfString, PackagePath->StartOfString, PackagePath->LengthInChars * sizeof(TCHAR));
+    Entry->PackagePath.LengthInChars = PackagePath->LengthInChars;
+    Entry->PackagePath.StartOfString[Entry->PackagePath.LengthInChars] = '\0';
+
+    if (CachePath != NULL) {
+        YoriLibCloneString(&Entry->CachePath, CachePath);
+    }
+
+    Entry->Result = ERROR_NOT_READY;
+    YoriLibAppendList(&YoriPkgPrefetchList, &Entry->ListEntry);
+    return TRUE;
+}
+
+/**
+ Fetch a single package, using or populating the local package cache if one
+ is configured.
+
+ @param Entry Pointer to the package to fetch.
+
+ @param IniFilePath Optionally points to the package INI file, used to
+        resolve mirrors.
+ */
+VOID
+YoriPkgPrefetchPackage(
+    __in PYORIPKG_PREFETCH_ENTRY Entry,
+    __in_opt PYORI_STRING IniFilePath
+    )
+{
+    YORI_STRING PartialPath;
+    YORI_STRING CacheDirectory;
+    DWORD Index;
+
+    //
+    //  If the package is already in the cache, use it from there.
+    //
+
+    if (Entry->CachePath.LengthInChars > 0 &&
+        GetFileAttributes(Entry->CachePath.StartOfString) != (DWORD)-1) {
+
+        YoriLibCloneString(&Entry->LocalPath, &Entry->CachePath);
+        Entry->DeleteWhenFinished = FALSE;
+        Entry->Result = ERROR_SUCCESS;
+        return;
+    }
+
+    Entry->Result = YoriPkgPackagePathToLocalPath(&Entry->PackagePath, IniFilePath, &Entry->LocalPath, &Entry->DeleteWhenFinished);
+    if (Entry->Result != ERROR_SUCCESS) {
+        return;
+    }
+
+    //
+    //  Only downloaded packages are added to the cache.  Local packages are
+    //  used in place, regardless of whether a cache is configured.
+    //
+
+    if (!Entry->DeleteWhenFinished || Entry->CachePath.LengthInChars == 0) {
+        return;
+    }
+
+    //
+    //  Create the cache directory if it doesn't exist yet.
+    //
+
+    YoriLibInitEmptyString(&CacheDirectory);
+    for (Index = Entry->CachePath.LengthInChars; Index > 0; Index--) {
+        if (YoriLibIsSep(Entry->CachePath.StartOfString[Index - 1])) {
+            YoriLibAllocateString(&CacheDirectory, Index);
+            if (CacheDirectory.StartOfString != NULL) {
+                memcpy(CacheDirectory.StartOfString, Entry->CachePath.StartOfString, (Index - 1) * sizeof(TCHAR));
+                CacheDirectory.LengthInChars = Index - 1;
+                CacheDirectory.StartOfString[CacheDirectory.LengthInChars] = '\0';
+            }
+            break;
+        }
+    }
+
+    if (CacheDirectory.StartOfString == NULL) {
+        return;
+    }
+
+    YoriLibCreateDirectoryAndParents(&CacheDirectory);
+    YoriLibFreeStringContents(&CacheDirectory);
+
+    //
+    //  Move the download into the cache under a temporary name and rename
+    //  it into place, so a package that was only partially copied is never
+    //  found in the cache.  If anything fails, keep using the temporary
+    //  download.
+    //
+
+    YoriLibInitEmptyString(&PartialPath);
+    YoriLibYPrintf(&PartialPath, _T("%y.partial"), &Entry->CachePath);
+    if (PartialPath.StartOfString == NULL) {
+        return;
+    }
+
+    if (!MoveFileEx(Entry->LocalPath.StartOfString, PartialPath.StartOfString, MOVEFILE_REPLACE_EXISTING | MOVEFILE_COPY_ALLOWED)) {
+        YoriLibFreeStringContents(&PartialPath);
+        return;
+    }
+
+    YoriLibFreeStringContents(&Entry->LocalPath);
+    Entry->DeleteWhenFinished = TRUE;
+    if (MoveFileEx(PartialPath.StartOfString, Entry->CachePath.StartOfString, MOVEFILE_REPLACE_EXISTING)) {
+        YoriLibFreeStringContents(&PartialPath);
+        YoriLibCloneString(&Entry->LocalPath, &Entry->CachePath);
+        Entry->DeleteWhenFinished = FALSE;
+    } else {
+        memcpy(&Entry->LocalPath, &PartialPath, sizeof(YORI_STRING));
+    }
+}
+
+/**
+ A worker thread which fetches queued packages until there are no more
+ packages to fetch.
+
+ @param Context Pointer to the YORIPKG_PREFETCH_CONTEXT shared by all
+        workers.
+
+ @return Zero.
+ */
+DWORD WINAPI
+YoriPkgPrefetchWorker(
+    __in LPVOID Context
+    )
+{
+    PYORIPKG_PREFETCH_CONTEXT PrefetchContext;
+    LONG Index;
+
+    PrefetchContext = (PYORIPKG_PREFETCH_CONTEXT)Context;
+
+    while (TRUE) {
+        Index = InterlockedIncrement(&PrefetchContext->NextEntry) - 1;
+        if ((DWORD)Index >= PrefetchContext->EntryCount) {
+            break;
+        }
+
+        if (YoriLibIsOperationCancelled()) {
+            break;
+        }
+
+        YoriPkgPrefetchPackage(PrefetchContext->Entries[Index], PrefetchContext->IniFilePath);
+    }
+
+    return 0;
+}
+
+/**
+ Fetch all packages queued with YoriPkgQueuePrefetch, using a bounded number
+ of concurrent downloads.  Packages that have been fetched are subsequently
+ returned from YoriPkgPackagePathToLocalPath without being fetched again.
+
+ @param IniFilePath Optionally points to the package INI file, used to
+        resolve mirrors.  This should be the same value that will be passed
+        to YoriPkgPackagePathToLocalPath.
+ */
+VOID
+YoriPkgExecutePrefetch(
+    __in_opt PYORI_STRING IniFilePath
+    )
+{
+    YORIPKG_PREFETCH_CONTEXT Context;
+    HANDLE Threads[YORIPKG_PREFETCH_MAX_THREADS];
+    PYORI_LIST_ENTRY ListEntry;
+    PYORIPKG_PREFETCH_ENTRY Entry;
+    DWORD ThreadCount;
+    DWORD Index;
+    DWORD ThreadId;
+
+    if (!YoriPkgPrefetchListInitialized) {
+        return;
+    }
+
+    ZeroMemory(&Context, sizeof(Context));
+    Context.IniFilePath = IniFilePath;
+
+    ListEntry = NULL;
+    ListEntry = YoriLibGetNextListEntry(&YoriPkgPrefetchList, ListEntry);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, YORIPKG_PREFETCH_ENTRY, ListEntry);
+        if (Entry->Result == ERROR_NOT_READY) {
+            Context.EntryCount++;
+        }
+        ListEntry = YoriLibGetNextListEntry(&YoriPkgPrefetchList, ListEntry);
+    }
+
+    if (Context.EntryCount == 0) {
+        return;
+    }
+
+    Context.Entries = YoriLibMalloc(Context.EntryCount * sizeof(PYORIPKG_PREFETCH_ENTRY));
+    if (Context.Entries == NULL) {
+        return;
+    }
+
+    Index = 0;
+    ListEntry = NULL;
+    ListEntry = YoriLibGetNextListEntry(&YoriPkgPrefetchList, ListEntry);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, YORIPKG_PREFETCH_ENTRY, ListEntry);
+        if (Entry->Result == ERROR_NOT_READY) {
+            Context.Entries[Index] = Entry;
+            Index++;
+        }
+        ListEntry = YoriLibGetNextListEntry(&YoriPkgPrefetchList, ListEntry);
+    }
+
+    //
+    //  WinInet is loaded on first use, which is not safe to do from
+    //  multiple threads at once, so load it here before any worker starts.
+    //
+
+    YoriLibLoadWinInetFunctions();
+
+    YoriPkgPrefetchActive = TRUE;
+    ThreadCount = 0;
+    if (Context.EntryCount > 1) {
+        for (Index = 0; Index < YORIPKG_PREFETCH_MAX_THREADS && Index < Context.EntryCount; Index++) {
+            Threads[ThreadCount] = CreateThread(NULL, 0, YoriPkgPrefetchWorker, &Context, 0, &ThreadId);
+            if (Threads[ThreadCount] == NULL) {
+                break;
+            }
+            ThreadCount++;
+        }
+    }
+
+    //
+    //  If no threads could be created, or there's only one package, fetch
+    //  on this thread.  Otherwise wait for the workers to drain the list.
+    //
+
+    if (ThreadCount == 0) {
+        YoriPkgPrefetchWorker(&Context);
+    } else {
+        WaitForMultipleObjects(ThreadCount, Threads, TRUE, INFINITE);
+        for (Index = 0; Index < ThreadCount; Index++) {
+            CloseHandle(Threads[Index]);
+        }
+    }
+    YoriPkgPrefetchActive = FALSE;
+
+    YoriLibFree(Context.Entries);
+}
+
+/**
+ Check whether a package has already been fetched by YoriPkgExecutePrefetch,
+ and if so, transfer ownership of the local copy to the caller.
+
+ @param PackagePath Pointer to the path to the package.
+
+ @param LocalPath On successful completion, populated with a fully qualified
+        local path to the package.
+
+ @param DeleteWhenFinished On successful completion, set to TRUE to indicate
+        the caller should delete the file (it is temporary); set to FALSE to
+        indicate the file should be retained.
+
+ @return TRUE to indicate the package had been fetched and LocalPath is
+         populated, FALSE if the package must be fetched by the caller.
+ */
+__success(return)
+BOOL
+YoriPkgTakePrefetchedPackage(
+    __in PYORI_STRING PackagePath,
+    __out PYORI_STRING LocalPath,
+    __out PBOOL DeleteWhenFinished
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORIPKG_PREFETCH_ENTRY Entry;
+
+    if (!YoriPkgPrefetchListInitialized || YoriPkgPrefetchActive) {
+        return FALSE;
+    }
+
+    ListEntry = NULL;
+    ListEntry = YoriLibGetNextListEntry(&YoriPkgPrefetchList, ListEntry);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, YORIPKG_PREFETCH_ENTRY, ListEntry);
+        if (Entry->Result == ERROR_SUCCESS &&
+            Entry->LocalPath.StartOfString != NULL &&
+            YoriLibCompareStringInsensitive(&Entry->PackagePath, PackagePath) == 0) {
+
+            memcpy(LocalPath, &Entry->LocalPath, sizeof(YORI_STRING));
+            *DeleteWhenFinished = Entry->DeleteWhenFinished;
+            YoriLibInitEmptyString(&Entry->LocalPath);
+            Entry->DeleteWhenFinished = FALSE;
+            return TRUE;
+        }
+        ListEntry = YoriLibGetNextListEntry(&YoriPkgPrefetchList, ListEntry);
+    }
+
+    return FALSE;
+}
+
+/**
+ Free all packages queued for prefetch.  Any temporary downloads that were
+ not consumed by a caller are deleted.
+ */
+VOID
+YoriPkgFreePrefetchedPackages(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORIPKG_PREFETCH_ENTRY Entry;
+
+    if (!YoriPkgPrefetchListInitialized) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&YoriPkgPrefetchList, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, YORIPKG_PREFETCH_ENTRY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&YoriPkgPrefetchList, ListEntry);
+
+        YoriLibRemoveListItem(&Entry->ListEntry);
+        if (Entry->DeleteWhenFinished && Entry->LocalPath.StartOfString != NULL) {
+            DeleteFile(Entry->LocalPath.StartOfString);
+        }
+        YoriLibFreeStringContents(&Entry->LocalPath);
+        YoriLibFreeStringContents(&Entry->CachePath);
+        YoriLibFreeStringContents(&Entry->PackagePath);
+        YoriLibFree(Entry);
+    }
+}
+
+// vim:sw=4:ts=4:et:
@@ -806,9 +806,20 @@ YoriPkgDownloadRemotePackages(
     }
 
     //
-    //  Download the packages we found.
+    //  Download the packages we found.  Fetch them all concurrently first,
+    //  then move each into place in order.
     //
 
+    PackageEntry = NULL;
+    PackageEntry = YoriLibGetNextListEntry(&PackageList, PackageEntry);
+    while (PackageEntry != NULL) {
+        Package = CONTAINING_RECORD(PackageEntry, YORIPKG_REMOTE_PACKAGE, PackageList);
+        YoriPkgQueuePrefetch(&Package->InstallUrl, NULL);
+        PackageEntry = YoriLibGetNextListEntry(&PackageList, PackageEntry);
+    }
+
+    YoriPkgExecutePrefetch(NULL);
+
     PackageEntry = NULL;
     PackageEntry = YoriLibGetNextListEntry(&PackageList, PackageEntry);
     while (PackageEntry != NULL) {
@@ -905,6 +916,7 @@ YoriPkgDownloadRemotePackages(
         PackageEntry = YoriLibGetNextListEntry(&PackageList, PackageEntry);
     }
 
+    YoriPkgFreePrefetchedPackages();
     YoriPkgFreeAllSourcesAndPackages(&SourcesList, &PackageList);
     YoriLibFreeStringContents(&PackagesIni);
 
@@ -1161,6 +1173,7 @@ YoriPkgInstallRemotePackages(
     PYORIPKG_REMOTE_PACKAGE Package;
     YORI_STRING IniFile;
     YORI_STRING IniValue;
+    YORI_STRING CachePath;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
     DWORD Error;
 
@@ -1196,6 +1209,27 @@ YoriPkgInstallRemotePackages(
                                                      MatchArch,
                                                      &PackagesMatchingCriteria);
 
+    //
+    //  Fetch all of the packages concurrently, using the local package cache
+    //  if one is configured.
+    //
+
+    PackageEntry = NULL;
+    PackageEntry = YoriLibGetNextListEntry(&PackagesMatchingCriteria, PackageEntry);
+    while (PackageEntry != NULL) {
+        Package = CONTAINING_RECORD(PackageEntry, YORIPKG_REMOTE_PACKAGE, PackageList);
+        PackageEntry = YoriLibGetNextListEntry(&PackagesMatchingCriteria, PackageEntry);
+
+        if (YoriPkgGetPackageCachePath(&IniFile, &Package->PackageName, &Package->Version, &Package->Architecture, &CachePath)) {
+            YoriPkgQueuePrefetch(&Package->InstallUrl, &CachePath);
+            YoriLibFreeStringContents(&CachePath);
+        } else {
+            YoriPkgQueuePrefetch(&Package->InstallUrl, NULL);
+        }
+    }
+
+    YoriPkgExecutePrefetch(&IniFile);
+
     //
     //  Find if any of these are installed and back them up.
     //
@@ -1235,6 +1269,7 @@ Exit:
     }
 
     YoriPkgDeletePendingPackages(&PendingPackages);
+    YoriPkgFreePrefetchedPackages();
 
     YoriPkgFreeAllSourcesAndPackages(NULL, &PackagesMatchingCriteria);
     YoriLibFreeStringContents(&IniFile);
@@ -1570,6 +1605,110 @@ YoriPkgIsNewerVersionAvailable(
     return TRUE;
 }
 
+/**
+ Find a package that has been described by a previously processed
+ pkglist.ini by the URL used to install it.
+
+ @param PendingPackages The set of packages being operated on.  This contains
+        a cache of URLs that are known.
+
+ @param PackageUrl Points to the URL of the package to find.
+
+ @return Pointer to the known package, or NULL if the URL is not known.
+ */
+PYORIPKG_REMOTE_PACKAGE
+YoriPkgFindKnownPackageByUrl(
+    __in PYORIPKG_PACKAGES_PENDING_INSTALL PendingPackages,
+    __in PYORI_STRING PackageUrl
+    )
+{
+    PYORI_LIST_ENTRY ListEntry = NULL;
+    PYORIPKG_REMOTE_PACKAGE KnownPackage;
+
+    ListEntry = YoriLibGetNextListEntry(&PendingPackages->KnownPackages, ListEntry);
+    while (ListEntry != NULL) {
+        KnownPackage = CONTAINING_RECORD(ListEntry, YORIPKG_REMOTE_PACKAGE, PackageList);
+        if (YoriLibCompareString(PackageUrl, &KnownPackage->InstallUrl) == 0) {
+            return KnownPackage;
+        }
+        ListEntry = YoriLibGetNextListEntry(&PendingPackages->KnownPackages, ListEntry);
+    }
+
+    return NULL;
+}
+
+/**
+ Queue a package which is about to be upgraded to be fetched by
+ YoriPkgExecutePrefetch.  If the package is described by a pkglist.ini in
+ its parent directory, its name, version and architecture are known, so the
+ local package cache can satisfy the request or be populated by it.
+
+ @param PendingPackages The set of packages being operated on.  This contains
+        a cache of packages from pkglist.ini files that have been processed,
+        and is updated with any pkglist.ini processed here.
+
+ @param PackagesIni Points to the system's packages.ini file so that
+        mirroring and the package cache can be applied.
+
+ @param PackageUrl Points to the URL of the package that will be installed.
+        This is the value that will later be passed to
+        YoriPkgPackagePathToLocalPath.
+ */
+VOID
+YoriPkgQueuePrefetchForUpgrade(
+    __inout PYORIPKG_PACKAGES_PENDING_INSTALL PendingPackages,
+    __in PYORI_STRING PackagesIni,
+    __in PYORI_STRING PackageUrl
+    )
+{
+    DWORD Index;
+    YORI_STRING Substring;
+    YORI_STRING MirroredPath;
+    YORI_STRING CachePath;
+    PYORIPKG_REMOTE_SOURCE RemoteSource;
+    PYORIPKG_REMOTE_PACKAGE KnownPackage;
+
+    YoriLibInitEmptyString(&MirroredPath);
+    if (!YoriPkgConvertUserPackagePathToMirroredPath(PackageUrl, PackagesIni, &MirroredPath)) {
+        YoriLibCloneString(&MirroredPath, PackageUrl);
+    }
+
+    //
+    //  If the package isn't known from an earlier version check, load
+    //  pkglist.ini from its parent directory.
+    //
+
+    KnownPackage = YoriPkgFindKnownPackageByUrl(PendingPackages, &MirroredPath);
+    if (KnownPackage == NULL) {
+        for (Index = MirroredPath.LengthInChars; Index > 0; Index--) {
+            if (YoriLibIsSep(MirroredPath.StartOfString[Index - 1])) {
+                YoriLibInitEmptyString(&Substring);
+                Substring.StartOfString = MirroredPath.StartOfString;
+                Substring.LengthInChars = Index - 1;
+                RemoteSource = YoriPkgAllocateRemoteSource(&Substring);
+                if (RemoteSource != NULL) {
+                    if (YoriPkgCollectPackagesFromSource(RemoteSource, PackagesIni, &PendingPackages->KnownPackages, NULL) == ERROR_SUCCESS) {
+                        KnownPackage = YoriPkgFindKnownPackageByUrl(PendingPackages, &MirroredPath);
+                    }
+                    YoriPkgFreeRemoteSource(RemoteSource);
+                }
+                break;
+            }
+        }
+    }
+
+    YoriLibFreeStringContents(&MirroredPath);
+
+    if (KnownPackage != NULL &&
+        YoriPkgGetPackageCachePath(PackagesIni, &KnownPackage->PackageName, &KnownPackage->Version, &KnownPackage->Architecture, &CachePath)) {
+
+        YoriPkgQueuePrefetch(PackageUrl, &CachePath);
+        YoriLibFreeStringContents(&CachePath);
+    } else {
+        YoriPkgQueuePrefetch(PackageUrl, NULL);
+    }
+}
+
 /**
  Query the configured sources and display them on the console.
 
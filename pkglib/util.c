@@ -141,6 +141,49 @@ YoriPkgGetPackageIniFile(
     return TRUE;
 }
 
+/**
+ Copy a value from an INI file that has been loaded into memory into a
+ caller supplied buffer.  If the value is not present, or the INI file could
+ not be loaded, the buffer is populated with an empty string.  Values that
+ do not fit are truncated, as GetPrivateProfileString would do.
+
+ @param IniFile Optionally points to the loaded INI file.
+
+ @param SectionName Pointer to the name of the section.
+
+ @param KeyName Pointer to a NULL terminated name of the key.
+
+ @param Value Pointer to a string with a buffer allocated, which is updated
+        to contain the value.
+ */
+VOID
+YoriPkgCopyIniValue(
+    __in_opt PVOID IniFile,
+    __in PCYORI_STRING SectionName,
+    __in LPCTSTR KeyName,
+    __inout PYORI_STRING Value
+    )
+{
+    YORI_STRING Key;
+    YORI_STRING Found;
+    DWORD Length;
+
+    Value->LengthInChars = 0;
+    if (IniFile != NULL) {
+        YoriLibConstantString(&Key, KeyName);
+        if (YoriLibIniGetString(IniFile, SectionName, &Key, &Found)) {
+            Length = Found.LengthInChars;
+            if (Length >= Value->LengthAllocated) {
+                Length = Value->LengthAllocated - 1;
+            }
+            memcpy(Value->StartOfString, Found.StartOfString, Length * sizeof(TCHAR));
+            Value->LengthInChars = Length;
+            YoriLibFreeStringContents(&Found);
+        }
+    }
+    Value->StartOfString[Value->LengthInChars] = '\0';
+}
+
 /**
  Given a fully qualified path to a package's INI file, extract package
  information.
@@ -190,58 +233,72 @@ YoriPkgGetPackageInfo(
     )
 {
     YORI_STRING TempBuffer;
+    YORI_STRING PackageSection;
+    PVOID IniFile;
     DWORD MaxFieldSize = YORIPKG_MAX_FIELD_LENGTH;
 
     if (!YoriLibAllocateString(&TempBuffer, 8 * MaxFieldSize)) {
         return FALSE;
     }
 
+    //
+    //  If the file can't be loaded, every field is returned empty, as
+    //  GetPrivateProfileString would do.
+    //
+
+    YoriLibConstantString(&PackageSection, _T("Package"));
+    IniFile = YoriLibIniOpen(IniPath);
+
     YoriLibCloneString(PackageName, &TempBuffer);
     PackageName->LengthAllocated = MaxFieldSize;
 
-    PackageName->LengthInChars = GetPrivateProfileString(_T("Package"), _T("Name"), _T(""), PackageName->StartOfString, PackageName->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, &PackageSection, _T("Name"), PackageName);
 
     YoriLibCloneString(PackageVersion, &TempBuffer);
     PackageVersion->StartOfString += 1 * MaxFieldSize;
     PackageVersion->LengthAllocated = MaxFieldSize;
 
-    PackageVersion->LengthInChars = GetPrivateProfileString(_T("Package"), _T("Version"), _T(""), PackageVersion->StartOfString, PackageVersion->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, &PackageSection, _T("Version"), PackageVersion);
 
     YoriLibCloneString(PackageArch, &TempBuffer);
     PackageArch->StartOfString += 2 * MaxFieldSize;
     PackageArch->LengthAllocated = MaxFieldSize;
 
-    PackageArch->LengthInChars = GetPrivateProfileString(_T("Package"), _T("Architecture"), _T(""), PackageArch->StartOfString, PackageArch->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, &PackageSection, _T("Architecture"), PackageArch);
 
     YoriLibCloneString(MinimumOSBuild, &TempBuffer);
     MinimumOSBuild->StartOfString += 3 * MaxFieldSize;
     MinimumOSBuild->LengthAllocated = MaxFieldSize;
 
-    MinimumOSBuild->LengthInChars = GetPrivateProfileString(_T("Package"), _T("MinimumOSBuild"), _T(""), MinimumOSBuild->StartOfString, MinimumOSBuild->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, &PackageSection, _T("MinimumOSBuild"), MinimumOSBuild);
 
     YoriLibCloneString(PackagePathForOlderBuilds, &TempBuffer);
     PackagePathForOlderBuilds->StartOfString += 4 * MaxFieldSize;
     PackagePathForOlderBuilds->LengthAllocated = MaxFieldSize;
 
-    PackagePathForOlderBuilds->LengthInChars = GetPrivateProfileString(_T("Package"), _T("PackagePathForOlderBuilds"), _T(""), PackagePathForOlderBuilds->StartOfString, PackagePathForOlderBuilds->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, &PackageSection, _T("PackagePathForOlderBuilds"), PackagePathForOlderBuilds);
 
     YoriLibCloneString(UpgradePath, &TempBuffer);
     UpgradePath->StartOfString += 5 * MaxFieldSize;
     UpgradePath->LengthAllocated = MaxFieldSize;
 
-    UpgradePath->LengthInChars = GetPrivateProfileString(_T("Package"), _T("UpgradePath"), _T(""), UpgradePath->StartOfString, UpgradePath->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, &PackageSection, _T("UpgradePath"), UpgradePath);
 
     YoriLibCloneString(SourcePath, &TempBuffer);
     SourcePath->StartOfString += 6 * MaxFieldSize;
     SourcePath->LengthAllocated = MaxFieldSize;
 
-    SourcePath->LengthInChars = GetPrivateProfileString(_T("Package"), _T("SourcePath"), _T(""), SourcePath->StartOfString, SourcePath->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, &PackageSection, _T("SourcePath"), SourcePath);
 
     YoriLibCloneString(SymbolPath, &TempBuffer);
     SymbolPath->StartOfString += 7 * MaxFieldSize;
     SymbolPath->LengthAllocated = MaxFieldSize;
 
-    SymbolPath->LengthInChars = GetPrivateProfileString(_T("Package"), _T("SymbolPath"), _T(""), SymbolPath->StartOfString, SymbolPath->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, &PackageSection, _T("SymbolPath"), SymbolPath);
+
+    if (IniFile != NULL) {
+        YoriLibIniClose(IniFile);
+    }
 
     YoriLibFreeStringContents(&TempBuffer);
     return TRUE;
@@ -285,6 +342,7 @@ YoriPkgGetInstalledPackageInfo(
     )
 {
     YORI_STRING TempBuffer;
+    PVOID IniFile;
     DWORD MaxFieldSize = YORIPKG_MAX_FIELD_LENGTH;
 
     ASSERT(YoriLibIsStringNullTerminated(IniPath));
@@ -294,34 +352,40 @@ YoriPkgGetInstalledPackageInfo(
         return FALSE;
     }
 
+    IniFile = YoriLibIniOpen(IniPath);
+
     YoriLibCloneString(PackageVersion, &TempBuffer);
     PackageVersion->LengthAllocated = MaxFieldSize;
 
-    PackageVersion->LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("Version"), _T(""), PackageVersion->StartOfString, PackageVersion->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, PackageName, _T("Version"), PackageVersion);
 
     YoriLibCloneString(PackageArch, &TempBuffer);
     PackageArch->StartOfString += 1 * MaxFieldSize;
     PackageArch->LengthAllocated = MaxFieldSize;
 
-    PackageArch->LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("Architecture"), _T(""), PackageArch->StartOfString, PackageArch->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, PackageName, _T("Architecture"), PackageArch);
 
     YoriLibCloneString(UpgradePath, &TempBuffer);
     UpgradePath->StartOfString += 2 * MaxFieldSize;
     UpgradePath->LengthAllocated = MaxFieldSize;
 
-    UpgradePath->LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("UpgradePath"), _T(""), UpgradePath->StartOfString, UpgradePath->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, PackageName, _T("UpgradePath"), UpgradePath);
 
     YoriLibCloneString(SourcePath, &TempBuffer);
     SourcePath->StartOfString += 3 * MaxFieldSize;
     SourcePath->LengthAllocated = MaxFieldSize;
 
-    SourcePath->LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("SourcePath"), _T(""), SourcePath->StartOfString, SourcePath->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, PackageName, _T("SourcePath"), SourcePath);
 
     YoriLibCloneString(SymbolPath, &TempBuffer);
     SymbolPath->StartOfString += 4 * MaxFieldSize;
     SymbolPath->LengthAllocated = MaxFieldSize;
 
-    SymbolPath->LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("SymbolPath"), _T(""), SymbolPath->StartOfString, SymbolPath->LengthAllocated, IniPath->StartOfString);
+    YoriPkgCopyIniValue(IniFile, PackageName, _T("SymbolPath"), SymbolPath);
+
+    if (IniFile != NULL) {
+        YoriLibIniClose(IniFile);
+    }
 
     YoriLibFreeStringContents(&TempBuffer);
     return TRUE;
@@ -918,6 +982,14 @@ YoriPkgPackagePathToLocalPath(
     YORI_STRING MirroredPath;
     DWORD Result = ERROR_SUCCESS;
 
+    //
+    //  If the package has already been fetched, use that copy.
+    //
+
+    if (YoriPkgTakePrefetchedPackage(PackagePath, LocalPath, DeleteWhenFinished)) {
+        return ERROR_SUCCESS;
+    }
+
     YoriLibInitEmptyString(&MirroredPath);
 
     //
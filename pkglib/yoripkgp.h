@@ -339,6 +339,13 @@ YoriPkgIsNewerVersionAvailable(
     __out PYORI_STRING RedirectToPackageUrl
     );
 
+VOID
+YoriPkgQueuePrefetchForUpgrade(
+    __inout PYORIPKG_PACKAGES_PENDING_INSTALL PendingPackages,
+    __in PYORI_STRING PackagesIni,
+    __in PYORI_STRING PackageUrl
+    );
+
 VOID
 YoriPkgFreeAllSourcesAndPackages(
     __in_opt PYORI_LIST_ENTRY SourcesList,
@@ -472,4 +479,37 @@ BOOL
 YoriPkgRemoveUninstallEntry(
     );
 
+__success(return)
+BOOL
+YoriPkgGetPackageCachePath(
+    __in PYORI_STRING IniFilePath,
+    __in PYORI_STRING PackageName,
+    __in PYORI_STRING Version,
+    __in PYORI_STRING Architecture,
+    __out PYORI_STRING CachePath
+    );
+
+__success(return)
+BOOL
+YoriPkgQueuePrefetch(
+    __in PYORI_STRING PackagePath,
+    __in_opt PYORI_STRING CachePath
+    );
+
+VOID
+YoriPkgExecutePrefetch(
+    __in_opt PYORI_STRING IniFilePath
+    );
+
+__success(return)
+BOOL
+YoriPkgTakePrefetchedPackage(
+    __in PYORI_STRING PackagePath,
+    __out PYORI_STRING LocalPath,
+    __out PBOOL DeleteWhenFinished
+    );
+
+VOID
+YoriPkgFreePrefetchedPackages(VOID);
+
 // vim:sw=4:ts=4:et:
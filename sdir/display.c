@@ -112,34 +112,56 @@ SdirWrite (
     HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
     DWORD i, j;
 
-    YORILIB_COLOR_ATTRIBUTES CacheAttr;
-    TCHAR CharCache[64];
+    TCHAR CharCache[512];
+    TCHAR EscapeBuffer[YORI_MAX_INTERNAL_VT_ESCAPE_CHARS];
+    YORI_STRING EscapeString;
 
-    CacheAttr.Ctrl = SdirDefaultColor.Ctrl;
-    CacheAttr.Win32Attr = SdirDefaultColor.Win32Attr;
+    YoriLibInitEmptyString(&EscapeString);
+    EscapeString.StartOfString = EscapeBuffer;
+    EscapeString.LengthAllocated = sizeof(EscapeBuffer)/sizeof(EscapeBuffer[0]);
 
     //
     //  We firstly load as much as we can into a stack buffer, then write it
-    //  out.  Those syscalls are expensive - run in a slow VM to see.  We
-    //  have to write out the buffer either when the next character has 
-    //  different color (so we can't use the same WriteConsole call) or when
-    //  the stack buffer is full.
+    //  out.  Those syscalls are expensive - run in a slow VM to see.  Color
+    //  changes are included in the buffer as VT escapes, so the output
+    //  layer can apply them without a separate write for each run of
+    //  color.  We only write out the buffer when it is full.
     //
 
     j = 0;
     for (i = 0; i < count; i++) { 
 
-        CacheAttr.Ctrl = str[i].Attr.Ctrl;
-        CacheAttr.Win32Attr = str[i].Attr.Win32Attr;
-        CharCache[j] = str[i].Char;
-        j++;
+        if (!YoriLibAreColorsIdentical(str[i].Attr, SdirCurrentAttribute)) {
+
+            SdirCurrentAttribute.Ctrl = str[i].Attr.Ctrl;
+            SdirCurrentAttribute.Win32Attr = str[i].Attr.Win32Attr;
+
+            //
+            //  Because the buffer is on the stack, this call shouldn't
+            //  fail.
+            //
+
+            if (!YoriLibVtStringForTextAttribute(&EscapeString, 0, str[i].Attr.Win32Attr)) {
+                ASSERT(FALSE);
+                return FALSE;
+            }
+
+            if (j + EscapeString.LengthInChars > sizeof(CharCache)/sizeof(CharCache[0])) {
+                SdirWriteRawStringToOutputDevice(hConsole, CharCache, j);
+                j = 0;
+            }
 
-        if (( i + 1 < count && !YoriLibAreColorsIdentical(str[i + 1].Attr, CacheAttr)) || (j >= sizeof(CharCache)/sizeof(CharCache[0]))) {
+            memcpy(&CharCache[j], EscapeString.StartOfString, EscapeString.LengthInChars * sizeof(TCHAR));
+            j += EscapeString.LengthInChars;
+        }
 
-            SdirSetConsoleTextAttribute(hConsole, CacheAttr);
+        if (j >= sizeof(CharCache)/sizeof(CharCache[0])) {
             SdirWriteRawStringToOutputDevice(hConsole, CharCache, j);
             j = 0;
         }
+
+        CharCache[j] = str[i].Char;
+        j++;
     }
 
     //
@@ -147,8 +169,6 @@ SdirWrite (
     //
 
     if (j > 0) {
-
-        SdirSetConsoleTextAttribute(hConsole, CacheAttr);
         SdirWriteRawStringToOutputDevice(hConsole, CharCache, j);
     }
 
@@ -87,6 +87,32 @@ SDIR_GLOBAL SdirGlobal;
 BOOL
 SdirDisplayCollection();
 
+/**
+ Return the access that the collection functions for the information being
+ displayed or sorted need on a handle to a file.
+
+ @return The access mask needed to collect information about a file.
+ */
+DWORD
+SdirGetCollectionAccess()
+{
+    DWORD i;
+    DWORD DesiredAccess;
+    PSDIR_FEATURE Feature;
+
+    DesiredAccess = 0;
+    for (i = 0; i < SdirGetNumSdirOptions(); i++) {
+        Feature = SdirFeatureByOptionNumber(i);
+        if ((Feature->Flags & SDIR_FEATURE_COLLECT) &&
+               SdirOptions[i].CollectFn) {
+
+            DesiredAccess |= YoriLibFileInfoAccessForCollectFn(SdirOptions[i].CollectFn);
+        }
+    }
+
+    return DesiredAccess;
+}
+
 /**
  Capture all required information from a file found by the system into a
  directory entry.
@@ -102,6 +128,11 @@ SdirDisplayCollection();
         needs to be displayed unconditionally.  This is used for directory
         headers etc.  If FALSE, the regular user specified rules are applied.
 
+ @param Session Optionally points to a file information session that the
+        caller has already used to query the file, so that its handle and
+        queried information are reused.  If NULL, the file is opened, if
+        needed, for the duration of this call.
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
@@ -110,13 +141,26 @@ SdirCaptureFoundItemIntoDirent (
     __out PYORI_FILE_INFO CurrentEntry,
     __in PWIN32_FIND_DATA FindData,
     __in PYORI_STRING FullPath,
-    __in BOOL ForceDisplay
+    __in BOOL ForceDisplay,
+    __in_opt PYORI_LIB_FILE_INFO_SESSION Session
     ) 
 {
     DWORD i;
+    PSDIR_FEATURE Feature;
+    YORI_LIB_FILE_INFO_SESSION LocalSession;
 
     memset(CurrentEntry, 0, sizeof(*CurrentEntry));
 
+    //
+    //  Share one handle to the file between each collection function.
+    //
+
+    if (Session == NULL) {
+        YoriLibFileInfoSessionInitialize(&LocalSession, SdirGetCollectionAccess());
+        CurrentEntry->Session = &LocalSession;
+    } else {
+        CurrentEntry->Session = Session;
+    }
 
     //
     //  Copy over the data from Win32's FindFirstFile into our own structure.
@@ -124,7 +168,6 @@ SdirCaptureFoundItemIntoDirent (
 
     for (i = 0; i < SdirGetNumSdirOptions(); i++) {
 
-        PSDIR_FEATURE Feature;
         Feature = SdirFeatureByOptionNumber(i);
 
         //
@@ -138,6 +181,11 @@ SdirCaptureFoundItemIntoDirent (
         }
     }
 
+    CurrentEntry->Session = NULL;
+    if (Session == NULL) {
+        YoriLibFileInfoSessionCleanup(&LocalSession);
+    }
+
     //
     //  Determine the color to display each entry from extensions and attributes.
     //
@@ -171,13 +219,14 @@ SdirRenderAttributesFromPath (
 
     hFind = FindFirstFile(FullPath->StartOfString, &FindData);
     if (hFind != INVALID_HANDLE_VALUE) {
-        SdirCaptureFoundItemIntoDirent(&CurrentEntry, &FindData, FullPath, TRUE);
+        SdirCaptureFoundItemIntoDirent(&CurrentEntry, &FindData, FullPath, TRUE, NULL);
         FindClose(hFind);
         OutAttributes->Ctrl = CurrentEntry.RenderAttributes.Ctrl;
         OutAttributes->Win32Attr = CurrentEntry.RenderAttributes.Win32Attr;
         return;
     } else {
         YORI_STRING DummyString;
+        YORI_LIB_FILE_INFO_SESSION Session;
 
         if (!YoriLibAllocateString(&DummyString, FullPath->LengthInChars + 2)) {
             OutAttributes->Ctrl = SdirDefaultColor.Ctrl;
@@ -187,8 +236,16 @@ SdirRenderAttributesFromPath (
 
         memset(&FindData, 0, sizeof(FindData));
         DummyString.LengthInChars = YoriLibSPrintfS(DummyString.StartOfString, DummyString.LengthAllocated, _T("%s\\"), FullPath);
-        YoriLibUpdateFindDataFromFileInformation(&FindData, DummyString.StartOfString, FALSE);
-        SdirCaptureFoundItemIntoDirent(&CurrentEntry, &FindData, &DummyString, TRUE);
+
+        //
+        //  Query the object and collect from it through one session so it
+        //  is only opened once.
+        //
+
+        YoriLibFileInfoSessionInitialize(&Session, FILE_READ_ATTRIBUTES | SdirGetCollectionAccess());
+        YoriLibFileInfoSessionUpdateFindData(&Session, &FindData, &DummyString, FALSE);
+        SdirCaptureFoundItemIntoDirent(&CurrentEntry, &FindData, &DummyString, TRUE, &Session);
+        YoriLibFileInfoSessionCleanup(&Session);
         YoriLibFreeStringContents(&DummyString);
         OutAttributes->Ctrl = CurrentEntry.RenderAttributes.Ctrl;
         OutAttributes->Win32Attr = CurrentEntry.RenderAttributes.Win32Attr;
@@ -227,7 +284,7 @@ SdirAddToCollection (
 
     SdirDirCollectionCurrent++;
 
-    SdirCaptureFoundItemIntoDirent(CurrentEntry, FindData, FullPath, FALSE);
+    SdirCaptureFoundItemIntoDirent(CurrentEntry, FindData, FullPath, FALSE, NULL);
 
     if (CurrentEntry->RenderAttributes.Ctrl & YORILIB_ATTRCTRL_HIDE) {
 
@@ -725,6 +782,15 @@ SdirEnumeratePathWithDepth (
             MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
         }
 
+        //
+        //  If short names aren't being displayed, sorted or filtered on,
+        //  don't ask the file system for them.
+        //
+
+        if ((Opts->FtShortName.Flags & SDIR_FEATURE_COLLECT) == 0) {
+            MatchFlags |= YORILIB_FILEENUM_NO_SHORT_NAMES;
+        }
+
         YoriLibInitEmptyString(&ItemFoundContext.StreamFullPath);
         ItemFoundContext.Error = ERROR_SUCCESS;
 
@@ -333,6 +333,25 @@ YoriApiGetHistoryStrings(
     return YoriShGetHistoryStrings(MaximumNumber, HistoryStrings);
 }
 
+/**
+ Returns resource usage for all processes that have executed within a job.
+
+ @param JobId The ID to query resource usage for.
+
+ @param Accounting On successful completion, populated with the resource
+        usage of the job.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+YoriApiGetJobAccounting(
+    __in DWORD JobId,
+    __out PYORI_LIB_JOB_ACCOUNTING Accounting
+    )
+{
+    return YoriShGetJobAccounting(JobId, Accounting);
+}
+
 /**
  Returns information associated with an executing or completed job ID.
 
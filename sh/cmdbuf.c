@@ -69,6 +69,12 @@ typedef struct _YORI_SH_PROCESS_BUFFER {
      */
     DWORD BytesSent;
 
+    /**
+     The maximum number of bytes to write to a pipe in a single operation.
+     This is captured from the pipe buffer size when the buffer is created.
+     */
+    DWORD BytesPerWrite;
+
     /**
      The data buffer.
      */
@@ -190,7 +196,7 @@ YoriShCmdBufferPumpToNextProcess(
 
     while (TRUE) {
 
-        BytesToWrite = 4096;
+        BytesToWrite = ThisBuffer->BytesPerWrite;
         AcquireMutex(ThisBuffer->Mutex);
         if (BytesSent + BytesToWrite > ThisBuffer->BytesPopulated) {
             BytesToWrite = ThisBuffer->BytesPopulated - BytesSent;
@@ -297,7 +303,7 @@ YoriShCmdBufferPump(
             while (ThisBuffer->BytesSent < ThisBuffer->BytesPopulated) {
                 DWORD BytesToWrite;
                 DWORD BytesWritten;
-                BytesToWrite = 4096;
+                BytesToWrite = ThisBuffer->BytesPerWrite;
                 if (ThisBuffer->BytesSent + BytesToWrite > ThisBuffer->BytesPopulated) {
                     BytesToWrite = ThisBuffer->BytesPopulated - ThisBuffer->BytesSent;
                 }
@@ -355,6 +361,7 @@ YoriShAllocateSingleProcessBuffer(
     )
 {
     Buffer->BytesAllocated = 1024;
+    Buffer->BytesPerWrite = YoriShGetPipeBufferSize();
     Buffer->Buffer = YoriLibMalloc(Buffer->BytesAllocated);
     if (Buffer->Buffer == NULL) {
         return FALSE;
@@ -529,23 +536,34 @@ YoriShForwardProcessBufferToNextProcess(
     ASSERT(ExecContext->StdOutType == StdOutTypeBuffer);
     ASSERT(ExecContext->StdErrType != StdErrTypeBuffer);
 
-    if (ExecContext->NextProgram != NULL &&
-        ExecContext->NextProgram->StdInType == StdInTypePipe &&
-        CreatePipe(&ReadHandle, &WriteHandle, NULL, 0)) {
+    if (ExecContext->NextProgram == NULL ||
+        ExecContext->NextProgram->StdInType != StdInTypePipe) {
 
-        ExecContext->NextProgram->StdIn.Pipe.PipeFromPriorProcess = ReadHandle;
+        return FALSE;
+    }
 
-        //
-        //  If we're forwarding to the next process, the previous one
-        //  should be finished
-        //
+    //
+    //  If we're forwarding to the next process, the previous one
+    //  should be finished
+    //
 
-        if (ThisBuffer->OutputBuffer.hPumpThread != NULL) {
-            if (WaitForSingleObject(ThisBuffer->OutputBuffer.hPumpThread, INFINITE) == WAIT_OBJECT_0) {
-                CloseHandle(ThisBuffer->OutputBuffer.hPumpThread);
-                ThisBuffer->OutputBuffer.hPumpThread = NULL;
-            }
+    if (ThisBuffer->OutputBuffer.hPumpThread != NULL) {
+        if (WaitForSingleObject(ThisBuffer->OutputBuffer.hPumpThread, INFINITE) == WAIT_OBJECT_0) {
+            CloseHandle(ThisBuffer->OutputBuffer.hPumpThread);
+            ThisBuffer->OutputBuffer.hPumpThread = NULL;
         }
+    }
+
+    //
+    //  All of the builtin's output is now in the buffer.  Ask for a pipe
+    //  large enough to hold it, so the pump can hand it over without
+    //  waiting for the next process to drain each write.  The pipe only
+    //  grows to a modest limit unless the user configured a larger one.
+    //
+
+    if (YoriShCreatePipe(&ReadHandle, &WriteHandle, ThisBuffer->OutputBuffer.BytesPopulated)) {
+
+        ExecContext->NextProgram->StdIn.Pipe.PipeFromPriorProcess = ReadHandle;
 
         //
         //  Reverse the flow and create a thread to pump data out
@@ -636,8 +654,7 @@ YoriShGetProcessBuffer(
         return FALSE;
     }
 
-    YoriLibMultibyteInput(ThisBuffer->Buffer, ThisBuffer->BytesPopulated, String->StartOfString, String->LengthAllocated);
-    String->LengthInChars = LengthNeeded;
+    String->LengthInChars = YoriLibMultibyteInput(ThisBuffer->Buffer, ThisBuffer->BytesPopulated, String->StartOfString, String->LengthAllocated);
     ReleaseMutex(ThisBuffer->Mutex);
 
     return TRUE;
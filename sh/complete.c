@@ -373,6 +373,7 @@ YoriShPerformExecutableTabCompletion(
     DWORD CompareLength;
     YORI_SH_EXEC_TAB_COMPLETE_CONTEXT ExecTabContext;
     YORI_STRING SearchString;
+    BOOLEAN UsedPathIndex;
 
     YoriLibInitEmptyString(&SearchString);
     SearchString.StartOfString = TabContext->SearchString.StartOfString;
@@ -466,15 +467,34 @@ YoriShPerformExecutableTabCompletion(
 
     //
     //  Secondly, search for the object in the PATH, resuming after the
-    //  previous search
-    //
-
-    YoriLibInitEmptyString(&FoundExecutable);
-    Result = YoriLibLocateExecutableInPath(&SearchString,
-                                           YoriShAddExecutableToTabList,
-                                           &ExecTabContext,
-                                           &FoundExecutable);
-    ASSERT(FoundExecutable.StartOfString == NULL);
+    //  previous search.  If the search is for a simple prefix, the index
+    //  of executables in the PATH can answer it without enumerating every
+    //  directory.
+    //
+
+    UsedPathIndex = FALSE;
+    if (CompareLength > 0 &&
+        CompareLength + 1 == SearchString.LengthInChars &&
+        YoriLibFindLeftMostCharacter(&SearchString, '?') == NULL &&
+        YoriLibFindLeftMostCharacter(&SearchString, '.') == NULL &&
+        YoriLibFindLeftMostCharacter(&SearchString, ':') == NULL &&
+        ExecTabContext.CharsToFinalSlash == 0) {
+
+        YORI_STRING Prefix;
+        YoriLibInitEmptyString(&Prefix);
+        Prefix.StartOfString = SearchString.StartOfString;
+        Prefix.LengthInChars = CompareLength;
+        UsedPathIndex = YoriShPathIndexFindExecutables(&Prefix, YoriShAddExecutableToTabList, &ExecTabContext);
+    }
+
+    if (!UsedPathIndex) {
+        YoriLibInitEmptyString(&FoundExecutable);
+        Result = YoriLibLocateExecutableInPath(&SearchString,
+                                               YoriShAddExecutableToTabList,
+                                               &ExecTabContext,
+                                               &FoundExecutable);
+        ASSERT(FoundExecutable.StartOfString == NULL);
+    }
 
     //
     //  Thirdly, search the table of builtins.
@@ -102,6 +102,99 @@ YoriShRevertRedirection(
     }
 }
 
+/**
+ The pipe buffer size to use if the user has not specified one.
+ */
+#define YORI_SH_DEFAULT_PIPE_BUFFER_SIZE (64 * 1024)
+
+/**
+ The smallest pipe buffer size that the user can specify.
+ */
+#define YORI_SH_MIN_PIPE_BUFFER_SIZE (4 * 1024)
+
+/**
+ The largest pipe buffer size that the user can specify.
+ */
+#define YORI_SH_MAX_PIPE_BUFFER_SIZE (16 * 1024 * 1024)
+
+/**
+ The largest pipe buffer size that the shell will use without the user
+ asking for it.  When a caller requests a larger pipe to hold data that is
+ already buffered, the size grows up to this limit, which keeps nonpaged
+ memory use bounded when a builtin generates a large amount of output.
+ */
+#define YORI_SH_MAX_IMPLICIT_PIPE_BUFFER_SIZE (1024 * 1024)
+
+/**
+ Return the buffer size to use when creating pipes.  This is the value of
+ the YORIPIPESIZE environment variable, in bytes, or a default if it is not
+ set.  The value is cached until the environment changes.
+
+ @return The pipe buffer size, in bytes.
+ */
+DWORD
+YoriShGetPipeBufferSize()
+{
+    LONGLONG llTemp;
+
+    if (YoriShGlobal.PipeBufferSize == 0 ||
+        YoriShGlobal.PipeBufferSizeGeneration != YoriShGlobal.EnvironmentGeneration) {
+
+        YoriShGlobal.PipeBufferSize = YORI_SH_DEFAULT_PIPE_BUFFER_SIZE;
+        if (YoriLibGetEnvironmentVariableAsNumber(_T("YORIPIPESIZE"), &llTemp) && llTemp > 0) {
+            if (llTemp < YORI_SH_MIN_PIPE_BUFFER_SIZE) {
+                llTemp = YORI_SH_MIN_PIPE_BUFFER_SIZE;
+            } else if (llTemp > YORI_SH_MAX_PIPE_BUFFER_SIZE) {
+                llTemp = YORI_SH_MAX_PIPE_BUFFER_SIZE;
+            }
+            YoriShGlobal.PipeBufferSize = (DWORD)llTemp;
+        }
+        YoriShGlobal.PipeBufferSizeGeneration = YoriShGlobal.EnvironmentGeneration;
+    }
+
+    return YoriShGlobal.PipeBufferSize;
+}
+
+/**
+ Create an anonymous pipe for communication between processes, or between
+ the shell and a process, using the configured pipe buffer size.
+
+ @param ReadHandle On successful completion, populated with the read end of
+        the pipe.
+
+ @param WriteHandle On successful completion, populated with the write end
+        of the pipe.
+
+ @param MinimumSize Specifies a buffer size that the caller would like the
+        pipe to have, in bytes.  If this is larger than the configured size,
+        it is used instead, up to YORI_SH_MAX_IMPLICIT_PIPE_BUFFER_SIZE.
+        Sizes beyond that are only used if the user configured them
+        explicitly via YORIPIPESIZE.  Can be zero to use the configured
+        size.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShCreatePipe(
+    __out PHANDLE ReadHandle,
+    __out PHANDLE WriteHandle,
+    __in DWORD MinimumSize
+    )
+{
+    DWORD PipeSize;
+
+    PipeSize = YoriShGetPipeBufferSize();
+    if (MinimumSize > PipeSize && PipeSize < YORI_SH_MAX_IMPLICIT_PIPE_BUFFER_SIZE) {
+        PipeSize = MinimumSize;
+        if (PipeSize > YORI_SH_MAX_IMPLICIT_PIPE_BUFFER_SIZE) {
+            PipeSize = YORI_SH_MAX_IMPLICIT_PIPE_BUFFER_SIZE;
+        }
+    }
+
+    return CreatePipe(ReadHandle, WriteHandle, NULL, PipeSize);
+}
+
 /**
  Temporarily set this process to have the same stdin/stdout/stderr as a
  a program that it intends to launch.  Keep information about the current
@@ -201,7 +294,7 @@ YoriShInitializeRedirection(
             HANDLE ReadHandle;
             HANDLE WriteHandle;
 
-            if (CreatePipe(&ReadHandle, &WriteHandle, NULL, 0)) {
+            if (YoriShCreatePipe(&ReadHandle, &WriteHandle, 0)) {
                 YoriLibMakeInheritableHandle(ReadHandle, &ReadHandle);
                 PreviousRedirectContext->ResetInput = TRUE;
                 SetStdHandle(STD_INPUT_HANDLE, ReadHandle);
@@ -270,7 +363,7 @@ YoriShInitializeRedirection(
         if (ExecContext->NextProgram != NULL &&
             ExecContext->NextProgram->StdInType == StdInTypePipe) {
 
-            if (CreatePipe(&ReadHandle, &WriteHandle, NULL, 0)) {
+            if (YoriShCreatePipe(&ReadHandle, &WriteHandle, 0)) {
 
                 YoriLibMakeInheritableHandle(WriteHandle, &WriteHandle);
 
@@ -284,7 +377,7 @@ YoriShInitializeRedirection(
     } else if (ExecContext->StdOutType == StdOutTypeBuffer) {
         HANDLE ReadHandle;
         HANDLE WriteHandle;
-        if (CreatePipe(&ReadHandle, &WriteHandle, NULL, 0)) {
+        if (YoriShCreatePipe(&ReadHandle, &WriteHandle, 0)) {
 
             YoriLibMakeInheritableHandle(WriteHandle, &WriteHandle);
 
@@ -350,7 +443,7 @@ YoriShInitializeRedirection(
     } else if (ExecContext->StdErrType == StdErrTypeBuffer) {
         HANDLE ReadHandle;
         HANDLE WriteHandle;
-        if (CreatePipe(&ReadHandle, &WriteHandle, NULL, 0)) {
+        if (YoriShCreatePipe(&ReadHandle, &WriteHandle, 0)) {
 
             YoriLibMakeInheritableHandle(WriteHandle, &WriteHandle);
 
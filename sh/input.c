@@ -677,6 +677,24 @@ YoriShAppCloseCtrlHandler(
     return TRUE;
 }
 
+/**
+ Discard any argument offsets recorded by a previous move to the previous or
+ next argument.
+
+ @param Buffer Pointer to the current input buffer context.
+ */
+VOID
+YoriShClearArgumentMap(
+    __inout PYORI_SH_INPUT_BUFFER Buffer
+    )
+{
+    YoriLibFreeStringContents(&Buffer->ArgMapString);
+    Buffer->ArgMapOffsets = NULL;
+    Buffer->ArgMapCount = 0;
+    Buffer->ArgMapCurrentArg = 0;
+    Buffer->ArgMapCursorOffset = 0;
+}
+
 /**
  NULL terminate the input buffer, and display a carriage return, in preparation
  for parsing and executing the input.
@@ -694,6 +712,7 @@ YoriShTerminateInput(
     Buffer->SuggestionPopulated = FALSE;
     YoriLibFreeStringContents(&Buffer->SuggestionString);
     YoriLibFreeStringContents(&Buffer->SearchString);
+    YoriShClearArgumentMap(Buffer);
     SetConsoleCtrlHandler(YoriShAppCloseCtrlHandler, FALSE);
     YoriShDisplayAfterKeyPress(Buffer);
     YoriShPostKeyPress(Buffer);
@@ -762,6 +781,7 @@ YoriShClearInput(
     Buffer->SuggestionPopulated = FALSE;
     YoriLibFreeStringContents(&Buffer->SuggestionString);
     YoriLibFreeStringContents(&Buffer->SearchString);
+    YoriShClearArgumentMap(Buffer);
     YoriShClearTabCompletionMatches(Buffer);
     if (Buffer->String.LengthInChars > 0) {
         YoriShExtendDirtyRangeToCover(Buffer, 0, Buffer->String.LengthInChars);
@@ -1266,6 +1286,179 @@ YoriShReplaceInputBufferTrackDirtyRange(
 }
 
 
+/**
+ Record the offset of each argument in the input buffer after it has been
+ regenerated from a parsed command context, so that subsequent moves to the
+ previous or next argument do not need to parse the string again.  On
+ failure no map is recorded and the next move will parse the string.
+
+ @param Buffer Pointer to the current input buffer context.  The string in
+        this buffer is expected to have been generated from CmdContext, with
+        the cursor at the beginning of an argument or the end of the string.
+
+ @param CmdContext Pointer to the command context that the input buffer was
+        generated from.
+ */
+VOID
+YoriShBuildArgumentMap(
+    __inout PYORI_SH_INPUT_BUFFER Buffer,
+    __in PYORI_SH_CMD_CONTEXT CmdContext
+    )
+{
+    DWORD ArgIndex;
+    DWORD CharIndex;
+    DWORD Offset;
+    TCHAR Char;
+    PYORI_STRING Arg;
+
+    YoriShClearArgumentMap(Buffer);
+
+    if (CmdContext->ArgC == 0) {
+        return;
+    }
+
+    //
+    //  Operators, escapes and embedded quotes can cause the parser to
+    //  select a different argument than the one beginning at the cursor,
+    //  so lines containing these are always parsed.
+    //
+
+    for (CharIndex = 0; CharIndex < Buffer->String.LengthInChars; CharIndex++) {
+        Char = Buffer->String.StartOfString[CharIndex];
+        if (Char == '|' ||
+            Char == '&' ||
+            Char == '>' ||
+            Char == '<' ||
+            Char == '\n' ||
+            YoriLibIsEscapeChar(Char)) {
+
+            return;
+        }
+    }
+
+    Buffer->ArgMapString.MemoryToFree = YoriLibReferencedMalloc(CmdContext->ArgC * sizeof(DWORD) + Buffer->String.LengthInChars * sizeof(TCHAR));
+    if (Buffer->ArgMapString.MemoryToFree == NULL) {
+        return;
+    }
+
+    Buffer->ArgMapOffsets = Buffer->ArgMapString.MemoryToFree;
+    Buffer->ArgMapCount = CmdContext->ArgC;
+
+    Offset = 0;
+    for (ArgIndex = 0; ArgIndex < CmdContext->ArgC; ArgIndex++) {
+        Arg = &CmdContext->ArgV[ArgIndex];
+        for (CharIndex = 0; CharIndex < Arg->LengthInChars; CharIndex++) {
+            if (Arg->StartOfString[CharIndex] == '"') {
+                YoriShClearArgumentMap(Buffer);
+                return;
+            }
+        }
+
+        if (ArgIndex > 0) {
+            Offset++;
+        }
+        Buffer->ArgMapOffsets[ArgIndex] = Offset;
+        Offset += Arg->LengthInChars;
+        if (CmdContext->ArgContexts[ArgIndex].Quoted) {
+            Offset += 2;
+        }
+    }
+
+    //
+    //  If the arguments don't account for the string exactly, the string
+    //  wasn't generated in the expected way, so don't try to use it.
+    //
+
+    if (Offset != Buffer->String.LengthInChars) {
+        YoriShClearArgumentMap(Buffer);
+        return;
+    }
+
+    Buffer->ArgMapCursorOffset = Buffer->CurrentOffset;
+    if (Buffer->CurrentOffset == Buffer->String.LengthInChars) {
+        Buffer->ArgMapCurrentArg = Buffer->ArgMapCount;
+    } else {
+        for (ArgIndex = 0; ArgIndex < Buffer->ArgMapCount; ArgIndex++) {
+            if (Buffer->ArgMapOffsets[ArgIndex] == Buffer->CurrentOffset) {
+                break;
+            }
+        }
+
+        if (ArgIndex == Buffer->ArgMapCount) {
+            YoriShClearArgumentMap(Buffer);
+            return;
+        }
+        Buffer->ArgMapCurrentArg = ArgIndex;
+    }
+
+    Buffer->ArgMapString.StartOfString = (LPTSTR)(Buffer->ArgMapOffsets + Buffer->ArgMapCount);
+    memcpy(Buffer->ArgMapString.StartOfString, Buffer->String.StartOfString, Buffer->String.LengthInChars * sizeof(TCHAR));
+    Buffer->ArgMapString.LengthInChars = Buffer->String.LengthInChars;
+    Buffer->ArgMapString.LengthAllocated = Buffer->String.LengthInChars;
+}
+
+/**
+ Move the cursor to the previous or next argument using the offsets recorded
+ by a previous move.  This is only possible if the input string and cursor
+ position have not changed since the offsets were recorded, which is the
+ case when the user presses Ctrl+Left or Ctrl+Right repeatedly.  The result
+ is the same as parsing and regenerating the string, but without the cost
+ of doing so on each key press.
+
+ @param Buffer Pointer to the current input buffer context.
+
+ @param MoveForward If TRUE, move to the next argument.  If FALSE, move to
+        the previous argument.
+
+ @return TRUE if the cursor was moved, FALSE if the recorded offsets are not
+         applicable and the string must be parsed.
+ */
+BOOL
+YoriShMoveCursorUsingArgumentMap(
+    __inout PYORI_SH_INPUT_BUFFER Buffer,
+    __in BOOL MoveForward
+    )
+{
+    DWORD CurrentArg;
+
+    if (Buffer->ArgMapOffsets == NULL ||
+        Buffer->CurrentOffset != Buffer->ArgMapCursorOffset ||
+        Buffer->String.LengthInChars != Buffer->ArgMapString.LengthInChars ||
+        memcmp(Buffer->String.StartOfString, Buffer->ArgMapString.StartOfString, Buffer->String.LengthInChars * sizeof(TCHAR)) != 0) {
+
+        return FALSE;
+    }
+
+    CurrentArg = Buffer->ArgMapCurrentArg;
+    if (MoveForward) {
+        if (CurrentArg + 1 < Buffer->ArgMapCount) {
+            CurrentArg++;
+        } else {
+            CurrentArg = Buffer->ArgMapCount;
+        }
+    } else {
+        if (CurrentArg == Buffer->ArgMapCount) {
+            CurrentArg = Buffer->ArgMapCount - 1;
+        } else if (CurrentArg > 0) {
+            CurrentArg--;
+        }
+    }
+
+    if (CurrentArg == Buffer->ArgMapCount) {
+        Buffer->CurrentOffset = Buffer->String.LengthInChars;
+    } else {
+        Buffer->CurrentOffset = Buffer->ArgMapOffsets[CurrentArg];
+    }
+
+    if (Buffer->CurrentOffset == Buffer->String.LengthInChars) {
+        CurrentArg = Buffer->ArgMapCount;
+    }
+
+    Buffer->ArgMapCurrentArg = CurrentArg;
+    Buffer->ArgMapCursorOffset = Buffer->CurrentOffset;
+    return TRUE;
+}
+
 /**
  Move the current cursor offset within the buffer to the argument before the
  one that is selected.  This requires parsing the arguments and moving the
@@ -1284,6 +1477,10 @@ YoriShMoveCursorToPriorArgument(
     DWORD BeginCurrentArg = 0;
     DWORD EndCurrentArg = 0;
 
+    if (YoriShMoveCursorUsingArgumentMap(Buffer, FALSE)) {
+        return;
+    }
+
     if (!YoriShParseCmdlineToCmdContext(&Buffer->String, Buffer->CurrentOffset, FALSE, &CmdContext)) {
         return;
     }
@@ -1335,6 +1532,7 @@ YoriShMoveCursorToPriorArgument(
             Buffer->CurrentOffset = Buffer->String.LengthInChars;
         }
         YoriLibFreeStringContents(&NewString);
+        YoriShBuildArgumentMap(Buffer, &CmdContext);
     }
 
     YoriShFreeCmdContext(&CmdContext);
@@ -1359,6 +1557,10 @@ YoriShMoveCursorToNextArgument(
     DWORD EndCurrentArg;
     BOOL MoveToEnd = FALSE;
 
+    if (YoriShMoveCursorUsingArgumentMap(Buffer, TRUE)) {
+        return;
+    }
+
     if (!YoriShParseCmdlineToCmdContext(&Buffer->String, Buffer->CurrentOffset, FALSE, &CmdContext)) {
         return;
     }
@@ -1390,6 +1592,7 @@ YoriShMoveCursorToNextArgument(
             Buffer->CurrentOffset = Buffer->String.LengthInChars;
         }
         YoriLibFreeStringContents(&NewString);
+        YoriShBuildArgumentMap(Buffer, &CmdContext);
     }
 
     YoriShFreeCmdContext(&CmdContext);
@@ -78,6 +78,13 @@ typedef struct _YORI_JOB {
      */
     HANDLE hProcess;
 
+    /**
+     A handle to a job object containing the child process and any
+     processes it launches, or NULL if the process could not be placed in
+     a job object.  This is used to report resource usage; completion is
+     determined from the process handle.
+     */
+    HANDLE hJobObject;
 
     /**
      The full command line that was used to execute the child process.
@@ -95,6 +102,65 @@ typedef struct _YORI_JOB {
  */
 YORI_LIST_ENTRY JobList;
 
+/**
+ Attempt to place a newly launched background process in a job object so
+ that resource usage can be reported for it and any processes it launches.
+ If this fails, the job is still tracked in the same way, but no accounting
+ information is available for it.
+
+ @param ThisJob Pointer to the job, with hProcess already populated.
+ */
+VOID
+YoriShAttachJobObject(
+    __in PYORI_JOB ThisJob
+    )
+{
+    HANDLE hJobObject;
+
+    hJobObject = YoriLibCreateJobObject();
+    if (hJobObject == NULL) {
+        return;
+    }
+
+    //
+    //  Assignment will fail if the process has already exited, or if it is
+    //  in a job already and the OS doesn't support nested jobs.
+    //
+
+    if (!YoriLibAssignProcessToJobObject(hJobObject, ThisJob->hProcess)) {
+        CloseHandle(hJobObject);
+        return;
+    }
+
+    ThisJob->hJobObject = hJobObject;
+}
+
+/**
+ Find a job given its job ID.
+
+ @param JobId The job ID to find.
+
+ @return Pointer to the job, or NULL if no job with this ID exists.
+ */
+PYORI_JOB
+YoriShFindJob(
+    __in DWORD JobId
+    )
+{
+    PYORI_JOB ThisJob;
+    PYORI_LIST_ENTRY ListEntry;
+
+    ListEntry = YoriLibGetNextListEntry(&JobList, NULL);
+    while (ListEntry != NULL) {
+        ThisJob = CONTAINING_RECORD(ListEntry, YORI_JOB, ListEntry);
+        if (ThisJob->JobId == JobId) {
+            return ThisJob;
+        }
+        ListEntry = YoriLibGetNextListEntry(&JobList, ListEntry);
+    }
+    return NULL;
+}
+
 /**
  Allocate a new job for background processing.
 
@@ -137,6 +203,7 @@ YoriShCreateNewJob(
     ThisJob->JobId = ++YoriShGlobal.PreviousJobId;
     ThisJob->hProcess = hProcess;
     ThisJob->dwProcessId = dwProcessId;
+    YoriShAttachJobObject(ThisJob);
 
     if (ExecContext->StdOutType == StdOutTypeBuffer &&
         ExecContext->StdOut.Buffer.ProcessBuffers != NULL) {
@@ -174,6 +241,10 @@ YoriShFreeJob(
         YoriShDereferenceProcessBuffer(ThisJob->ProcessBuffers);
     }
 
+    if (ThisJob->hJobObject != NULL) {
+        CloseHandle(ThisJob->hJobObject);
+    }
+
     YoriLibFreeStringContents(&ThisJob->CmdLine);
     YoriLibFree(ThisJob);
 }
@@ -539,4 +610,37 @@ YoriShGetJobInformation(
     return FALSE;
 }
 
+/**
+ Returns resource usage for all processes that have executed within a job.
+ This is only available if the job's process could be placed in a job
+ object.
+
+ @param JobId The ID to query resource usage for.
+
+ @param Accounting On successful completion, populated with the resource
+        usage of the job.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShGetJobAccounting(
+    __in DWORD JobId,
+    __out PYORI_LIB_JOB_ACCOUNTING Accounting
+    )
+{
+    PYORI_JOB ThisJob;
+
+    if (YoriShGlobal.PreviousJobId == 0) {
+        return FALSE;
+    }
+
+    ThisJob = YoriShFindJob(JobId);
+    if (ThisJob == NULL || ThisJob->hJobObject == NULL) {
+        return FALSE;
+    }
+
+    return YoriLibQueryJobObjectAccounting(ThisJob->hJobObject, Accounting);
+}
+
 // vim:sw=4:ts=4:et:
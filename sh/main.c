@@ -718,6 +718,13 @@ ymain (
             YoriShDisplayPrompt();
             YoriShPreCommand(FALSE);
 
+            //
+            //  While waiting for input, make sure the index of executables
+            //  in the PATH is current so tab completion can use it.
+            //
+
+            YoriShPathIndexRefresh();
+
             if (!YoriShGetExpression(&CurrentExpression)) {
                 break;
             }
@@ -741,6 +748,7 @@ ymain (
     YoriShClearAllAliases();
     YoriShBuiltinUnregisterAll();
     YoriShDiscardSavedRestartState(NULL);
+    YoriShPathIndexCleanup();
     YoriShCleanupInputContext();
     YoriLibFreeStringContents(&YoriShGlobal.PreCmdVariable);
     YoriLibFreeStringContents(&YoriShGlobal.PostCmdVariable);
@@ -130,6 +130,54 @@ YoriShIsArgumentSeperator(
     return FALSE;
 }
 
+/**
+ Count the number of characters at the beginning of a string which have no
+ significance when splitting arguments, so they can be processed in bulk.
+ The count stops at any quote, escape, space, or character that may begin
+ an argument seperator.  Within a quoted section, spaces and seperators are
+ part of the argument, so only quotes and escapes end the count.
+
+ @param String Pointer to the remainder of the string to parse.
+
+ @param QuoteOpen TRUE if the string is within a quoted section.
+
+ @return The number of characters which are part of the current argument
+         without further processing.
+ */
+DWORD
+YoriShCountPlainArgumentChars(
+    __in PYORI_STRING String,
+    __in BOOL QuoteOpen
+    )
+{
+    DWORD Index;
+    TCHAR Char;
+
+    for (Index = 0; Index < String->LengthInChars; Index++) {
+        Char = String->StartOfString[Index];
+        if (Char == '"' || YoriLibIsEscapeChar(Char)) {
+            break;
+        }
+
+        if (!QuoteOpen) {
+            if (Char == ' ' || Char == '|' || Char == '&' || Char == '\n' ||
+                Char == '>' || Char == '<') {
+
+                break;
+            }
+
+            if ((Char == '1' || Char == '2') &&
+                Index + 1 < String->LengthInChars &&
+                String->StartOfString[Index + 1] == '>') {
+
+                break;
+            }
+        }
+    }
+
+    return Index;
+}
+
 /**
  Remove spaces from the beginning of a Yori string.  Note this implies
  advancing the StartOfString pointer, so a caller cannot assume this
@@ -215,6 +263,8 @@ YoriShParseCmdlineToCmdContext(
     DWORD ArgOffset = 0;
     DWORD RequiredCharCount = 0;
     DWORD CharsToConsume = 0;
+    DWORD PlainChars;
+    DWORD CharsToCurrentOffset;
     BOOL TerminateArg;
     BOOL TerminateNextArg = FALSE;
     BOOL QuoteOpen = FALSE;
@@ -244,6 +294,45 @@ YoriShParseCmdlineToCmdContext(
 
     while (Char.LengthInChars > 0) {
 
+        //
+        //  Consume any run of characters that can't start or end an
+        //  argument in one step.  This is the same as processing each
+        //  character below, including finding the current argument, but
+        //  avoids reevaluating every condition for every character.
+        //
+
+        PlainChars = YoriShCountPlainArgumentChars(&Char, QuoteOpen);
+        if (PlainChars > 0) {
+            if (!CurrentArgFound &&
+                (Char.StartOfString - CmdLine->StartOfString + PlainChars >= (LONG)CurrentOffset)) {
+
+                CharsToCurrentOffset = 1;
+                if (Char.StartOfString - CmdLine->StartOfString < (LONG)CurrentOffset) {
+                    CharsToCurrentOffset = CurrentOffset - (DWORD)(Char.StartOfString - CmdLine->StartOfString);
+                }
+
+                CurrentArgFound = TRUE;
+                CmdContext->CurrentArg = ArgCount;
+                CmdContext->CurrentArgOffset = ArgOffset + CharsToCurrentOffset;
+            }
+
+            RequiredCharCount += PlainChars;
+            ArgOffset += PlainChars;
+            Char.StartOfString += PlainChars;
+            Char.LengthInChars -= PlainChars;
+
+            if (Char.LengthInChars == 0) {
+                if (!CurrentArgFound) {
+                    CurrentArgFound = TRUE;
+                    CmdContext->CurrentArg = ArgCount;
+                    CmdContext->CurrentArgOffset = ArgOffset;
+                }
+                ArgOffset = 0;
+                ArgCount++;
+            }
+            continue;
+        }
+
         //
         //  If it's an escape char, consume two characters as literal until
         //  we hit the end of the string.
@@ -511,6 +600,20 @@ YoriShParseCmdlineToCmdContext(
 
     while (Char.LengthInChars > 0) {
 
+        //
+        //  Copy any run of characters that can't start or end an argument
+        //  in one step.
+        //
+
+        PlainChars = YoriShCountPlainArgumentChars(&Char, QuoteOpen);
+        if (PlainChars > 0) {
+            memcpy(OutputString, Char.StartOfString, PlainChars * sizeof(TCHAR));
+            OutputString += PlainChars;
+            Char.StartOfString += PlainChars;
+            Char.LengthInChars -= PlainChars;
+            continue;
+        }
+
         //
         //  If it's an escape char, consume two characters as literal until
         //  we hit the end of the string.
@@ -839,8 +942,11 @@ YoriShRemoveEscapesFromCmdContext(
     DWORD ArgIndex;
     DWORD CharIndex;
     DWORD DestIndex;
+    DWORD CharsNeeded;
     BOOLEAN EscapeFound;
     PYORI_STRING ThisArg;
+    PVOID MemoryToFree;
+    LPTSTR OutputString;
 
     //
     //  MSFIX: This will perform a memory allocation which could be
@@ -851,17 +957,40 @@ YoriShRemoveEscapesFromCmdContext(
         return FALSE;
     }
 
+    //
+    //  Count the space needed for every argument that contains an escape.
+    //  Arguments without escapes continue to refer to the original string,
+    //  and arguments with escapes are all copied into a single allocation.
+    //
+
+    CharsNeeded = 0;
     for (ArgIndex = 0; ArgIndex < NoEscapedCmdContext->ArgC; ArgIndex++) {
         ThisArg = &NoEscapedCmdContext->ArgV[ArgIndex];
 
-        EscapeFound = FALSE;
+        for (CharIndex = 0; CharIndex < ThisArg->LengthInChars; CharIndex++) {
+            if (YoriLibIsEscapeChar(ThisArg->StartOfString[CharIndex])) {
+                CharsNeeded += ThisArg->LengthInChars + 1;
+                break;
+            }
+        }
+    }
 
-        //
-        //  Keep looping to the end of each argument.  This does two
-        //  things: we have to search looking for an escape until we
-        //  find one, and if we do find one, we need to know the
-        //  length of the string.
-        //
+    if (CharsNeeded == 0) {
+        return TRUE;
+    }
+
+    MemoryToFree = YoriLibReferencedMalloc(CharsNeeded * sizeof(TCHAR));
+    if (MemoryToFree == NULL) {
+        YoriShFreeCmdContext(NoEscapedCmdContext);
+        return FALSE;
+    }
+
+    OutputString = MemoryToFree;
+
+    for (ArgIndex = 0; ArgIndex < NoEscapedCmdContext->ArgC; ArgIndex++) {
+        ThisArg = &NoEscapedCmdContext->ArgV[ArgIndex];
+
+        EscapeFound = FALSE;
 
         for (CharIndex = 0; CharIndex < ThisArg->LengthInChars; CharIndex++) {
             if (YoriLibIsEscapeChar(ThisArg->StartOfString[CharIndex])) {
@@ -873,9 +1002,8 @@ YoriShRemoveEscapesFromCmdContext(
         if (EscapeFound) {
             YORI_STRING NewArg;
 
-            if (!YoriLibAllocateString(&NewArg, ThisArg->LengthInChars + 1)) {
-                return FALSE;
-            }
+            YoriLibInitEmptyString(&NewArg);
+            NewArg.StartOfString = OutputString;
 
             for (CharIndex = 0, DestIndex = 0; CharIndex < ThisArg->LengthInChars; CharIndex++, DestIndex++) {
                 if (YoriLibIsEscapeChar(ThisArg->StartOfString[CharIndex])) {
@@ -889,6 +1017,11 @@ YoriShRemoveEscapesFromCmdContext(
             }
             NewArg.StartOfString[DestIndex] = '\0';
             NewArg.LengthInChars = DestIndex;
+            NewArg.LengthAllocated = ThisArg->LengthInChars + 1;
+            OutputString += NewArg.LengthAllocated;
+
+            YoriLibReference(MemoryToFree);
+            NewArg.MemoryToFree = MemoryToFree;
 
             YoriLibFreeStringContents(&NoEscapedCmdContext->ArgV[ArgIndex]);
 
@@ -896,6 +1029,8 @@ YoriShRemoveEscapesFromCmdContext(
         }
     }
 
+    YoriLibDereference(MemoryToFree);
+
     return TRUE;
 }
 
@@ -0,0 +1,931 @@
+/**
+ * @file sh/pathidx.c
+ *
+ * Yori shell cache of executables found in the PATH
+ *
+ * Copyright (c) 2020 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yori.h"
+
+/**
+ Information about a single directory within the PATH, and the executable
+ files that were found in it.
+ */
+typedef struct _YORI_SH_PATH_INDEX_DIRECTORY {
+
+    /**
+     The fully qualified name of the directory.
+     */
+    YORI_STRING DirectoryName;
+
+    /**
+     A handle to a change notification which becomes signalled when files
+     are added, removed or renamed in the directory.  If NULL, the directory
+     could not be monitored, so its contents are not cached and it is
+     enumerated whenever it is searched.
+     */
+    HANDLE ChangeNotification;
+
+    /**
+     The number of elements in FileNames.
+     */
+    DWORD FileCount;
+
+    /**
+     The number of elements allocated in FileNames.
+     */
+    DWORD FilesAllocated;
+
+    /**
+     An array of file names found in the directory which have an extension
+     from PATHEXT, in the order they were enumerated.  Each string is an
+     independent allocation.
+     */
+    PYORI_STRING FileNames;
+
+    /**
+     A hash table of the names in FileNames, allowing a file to be found by
+     name without scanning the directory.  This is NULL if the directory
+     contains no files.
+     */
+    PYORI_HASH_TABLE FileHash;
+
+    /**
+     An array of FileCount hash entries, one for each element of FileNames,
+     which are inserted into FileHash.
+     */
+    PYORI_HASH_ENTRY FileHashEntries;
+
+} YORI_SH_PATH_INDEX_DIRECTORY, *PYORI_SH_PATH_INDEX_DIRECTORY;
+
+/**
+ A snapshot of the executables found in every directory in the PATH.
+ */
+typedef struct _YORI_SH_PATH_INDEX {
+
+    /**
+     The value of the PATH variable when the index was built.
+     */
+    YORI_STRING PathVariable;
+
+    /**
+     The value of the PATHEXT variable when the index was built.
+     */
+    YORI_STRING PathExtVariable;
+
+    /**
+     An array of extensions parsed from PathExtVariable, in search order.
+     The strings point into PathExtVariable.
+     */
+    PYORI_STRING Extensions;
+
+    /**
+     The number of elements in Extensions.
+     */
+    DWORD ExtensionCount;
+
+    /**
+     An array of directories, in the order they occur in PATH.
+     */
+    PYORI_SH_PATH_INDEX_DIRECTORY Directories;
+
+    /**
+     The number of elements in Directories.
+     */
+    DWORD DirectoryCount;
+
+    /**
+     The environment generation when the index was built.  If the
+     environment has not changed since, PathVariable and PathExtVariable do
+     not need to be compared.
+     */
+    DWORD EnvironmentGeneration;
+
+} YORI_SH_PATH_INDEX, *PYORI_SH_PATH_INDEX;
+
+/**
+ The index that is currently used to answer queries, or NULL if no index
+ has been built.
+ */
+PYORI_SH_PATH_INDEX YoriShPathIndex;
+
+/**
+ An index being constructed by a background thread.  This is only valid
+ once YoriShPathIndexThread has terminated.
+ */
+PYORI_SH_PATH_INDEX YoriShPendingPathIndex;
+
+/**
+ A handle to a thread which is building a new index, or NULL if no index is
+ being built.
+ */
+HANDLE YoriShPathIndexThread;
+
+/**
+ Free a directory within the index.
+
+ @param Directory Pointer to the directory to free.
+ */
+VOID
+YoriShPathIndexFreeDirectory(
+    __in PYORI_SH_PATH_INDEX_DIRECTORY Directory
+    )
+{
+    DWORD Index;
+
+    if (Directory->FileHash != NULL) {
+        for (Index = 0; Index < Directory->FileCount; Index++) {
+            YoriLibHashRemoveByEntry(&Directory->FileHashEntries[Index]);
+        }
+        YoriLibFreeEmptyHashTable(Directory->FileHash);
+        YoriLibFree(Directory->FileHashEntries);
+        Directory->FileHash = NULL;
+        Directory->FileHashEntries = NULL;
+    }
+
+    for (Index = 0; Index < Directory->FileCount; Index++) {
+        YoriLibFreeStringContents(&Directory->FileNames[Index]);
+    }
+
+    if (Directory->FileNames != NULL) {
+        YoriLibFree(Directory->FileNames);
+        Directory->FileNames = NULL;
+    }
+
+    if (Directory->ChangeNotification != NULL) {
+        FindCloseChangeNotification(Directory->ChangeNotification);
+        Directory->ChangeNotification = NULL;
+    }
+
+    YoriLibFreeStringContents(&Directory->DirectoryName);
+    Directory->FileCount = 0;
+    Directory->FilesAllocated = 0;
+}
+
+/**
+ Free an index.
+
+ @param PathIndex Pointer to the index to free.
+ */
+VOID
+YoriShPathIndexFree(
+    __in PYORI_SH_PATH_INDEX PathIndex
+    )
+{
+    DWORD Index;
+
+    if (PathIndex->Directories != NULL) {
+        for (Index = 0; Index < PathIndex->DirectoryCount; Index++) {
+            YoriShPathIndexFreeDirectory(&PathIndex->Directories[Index]);
+        }
+        YoriLibFree(PathIndex->Directories);
+    }
+
+    if (PathIndex->Extensions != NULL) {
+        YoriLibFree(PathIndex->Extensions);
+    }
+
+    YoriLibFreeStringContents(&PathIndex->PathVariable);
+    YoriLibFreeStringContents(&PathIndex->PathExtVariable);
+    YoriLibFree(PathIndex);
+}
+
+/**
+ Return the index of the PATHEXT extension that a file name ends in.
+
+ @param PathIndex Pointer to the index containing the extensions.
+
+ @param FileName Pointer to the file name.
+
+ @param ExtensionIndex On successful completion, updated to contain the index
+        of the extension within PathIndex->Extensions.
+
+ @return TRUE if the file name ends in an extension from PATHEXT, FALSE if
+         it does not.
+ */
+__success(return)
+BOOLEAN
+YoriShPathIndexFindExtension(
+    __in PYORI_SH_PATH_INDEX PathIndex,
+    __in PYORI_STRING FileName,
+    __out PDWORD ExtensionIndex
+    )
+{
+    DWORD Index;
+    PYORI_STRING Extension;
+    YORI_STRING Tail;
+
+    for (Index = 0; Index < PathIndex->ExtensionCount; Index++) {
+        Extension = &PathIndex->Extensions[Index];
+        if (FileName->LengthInChars > Extension->LengthInChars) {
+            YoriLibInitEmptyString(&Tail);
+            Tail.StartOfString = &FileName->StartOfString[FileName->LengthInChars - Extension->LengthInChars];
+            Tail.LengthInChars = Extension->LengthInChars;
+            if (YoriLibCompareStringInsensitive(&Tail, Extension) == 0) {
+                *ExtensionIndex = Index;
+                return TRUE;
+            }
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ Enumerate a directory, recording every file with an extension from
+ PATHEXT.
+
+ @param PathIndex Pointer to the index, which supplies the extensions.
+
+ @param Directory Pointer to the directory to populate.  The directory name
+        must already be populated.
+
+ @param Prefix Optionally points to a prefix that file names must start
+        with.  If NULL, all executable files are recorded.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriShPathIndexPopulateDirectory(
+    __in PYORI_SH_PATH_INDEX PathIndex,
+    __inout PYORI_SH_PATH_INDEX_DIRECTORY Directory,
+    __in_opt PYORI_STRING Prefix
+    )
+{
+    YORI_STRING SearchName;
+    YORI_STRING FoundName;
+    WIN32_FIND_DATA FindData;
+    HANDLE hFind;
+    DWORD ExtensionIndex;
+    PYORI_STRING NewFileNames;
+    DWORD PrefixLength;
+    DWORD Index;
+
+    PrefixLength = 0;
+    if (Prefix != NULL) {
+        PrefixLength = Prefix->LengthInChars;
+    }
+
+    if (!YoriLibAllocateString(&SearchName, Directory->DirectoryName.LengthInChars + PrefixLength + 3)) {
+        return FALSE;
+    }
+
+    if (Directory->DirectoryName.LengthInChars > 0 &&
+        YoriLibIsSep(Directory->DirectoryName.StartOfString[Directory->DirectoryName.LengthInChars - 1])) {
+
+        SearchName.LengthInChars = YoriLibSPrintf(SearchName.StartOfString, _T("%y"), &Directory->DirectoryName);
+    } else {
+        SearchName.LengthInChars = YoriLibSPrintf(SearchName.StartOfString, _T("%y\\"), &Directory->DirectoryName);
+    }
+
+    if (Prefix != NULL) {
+        memcpy(&SearchName.StartOfString[SearchName.LengthInChars], Prefix->StartOfString, PrefixLength * sizeof(TCHAR));
+        SearchName.LengthInChars += PrefixLength;
+    }
+    SearchName.StartOfString[SearchName.LengthInChars] = '*';
+    SearchName.StartOfString[SearchName.LengthInChars + 1] = '\0';
+    SearchName.LengthInChars++;
+
+    hFind = FindFirstFile(SearchName.StartOfString, &FindData);
+    YoriLibFreeStringContents(&SearchName);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        return TRUE;
+    }
+
+    do {
+        if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            continue;
+        }
+
+        YoriLibConstantString(&FoundName, FindData.cFileName);
+        if (!YoriShPathIndexFindExtension(PathIndex, &FoundName, &ExtensionIndex)) {
+            continue;
+        }
+
+        if (Directory->FileCount >= Directory->FilesAllocated) {
+            DWORD NewAllocated;
+            NewAllocated = Directory->FilesAllocated * 2;
+            if (NewAllocated < 0x40) {
+                NewAllocated = 0x40;
+            }
+            NewFileNames = YoriLibMalloc(NewAllocated * sizeof(YORI_STRING));
+            if (NewFileNames == NULL) {
+                FindClose(hFind);
+                return FALSE;
+            }
+            if (Directory->FileNames != NULL) {
+                memcpy(NewFileNames, Directory->FileNames, Directory->FileCount * sizeof(YORI_STRING));
+                YoriLibFree(Directory->FileNames);
+            }
+            Directory->FileNames = NewFileNames;
+            Directory->FilesAllocated = NewAllocated;
+        }
+
+        if (!YoriLibAllocateString(&Directory->FileNames[Directory->FileCount], FoundName.LengthInChars + 1)) {
+            FindClose(hFind);
+            return FALSE;
+        }
+
+        Directory->FileNames[Directory->FileCount].LengthInChars = YoriLibSPrintf(Directory->FileNames[Directory->FileCount].StartOfString, _T("%y"), &FoundName);
+        Directory->FileCount++;
+
+    } while (FindNextFile(hFind, &FindData));
+
+    FindClose(hFind);
+
+    //
+    //  Index the names so that the files sharing a base name can be found
+    //  without scanning the whole directory again for every match.
+    //
+
+    if (Directory->FileCount > 0) {
+        Directory->FileHash = YoriLibAllocateHashTable(Directory->FileCount / 2 + 1);
+        if (Directory->FileHash == NULL) {
+            return FALSE;
+        }
+
+        Directory->FileHashEntries = YoriLibMalloc(Directory->FileCount * sizeof(YORI_HASH_ENTRY));
+        if (Directory->FileHashEntries == NULL) {
+            YoriLibFreeEmptyHashTable(Directory->FileHash);
+            Directory->FileHash = NULL;
+            return FALSE;
+        }
+
+        for (Index = 0; Index < Directory->FileCount; Index++) {
+            YoriLibHashInsertByKey(Directory->FileHash, &Directory->FileNames[Index], &Directory->FileNames[Index], &Directory->FileHashEntries[Index]);
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Construct an empty index for the current values of PATH and PATHEXT,
+ containing the directory names and extensions but no files.
+
+ @return Pointer to the newly allocated index, or NULL on failure.
+ */
+PYORI_SH_PATH_INDEX
+YoriShPathIndexAllocate()
+{
+    PYORI_SH_PATH_INDEX PathIndex;
+    YORI_STRING Component;
+    DWORD Index;
+    DWORD Start;
+    DWORD Count;
+
+    PathIndex = YoriLibMalloc(sizeof(YORI_SH_PATH_INDEX));
+    if (PathIndex == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(PathIndex, sizeof(YORI_SH_PATH_INDEX));
+    PathIndex->EnvironmentGeneration = YoriShGlobal.EnvironmentGeneration;
+    YoriLibInitEmptyString(&PathIndex->PathVariable);
+    YoriLibInitEmptyString(&PathIndex->PathExtVariable);
+
+    if (!YoriLibAllocateAndGetEnvironmentVariable(_T("PATH"), &PathIndex->PathVariable) ||
+        !YoriLibAllocateAndGetEnvironmentVariable(_T("PATHEXT"), &PathIndex->PathExtVariable)) {
+
+        YoriShPathIndexFree(PathIndex);
+        return NULL;
+    }
+
+    if (PathIndex->PathExtVariable.LengthInChars == 0) {
+        YoriLibFreeStringContents(&PathIndex->PathExtVariable);
+        if (!YoriLibAllocateString(&PathIndex->PathExtVariable, sizeof(".com;.exe;.bat;.cmd"))) {
+            YoriShPathIndexFree(PathIndex);
+            return NULL;
+        }
+        PathIndex->PathExtVariable.LengthInChars = YoriLibSPrintf(PathIndex->PathExtVariable.StartOfString, _T(".com;.exe;.bat;.cmd"));
+    }
+
+    //
+    //  Count the components in each variable, allocate arrays, and fill
+    //  them.  Empty components are skipped.
+    //
+
+    Count = 1;
+    for (Index = 0; Index < PathIndex->PathExtVariable.LengthInChars; Index++) {
+        if (PathIndex->PathExtVariable.StartOfString[Index] == ';') {
+            Count++;
+        }
+    }
+
+    PathIndex->Extensions = YoriLibMalloc(Count * sizeof(YORI_STRING));
+    if (PathIndex->Extensions == NULL) {
+        YoriShPathIndexFree(PathIndex);
+        return NULL;
+    }
+
+    Start = 0;
+    for (Index = 0; Index <= PathIndex->PathExtVariable.LengthInChars; Index++) {
+        if (Index == PathIndex->PathExtVariable.LengthInChars ||
+            PathIndex->PathExtVariable.StartOfString[Index] == ';') {
+
+            if (Index > Start) {
+                YoriLibInitEmptyString(&PathIndex->Extensions[PathIndex->ExtensionCount]);
+                PathIndex->Extensions[PathIndex->ExtensionCount].StartOfString = &PathIndex->PathExtVariable.StartOfString[Start];
+                PathIndex->Extensions[PathIndex->ExtensionCount].LengthInChars = Index - Start;
+                PathIndex->ExtensionCount++;
+            }
+            Start = Index + 1;
+        }
+    }
+
+    Count = 1;
+    for (Index = 0; Index < PathIndex->PathVariable.LengthInChars; Index++) {
+        if (PathIndex->PathVariable.StartOfString[Index] == ';') {
+            Count++;
+        }
+    }
+
+    PathIndex->Directories = YoriLibMalloc(Count * sizeof(YORI_SH_PATH_INDEX_DIRECTORY));
+    if (PathIndex->Directories == NULL) {
+        YoriShPathIndexFree(PathIndex);
+        return NULL;
+    }
+    ZeroMemory(PathIndex->Directories, Count * sizeof(YORI_SH_PATH_INDEX_DIRECTORY));
+
+    Start = 0;
+    for (Index = 0; Index <= PathIndex->PathVariable.LengthInChars; Index++) {
+        if (Index == PathIndex->PathVariable.LengthInChars ||
+            PathIndex->PathVariable.StartOfString[Index] == ';') {
+
+            if (Index > Start) {
+                PYORI_SH_PATH_INDEX_DIRECTORY Directory;
+                Directory = &PathIndex->Directories[PathIndex->DirectoryCount];
+                YoriLibInitEmptyString(&Component);
+                Component.StartOfString = &PathIndex->PathVariable.StartOfString[Start];
+                Component.LengthInChars = Index - Start;
+                if (!YoriLibAllocateString(&Directory->DirectoryName, Component.LengthInChars + 1)) {
+                    YoriShPathIndexFree(PathIndex);
+                    return NULL;
+                }
+                Directory->DirectoryName.LengthInChars = YoriLibSPrintf(Directory->DirectoryName.StartOfString, _T("%y"), &Component);
+                PathIndex->DirectoryCount++;
+            }
+            Start = Index + 1;
+        }
+    }
+
+    return PathIndex;
+}
+
+/**
+ Return TRUE if a directory name is fully qualified, meaning its meaning
+ does not depend on the current directory.
+
+ @param DirectoryName Pointer to the directory name.
+
+ @return TRUE if the directory name is fully qualified, FALSE if it is
+         relative.
+ */
+BOOLEAN
+YoriShPathIndexIsFullyQualified(
+    __in PYORI_STRING DirectoryName
+    )
+{
+    if (YoriLibIsDriveLetterWithColonAndSlash(DirectoryName)) {
+        return TRUE;
+    }
+
+    if (DirectoryName->LengthInChars >= 2 &&
+        YoriLibIsSep(DirectoryName->StartOfString[0]) &&
+        YoriLibIsSep(DirectoryName->StartOfString[1])) {
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ A background thread which enumerates every directory in an index.  Each
+ directory which is fully specified is monitored for changes before it is
+ enumerated, so any change that occurs during enumeration is detected.
+ Relative directories, or directories that cannot be monitored, are left
+ empty so that they are enumerated when searched.
+
+ @param Context Pointer to the index to populate.
+
+ @return Zero.
+ */
+DWORD WINAPI
+YoriShPathIndexBuildThread(
+    __in LPVOID Context
+    )
+{
+    PYORI_SH_PATH_INDEX PathIndex;
+    PYORI_SH_PATH_INDEX_DIRECTORY Directory;
+    DWORD Index;
+    DWORD SubIndex;
+
+    PathIndex = (PYORI_SH_PATH_INDEX)Context;
+
+    for (Index = 0; Index < PathIndex->DirectoryCount; Index++) {
+        Directory = &PathIndex->Directories[Index];
+
+        if (!YoriShPathIndexIsFullyQualified(&Directory->DirectoryName)) {
+            continue;
+        }
+
+        Directory->ChangeNotification = FindFirstChangeNotification(Directory->DirectoryName.StartOfString, FALSE, FILE_NOTIFY_CHANGE_FILE_NAME);
+        if (Directory->ChangeNotification == INVALID_HANDLE_VALUE) {
+            Directory->ChangeNotification = NULL;
+            continue;
+        }
+
+        //
+        //  If the directory can't be fully enumerated, discard what was
+        //  found and stop monitoring it, so it is enumerated when searched.
+        //
+
+        if (!YoriShPathIndexPopulateDirectory(PathIndex, Directory, NULL)) {
+            FindCloseChangeNotification(Directory->ChangeNotification);
+            Directory->ChangeNotification = NULL;
+            for (SubIndex = 0; SubIndex < Directory->FileCount; SubIndex++) {
+                YoriLibFreeStringContents(&Directory->FileNames[SubIndex]);
+            }
+            Directory->FileCount = 0;
+        }
+    }
+
+    YoriShPendingPathIndex = PathIndex;
+    return 0;
+}
+
+/**
+ Check whether the index reflects the current PATH and PATHEXT values.
+
+ @param PathIndex Pointer to the index to check.
+
+ @return TRUE if the index describes the current PATH and PATHEXT, FALSE if
+         it does not.
+ */
+BOOLEAN
+YoriShPathIndexMatchesEnvironment(
+    __in PYORI_SH_PATH_INDEX PathIndex
+    )
+{
+    YORI_STRING Value;
+    BOOLEAN Result;
+
+    if (PathIndex->EnvironmentGeneration == YoriShGlobal.EnvironmentGeneration) {
+        return TRUE;
+    }
+
+    YoriLibInitEmptyString(&Value);
+    if (!YoriLibAllocateAndGetEnvironmentVariable(_T("PATH"), &Value)) {
+        return FALSE;
+    }
+
+    Result = FALSE;
+    if (YoriLibCompareString(&Value, &PathIndex->PathVariable) == 0) {
+        YoriLibFreeStringContents(&Value);
+        if (YoriLibAllocateAndGetEnvironmentVariable(_T("PATHEXT"), &Value)) {
+            if (Value.LengthInChars == 0 ||
+                YoriLibCompareString(&Value, &PathIndex->PathExtVariable) == 0) {
+                Result = TRUE;
+            }
+        }
+    }
+
+    YoriLibFreeStringContents(&Value);
+
+    if (Result) {
+        PathIndex->EnvironmentGeneration = YoriShGlobal.EnvironmentGeneration;
+    }
+
+    return Result;
+}
+
+/**
+ Return TRUE if a directory in the index has been modified since it was
+ enumerated.
+
+ @param Directory Pointer to the directory to check.
+
+ @return TRUE if the directory has changed, FALSE if it has not.
+ */
+BOOLEAN
+YoriShPathIndexIsDirectoryStale(
+    __in PYORI_SH_PATH_INDEX_DIRECTORY Directory
+    )
+{
+    if (Directory->ChangeNotification == NULL) {
+        return FALSE;
+    }
+
+    if (WaitForSingleObject(Directory->ChangeNotification, 0) == WAIT_OBJECT_0) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ Collect the result of any background index build that has completed, and
+ if the index is missing or out of date, start building a new one in the
+ background.  This is called while waiting for user input, so that the
+ index is usually ready by the time it is needed.
+ */
+VOID
+YoriShPathIndexRefresh()
+{
+    DWORD ThreadId;
+    DWORD Index;
+    BOOLEAN Rebuild;
+    PYORI_SH_PATH_INDEX NewIndex;
+
+    if (YoriShPathIndexThread != NULL) {
+        if (WaitForSingleObject(YoriShPathIndexThread, 0) != WAIT_OBJECT_0) {
+            return;
+        }
+
+        CloseHandle(YoriShPathIndexThread);
+        YoriShPathIndexThread = NULL;
+
+        if (YoriShPathIndex != NULL) {
+            YoriShPathIndexFree(YoriShPathIndex);
+        }
+        YoriShPathIndex = YoriShPendingPathIndex;
+        YoriShPendingPathIndex = NULL;
+    }
+
+    Rebuild = FALSE;
+    if (YoriShPathIndex == NULL ||
+        !YoriShPathIndexMatchesEnvironment(YoriShPathIndex)) {
+
+        Rebuild = TRUE;
+    } else {
+        for (Index = 0; Index < YoriShPathIndex->DirectoryCount; Index++) {
+            if (YoriShPathIndexIsDirectoryStale(&YoriShPathIndex->Directories[Index])) {
+                Rebuild = TRUE;
+                break;
+            }
+        }
+    }
+
+    if (!Rebuild) {
+        return;
+    }
+
+    NewIndex = YoriShPathIndexAllocate();
+    if (NewIndex == NULL) {
+        return;
+    }
+
+    YoriShPathIndexThread = CreateThread(NULL, 0, YoriShPathIndexBuildThread, NewIndex, 0, &ThreadId);
+    if (YoriShPathIndexThread == NULL) {
+        YoriShPathIndexFree(NewIndex);
+    }
+}
+
+/**
+ Report every executable in a directory whose name starts with a prefix, in
+ the same order as a path search would: for each matching file in
+ enumeration order, every file with the same base name is reported in
+ PATHEXT order.
+
+ @param PathIndex Pointer to the index, which supplies the extensions.
+
+ @param Directory Pointer to the directory containing files to report.
+
+ @param Prefix Pointer to the prefix that file names must start with.
+
+ @param MatchCallback Pointer to a function to invoke for each match.
+
+ @param MatchContext Context to pass to MatchCallback.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriShPathIndexReportDirectory(
+    __in PYORI_SH_PATH_INDEX PathIndex,
+    __in PYORI_SH_PATH_INDEX_DIRECTORY Directory,
+    __in PYORI_STRING Prefix,
+    __in PYORI_LIB_PATH_MATCH_FN MatchCallback,
+    __in PVOID MatchContext
+    )
+{
+    YORI_STRING FoundPath;
+    YORI_STRING BaseName;
+    YORI_STRING LookupName;
+    PYORI_STRING FileName;
+    PYORI_STRING Extension;
+    PYORI_STRING Candidate;
+    PYORI_HASH_ENTRY HashEntry;
+    YORI_STRING FullDirectoryName;
+    LPTSTR FilePart;
+    DWORD Index;
+    DWORD ExtIndex;
+    DWORD ExtensionIndex;
+    BOOLEAN Result;
+
+    YoriLibInitEmptyString(&FullDirectoryName);
+    if (!YoriLibGetFullPathNameReturnAllocation(&Directory->DirectoryName, FALSE, &FullDirectoryName, &FilePart)) {
+        return FALSE;
+    }
+
+    if (FullDirectoryName.LengthInChars > 0 &&
+        YoriLibIsSep(FullDirectoryName.StartOfString[FullDirectoryName.LengthInChars - 1])) {
+
+        FullDirectoryName.LengthInChars--;
+    }
+
+    YoriLibInitEmptyString(&FoundPath);
+    YoriLibInitEmptyString(&LookupName);
+    Result = TRUE;
+
+    for (Index = 0; Index < Directory->FileCount; Index++) {
+        FileName = &Directory->FileNames[Index];
+        if (YoriLibCompareStringInsensitiveCount(FileName, Prefix, Prefix->LengthInChars) != 0) {
+            continue;
+        }
+
+        if (!YoriShPathIndexFindExtension(PathIndex, FileName, &ExtensionIndex)) {
+            continue;
+        }
+
+        YoriLibInitEmptyString(&BaseName);
+        BaseName.StartOfString = FileName->StartOfString;
+        BaseName.LengthInChars = FileName->LengthInChars - PathIndex->Extensions[ExtensionIndex].LengthInChars;
+
+        //
+        //  Every file with this base name starts with the prefix, so it is
+        //  sufficient to look for each extension among the files in this
+        //  directory.
+        //
+
+        for (ExtIndex = 0; ExtIndex < PathIndex->ExtensionCount; ExtIndex++) {
+            Extension = &PathIndex->Extensions[ExtIndex];
+            if (LookupName.LengthAllocated < BaseName.LengthInChars + Extension->LengthInChars) {
+                YoriLibFreeStringContents(&LookupName);
+                if (!YoriLibAllocateString(&LookupName, BaseName.LengthInChars + Extension->LengthInChars + 0x40)) {
+                    Result = FALSE;
+                    goto Exit;
+                }
+            }
+
+            memcpy(LookupName.StartOfString, BaseName.StartOfString, BaseName.LengthInChars * sizeof(TCHAR));
+            memcpy(&LookupName.StartOfString[BaseName.LengthInChars], Extension->StartOfString, Extension->LengthInChars * sizeof(TCHAR));
+            LookupName.LengthInChars = BaseName.LengthInChars + Extension->LengthInChars;
+
+            HashEntry = YoriLibHashLookupByKey(Directory->FileHash, &LookupName);
+            if (HashEntry == NULL) {
+                continue;
+            }
+
+            Candidate = HashEntry->Context;
+            if (FoundPath.LengthAllocated < FullDirectoryName.LengthInChars + Candidate->LengthInChars + 2) {
+                YoriLibFreeStringContents(&FoundPath);
+                if (!YoriLibAllocateString(&FoundPath, FullDirectoryName.LengthInChars + Candidate->LengthInChars + 0x40)) {
+                    Result = FALSE;
+                    goto Exit;
+                }
+            }
+
+            FoundPath.LengthInChars = YoriLibSPrintf(FoundPath.StartOfString, _T("%y\\%y"), &FullDirectoryName, Candidate);
+            if (!MatchCallback(&FoundPath, MatchContext)) {
+                Result = FALSE;
+                goto Exit;
+            }
+        }
+    }
+
+Exit:
+    YoriLibFreeStringContents(&LookupName);
+    YoriLibFreeStringContents(&FoundPath);
+    YoriLibFreeStringContents(&FullDirectoryName);
+    return Result;
+}
+
+/**
+ Search the current directory and every directory in the PATH for
+ executables whose name starts with a prefix, using the index for any
+ directory that is known not to have changed.
+
+ @param Prefix Pointer to the prefix to search for.  This should not contain
+        any path component, extension or wildcard.
+
+ @param MatchCallback Pointer to a function to invoke for each match.
+
+ @param MatchContext Context to pass to MatchCallback.
+
+ @return TRUE if the search was performed via the index.  FALSE if the index
+         is not available or is out of date, or if the search could not be
+         completed, in which case the caller should perform a regular path
+         search.
+ */
+__success(return)
+BOOLEAN
+YoriShPathIndexFindExecutables(
+    __in PYORI_STRING Prefix,
+    __in PYORI_LIB_PATH_MATCH_FN MatchCallback,
+    __in PVOID MatchContext
+    )
+{
+    YORI_SH_PATH_INDEX_DIRECTORY LiveDirectory;
+    PYORI_SH_PATH_INDEX_DIRECTORY Directory;
+    DWORD Index;
+    BOOLEAN Result;
+
+    YoriShPathIndexRefresh();
+
+    if (YoriShPathIndex == NULL ||
+        !YoriShPathIndexMatchesEnvironment(YoriShPathIndex)) {
+
+        return FALSE;
+    }
+
+    //
+    //  The current directory is always searched first, and is never
+    //  cached.  Directories that can't be monitored or have changed are
+    //  enumerated now, the same as a regular path search would.  The
+    //  refresh above has already started rebuilding the index if anything
+    //  changed.
+    //
+
+    ZeroMemory(&LiveDirectory, sizeof(LiveDirectory));
+    YoriLibConstantString(&LiveDirectory.DirectoryName, _T("."));
+    Result = YoriShPathIndexPopulateDirectory(YoriShPathIndex, &LiveDirectory, Prefix);
+    if (Result) {
+        Result = YoriShPathIndexReportDirectory(YoriShPathIndex, &LiveDirectory, Prefix, MatchCallback, MatchContext);
+    }
+    YoriShPathIndexFreeDirectory(&LiveDirectory);
+
+    for (Index = 0; Result && Index < YoriShPathIndex->DirectoryCount; Index++) {
+        Directory = &YoriShPathIndex->Directories[Index];
+        if (Directory->DirectoryName.LengthInChars == 0) {
+            continue;
+        }
+
+        if (Directory->ChangeNotification != NULL &&
+            !YoriShPathIndexIsDirectoryStale(Directory)) {
+
+            Result = YoriShPathIndexReportDirectory(YoriShPathIndex, Directory, Prefix, MatchCallback, MatchContext);
+        } else {
+            ZeroMemory(&LiveDirectory, sizeof(LiveDirectory));
+            LiveDirectory.DirectoryName.StartOfString = Directory->DirectoryName.StartOfString;
+            LiveDirectory.DirectoryName.LengthInChars = Directory->DirectoryName.LengthInChars;
+            Result = YoriShPathIndexPopulateDirectory(YoriShPathIndex, &LiveDirectory, Prefix);
+            if (Result) {
+                Result = YoriShPathIndexReportDirectory(YoriShPathIndex, &LiveDirectory, Prefix, MatchCallback, MatchContext);
+            }
+            LiveDirectory.DirectoryName.StartOfString = NULL;
+            LiveDirectory.DirectoryName.LengthInChars = 0;
+            YoriShPathIndexFreeDirectory(&LiveDirectory);
+        }
+    }
+
+    return Result;
+}
+
+/**
+ Free the index.  If a background thread is still building an index, it is
+ left to finish or be terminated when the process exits, since waiting for
+ it could block on a slow network directory.
+ */
+VOID
+YoriShPathIndexCleanup()
+{
+    if (YoriShPathIndexThread != NULL) {
+        if (WaitForSingleObject(YoriShPathIndexThread, 0) == WAIT_OBJECT_0) {
+            if (YoriShPendingPathIndex != NULL) {
+                YoriShPathIndexFree(YoriShPendingPathIndex);
+                YoriShPendingPathIndex = NULL;
+            }
+        }
+        CloseHandle(YoriShPathIndexThread);
+        YoriShPathIndexThread = NULL;
+    }
+
+    if (YoriShPathIndex != NULL) {
+        YoriShPathIndexFree(YoriShPathIndex);
+        YoriShPathIndex = NULL;
+    }
+}
+
+// vim:sw=4:ts=4:et:
@@ -68,9 +68,405 @@ YoriShGetTempPath(
     return TRUE;
 }
 
+/**
+ The signature at the start of a restart snapshot, which is "YRST" when
+ viewed as bytes.
+ */
+#define YORI_SH_RESTART_SIGNATURE 0x54535259
+
+/**
+ The version of the restart snapshot format.  This should be incremented
+ whenever the header or the meaning of any section changes, which causes
+ snapshots from other versions to be ignored.
+ */
+#define YORI_SH_RESTART_VERSION   1
+
+/**
+ The largest restart snapshot that will be loaded.  This is well beyond the
+ size of any state that could be saved, and exists to avoid allocating
+ unbounded memory for a corrupt file.
+ */
+#define YORI_SH_RESTART_MAX_SIZE  (64 * 1024 * 1024)
+
+/**
+ Round a section length up so that the following section is DWORD aligned.
+ */
+#define YORI_SH_RESTART_ALIGN(x)  (((x) + 3) & ~(3))
+
+/**
+ The variable length sections within a restart snapshot.
+ */
+typedef enum _YORI_SH_RESTART_SECTION_ID {
+    YoriShRestartSectionTitle = 0,
+    YoriShRestartSectionFontName = 1,
+    YoriShRestartSectionCurrentDirectory = 2,
+    YoriShRestartSectionEnvironment = 3,
+    YoriShRestartSectionAliases = 4,
+    YoriShRestartSectionHistory = 5,
+    YoriShRestartSectionContents = 6,
+    YoriShRestartSectionMax = 7
+} YORI_SH_RESTART_SECTION_ID;
+
+/**
+ Describes the location of a variable length section within a restart
+ snapshot.
+ */
+typedef struct _YORI_SH_RESTART_SECTION {
+
+    /**
+     The offset of the section from the beginning of the snapshot, in bytes.
+     This is always DWORD aligned.
+     */
+    DWORD Offset;
+
+    /**
+     The length of the section, in bytes.  Zero indicates the section is not
+     present.
+     */
+    DWORD Length;
+} YORI_SH_RESTART_SECTION, *PYORI_SH_RESTART_SECTION;
+
+/**
+ The header at the beginning of a restart snapshot.  This contains all fixed
+ size state, followed by the location of each variable length section.  The
+ snapshot is written with a single write and read with a single read, so
+ the sections follow this header in the same file.
+
+ String sections contain a NULL terminated string.  The environment, alias
+ and history sections contain a series of NULL terminated strings followed
+ by an additional NULL terminator.  The contents section contains an array
+ of CHAR_INFO structures describing the cells of the console.
+ */
+typedef struct _YORI_SH_RESTART_HEADER {
+
+    /**
+     Set to YORI_SH_RESTART_SIGNATURE.
+     */
+    DWORD Signature;
+
+    /**
+     Set to YORI_SH_RESTART_VERSION.
+     */
+    DWORD Version;
+
+    /**
+     The size of this header, in bytes.
+     */
+    DWORD HeaderSize;
+
+    /**
+     The size of the entire snapshot, in bytes.
+     */
+    DWORD FileSize;
+
+    /**
+     A checksum of the entire snapshot, calculated with this field set to
+     zero.
+     */
+    DWORD Checksum;
+
+    /**
+     The width of the console screen buffer.
+     */
+    WORD BufferWidth;
+
+    /**
+     The height of the console screen buffer.
+     */
+    WORD BufferHeight;
+
+    /**
+     The width of the console window.
+     */
+    WORD WindowWidth;
+
+    /**
+     The height of the console window.
+     */
+    WORD WindowHeight;
+
+    /**
+     The default color of the console.
+     */
+    WORD DefaultColor;
+
+    /**
+     The color used by the console for popups.
+     */
+    WORD PopupColor;
+
+    /**
+     The RGB values to use for the 16 console colors.
+     */
+    DWORD ColorTable[16];
+
+    /**
+     The index of the console font.
+     */
+    DWORD FontIndex;
+
+    /**
+     The width of each character in the console font.  Zero if the font
+     could not be queried.
+     */
+    WORD FontWidth;
+
+    /**
+     The height of each character in the console font.  Zero if the font
+     could not be queried.
+     */
+    WORD FontHeight;
+
+    /**
+     The family of the console font.
+     */
+    DWORD FontFamily;
+
+    /**
+     The weight of the console font.
+     */
+    DWORD FontWeight;
+
+    /**
+     The number of cells in each line of the contents section.
+     */
+    WORD ContentsWidth;
+
+    /**
+     The number of lines in the contents section.
+     */
+    WORD ContentsHeight;
+
+    /**
+     The location of each variable length section.
+     */
+    YORI_SH_RESTART_SECTION Sections[YoriShRestartSectionMax];
+
+} YORI_SH_RESTART_HEADER, *PYORI_SH_RESTART_HEADER;
+
+/**
+ Calculate a checksum over a restart snapshot.  This is a 32 bit FNV-1a
+ hash, which is sufficient to detect a torn or truncated write.
+
+ @param Buffer Pointer to the snapshot.
+
+ @param Length The number of bytes in the snapshot.
+
+ @return The checksum.
+ */
+DWORD
+YoriShRestartChecksum(
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD Hash;
+    DWORD Index;
+
+    Hash = 0x811C9DC5;
+    for (Index = 0; Index < Length; Index++) {
+        Hash = (Hash ^ Buffer[Index]) * 0x01000193;
+    }
+
+    return Hash;
+}
+
+/**
+ Return the number of characters in a series of NULL terminated strings,
+ terminated by an additional NULL, including all terminators.
+
+ @param MultiSz Pointer to the series of strings.
+
+ @return The number of characters.
+ */
+DWORD
+YoriShRestartMultiSzLength(
+    __in LPCTSTR MultiSz
+    )
+{
+    LPCTSTR Entry;
+
+    Entry = MultiSz;
+    while (*Entry != '\0') {
+        Entry += _tcslen(Entry) + 1;
+    }
+
+    return (DWORD)(Entry - MultiSz + 1);
+}
+
+/**
+ Capture the lines of the console above the cursor.
+
+ @param LineCount Specifies the maximum number of lines to capture.  If
+        zero, all lines above the cursor are captured.
+
+ @param Cells On successful completion, updated to point to a newly
+        allocated array of cells.  The caller should free this with
+        YoriLibFree.
+
+ @param Width On successful completion, updated to contain the number of
+        cells in each line.
+
+ @param Height On successful completion, updated to contain the number of
+        lines captured.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShCaptureConsoleContents(
+    __in DWORD LineCount,
+    __out PCHAR_INFO *Cells,
+    __out PWORD Width,
+    __out PWORD Height
+    )
+{
+    CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
+    HANDLE hConsole;
+    PCHAR_INFO ReadBuffer;
+    COORD ReadBufferOffset;
+    COORD LineReadBufferSize;
+    SMALL_RECT LineReadWindow;
+    WORD LineIndex;
+
+    hConsole = CreateFile(_T("CONOUT$"), GENERIC_READ|GENERIC_WRITE, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+    if (hConsole == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    if (!GetConsoleScreenBufferInfo(hConsole, &ScreenInfo)) {
+        CloseHandle(hConsole);
+        return FALSE;
+    }
+
+    if (LineCount == 0 || LineCount > (DWORD)ScreenInfo.dwCursorPosition.Y) {
+        LineCount = ScreenInfo.dwCursorPosition.Y;
+    }
+
+    if (LineCount == 0 || ScreenInfo.dwSize.X <= 0) {
+        CloseHandle(hConsole);
+        return FALSE;
+    }
+
+    ReadBuffer = YoriLibMalloc(ScreenInfo.dwSize.X * LineCount * sizeof(CHAR_INFO));
+    if (ReadBuffer == NULL) {
+        CloseHandle(hConsole);
+        return FALSE;
+    }
+
+    ReadBufferOffset.X = 0;
+    ReadBufferOffset.Y = 0;
+    LineReadBufferSize.X = ScreenInfo.dwSize.X;
+    LineReadBufferSize.Y = 1;
+
+    //
+    //  ReadConsoleOutput fails if it's given a large request, so give it
+    //  a pile of small (one line) requests.
+    //
+
+    for (LineIndex = 0; LineIndex < (WORD)LineCount; LineIndex++) {
+
+        LineReadWindow.Left = 0;
+        LineReadWindow.Right = (SHORT)(ScreenInfo.dwSize.X - 1);
+        LineReadWindow.Top = (SHORT)(ScreenInfo.dwCursorPosition.Y - LineCount + LineIndex);
+        LineReadWindow.Bottom = LineReadWindow.Top;
+
+        if (!ReadConsoleOutput(hConsole, &ReadBuffer[LineIndex * ScreenInfo.dwSize.X], LineReadBufferSize, ReadBufferOffset, &LineReadWindow)) {
+            CloseHandle(hConsole);
+            YoriLibFree(ReadBuffer);
+            return FALSE;
+        }
+    }
+
+    CloseHandle(hConsole);
+
+    *Cells = ReadBuffer;
+    *Width = (WORD)ScreenInfo.dwSize.X;
+    *Height = (WORD)LineCount;
+    return TRUE;
+}
+
+/**
+ Display the contents of the console as captured in a restart snapshot.
+ The cells are converted into a single string containing VT100 escapes for
+ color changes, which is written to the console in one operation.  Each line
+ spans the full width of the console, so the console wraps it onto the next
+ line without any explicit line break.
+
+ @param Cells Pointer to the array of cells to display.
+
+ @param Width The number of cells in each line.
+
+ @param Height The number of lines.
+ */
+VOID
+YoriShDisplayRestartContents(
+    __in PCHAR_INFO Cells,
+    __in WORD Width,
+    __in WORD Height
+    )
+{
+    TCHAR EscapeStringBuffer[YORI_MAX_INTERNAL_VT_ESCAPE_CHARS];
+    YORI_STRING EscapeString;
+    YORI_STRING Contents;
+    DWORD CellCount;
+    DWORD CellIndex;
+    DWORD CharsNeeded;
+    WORD LastAttribute;
+
+    YoriLibInitEmptyString(&EscapeString);
+    EscapeString.StartOfString = EscapeStringBuffer;
+    EscapeString.LengthAllocated = sizeof(EscapeStringBuffer)/sizeof(EscapeStringBuffer[0]);
+
+    CellCount = Width * Height;
+
+    //
+    //  Count the characters needed for the text and every escape, then
+    //  go through again populating both.
+    //
+
+    LastAttribute = Cells[0].Attributes;
+    YoriLibVtStringForTextAttribute(&EscapeString, 0, LastAttribute);
+    CharsNeeded = CellCount + EscapeString.LengthInChars;
+
+    for (CellIndex = 0; CellIndex < CellCount; CellIndex++) {
+        if (Cells[CellIndex].Attributes != LastAttribute) {
+            LastAttribute = Cells[CellIndex].Attributes;
+            YoriLibVtStringForTextAttribute(&EscapeString, 0, LastAttribute);
+            CharsNeeded += EscapeString.LengthInChars;
+        }
+    }
+
+    if (!YoriLibAllocateString(&Contents, CharsNeeded)) {
+        return;
+    }
+
+    LastAttribute = Cells[0].Attributes;
+    YoriLibVtStringForTextAttribute(&EscapeString, 0, LastAttribute);
+    memcpy(Contents.StartOfString, EscapeString.StartOfString, EscapeString.LengthInChars * sizeof(TCHAR));
+    Contents.LengthInChars = EscapeString.LengthInChars;
+
+    for (CellIndex = 0; CellIndex < CellCount; CellIndex++) {
+        if (Cells[CellIndex].Attributes != LastAttribute) {
+            LastAttribute = Cells[CellIndex].Attributes;
+            YoriLibVtStringForTextAttribute(&EscapeString, 0, LastAttribute);
+            memcpy(&Contents.StartOfString[Contents.LengthInChars], EscapeString.StartOfString, EscapeString.LengthInChars * sizeof(TCHAR));
+            Contents.LengthInChars += EscapeString.LengthInChars;
+        }
+        Contents.StartOfString[Contents.LengthInChars] = Cells[CellIndex].Char.UnicodeChar;
+        Contents.LengthInChars++;
+    }
+
+    ASSERT(Contents.LengthInChars == CharsNeeded);
+    YoriLibOutputString(GetStdHandle(STD_OUTPUT_HANDLE), 0, &Contents);
+    YoriLibFreeStringContents(&Contents);
+}
+
 /**
  Try to save the current state of the process so that it can be recovered
- from this state after a subsequent unexpected termination.
+ from this state after a subsequent unexpected termination.  All state is
+ collected into memory, formatted as a single snapshot, and written to disk
+ with one write.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
@@ -81,11 +477,25 @@ YoriShSaveRestartStateWorker(
 {
     YORI_CONSOLE_SCREEN_BUFFER_INFOEX ScreenBufferInfo;
     YORI_CONSOLE_FONT_INFOEX FontInfo;
+    PYORI_SH_RESTART_HEADER Header;
+    PVOID SectionData[YoriShRestartSectionMax];
+    DWORD SectionLength[YoriShRestartSectionMax];
+    TCHAR RestartCommandLine[sizeof("-restart ") + 2 * sizeof(DWORD)];
 
-    YORI_STRING WriteBuffer;
     YORI_STRING RestartFileName;
-    YORI_STRING RestartBufferFileName;
+    YORI_STRING TempFileName;
+    YORI_STRING Title;
+    YORI_STRING CurrentDirectory;
     YORI_STRING Env;
+    YORI_STRING Aliases;
+    YORI_STRING History;
+    PCHAR_INFO Contents;
+    WORD ContentsWidth;
+    WORD ContentsHeight;
+    HANDLE hFile;
+    PUCHAR Buffer;
+    DWORD FileSize;
+    DWORD BytesWritten;
     LPTSTR Comma;
     DWORD Count;
     DWORD LineCount;
@@ -159,7 +569,7 @@ YoriShSaveRestartStateWorker(
     YoriLibFreeStringContents(&RestartFileName);
 
     //
-    //  Query window dimensions and state, and save it.
+    //  Query window dimensions and state.
     //
 
     ZeroMemory(&ScreenBufferInfo, sizeof(ScreenBufferInfo));
@@ -169,232 +579,236 @@ YoriShSaveRestartStateWorker(
         return 0;
     }
 
-    if (!YoriShGetTempPath(&RestartFileName, sizeof("\\yori-restart-.ini") + 2 * sizeof(DWORD))) {
+    if (!YoriShGetTempPath(&RestartFileName, sizeof("\\yori-restart-.dat") + 2 * sizeof(DWORD))) {
         return 0;
     }
 
     YoriLibSPrintf(RestartFileName.StartOfString + RestartFileName.LengthInChars,
-                   _T("\\yori-restart-%x.ini"),
+                   _T("\\yori-restart-%x.dat"),
                    GetCurrentProcessId());
 
-    if (!YoriLibAllocateString(&WriteBuffer, 64 * 1024)) {
+    if (!YoriShGetTempPath(&TempFileName, sizeof("\\yori-restart-.tmp") + 2 * sizeof(DWORD))) {
         YoriLibFreeStringContents(&RestartFileName);
         return 0;
     }
 
-    YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.dwSize.X);
-    WritePrivateProfileString(_T("Window"), _T("BufferWidth"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-    YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.dwSize.Y);
-    WritePrivateProfileString(_T("Window"), _T("BufferHeight"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-    YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.srWindow.Right - ScreenBufferInfo.srWindow.Left + 1);
-    WritePrivateProfileString(_T("Window"), _T("WindowWidth"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-    YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.srWindow.Bottom - ScreenBufferInfo.srWindow.Top + 1);
-    WritePrivateProfileString(_T("Window"), _T("WindowHeight"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-
-    YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), YoriLibVtGetDefaultColor());
-    WritePrivateProfileString(_T("Window"), _T("DefaultColor"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-    YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.wPopupAttributes);
-    WritePrivateProfileString(_T("Window"), _T("PopupColor"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+    YoriLibSPrintf(TempFileName.StartOfString + TempFileName.LengthInChars,
+                   _T("\\yori-restart-%x.tmp"),
+                   GetCurrentProcessId());
 
-    for (Count = 0; Count < sizeof(ScreenBufferInfo.ColorTable)/sizeof(ScreenBufferInfo.ColorTable[0]); Count++) {
-        TCHAR ColorName[32];
-        YoriLibSPrintf(ColorName, _T("Color%i"), Count);
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.ColorTable[Count]);
-        WritePrivateProfileString(_T("Window"), ColorName, WriteBuffer.StartOfString, RestartFileName.StartOfString);
-    }
+    ZeroMemory(SectionData, sizeof(SectionData));
+    ZeroMemory(SectionLength, sizeof(SectionLength));
+    YoriLibInitEmptyString(&Title);
+    YoriLibInitEmptyString(&CurrentDirectory);
+    YoriLibInitEmptyString(&Env);
+    YoriLibInitEmptyString(&Aliases);
+    YoriLibInitEmptyString(&History);
+    Contents = NULL;
+    ContentsWidth = 0;
+    ContentsHeight = 0;
+    Buffer = NULL;
 
     //
-    //  Query the window title and save it.
+    //  Query the window title.  Apparently GetConsoleTitle can't tell us how
+    //  much memory it needs, so use a buffer that's large enough for any
+    //  reasonable title.
     //
 
-    WriteBuffer.LengthInChars = GetConsoleTitle(WriteBuffer.StartOfString, 4095);
-    if (WriteBuffer.LengthInChars > 0) {
-        WritePrivateProfileString(_T("Window"), _T("Title"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-    } else {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Error getting window title: %i\n"), GetLastError());
+    if (YoriLibAllocateString(&Title, 4096)) {
+        Title.LengthInChars = GetConsoleTitle(Title.StartOfString, Title.LengthAllocated - 1);
+        if (Title.LengthInChars > 0) {
+            Title.StartOfString[Title.LengthInChars] = '\0';
+            SectionData[YoriShRestartSectionTitle] = Title.StartOfString;
+            SectionLength[YoriShRestartSectionTitle] = (Title.LengthInChars + 1) * sizeof(TCHAR);
+        } else {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Error getting window title: %i\n"), GetLastError());
+        }
     }
 
     //
-    //  Query window font information and save it.
+    //  Query window font information.
     //
 
     ZeroMemory(&FontInfo, sizeof(FontInfo));
     FontInfo.cbSize = sizeof(FontInfo);
     if (DllKernel32.pGetCurrentConsoleFontEx(GetStdHandle(STD_OUTPUT_HANDLE), FALSE, &FontInfo)) {
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.nFont);
-        WritePrivateProfileString(_T("Window"), _T("FontIndex"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.dwFontSize.X);
-        WritePrivateProfileString(_T("Window"), _T("FontWidth"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.dwFontSize.Y);
-        WritePrivateProfileString(_T("Window"), _T("FontHeight"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.FontFamily);
-        WritePrivateProfileString(_T("Window"), _T("FontFamily"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.FontWeight);
-        WritePrivateProfileString(_T("Window"), _T("FontWeight"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-        WritePrivateProfileString(_T("Window"), _T("FontName"), FontInfo.FaceName, RestartFileName.StartOfString);
+        FontInfo.FaceName[sizeof(FontInfo.FaceName)/sizeof(FontInfo.FaceName[0]) - 1] = '\0';
+        SectionData[YoriShRestartSectionFontName] = FontInfo.FaceName;
+        SectionLength[YoriShRestartSectionFontName] = ((DWORD)_tcslen(FontInfo.FaceName) + 1) * sizeof(TCHAR);
+    } else {
+        ZeroMemory(&FontInfo, sizeof(FontInfo));
     }
 
     //
-    //  Query the current directory and save it.
+    //  Query the current directory.
     //
 
-    WriteBuffer.LengthInChars = GetCurrentDirectory(WriteBuffer.LengthAllocated, WriteBuffer.StartOfString);
-    if (WriteBuffer.LengthInChars > 0 && WriteBuffer.LengthInChars < WriteBuffer.LengthAllocated) {
-        WritePrivateProfileString(_T("Window"), _T("CurrentDirectory"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+    Count = GetCurrentDirectory(0, NULL);
+    if (Count > 0 && YoriLibAllocateString(&CurrentDirectory, Count)) {
+        CurrentDirectory.LengthInChars = GetCurrentDirectory(CurrentDirectory.LengthAllocated, CurrentDirectory.StartOfString);
+        if (CurrentDirectory.LengthInChars > 0 && CurrentDirectory.LengthInChars < CurrentDirectory.LengthAllocated) {
+            SectionData[YoriShRestartSectionCurrentDirectory] = CurrentDirectory.StartOfString;
+            SectionLength[YoriShRestartSectionCurrentDirectory] = (CurrentDirectory.LengthInChars + 1) * sizeof(TCHAR);
+        }
     }
 
     //
-    //  Write the current environment
+    //  Capture the current environment.  This includes the current
+    //  directories on other drives, which are recorded as =C: type
+    //  variables.
     //
 
     if (YoriLibGetEnvironmentStrings(&Env)) {
-        LPTSTR ThisPair;
-        LPTSTR ThisVar;
-        LPTSTR ThisValue;
-
-        ThisPair = Env.StartOfString;
-        while (*ThisPair != '\0') {
-            ThisVar = ThisPair;
-            ThisPair += _tcslen(ThisPair) + 1;
-
-            if (ThisVar[0] != '=') {
-                ThisValue = _tcschr(ThisVar, '=');
-                if (ThisValue) {
-                    ThisValue[0] = '\0';
-                    ThisValue++;
-
-                    WritePrivateProfileString(_T("Environment"), ThisVar, ThisValue, RestartFileName.StartOfString);
-
-                    ThisValue--;
-                    ThisValue[0] = '=';
-                }
-            }
-        }
-
-        //
-        //  With the "regular" environment done, go through and write a new
-        //  section for current directories on alternate drives.  These are
-        //  part of the environment but inexpressible in the INI format as
-        //  regular entries, so they get their own section.
-        //
-
-        ThisPair = Env.StartOfString;
-        while (*ThisPair != '\0') {
-            ThisVar = ThisPair;
-            ThisPair += _tcslen(ThisPair) + 1;
-
-            if (ThisVar[0] == '=' &&
-                ((ThisVar[1] >= 'A' && ThisVar[1] <= 'Z') ||
-                 (ThisVar[1] >= 'a' && ThisVar[1] <= 'z')) &&
-                ThisVar[2] == ':' &&
-                ThisVar[3] == '=') {
-
-                ThisValue = &ThisVar[3];
-                ThisVar++;
-                ThisValue[0] = '\0';
-                ThisValue++;
-
-                WritePrivateProfileString(_T("CurrentDirectories"), ThisVar, ThisValue, RestartFileName.StartOfString);
+        SectionData[YoriShRestartSectionEnvironment] = Env.StartOfString;
+        SectionLength[YoriShRestartSectionEnvironment] = YoriShRestartMultiSzLength(Env.StartOfString) * sizeof(TCHAR);
+    } else {
+        YoriLibInitEmptyString(&Env);
+    }
 
-                ThisValue--;
-                ThisValue[0] = '=';
-            }
-        }
+    //
+    //  Capture the current aliases.
+    //
 
-        YoriLibFreeStringContents(&Env);
+    if (YoriShGetAliasStrings(YORI_SH_GET_ALIAS_STRINGS_INCLUDE_USER, &Aliases)) {
+        SectionData[YoriShRestartSectionAliases] = Aliases.StartOfString;
+        SectionLength[YoriShRestartSectionAliases] = YoriShRestartMultiSzLength(Aliases.StartOfString) * sizeof(TCHAR);
     }
 
     //
-    //  Write the current aliases
+    //  Capture history, oldest first.
     //
 
-    if (YoriShGetAliasStrings(YORI_SH_GET_ALIAS_STRINGS_INCLUDE_USER, &Env)) {
-        LPTSTR ThisPair;
-        LPTSTR ThisVar;
-        LPTSTR ThisValue;
-
-        ThisPair = Env.StartOfString;
-        while (*ThisPair != '\0') {
-            ThisVar = ThisPair;
-            ThisPair += _tcslen(ThisPair) + 1;
-            if (ThisVar[0] != '=') {
-                ThisValue = _tcschr(ThisVar, '=');
-                if (ThisValue) {
-                    ThisValue[0] = '\0';
-                    ThisValue++;
+    if (YoriShGetHistoryStrings(100, &History)) {
+        SectionData[YoriShRestartSectionHistory] = History.StartOfString;
+        SectionLength[YoriShRestartSectionHistory] = YoriShRestartMultiSzLength(History.StartOfString) * sizeof(TCHAR);
+    }
 
-                    WritePrivateProfileString(_T("Aliases"), ThisVar, ThisValue, RestartFileName.StartOfString);
-                }
-            }
-        }
+    //
+    //  Capture the window contents.
+    //
 
-        YoriLibFreeStringContents(&Env);
+    if (YoriShCaptureConsoleContents(LineCount, &Contents, &ContentsWidth, &ContentsHeight)) {
+        SectionData[YoriShRestartSectionContents] = Contents;
+        SectionLength[YoriShRestartSectionContents] = ContentsWidth * ContentsHeight * sizeof(CHAR_INFO);
     }
 
     //
-    //  Write history.  We only care about values here but want to maintain
-    //  sort order, so zero prefix count to use as a key.
+    //  Calculate the size of the snapshot, keeping each section DWORD
+    //  aligned, and generate it in memory.
     //
 
-    if (YoriShGetHistoryStrings(100, &Env)) {
-        LPTSTR ThisValue;
+    FileSize = sizeof(YORI_SH_RESTART_HEADER);
+    for (Count = 0; Count < YoriShRestartSectionMax; Count++) {
+        FileSize += YORI_SH_RESTART_ALIGN(SectionLength[Count]);
+    }
 
-        ThisValue = Env.StartOfString;
-        Count = 1;
-        while (*ThisValue != '\0') {
-            YoriLibSPrintf(WriteBuffer.StartOfString, _T("%03i"), Count);
-            WritePrivateProfileString(_T("History"), WriteBuffer.StartOfString, ThisValue, RestartFileName.StartOfString);
-            ThisValue += _tcslen(ThisValue) + 1;
-            Count++;
-        }
+    Buffer = YoriLibMalloc(FileSize);
+    if (Buffer == NULL) {
+        goto Exit;
+    }
 
-        YoriLibFreeStringContents(&Env);
+    ZeroMemory(Buffer, FileSize);
+    Header = (PYORI_SH_RESTART_HEADER)Buffer;
+    Header->Signature = YORI_SH_RESTART_SIGNATURE;
+    Header->Version = YORI_SH_RESTART_VERSION;
+    Header->HeaderSize = sizeof(YORI_SH_RESTART_HEADER);
+    Header->FileSize = FileSize;
+
+    Header->BufferWidth = (WORD)ScreenBufferInfo.dwSize.X;
+    Header->BufferHeight = (WORD)ScreenBufferInfo.dwSize.Y;
+    Header->WindowWidth = (WORD)(ScreenBufferInfo.srWindow.Right - ScreenBufferInfo.srWindow.Left + 1);
+    Header->WindowHeight = (WORD)(ScreenBufferInfo.srWindow.Bottom - ScreenBufferInfo.srWindow.Top + 1);
+    Header->DefaultColor = YoriLibVtGetDefaultColor();
+    Header->PopupColor = ScreenBufferInfo.wPopupAttributes;
+    memcpy(Header->ColorTable, ScreenBufferInfo.ColorTable, sizeof(Header->ColorTable));
+
+    Header->FontIndex = FontInfo.nFont;
+    Header->FontWidth = (WORD)FontInfo.dwFontSize.X;
+    Header->FontHeight = (WORD)FontInfo.dwFontSize.Y;
+    Header->FontFamily = FontInfo.FontFamily;
+    Header->FontWeight = FontInfo.FontWeight;
+
+    Header->ContentsWidth = ContentsWidth;
+    Header->ContentsHeight = ContentsHeight;
+
+    FileSize = sizeof(YORI_SH_RESTART_HEADER);
+    for (Count = 0; Count < YoriShRestartSectionMax; Count++) {
+        if (SectionLength[Count] > 0) {
+            Header->Sections[Count].Offset = FileSize;
+            Header->Sections[Count].Length = SectionLength[Count];
+            memcpy(Buffer + FileSize, SectionData[Count], SectionLength[Count]);
+            FileSize += YORI_SH_RESTART_ALIGN(SectionLength[Count]);
+        }
     }
 
+    ASSERT(FileSize == Header->FileSize);
+    Header->Checksum = YoriShRestartChecksum(Buffer, FileSize);
+
     //
-    //  Write the window contents
+    //  Write the snapshot to a temporary file beside the previous one and
+    //  move it into place once it is complete, so an interrupted save
+    //  leaves the previous snapshot intact.  If the move itself is
+    //  interrupted, the checksum will not match and the snapshot will be
+    //  ignored.
     //
 
-    if (YoriLibAllocateString(&RestartBufferFileName, RestartFileName.LengthAllocated)) {
+    hFile = CreateFile(TempFileName.StartOfString,
+                       GENERIC_WRITE,
+                       FILE_SHARE_READ | FILE_SHARE_DELETE,
+                       NULL,
+                       CREATE_ALWAYS,
+                       FILE_ATTRIBUTE_NORMAL,
+                       NULL);
 
-        HANDLE hBufferFile;
+    if (hFile == INVALID_HANDLE_VALUE) {
+        goto Exit;
+    }
 
-        memcpy(RestartBufferFileName.StartOfString, RestartFileName.StartOfString, RestartFileName.LengthInChars * sizeof(TCHAR));
-        RestartBufferFileName.LengthInChars = RestartFileName.LengthInChars;
-        YoriLibSPrintf(RestartBufferFileName.StartOfString + RestartBufferFileName.LengthInChars,
-                       _T("\\yori-restart-%x.txt"),
-                       GetCurrentProcessId());
+    if (!WriteFile(hFile, Buffer, FileSize, &BytesWritten, NULL) ||
+        BytesWritten != FileSize) {
 
-        hBufferFile = CreateFile(RestartBufferFileName.StartOfString,
-                                 GENERIC_WRITE,
-                                 FILE_SHARE_READ | FILE_SHARE_DELETE,
-                                 NULL,
-                                 CREATE_ALWAYS,
-                                 FILE_ATTRIBUTE_NORMAL,
-                                 NULL);
+        CloseHandle(hFile);
+        DeleteFile(TempFileName.StartOfString);
+        goto Exit;
+    }
 
-        if (hBufferFile != INVALID_HANDLE_VALUE) {
-            YoriLibRewriteConsoleContents(hBufferFile, LineCount, 0);
-            WritePrivateProfileString(_T("Window"), _T("Contents"), RestartBufferFileName.StartOfString, RestartFileName.StartOfString);
-            CloseHandle(hBufferFile);
-        }
+    FlushFileBuffers(hFile);
+    CloseHandle(hFile);
+
+    if (!MoveFileEx(TempFileName.StartOfString,
+                    RestartFileName.StartOfString,
+                    MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
 
-        YoriLibFreeStringContents(&RestartBufferFileName);
+        DeleteFile(TempFileName.StartOfString);
+        goto Exit;
     }
 
     //
     //  Register the process to be restarted on failure
     //
-    
+
     if (!YoriShProcessRegisteredForRestart) {
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("-restart %x"), GetCurrentProcessId());
+        YoriLibSPrintf(RestartCommandLine, _T("-restart %x"), GetCurrentProcessId());
 
-        DllKernel32.pRegisterApplicationRestart(WriteBuffer.StartOfString, 0);
+        DllKernel32.pRegisterApplicationRestart(RestartCommandLine, 0);
         YoriShProcessRegisteredForRestart = TRUE;
     }
 
+Exit:
+
+    if (Buffer != NULL) {
+        YoriLibFree(Buffer);
+    }
+    if (Contents != NULL) {
+        YoriLibFree(Contents);
+    }
+    YoriLibFreeStringContents(&History);
+    YoriLibFreeStringContents(&Aliases);
+    YoriLibFreeStringContents(&Env);
+    YoriLibFreeStringContents(&CurrentDirectory);
+    YoriLibFreeStringContents(&Title);
+    YoriLibFreeStringContents(&TempFileName);
     YoriLibFreeStringContents(&RestartFileName);
-    YoriLibFreeStringContents(&WriteBuffer);
 
     return 0;
 }
@@ -449,14 +863,154 @@ YoriShCleanupRestartSaveThreadIfCompleted()
 }
 
 /**
- Try to recover a previous process ID that terminated unexpectedly.
+ Return a pointer to a string section within a restart snapshot, after
+ checking that it is contained within the snapshot and is correctly
+ terminated.
+
+ @param Header Pointer to the snapshot.  The snapshot's size is assumed to
+        have been validated against Header->FileSize.
+
+ @param SectionId Specifies the section to return.
+
+ @param MultiSz If TRUE, the section is a series of NULL terminated strings
+        followed by an additional NULL.  If FALSE, the section is a single
+        NULL terminated string.
+
+ @return Pointer to the section, or NULL if the section is not present or
+         is not valid.
+ */
+LPTSTR
+YoriShGetRestartStringSection(
+    __in PYORI_SH_RESTART_HEADER Header,
+    __in YORI_SH_RESTART_SECTION_ID SectionId,
+    __in BOOLEAN MultiSz
+    )
+{
+    PYORI_SH_RESTART_SECTION Section;
+    LPTSTR String;
+    DWORD LengthInChars;
+
+    Section = &Header->Sections[SectionId];
+    if (Section->Length < sizeof(TCHAR) ||
+        (Section->Length % sizeof(TCHAR)) != 0 ||
+        (Section->Offset % sizeof(DWORD)) != 0 ||
+        Section->Offset < Header->HeaderSize ||
+        Section->Offset > Header->FileSize ||
+        Section->Length > Header->FileSize - Section->Offset) {
+
+        return NULL;
+    }
+
+    String = (LPTSTR)((PUCHAR)Header + Section->Offset);
+    LengthInChars = Section->Length / sizeof(TCHAR);
+    if (String[LengthInChars - 1] != '\0') {
+        return NULL;
+    }
+
+    //
+    //  A series of strings needs two terminators so that walking the
+    //  series cannot run beyond the section, unless it's an empty series.
+    //
+
+    if (MultiSz && LengthInChars > 1 && String[LengthInChars - 2] != '\0') {
+        return NULL;
+    }
+
+    return String;
+}
+
+/**
+ Load a restart snapshot from disk and check that it is complete and was
+ written by this version of the shell.
+
+ @param RestartFileName Pointer to the name of the snapshot file.
+
+ @return Pointer to the snapshot, which the caller should free with
+         YoriLibFree, or NULL if the snapshot could not be loaded or is not
+         valid.
+ */
+PYORI_SH_RESTART_HEADER
+YoriShLoadRestartSnapshot(
+    __in PYORI_STRING RestartFileName
+    )
+{
+    PYORI_SH_RESTART_HEADER Header;
+    HANDLE hFile;
+    DWORD FileSize;
+    DWORD FileSizeHigh;
+    DWORD BytesRead;
+    DWORD Checksum;
+
+    hFile = CreateFile(RestartFileName->StartOfString,
+                       GENERIC_READ,
+                       FILE_SHARE_READ | FILE_SHARE_DELETE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                       NULL);
+
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    FileSize = GetFileSize(hFile, &FileSizeHigh);
+    if (FileSize == INVALID_FILE_SIZE ||
+        FileSizeHigh != 0 ||
+        FileSize < sizeof(YORI_SH_RESTART_HEADER) ||
+        FileSize > YORI_SH_RESTART_MAX_SIZE) {
+
+        CloseHandle(hFile);
+        return NULL;
+    }
+
+    Header = YoriLibMalloc(FileSize);
+    if (Header == NULL) {
+        CloseHandle(hFile);
+        return NULL;
+    }
+
+    if (!ReadFile(hFile, Header, FileSize, &BytesRead, NULL) ||
+        BytesRead != FileSize) {
+
+        YoriLibFree(Header);
+        CloseHandle(hFile);
+        return NULL;
+    }
+
+    CloseHandle(hFile);
+
+    if (Header->Signature != YORI_SH_RESTART_SIGNATURE ||
+        Header->Version != YORI_SH_RESTART_VERSION ||
+        Header->HeaderSize != sizeof(YORI_SH_RESTART_HEADER) ||
+        Header->FileSize != FileSize) {
+
+        YoriLibFree(Header);
+        return NULL;
+    }
+
+    Checksum = Header->Checksum;
+    Header->Checksum = 0;
+    if (YoriShRestartChecksum((PUCHAR)Header, FileSize) != Checksum) {
+        YoriLibFree(Header);
+        return NULL;
+    }
+    Header->Checksum = Checksum;
+
+    return Header;
+}
+
+
+/**
+ Try to recover a previous process ID that terminated unexpectedly from the
+ .ini format used by earlier versions of the shell.  This allows state saved
+ by an earlier version to be recovered once by the current version.
 
  @param ProcessId Pointer to the process ID to try to recover.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
-YoriShLoadSavedRestartState(
+YoriShLoadLegacyRestartState(
     __in PYORI_STRING ProcessId
     )
 {
@@ -466,13 +1020,6 @@ YoriShLoadSavedRestartState(
     DWORD Count;
     YORI_CONSOLE_FONT_INFOEX FontInfo;
 
-    if (DllKernel32.pSetConsoleScreenBufferInfoEx == NULL ||
-        DllKernel32.pSetCurrentConsoleFontEx == NULL) {
-
-        return FALSE;
-    }
-
-
     if (!YoriShGetTempPath(&RestartFileName, sizeof("\\yori-restart-.ini") + 2 * sizeof(DWORD))) {
         return FALSE;
     }
@@ -675,12 +1222,13 @@ YoriShLoadSavedRestartState(
                 if (ThisValue) {
                     ThisValue[0] = '\0';
                     ThisValue++;
-                    ValueLength = _tcslen(ThisValue);
+                    ValueLength = (DWORD)_tcslen(ThisValue);
                     if (YoriLibAllocateString(&ThisEntry, ValueLength + 1)) {
                         memcpy(ThisEntry.StartOfString, ThisValue, (ValueLength + 1) * sizeof(TCHAR));
                         ThisEntry.LengthInChars = ValueLength;
 
                         YoriShAddToHistory(&ThisEntry, FALSE);
+                        YoriLibFreeStringContents(&ThisEntry);
                     }
                 }
             }
@@ -727,6 +1275,223 @@ YoriShLoadSavedRestartState(
     return TRUE;
 }
 
+
+/**
+ Try to recover a previous process ID that terminated unexpectedly.
+
+ @param ProcessId Pointer to the process ID to try to recover.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+YoriShLoadSavedRestartState(
+    __in PYORI_STRING ProcessId
+    )
+{
+    YORI_STRING RestartFileName;
+    YORI_CONSOLE_SCREEN_BUFFER_INFOEX ScreenBufferInfo;
+    YORI_CONSOLE_FONT_INFOEX FontInfo;
+    PYORI_SH_RESTART_HEADER Header;
+    PYORI_SH_RESTART_SECTION Section;
+    LPTSTR ThisPair;
+    LPTSTR ThisVar;
+    LPTSTR ThisValue;
+    LPTSTR String;
+
+    if (DllKernel32.pSetConsoleScreenBufferInfoEx == NULL ||
+        DllKernel32.pSetCurrentConsoleFontEx == NULL) {
+
+        return FALSE;
+    }
+
+    if (!YoriShGetTempPath(&RestartFileName, sizeof("\\yori-restart-.dat") + 2 * sizeof(DWORD))) {
+        return FALSE;
+    }
+
+    YoriLibSPrintf(RestartFileName.StartOfString + RestartFileName.LengthInChars,
+                   _T("\\yori-restart-%y.dat"),
+                   ProcessId);
+
+    Header = YoriShLoadRestartSnapshot(&RestartFileName);
+    YoriLibFreeStringContents(&RestartFileName);
+    if (Header == NULL) {
+        return YoriShLoadLegacyRestartState(ProcessId);
+    }
+
+    //
+    //  Populate window settings
+    //
+
+    if (Header->BufferWidth == 0 || Header->BufferHeight == 0 ||
+        Header->WindowWidth == 0 || Header->WindowHeight == 0) {
+
+        YoriLibFree(Header);
+        return FALSE;
+    }
+
+    ZeroMemory(&ScreenBufferInfo, sizeof(ScreenBufferInfo));
+    ScreenBufferInfo.cbSize = sizeof(ScreenBufferInfo);
+
+    ScreenBufferInfo.dwSize.X = Header->BufferWidth;
+    ScreenBufferInfo.dwSize.Y = Header->BufferHeight;
+    ScreenBufferInfo.dwMaximumWindowSize.X = Header->WindowWidth;
+    ScreenBufferInfo.dwMaximumWindowSize.Y = Header->WindowHeight;
+
+    ScreenBufferInfo.srWindow.Bottom = (USHORT)(ScreenBufferInfo.dwMaximumWindowSize.Y - 1);
+    ScreenBufferInfo.srWindow.Right = (USHORT)(ScreenBufferInfo.dwMaximumWindowSize.X);
+
+    ScreenBufferInfo.wAttributes = Header->DefaultColor;
+    ScreenBufferInfo.wPopupAttributes = Header->PopupColor;
+    memcpy(ScreenBufferInfo.ColorTable, Header->ColorTable, sizeof(ScreenBufferInfo.ColorTable));
+
+    YoriLibVtSetDefaultColor(ScreenBufferInfo.wAttributes);
+
+    //
+    //  Populate window fonts
+    //
+
+    ZeroMemory(&FontInfo, sizeof(FontInfo));
+    FontInfo.cbSize = sizeof(FontInfo);
+    FontInfo.nFont = Header->FontIndex;
+    FontInfo.dwFontSize.X = Header->FontWidth;
+    FontInfo.dwFontSize.Y = Header->FontHeight;
+    FontInfo.FontFamily = Header->FontFamily;
+    FontInfo.FontWeight = Header->FontWeight;
+    String = YoriShGetRestartStringSection(Header, YoriShRestartSectionFontName, FALSE);
+    if (String != NULL) {
+        YoriLibSPrintfS(FontInfo.FaceName, sizeof(FontInfo.FaceName)/sizeof(FontInfo.FaceName[0]), _T("%s"), String);
+    }
+
+    if (FontInfo.dwFontSize.X > 0 && FontInfo.dwFontSize.Y > 0 && FontInfo.FontWeight > 0) {
+        DllKernel32.pSetCurrentConsoleFontEx(GetStdHandle(STD_OUTPUT_HANDLE), FALSE, &FontInfo);
+    }
+
+    DllKernel32.pSetConsoleScreenBufferInfoEx(GetStdHandle(STD_OUTPUT_HANDLE), &ScreenBufferInfo);
+
+    //
+    //  Populate the window title
+    //
+
+    String = YoriShGetRestartStringSection(Header, YoriShRestartSectionTitle, FALSE);
+    if (String != NULL) {
+        SetConsoleTitle(String);
+    } else {
+        SetConsoleTitle(_T("Yori"));
+    }
+
+    //
+    //  Populate the current directory
+    //
+
+    String = YoriShGetRestartStringSection(Header, YoriShRestartSectionCurrentDirectory, FALSE);
+    if (String != NULL && String[0] != '\0') {
+        SetCurrentDirectory(String);
+    }
+
+    //
+    //  Populate the environment, including current directories on other
+    //  drives.  Other variables starting with = are maintained by the
+    //  system and are not restored.
+    //
+
+    String = YoriShGetRestartStringSection(Header, YoriShRestartSectionEnvironment, TRUE);
+    if (String != NULL) {
+        ThisPair = String;
+        while (*ThisPair != '\0') {
+            ThisVar = ThisPair;
+            ThisPair += _tcslen(ThisPair) + 1;
+            if (ThisVar[0] != '=') {
+                ThisValue = _tcschr(ThisVar, '=');
+                if (ThisValue) {
+                    ThisValue[0] = '\0';
+                    ThisValue++;
+
+                    SetEnvironmentVariable(ThisVar, ThisValue);
+                }
+            } else if (((ThisVar[1] >= 'A' && ThisVar[1] <= 'Z') ||
+                        (ThisVar[1] >= 'a' && ThisVar[1] <= 'z')) &&
+                       ThisVar[2] == ':' &&
+                       ThisVar[3] == '=') {
+
+                ThisValue = &ThisVar[3];
+                ThisValue[0] = '\0';
+                ThisValue++;
+
+                SetEnvironmentVariable(ThisVar, ThisValue);
+            }
+        }
+    }
+
+    //
+    //  Populate aliases
+    //
+
+    String = YoriShGetRestartStringSection(Header, YoriShRestartSectionAliases, TRUE);
+    if (String != NULL) {
+        ThisPair = String;
+        while (*ThisPair != '\0') {
+            ThisVar = ThisPair;
+            ThisPair += _tcslen(ThisPair) + 1;
+            if (ThisVar[0] != '=') {
+                ThisValue = _tcschr(ThisVar, '=');
+                if (ThisValue) {
+                    ThisValue[0] = '\0';
+                    ThisValue++;
+
+                    YoriShAddAliasLiteral(ThisVar, ThisValue, FALSE);
+                }
+            }
+        }
+    }
+
+    //
+    //  Populate history
+    //
+
+    String = YoriShGetRestartStringSection(Header, YoriShRestartSectionHistory, TRUE);
+    if (String != NULL && String[0] != '\0') {
+        YORI_STRING ThisEntry;
+        DWORD ValueLength;
+
+        YoriShInitHistory();
+
+        ThisValue = String;
+        while (*ThisValue != '\0') {
+            ValueLength = (DWORD)_tcslen(ThisValue);
+            if (YoriLibAllocateString(&ThisEntry, ValueLength + 1)) {
+                memcpy(ThisEntry.StartOfString, ThisValue, (ValueLength + 1) * sizeof(TCHAR));
+                ThisEntry.LengthInChars = ValueLength;
+
+                YoriShAddToHistory(&ThisEntry, FALSE);
+                YoriLibFreeStringContents(&ThisEntry);
+            }
+            ThisValue += ValueLength + 1;
+        }
+    }
+
+    //
+    //  Populate window contents
+    //
+
+    Section = &Header->Sections[YoriShRestartSectionContents];
+    if (Header->ContentsWidth > 0 &&
+        Header->ContentsHeight > 0 &&
+        Section->Length == (DWORD)Header->ContentsWidth * Header->ContentsHeight * sizeof(CHAR_INFO) &&
+        (Section->Offset % sizeof(DWORD)) == 0 &&
+        Section->Offset >= Header->HeaderSize &&
+        Section->Offset <= Header->FileSize &&
+        Section->Length <= Header->FileSize - Section->Offset) {
+
+        YoriShDisplayRestartContents((PCHAR_INFO)((PUCHAR)Header + Section->Offset),
+                                     Header->ContentsWidth,
+                                     Header->ContentsHeight);
+    }
+
+    YoriLibFree(Header);
+
+    return TRUE;
+}
+
 /**
  Delete any restart information from disk.
 
@@ -740,6 +1505,8 @@ YoriShDiscardSavedRestartState(
     )
 {
     YORI_STRING RestartFileName;
+    LPCTSTR Extensions[] = {_T("dat"), _T("tmp"), _T("ini"), _T("txt")};
+    DWORD Index;
 
     if (YoriShGlobal.RestartSaveThread != NULL) {
         WaitForSingleObject(YoriShGlobal.RestartSaveThread, INFINITE);
@@ -747,33 +1514,31 @@ YoriShDiscardSavedRestartState(
         YoriShGlobal.RestartSaveThread = NULL;
     }
 
-    if (!YoriShGetTempPath(&RestartFileName, sizeof("\\yori-restart-.ini") + 2 * sizeof(DWORD))) {
+    if (!YoriShGetTempPath(&RestartFileName, sizeof("\\yori-restart-.dat") + 2 * sizeof(DWORD))) {
         return;
     }
 
-    if (ProcessId != NULL) {
-        YoriLibSPrintf(RestartFileName.StartOfString + RestartFileName.LengthInChars,
-                       _T("\\yori-restart-%y.ini"),
-                       ProcessId);
-    } else {
-        YoriLibSPrintf(RestartFileName.StartOfString + RestartFileName.LengthInChars,
-                       _T("\\yori-restart-%x.ini"),
-                       GetCurrentProcessId());
-    }
+    //
+    //  Remove the current snapshot along with any state left in the format
+    //  used by earlier versions.
+    //
 
-    DeleteFile(RestartFileName.StartOfString);
+    for (Index = 0; Index < sizeof(Extensions)/sizeof(Extensions[0]); Index++) {
+        if (ProcessId != NULL) {
+            YoriLibSPrintf(RestartFileName.StartOfString + RestartFileName.LengthInChars,
+                           _T("\\yori-restart-%y.%s"),
+                           ProcessId,
+                           Extensions[Index]);
+        } else {
+            YoriLibSPrintf(RestartFileName.StartOfString + RestartFileName.LengthInChars,
+                           _T("\\yori-restart-%x.%s"),
+                           GetCurrentProcessId(),
+                           Extensions[Index]);
+        }
 
-    if (ProcessId != NULL) {
-        YoriLibSPrintf(RestartFileName.StartOfString + RestartFileName.LengthInChars,
-                       _T("\\yori-restart-%y.txt"),
-                       ProcessId);
-    } else {
-        YoriLibSPrintf(RestartFileName.StartOfString + RestartFileName.LengthInChars,
-                       _T("\\yori-restart-%x.txt"),
-                       GetCurrentProcessId());
+        DeleteFile(RestartFileName.StartOfString);
     }
 
-    DeleteFile(RestartFileName.StartOfString);
     YoriLibFreeStringContents(&RestartFileName);
 }
 
@@ -344,6 +344,17 @@ YoriShSetEnvironmentStrings(
 
 // *** EXEC.C ***
 
+DWORD
+YoriShGetPipeBufferSize();
+
+__success(return)
+BOOL
+YoriShCreatePipe(
+    __out PHANDLE ReadHandle,
+    __out PHANDLE WriteHandle,
+    __in DWORD MinimumSize
+    );
+
 DWORD
 YoriShInitializeRedirection(
     __in PYORI_SH_SINGLE_EXEC_CONTEXT ExecContext,
@@ -513,6 +524,13 @@ YoriShGetJobInformation(
     __inout PYORI_STRING Command
     );
 
+__success(return)
+BOOL
+YoriShGetJobAccounting(
+    __in DWORD JobId,
+    __out PYORI_LIB_JOB_ACCOUNTING Accounting
+    );
+
 // *** MAIN.C ***
 
 VOID
@@ -629,6 +647,22 @@ YoriShFindBestBackquoteSubstringAtOffset(
     __out PYORI_STRING CurrentSubset
     );
 
+// *** PATHIDX.C ***
+
+VOID
+YoriShPathIndexRefresh();
+
+__success(return)
+BOOLEAN
+YoriShPathIndexFindExecutables(
+    __in PYORI_STRING Prefix,
+    __in PYORI_LIB_PATH_MATCH_FN MatchCallback,
+    __in PVOID MatchContext
+    );
+
+VOID
+YoriShPathIndexCleanup();
+
 // *** PROMPT.C ***
 BOOL
 YoriShDisplayPrompt();
@@ -709,6 +709,37 @@ typedef struct _YORI_SH_INPUT_BUFFER {
      */
     YORI_STRING SearchString;
 
+    /**
+     A copy of the input string as it was after the most recent move to the
+     previous or next argument.  While the input string still matches and
+     the cursor has not moved, repeated moves can use the argument offsets
+     below rather than parsing the string again.
+     */
+    YORI_STRING ArgMapString;
+
+    /**
+     Pointer to an array of offsets within @ref ArgMapString of the beginning
+     of each argument.  This is allocated as part of @ref ArgMapString.
+     */
+    PDWORD ArgMapOffsets;
+
+    /**
+     The number of elements in @ref ArgMapOffsets.
+     */
+    DWORD ArgMapCount;
+
+    /**
+     The argument that the cursor was moved to, or @ref ArgMapCount if the
+     cursor was moved to the end of the string.
+     */
+    DWORD ArgMapCurrentArg;
+
+    /**
+     The cursor offset after the most recent move to the previous or next
+     argument.
+     */
+    DWORD ArgMapCursorOffset;
+
 } YORI_SH_INPUT_BUFFER, *PYORI_SH_INPUT_BUFFER;
 
 /**
@@ -879,6 +910,19 @@ typedef struct _YORI_SH_GLOBALS {
      */
     DWORD InputParamsGeneration;
 
+    /**
+     The size of the buffer to request when creating pipes between
+     processes, in bytes.  Zero if it has not been loaded from the
+     environment yet.
+     */
+    DWORD PipeBufferSize;
+
+    /**
+     The generation of the environment last time the pipe buffer size was
+     refreshed.
+     */
+    DWORD PipeBufferSizeGeneration;
+
     /**
      A handle to a thread which is saving restart state.  Note that this may
      be NULL if no thread has been created or if it has completed.
@@ -408,6 +408,8 @@ ENTRYPOINT(
 
 #if YORI_BUILTIN
     YoriLibCancelEnable();
+#else
+    YoriLibEnableFileMapping();
 #endif
 
     //
@@ -403,6 +403,8 @@ ENTRYPOINT(
 
 #if YORI_BUILTIN
     YoriLibCancelEnable();
+#else
+    YoriLibEnableFileMapping();
 #endif
 
     //